@@ -84,6 +84,9 @@ copy /Y "%BUILD_DIR_X86%\bin\EspeakSAPI.dll" "%OUTPUT_DIR%\x86\"
 echo Copying x86 Configurator...
 copy /Y "%BUILD_DIR_X86%\bin\EspeakSAPIConfig.exe" "%OUTPUT_DIR%\x86\"
 
+echo Copying x86 synthesis worker...
+copy /Y "%BUILD_DIR_X86%\bin\EspeakSAPIWorker.exe" "%OUTPUT_DIR%\x86\"
+
 echo Copying x86 espeak-ng DLL...
 copy /Y "%BUILD_DIR_X86%\bin\espeak-ng.dll" "%OUTPUT_DIR%\x86\"
 
@@ -93,6 +96,9 @@ copy /Y "%BUILD_DIR_X64%\bin\EspeakSAPI.dll" "%OUTPUT_DIR%\x64\"
 echo Copying x64 Configurator...
 copy /Y "%BUILD_DIR_X64%\bin\EspeakSAPIConfig.exe" "%OUTPUT_DIR%\x64\"
 
+echo Copying x64 synthesis worker...
+copy /Y "%BUILD_DIR_X64%\bin\EspeakSAPIWorker.exe" "%OUTPUT_DIR%\x64\"
+
 echo Copying x64 espeak-ng DLL...
 copy /Y "%BUILD_DIR_X64%\bin\espeak-ng.dll" "%OUTPUT_DIR%\x64\"
 
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include "IEnumSpObjectTokensImpl.hpp"
 #include "espeak_wrapper.h"
+#include "voice_catalog.hpp"
 #include "config_manager.hpp"
 #include "voice_utils.hpp"
 #include "error_handler.hpp"
@@ -13,6 +14,7 @@ namespace sapi {
 
 IEnumSpObjectTokensImpl::IEnumSpObjectTokensImpl(bool initialize)
     : index_(0)
+    , voices_(std::make_shared<voice_list>())
 {
     if (!initialize) {
         return;
@@ -25,60 +27,71 @@ IEnumSpObjectTokensImpl::IEnumSpObjectTokensImpl(bool initialize)
     DEBUG_LOG("IEnumSpObjectTokensImpl: Loading config (default_only=%d, enabled_voices=%zu, profiles=%zu)",
               cfg.default_only, cfg.enabled_voices.size(), cfg.voice_profiles.size());
 
-    EspeakEngine& engine = EspeakEngine::getInstance();
-    if (engine.initialize()) {
-        std::vector<VoiceInfo> espeak_voices = engine.getVoices();
+    const std::vector<CatalogVoice> espeak_voices = VoiceCatalog::getInstance().voices(
+        [](const VoiceInfo& voice) {
+            return voice_attributes::resolve_language_id(cleanLanguageString(voice.languages));
+        });
 
-        if (cfg.default_only) {
-            for (const auto& voice : espeak_voices) {
-                std::string voice_id = extractBaseVoiceName(voice.identifier, voice.name);
+    if (cfg.default_only) {
+        for (const auto& voice : espeak_voices) {
+            std::string voice_id = extractBaseVoiceName(voice.voice.identifier, voice.voice.name);
 
-                if (voice_id == "en" || voice_id == "en-us") {
-                    addVoice(voice, cfg.global_variant);
-                    DEBUG_LOG("IEnumSpObjectTokensImpl: Added default voice '%s'", voice_id.c_str());
-                    break;
-                }
+            if (voice_id == "en" || voice_id == "en-us") {
+                addVoice(voice, cfg.global_variant);
+                DEBUG_LOG("IEnumSpObjectTokensImpl: Added default voice '%s'", voice_id.c_str());
+                break;
             }
-        } else {
-            for (const auto& voice : espeak_voices) {
-                std::string voice_id = extractBaseVoiceName(voice.identifier, voice.name);
+        }
+    } else {
+        for (const auto& voice : espeak_voices) {
+            std::string voice_id = extractBaseVoiceName(voice.voice.identifier, voice.voice.name);
 
-                if (isVoiceEnabled(voice_id, cfg.enabled_voices)) {
-                    addVoice(voice, cfg.global_variant);
-                    DEBUG_LOG("IEnumSpObjectTokensImpl: Added enabled voice '%s'", voice_id.c_str());
-                }
+            if (isVoiceEnabled(voice_id, cfg.enabled_voices)) {
+                addVoice(voice, cfg.global_variant);
+                DEBUG_LOG("IEnumSpObjectTokensImpl: Added enabled voice '%s'", voice_id.c_str());
             }
         }
+    }
 
-        for (const auto& profile : cfg.voice_profiles) {
-            if (profile.enabled) {
-                for (const auto& voice : espeak_voices) {
-                    std::string voice_id = extractBaseVoiceName(voice.identifier, voice.name);
-
-                    if (voice_id == profile.base_voice) {
-                        addVoiceProfile(voice, profile.name, profile.variant, profile.id);
-                        DEBUG_LOG("IEnumSpObjectTokensImpl: Added voice profile '%s' (%s+%s)",
-                                  profile.name.c_str(), profile.base_voice.c_str(), profile.variant.c_str());
-                        break;
-                    }
+    for (const auto& profile : cfg.voice_profiles) {
+        if (profile.enabled) {
+            for (const auto& voice : espeak_voices) {
+                std::string voice_id = extractBaseVoiceName(voice.voice.identifier, voice.voice.name);
+
+                if (voice_id == profile.base_voice) {
+                    addVoiceProfile(voice, profile.name, profile.variant, profile.id);
+                    DEBUG_LOG("IEnumSpObjectTokensImpl: Added voice profile '%s' (%s+%s)",
+                              profile.name.c_str(), profile.base_voice.c_str(), profile.variant.c_str());
+                    break;
                 }
             }
         }
     }
 
-    if (sapi_voices_.empty()) {
+    if (voices_->attributes.empty()) {
         DEBUG_LOG("IEnumSpObjectTokensImpl: No voices configured, adding fallback 'en' voice");
-        sapi_voices_.emplace_back("en", "en", false, 0, "en");
+        voices_->attributes.emplace_back("en", "en", false, 0, "en");
     }
+    voices_->tokens.resize(voices_->attributes.size());
 
-    DEBUG_LOG("IEnumSpObjectTokensImpl: Total SAPI voices available: %zu", sapi_voices_.size());
+    DEBUG_LOG("IEnumSpObjectTokensImpl: Total SAPI voices available: %zu", voices_->attributes.size());
+}
+
+IEnumSpObjectTokensImpl::ISpObjectTokenPtr IEnumSpObjectTokensImpl::get_token(std::size_t index) const
+{
+    std::lock_guard<std::mutex> lock(voices_->mutex);
+    ISpObjectTokenPtr& token = voices_->tokens[index];
+    if (!token) {
+        token = create_token(voices_->attributes[index]);
+    }
+    return token;
 }
 
-IEnumSpObjectTokensImpl::ISpObjectTokenPtr IEnumSpObjectTokensImpl::create_token(
-    const voice_attributes& attr) const
+IEnumSpObjectTokensImpl::ISpObjectTokenPtr IEnumSpObjectTokensImpl::create_token(const voice_attributes& attr)
 {
-    std::wstring token_id = std::wstring(SPCAT_VOICES) + L"\\TokenEnums\\eSpeak-NG\\" + attr.get_name();
-    com::object<voice_token> obj_data_key(attr);
+    const std::shared_ptr<const voice_token_data> data = voice_token::data_for(attr);
+    std::wstring token_id = std::wstring(SPCAT_VOICES) + L"\\TokenEnums\\eSpeak-NG\\" + data->name;
+    com::object<voice_token> obj_data_key(data);
     com::interface_ptr<ISpDataKey> int_data_key(obj_data_key);
 
     ISpObjectTokenInitPtr int_token_init(CLSID_SpObjectToken);
@@ -114,11 +127,11 @@ STDMETHODIMP IEnumSpObjectTokensImpl::Next(ULONG celt, ISpObjectToken** pelt, UL
         std::vector<ISpObjectTokenPtr> tokens;
         tokens.reserve(celt);
 
-        const std::size_t max_index = sapi_voices_.size();
+        const std::size_t max_index = voices_->attributes.size();
         const std::size_t next_index = (std::min)(index_ + static_cast<std::size_t>(celt), max_index);
 
         for (std::size_t i = index_; i < next_index; ++i) {
-            tokens.push_back(create_token(sapi_voices_[i]));
+            tokens.push_back(get_token(i));
         }
 
         for (std::size_t i = 0; i < tokens.size(); ++i) {
@@ -137,7 +150,7 @@ STDMETHODIMP IEnumSpObjectTokensImpl::Next(ULONG celt, ISpObjectToken** pelt, UL
 
 STDMETHODIMP IEnumSpObjectTokensImpl::Skip(ULONG celt)
 {
-    const std::size_t remaining = sapi_voices_.size() - index_;
+    const std::size_t remaining = voices_->attributes.size() - index_;
     const std::size_t num_skipped = (std::min)(remaining, static_cast<std::size_t>(celt));
     index_ += num_skipped;
     return (num_skipped == celt) ? S_OK : S_FALSE;
@@ -154,7 +167,7 @@ STDMETHODIMP IEnumSpObjectTokensImpl::GetCount(ULONG* pulCount)
     if (!pulCount) {
         return E_POINTER;
     }
-    *pulCount = static_cast<ULONG>(sapi_voices_.size());
+    *pulCount = static_cast<ULONG>(voices_->attributes.size());
     return S_OK;
 }
 
@@ -166,11 +179,11 @@ STDMETHODIMP IEnumSpObjectTokensImpl::Item(ULONG Index, ISpObjectToken** ppToken
         }
         *ppToken = nullptr;
 
-        if (Index >= sapi_voices_.size()) {
+        if (Index >= voices_->attributes.size()) {
             return SPERR_NO_MORE_ITEMS;
         }
 
-        ISpObjectTokenPtr int_token = create_token(sapi_voices_[Index]);
+        ISpObjectTokenPtr int_token = get_token(Index);
         int_token.AddRef();
         *ppToken = int_token.GetInterfacePtr();
         return S_OK;
@@ -186,7 +199,7 @@ STDMETHODIMP IEnumSpObjectTokensImpl::Clone(IEnumSpObjectTokens** ppEnum)
         *ppEnum = nullptr;
 
         com::object<IEnumSpObjectTokensImpl> obj(false);
-        obj->sapi_voices_ = sapi_voices_;
+        obj->voices_ = voices_;
         obj->index_ = index_;
         com::interface_ptr<IEnumSpObjectTokens> int_ptr(obj);
         *ppEnum = int_ptr.get();
@@ -194,8 +207,9 @@ STDMETHODIMP IEnumSpObjectTokensImpl::Clone(IEnumSpObjectTokens** ppEnum)
     }, "IEnumSpObjectTokens::Clone");
 }
 
-void IEnumSpObjectTokensImpl::addVoice(const ::Espeak::VoiceInfo& voice, const std::string& global_variant)
+void IEnumSpObjectTokensImpl::addVoice(const ::Espeak::CatalogVoice& entry, const std::string& global_variant)
 {
+    const ::Espeak::VoiceInfo& voice = entry.voice;
     bool is_female = isGenderFemale(voice.gender);
     std::string display_name = voice.name.empty() ? voice.identifier : voice.name;
 
@@ -208,12 +222,13 @@ void IEnumSpObjectTokensImpl::addVoice(const ::Espeak::VoiceInfo& voice, const s
 
     std::string clean_languages = cleanLanguageString(voice.languages);
 
-    sapi_voices_.emplace_back(display_name, clean_languages, is_female, voice.age, voice_id);
+    voices_->attributes.emplace_back(display_name, clean_languages, is_female, voice.age, voice_id, entry.language_id);
 }
 
-void IEnumSpObjectTokensImpl::addVoiceProfile(const ::Espeak::VoiceInfo& base_voice, const std::string& profile_name,
+void IEnumSpObjectTokensImpl::addVoiceProfile(const ::Espeak::CatalogVoice& entry, const std::string& profile_name,
                                                const std::string& variant, const std::string& profile_id)
 {
+    const ::Espeak::VoiceInfo& base_voice = entry.voice;
     bool is_female = isGenderFemale(base_voice.gender);
 
     std::string voice_id = extractBaseVoiceName(base_voice.identifier, base_voice.name);
@@ -224,7 +239,7 @@ void IEnumSpObjectTokensImpl::addVoiceProfile(const ::Espeak::VoiceInfo& base_vo
 
     std::string clean_languages = cleanLanguageString(base_voice.languages);
 
-    sapi_voices_.emplace_back(profile_name, clean_languages, is_female, base_voice.age, voice_id);
+    voices_->attributes.emplace_back(profile_name, clean_languages, is_female, base_voice.age, voice_id, entry.language_id);
 }
 
 bool IEnumSpObjectTokensImpl::isVoiceEnabled(std::string_view voice_id,
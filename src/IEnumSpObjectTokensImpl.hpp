@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+#include <mutex>
 #include <vector>
 #include <string_view>
 #include <windows.h>
@@ -13,6 +15,7 @@
 #include "voice_attributes.hpp"
 #include "voice_token.hpp"
 #include "espeak_wrapper.h"
+#include "voice_catalog.hpp"
 
 namespace Espeak {
 namespace sapi {
@@ -43,15 +46,24 @@ private:
     _COM_SMARTPTR_TYPEDEF(ISpObjectToken, __uuidof(ISpObjectToken));
     _COM_SMARTPTR_TYPEDEF(ISpObjectTokenInit, __uuidof(ISpObjectTokenInit));
 
-    [[nodiscard]] ISpObjectTokenPtr create_token(const voice_attributes& attr) const;
+    struct voice_list
+    {
+        std::vector<voice_attributes> attributes;
+        std::mutex mutex;
+        std::vector<ISpObjectTokenPtr> tokens;
+    };
+
+    [[nodiscard]] ISpObjectTokenPtr get_token(std::size_t index) const;
+
+    [[nodiscard]] static ISpObjectTokenPtr create_token(const voice_attributes& attr);
 
-    void addVoice(const ::Espeak::VoiceInfo& voice, const std::string& global_variant);
-    void addVoiceProfile(const ::Espeak::VoiceInfo& base_voice, const std::string& profile_name,
+    void addVoice(const ::Espeak::CatalogVoice& entry, const std::string& global_variant);
+    void addVoiceProfile(const ::Espeak::CatalogVoice& entry, const std::string& profile_name,
                          const std::string& variant, const std::string& profile_id);
     bool isVoiceEnabled(std::string_view voice_id, const std::vector<std::string>& enabled_list) const;
 
     std::size_t index_;
-    std::vector<voice_attributes> sapi_voices_;
+    std::shared_ptr<voice_list> voices_;
 };
 }
 }
@@ -5,6 +5,21 @@
 namespace Espeak {
 namespace sapi {
 
+const ISpDataKeyImpl::value_map& ISpDataKeyImpl::values() const noexcept
+{
+    static const value_map empty;
+    return values_ ? *values_ : empty;
+}
+
+ISpDataKeyImpl::value_map& ISpDataKeyImpl::mutable_values()
+{
+    if (!owned_values_) {
+        owned_values_ = values_ ? std::make_shared<value_map>(*values_) : std::make_shared<value_map>();
+        values_ = owned_values_;
+    }
+    return *owned_values_;
+}
+
 STDMETHODIMP ISpDataKeyImpl::GetData(LPCWSTR /*pszValueName*/, ULONG* /*pcbData*/, BYTE* /*pData*/)
 {
     return SPERR_NOT_FOUND;
@@ -21,8 +36,8 @@ STDMETHODIMP ISpDataKeyImpl::GetStringValue(LPCWSTR pszValueName, LPWSTR* ppszVa
         if (!pszValueName || pszValueName[0] == L'\0') {
             *ppszValue = com::strdup(default_value_);
         } else {
-            auto it = values_.find(pszValueName);
-            if (it == values_.end()) {
+            auto it = values().find(pszValueName);
+            if (it == values().end()) {
                 return SPERR_NOT_FOUND;
             }
             *ppszValue = com::strdup(it->second);
@@ -49,7 +64,7 @@ STDMETHODIMP ISpDataKeyImpl::EnumKeys(ULONG /*Index*/, LPWSTR* /*ppszSubKeyName*
 STDMETHODIMP ISpDataKeyImpl::EnumValues(ULONG Index, LPWSTR* ppszValueName)
 {
     return com::safe_com_call([&]() -> HRESULT {
-        if (Index >= values_.size()) {
+        if (Index >= values().size()) {
             return SPERR_NO_MORE_ITEMS;
         }
         if (!ppszValueName) {
@@ -57,7 +72,7 @@ STDMETHODIMP ISpDataKeyImpl::EnumValues(ULONG Index, LPWSTR* ppszValueName)
         }
         *ppszValueName = nullptr;
 
-        auto it = values_.begin();
+        auto it = values().begin();
         std::advance(it, Index);
         *ppszValueName = com::strdup(it->first);
         return S_OK;
@@ -2,6 +2,7 @@
 
 #include <string>
 #include <map>
+#include <memory>
 #include <windows.h>
 #include <sapi.h>
 #include <sapiddk.h>
@@ -14,7 +15,23 @@ namespace sapi {
 
 class ISpDataKeyImpl : public ISpDataKey
 {
+protected:
+    struct str_less
+    {
+        [[nodiscard]] bool operator()(const std::wstring& s1, const std::wstring& s2) const noexcept
+        {
+            return _wcsicmp(s1.c_str(), s2.c_str()) < 0;
+        }
+    };
+
 public:
+    using value_map = std::map<std::wstring, std::wstring, str_less>;
+    using shared_values = std::shared_ptr<const value_map>;
+
+    ISpDataKeyImpl() = default;
+
+    explicit ISpDataKeyImpl(shared_values values) : values_(std::move(values)) {}
+
     STDMETHOD(GetData)(LPCWSTR pszValueName, ULONG* pcbData, BYTE* pData) override;
     STDMETHOD(GetStringValue)(LPCWSTR pszValueName, LPWSTR* ppszValue) override;
     STDMETHOD(GetDWORD)(LPCWSTR pszKeyName, DWORD* pdwValue) override;
@@ -31,7 +48,7 @@ public:
 
     void set(const std::wstring& name, const std::wstring& value)
     {
-        values_[name] = value;
+        mutable_values()[name] = value;
     }
 
     void set(const std::wstring& value)
@@ -40,24 +57,19 @@ public:
     }
 
 protected:
-    struct str_less
-    {
-        [[nodiscard]] bool operator()(const std::wstring& s1, const std::wstring& s2) const noexcept
-        {
-            return _wcsicmp(s1.c_str(), s2.c_str()) < 0;
-        }
-    };
-
     [[nodiscard]] void* get_interface(REFIID riid) noexcept
     {
         return com::try_primary_interface<ISpDataKey>(this, riid);
     }
 
 private:
-    using value_map = std::map<std::wstring, std::wstring, str_less>;
+    [[nodiscard]] const value_map& values() const noexcept;
+
+    [[nodiscard]] value_map& mutable_values();
 
     std::wstring default_value_;
-    value_map values_;
+    shared_values values_;
+    std::shared_ptr<value_map> owned_values_;
 };
 }
 }
@@ -1,9 +1,16 @@
+#include <atomic>
 #include <new>
 #include <string>
-#include <cmath>
-#include <algorithm>
+#include <vector>
+#include <cstdint>
+#include <ctime>
+#include <mutex>
 #include "utils.hpp"
 #include "ISpTTSEngineImpl.hpp"
+#include "speak_trace.hpp"
+#include "speak_timeline.hpp"
+#include "perf_counters.hpp"
+#include "engine_warmup.hpp"
 #include "config_manager.hpp"
 #include "error_handler.hpp"
 #include "debug_log.h"
@@ -14,92 +21,209 @@ namespace sapi {
 namespace {
 
 constexpr WORD AUDIO_CHANNELS = 1;
-constexpr DWORD AUDIO_SAMPLE_RATE = 22050;
 constexpr WORD AUDIO_BITS_PER_SAMPLE = 16;
+constexpr WORD FLOAT_BITS_PER_SAMPLE = 32;
 
-constexpr int MIN_RATE = -10;
-constexpr int MAX_RATE = 10;
-constexpr int RATE_TO_WPM_MULTIPLIER = 10;
+static_assert(SITE_ACTION_ABORT == SPVES_ABORT && SITE_ACTION_SKIP == SPVES_SKIP &&
+              SITE_ACTION_RATE == SPVES_RATE && SITE_ACTION_VOLUME == SPVES_VOLUME,
+              "site actions mirror SPVESACTIONS");
 
-constexpr int BASE_PITCH = 50;
-constexpr int PITCH_ADJ_MULTIPLIER = 2;
-constexpr int MIN_PITCH_ADJ = -50;
-constexpr int MAX_PITCH_ADJ = 50;
-
-constexpr int MIN_VOLUME = 0;
-constexpr int MAX_VOLUME = 100;
+WORD bits_per_sample(const output_format& format) {
+    return format.sample_format == SampleFormat::Float32 ? FLOAT_BITS_PER_SAMPLE : AUDIO_BITS_PER_SAMPLE;
+}
 
-struct SpeakContext {
-    ISpTTSEngineSite* caller = nullptr;
-    ULONGLONG bytes_written = 0;
-    bool aborted = false;
-};
+bool parse_wave_format(const WAVEFORMATEX* wfx, output_format& format) {
+    if (!wfx) {
+        return false;
+    }
 
-inline bool checkAndHandleActionFlags(ISpTTSEngineSite* site, bool* aborted = nullptr) {
-    const DWORD actions = site->GetActions();
+    WORD tag = wfx->wFormatTag;
+    if (tag == WAVE_FORMAT_EXTENSIBLE) {
+        if (wfx->cbSize < sizeof(WAVEFORMATEXTENSIBLE) - sizeof(WAVEFORMATEX)) {
+            return false;
+        }
+        tag = static_cast<WORD>(reinterpret_cast<const WAVEFORMATEXTENSIBLE*>(wfx)->SubFormat.Data1);
+    }
 
-    if (actions & SPVES_ABORT) {
-        DEBUG_LOG("SAPI: ABORT requested");
-        if (aborted) *aborted = true;
+    if (tag == WAVE_FORMAT_PCM && wfx->wBitsPerSample == AUDIO_BITS_PER_SAMPLE) {
+        format.sample_format = SampleFormat::Pcm16;
+    } else if (tag == WAVE_FORMAT_IEEE_FLOAT && wfx->wBitsPerSample == FLOAT_BITS_PER_SAMPLE) {
+        format.sample_format = SampleFormat::Float32;
+    } else {
         return false;
     }
 
-    if (actions & SPVES_SKIP) {
-        DEBUG_LOG("SAPI: SKIP requested");
-        site->CompleteSkip(0);
-        if (aborted) *aborted = true;
+    if (wfx->nSamplesPerSec < static_cast<DWORD>(Resampler::MIN_RATE) ||
+        wfx->nSamplesPerSec > static_cast<DWORD>(Resampler::MAX_RATE)) {
         return false;
     }
-
+    format.sample_rate = wfx->nSamplesPerSec;
     return true;
 }
 
-bool speak_callback(const short* audio, int sample_count, void* user) {
-    auto* ctx = static_cast<SpeakContext*>(user);
-    if (!ctx || !ctx->caller) {
-        DEBUG_LOG("SAPI Callback: ERROR - No context or caller");
-        return false;
+fragment_kind kind_of(const SPVTEXTFRAG* frag) {
+    switch (frag->State.eAction) {
+        case SPVA_Speak:
+            return fragment_kind::speak;
+        case SPVA_SpellOut:
+            return fragment_kind::spell_out;
+        case SPVA_Silence:
+            return fragment_kind::silence;
+        case SPVA_Bookmark:
+            return fragment_kind::bookmark;
+        default:
+            return fragment_kind::ignored;
     }
+}
 
-    if (!checkAndHandleActionFlags(ctx->caller, &ctx->aborted)) {
-        return false;
+speak_fragment to_speak_fragment(const SPVTEXTFRAG* frag) {
+    static_assert(sizeof(WCHAR) == sizeof(char16_t), "SAPI text is UTF-16");
+    speak_fragment fragment;
+    fragment.kind = kind_of(frag);
+    if (frag->pTextStart && frag->ulTextLen > 0) {
+        fragment.text = std::u16string_view(reinterpret_cast<const char16_t*>(frag->pTextStart), frag->ulTextLen);
     }
+    fragment.source_offset = frag->ulTextSrcOffset;
+    fragment.rate_adj = frag->State.RateAdj;
+    fragment.pitch_adj = frag->State.PitchAdj.MiddleAdj;
+    fragment.volume = frag->State.Volume;
+    fragment.emphasis = frag->State.EmphAdj;
+    fragment.silence_ms = frag->State.SilenceMSecs;
+    return fragment;
+}
 
-    DEBUG_LOG("SAPI Callback: Writing %d samples (%d bytes) to SAPI",
-              sample_count, sample_count * 2);
-
-    auto ptr = reinterpret_cast<const BYTE*>(audio);
-    ULONG remaining = static_cast<ULONG>(sample_count * sizeof(short));
+// Forwards a synthesis run to the SAPI output site.
+class site_adapter : public speak_site
+{
+public:
+    explicit site_adapter(ISpTTSEngineSite* site) : site_(site) {}
 
-    while (remaining > 0) {
-        if (!checkAndHandleActionFlags(ctx->caller, &ctx->aborted)) {
-            return false;
-        }
+    unsigned actions() override
+    {
+        return static_cast<unsigned>(site_->GetActions());
+    }
 
-        ULONG written = remaining;
-        HRESULT hr = ctx->caller->Write(ptr, remaining, &written);
+    bool write(const void* data, std::size_t size, std::size_t& written) override
+    {
+        ULONG count = static_cast<ULONG>(size);
+        const HRESULT hr = site_->Write(data, count, &count);
         if (FAILED(hr)) {
-            DEBUG_LOG("SAPI Callback: Write FAILED with HRESULT 0x%08X", hr);
+            LOG_ERROR("SAPI Write: FAILED with HRESULT 0x%08X", hr);
             return false;
         }
-        if (written > remaining) {
-            DEBUG_LOG("SAPI Callback: Write error - written (%lu) > remaining (%lu)",
-                      written, remaining);
-            return false;
+        written = count;
+        note_cold_start(PerfStage::FirstAudio);
+        return true;
+    }
+
+    void add_events(const site_event* events, std::size_t count) override
+    {
+        events_.clear();
+        for (std::size_t i = 0; i < count; ++i) {
+            const site_event& event = events[i];
+            SPEVENT sp = {};
+            sp.ullAudioStreamOffset = event.offset;
+            sp.ulStreamNum = 0;
+            switch (event.type) {
+                case site_event_type::word_boundary:
+                case site_event_type::sentence_boundary:
+                    sp.eEventId = event.type == site_event_type::word_boundary ? SPEI_WORD_BOUNDARY : SPEI_SENTENCE_BOUNDARY;
+                    sp.elParamType = SPET_LPARAM_IS_UNDEFINED;
+                    sp.wParam = static_cast<WPARAM>(event.source_length);
+                    sp.lParam = static_cast<LPARAM>(event.source_start);
+                    break;
+                case site_event_type::bookmark:
+                    sp.eEventId = SPEI_TTS_BOOKMARK;
+                    sp.elParamType = event.bookmark ? SPET_LPARAM_IS_STRING : SPET_LPARAM_IS_UNDEFINED;
+                    sp.wParam = static_cast<WPARAM>(event.bookmark_id);
+                    sp.lParam = reinterpret_cast<LPARAM>(reinterpret_cast<const WCHAR*>(event.bookmark));
+                    break;
+            }
+            events_.push_back(sp);
         }
-        ctx->bytes_written += written;
-        remaining -= written;
-        ptr += written;
+        [[maybe_unused]] HRESULT hr = site_->AddEvents(events_.data(), static_cast<ULONG>(events_.size()));
+        DEBUG_LOG("SAPI Event: AddEvents result 0x%08X", hr);
     }
 
-    DEBUG_LOG("SAPI Callback: Successfully wrote %d samples", sample_count);
-    return true;
+    long rate() override
+    {
+        long rate = 0;
+        site_->GetRate(&rate);
+        return rate;
+    }
+
+    unsigned short volume() override
+    {
+        unsigned short volume = 100;
+        site_->GetVolume(&volume);
+        return volume;
+    }
+
+    void complete_skip() override
+    {
+        site_->CompleteSkip(0);
+    }
+
+private:
+    ISpTTSEngineSite* site_;
+    std::vector<SPEVENT> events_;
+};
+
+// Opened on the first traced call; one file per process under the config directory.
+trace_writer* speak_trace_writer()
+{
+    static trace_writer writer;
+    static std::once_flag opened;
+    std::call_once(opened, [] {
+        const utils::fs::path config_dir = utils::getEspeakConfigDir();
+        if (config_dir.empty()) {
+            return;
+        }
+        const utils::fs::path dir = config_dir / "traces";
+        std::error_code ec;
+        utils::fs::create_directories(dir, ec);
+        const utils::fs::path path = dir / ("speak-" + std::to_string(std::time(nullptr)) + "-" +
+                                            std::to_string(GetCurrentProcessId()) + ".trace");
+        if (!writer.open(path)) {
+            LOG_WARN("Speak trace: Failed to open %S", path.c_str());
+        }
+    });
+    return writer.is_open() ? &writer : nullptr;
+}
+
+// Serves "EspeakPerfViewer --timeline" once the Speak call that saw it is done,
+// so the dump includes that call.
+void dump_requested_timeline()
+{
+    static std::atomic<std::uint32_t> served{0};
+    const std::uint32_t requests = PerfCounters::local().timelineRequests();
+    if (requests == served.load(std::memory_order_relaxed) || served.exchange(requests) == requests) {
+        return;
+    }
+    Timeline& timeline = Timeline::instance();
+    if (!timeline.enabled()) {
+        LOG_WARN("Timeline: Dump requested but speak_timeline is off");
+        return;
+    }
+    const utils::fs::path config_dir = utils::getEspeakConfigDir();
+    if (config_dir.empty()) {
+        return;
+    }
+    const utils::fs::path dir = config_dir / "traces";
+    std::error_code ec;
+    utils::fs::create_directories(dir, ec);
+    timeline.dump(dir / ("timeline-" + std::to_string(std::time(nullptr)) + "-" +
+                         std::to_string(GetCurrentProcessId()) + ".json"));
 }
 }
 
 ISpTTSEngineImpl::ISpTTSEngineImpl()
 {
-    [[maybe_unused]] bool initialized = EspeakEngine::getInstance().initialize();
+    note_cold_start(PerfStage::EngineCreated);
+    init_pending_ = warmup_pending();
+    if (!init_pending_) {
+        [[maybe_unused]] bool initialized = EspeakEngine::getInstance().initialize();
+    }
 }
 
 STDMETHODIMP ISpTTSEngineImpl::SetObjectToken(ISpObjectToken* pToken)
@@ -132,14 +256,11 @@ STDMETHODIMP ISpTTSEngineImpl::SetObjectToken(ISpObjectToken* pToken)
             espeak_voice_id = utils::wstring_to_string(name.get());
         }
 
+        // The engine is shared between instances, so the voice is applied with each synthesis call.
         voice_name_ = espeak_voice_id;
         DEBUG_LOG("SetObjectToken: Display name = %S, Voice ID = %s",
                   name.get(), espeak_voice_id.c_str());
 
-        if (!EspeakEngine::getInstance().setVoice(espeak_voice_id)) {
-            DEBUG_LOG("SetObjectToken: WARNING - Failed to set voice, will use default");
-        }
-
         token_ = pToken;
         DEBUG_LOG("SetObjectToken: SUCCESS");
         return S_OK;
@@ -167,8 +288,8 @@ STDMETHODIMP ISpTTSEngineImpl::GetObjectToken(ISpObjectToken** ppToken)
 }
 
 STDMETHODIMP ISpTTSEngineImpl::GetOutputFormat(
-    const GUID* /*pTargetFmtId*/,
-    const WAVEFORMATEX* /*pTargetWaveFormatEx*/,
+    const GUID* pTargetFmtId,
+    const WAVEFORMATEX* pTargetWaveFormatEx,
     GUID* pOutputFormatId,
     WAVEFORMATEX** ppCoMemOutputWaveFormatEx)
 {
@@ -192,10 +313,20 @@ STDMETHODIMP ISpTTSEngineImpl::GetOutputFormat(
         return E_OUTOFMEMORY;
     }
 
-    pwfex->wFormatTag = WAVE_FORMAT_PCM;
+    output_format format = native_format();
+    output_format requested = format;
+    if (config::ConfigManager::getInstance().snapshot()->negotiate_output_format &&
+        pTargetFmtId && *pTargetFmtId == SPDFID_WaveFormatEx &&
+        parse_wave_format(pTargetWaveFormatEx, requested)) {
+        format = requested;
+        DEBUG_LOG("GetOutputFormat: Using requested format (%u Hz, %s)", format.sample_rate,
+                  format.sample_format == SampleFormat::Float32 ? "float" : "pcm16");
+    }
+
+    pwfex->wFormatTag = format.sample_format == SampleFormat::Float32 ? WAVE_FORMAT_IEEE_FLOAT : WAVE_FORMAT_PCM;
     pwfex->nChannels = AUDIO_CHANNELS;
-    pwfex->nSamplesPerSec = AUDIO_SAMPLE_RATE;
-    pwfex->wBitsPerSample = AUDIO_BITS_PER_SAMPLE;
+    pwfex->nSamplesPerSec = format.sample_rate;
+    pwfex->wBitsPerSample = bits_per_sample(format);
     pwfex->nBlockAlign = pwfex->nChannels * pwfex->wBitsPerSample / 8;
     pwfex->nAvgBytesPerSec = pwfex->nSamplesPerSec * pwfex->nBlockAlign;
     pwfex->cbSize = 0;
@@ -208,15 +339,16 @@ STDMETHODIMP ISpTTSEngineImpl::GetOutputFormat(
 
 STDMETHODIMP ISpTTSEngineImpl::Speak(
     DWORD dwSpeakFlags,
-    REFGUID /*rguidFormatId*/,
-    const WAVEFORMATEX* /*pWaveFormatEx*/,
+    REFGUID rguidFormatId,
+    const WAVEFORMATEX* pWaveFormatEx,
     const SPVTEXTFRAG* pTextFragList,
     ISpTTSEngineSite* pOutputSite)
 {
     DEBUG_LOG("=== Speak Called ===");
     DEBUG_LOG("Speak Flags: 0x%08X", dwSpeakFlags);
 
-    return com::safe_com_call([&]() -> HRESULT {
+    const HRESULT hr = com::safe_com_call([&]() -> HRESULT {
+        const TimelineSpan span("Speak");
         if (!pTextFragList) {
             DEBUG_LOG("Speak: ERROR - pTextFragList is NULL");
             return E_INVALIDARG;
@@ -225,222 +357,59 @@ STDMETHODIMP ISpTTSEngineImpl::Speak(
             DEBUG_LOG("Speak: ERROR - pOutputSite is NULL");
             return E_INVALIDARG;
         }
-        long sapi_rate = 0;
-        pOutputSite->GetRate(&sapi_rate);
+        note_cold_start(PerfStage::FirstSpeak);
 
-        unsigned short sapi_volume = 100;
-        pOutputSite->GetVolume(&sapi_volume);
+        if (init_pending_) {
+            wait_for_warmup();
+            init_pending_ = false;
+            [[maybe_unused]] bool initialized = EspeakEngine::getInstance().initialize();
+        }
 
-        DEBUG_LOG("=== New Speech Request ===");
-        DEBUG_LOG("Voice: %s", voice_name_.c_str());
-        DEBUG_LOG("SAPI Rate: %d, SAPI Volume: %u", (int)sapi_rate, sapi_volume);
+        speak_options options;
+        options.voice = voice_name_;
+        if (rguidFormatId != SPDFID_WaveFormatEx || !parse_wave_format(pWaveFormatEx, options.format)) {
+            options.format = native_format();
+        }
 
         ULONGLONG event_interest = 0;
         pOutputSite->GetEventInterest(&event_interest);
-        const bool send_sentence_events = (event_interest & (1ULL << SPEI_SENTENCE_BOUNDARY)) != 0;
-        const bool send_word_events = (event_interest & (1ULL << SPEI_WORD_BOUNDARY)) != 0;
-        DEBUG_LOG("Event interest: 0x%llX (sentence: %d, word: %d)",
-                  event_interest, send_sentence_events, send_word_events);
-
-        SpeakContext ctx;
-        ctx.caller = pOutputSite;
-        ctx.bytes_written = 0;
-        ctx.aborted = false;
-
-        [[maybe_unused]] int frag_count = 0;
-        for (const SPVTEXTFRAG* f = pTextFragList; f; f = f->pNext) {
-            frag_count++;
-        }
-        DEBUG_LOG("Fragment count: %d", frag_count);
-
-        [[maybe_unused]] int frag_num = 0;
-        for (const SPVTEXTFRAG* frag = pTextFragList; frag; frag = frag->pNext) {
-            frag_num++;
-            DEBUG_LOG("--- Processing Fragment %d/%d ---", frag_num, frag_count);
-
-            const DWORD actions = pOutputSite->GetActions();
-            DEBUG_LOG("Actions flags: 0x%08X (ABORT=%d, SKIP=%d, RATE=%d, VOLUME=%d)",
-                     actions,
-                     !!(actions & SPVES_ABORT),
-                     !!(actions & SPVES_SKIP),
-                     !!(actions & SPVES_RATE),
-                     !!(actions & SPVES_VOLUME));
-
-            if (!checkAndHandleActionFlags(pOutputSite)) {
-                break;
-            }
-
-            if (actions & SPVES_RATE) {
-                pOutputSite->GetRate(&sapi_rate);
-                DEBUG_LOG("  Rate updated via SPVES_RATE: %d", (int)sapi_rate);
-            }
-            if (actions & SPVES_VOLUME) {
-                pOutputSite->GetVolume(&sapi_volume);
-                DEBUG_LOG("  Volume updated via SPVES_VOLUME: %u", sapi_volume);
-            }
-
-            long current_rate = 0;
-            HRESULT hr_rate = pOutputSite->GetRate(&current_rate);
-            if (SUCCEEDED(hr_rate) && current_rate != sapi_rate) {
-                DEBUG_LOG("  Rate mismatch detected! Cached=%d, Current=%d - using current",
-                         (int)sapi_rate, (int)current_rate);
-                sapi_rate = current_rate;
-            }
-
-            DEBUG_LOG("Fragment eAction: %d (SPVA_Speak=0, SPVA_Silence=1, "
-                      "SPVA_Pronounce=2, SPVA_Bookmark=3, SPVA_SpellOut=4)",
-                      frag->State.eAction);
-            DEBUG_LOG("Fragment State: RateAdj=%d, Volume=%u, PitchAdj=%d",
-                     frag->State.RateAdj, frag->State.Volume, frag->State.PitchAdj.MiddleAdj);
-
-            if (frag->State.eAction == SPVA_Bookmark) {
-                DEBUG_LOG("Fragment is a BOOKMARK");
-                if (frag->ulTextLen > 0 && frag->pTextStart) {
-                    std::wstring bookmark_text(frag->pTextStart, frag->ulTextLen);
-                    DEBUG_LOG("Bookmark text: \"%S\"", bookmark_text.c_str());
-
-                    long bookmark_id = 0;
-                    try {
-                        bookmark_id = std::stol(bookmark_text);
-                    }
-                    catch (const std::invalid_argument&) {
-                        DEBUG_LOG("Bookmark: Invalid number format '%S', using 0", bookmark_text.c_str());
-                    }
-                    catch (const std::out_of_range&) {
-                        DEBUG_LOG("Bookmark: Number out of range '%S', using 0", bookmark_text.c_str());
-                    }
-
-                    SPEVENT event = {};
-                    event.eEventId = SPEI_TTS_BOOKMARK;
-                    event.elParamType = SPET_LPARAM_IS_STRING;
-                    event.ullAudioStreamOffset = ctx.bytes_written;
-                    event.ulStreamNum = 0;
-                    event.lParam = reinterpret_cast<LPARAM>(bookmark_text.c_str());
-                    event.wParam = bookmark_id;
-                    [[maybe_unused]] HRESULT hr = pOutputSite->AddEvents(&event, 1);
-                    DEBUG_LOG("SAPI Event: Bookmark at byte offset %llu, id=%ld - Result: 0x%08X",
-                              ctx.bytes_written, bookmark_id, hr);
-                } else {
-                    SPEVENT event = {};
-                    event.eEventId = SPEI_TTS_BOOKMARK;
-                    event.elParamType = SPET_LPARAM_IS_UNDEFINED;
-                    event.ullAudioStreamOffset = ctx.bytes_written;
-                    event.ulStreamNum = 0;
-                    event.lParam = 0;
-                    event.wParam = 0;
-                    [[maybe_unused]] HRESULT hr = pOutputSite->AddEvents(&event, 1);
-                    DEBUG_LOG("SAPI Event: Bookmark (empty) at byte offset %llu - Result: 0x%08X",
-                              ctx.bytes_written, hr);
-                }
-                continue;
-            }
-
-            if (frag->State.eAction != SPVA_Speak && frag->State.eAction != SPVA_SpellOut) {
-                DEBUG_LOG("Fragment skipped - not Speak or SpellOut action");
-                continue;
-            }
-
-            if (frag->ulTextLen == 0 || !frag->pTextStart) {
-                DEBUG_LOG("Fragment skipped - no text");
-                continue;
-            }
-
-            const std::string text = utils::wstring_to_string(frag->pTextStart, frag->ulTextLen);
-            DEBUG_LOG("Fragment text: \"%s\"", text.c_str());
-            if (text.empty()) {
-                DEBUG_LOG("Fragment skipped - empty after conversion");
-                continue;
-            }
-
-            if (send_sentence_events) {
-                SPEVENT event = {};
-                event.eEventId = SPEI_SENTENCE_BOUNDARY;
-                event.elParamType = SPET_LPARAM_IS_UNDEFINED;
-                event.ullAudioStreamOffset = ctx.bytes_written;
-                event.ulStreamNum = 0;
-                event.lParam = frag->ulTextSrcOffset;
-                event.wParam = frag->ulTextLen;
-                [[maybe_unused]] HRESULT hr = pOutputSite->AddEvents(&event, 1);
-                DEBUG_LOG("SAPI Event: Sentence boundary at byte offset %llu - Result: 0x%08X",
-                          ctx.bytes_written, hr);
-            }
-
-            if (send_word_events) {
-                const wchar_t* text_start = frag->pTextStart;
-                ULONG text_len = frag->ulTextLen;
-
-                bool in_word = false;
-                ULONG word_start = 0;
-
-                for (ULONG i = 0; i <= text_len; ++i) {
-                    bool is_word_char = (i < text_len) &&
-                                       (iswalnum(text_start[i]) || text_start[i] == L'\'' ||
-                                        text_start[i] == L'-');
-
-                    if (is_word_char && !in_word) {
-                        word_start = i;
-                        in_word = true;
-                    } else if (!is_word_char && in_word) {
-                        ULONG word_len = i - word_start;
-                        SPEVENT event = {};
-                        event.eEventId = SPEI_WORD_BOUNDARY;
-                        event.elParamType = SPET_LPARAM_IS_UNDEFINED;
-                        event.ullAudioStreamOffset = ctx.bytes_written;
-                        event.ulStreamNum = 0;
-                        event.lParam = frag->ulTextSrcOffset + word_start;
-                        event.wParam = word_len;
-                        [[maybe_unused]] HRESULT hr = pOutputSite->AddEvents(&event, 1);
-
-                        std::wstring word_text(text_start + word_start, word_len);
-                        DEBUG_LOG("SAPI Event: Word boundary \"%S\" at byte offset %llu - Result: 0x%08X",
-                                  word_text.c_str(), ctx.bytes_written, hr);
-
-                        in_word = false;
-                    }
-                }
-            }
-
-            int combined_rate = static_cast<int>(sapi_rate) + frag->State.RateAdj;
-            combined_rate = std::clamp(combined_rate, MIN_RATE, MAX_RATE);
-            int espeak_rate = combined_rate * RATE_TO_WPM_MULTIPLIER;
-
-            int pitch_adj = frag->State.PitchAdj.MiddleAdj;
-            int espeak_pitch = BASE_PITCH + std::clamp(pitch_adj * PITCH_ADJ_MULTIPLIER, MIN_PITCH_ADJ, MAX_PITCH_ADJ);
-
-            int volume_adj = (sapi_volume - MAX_VOLUME) + (frag->State.Volume - MAX_VOLUME);
-            int espeak_volume = std::clamp(static_cast<int>(sapi_volume) + volume_adj, MIN_VOLUME, MAX_VOLUME);
-
-            config::ConfigManager& config_mgr = config::ConfigManager::getInstance();
-            config::Configuration cfg = config_mgr.getConfig();
-            int intonation = cfg.intonation;
-            int wordgap = cfg.wordgap;
-            bool rateboost = cfg.rateboost;
-
-            DEBUG_LOG("--- Parameters ---");
-            DEBUG_LOG("  Rate: SAPI=%d -> eSpeak-range=%d%s", combined_rate, espeak_rate, rateboost ? " (will boost x3 at WPM level)" : "");
-            DEBUG_LOG("  Pitch: SAPI=%d -> eSpeak=%d", pitch_adj, espeak_pitch);
-            DEBUG_LOG("  Volume: SAPI=%u -> eSpeak=%d", sapi_volume, espeak_volume);
-            DEBUG_LOG("  Intonation: %d", intonation);
-            DEBUG_LOG("  Word gap: %d", wordgap);
-
-            if (!EspeakEngine::getInstance().speak(text, espeak_rate, espeak_pitch, espeak_volume,
-                                                    intonation, wordgap, rateboost, speak_callback, &ctx)) {
-                if (ctx.aborted) {
-                    DEBUG_LOG("Speech aborted");
-                    break;
-                }
-                DEBUG_LOG("Speech failed");
-                return E_FAIL;
+        options.sentence_events = (event_interest & (1ULL << SPEI_SENTENCE_BOUNDARY)) != 0;
+        options.word_events = (event_interest & (1ULL << SPEI_WORD_BOUNDARY)) != 0;
+        DEBUG_LOG("Event interest: 0x%llX", event_interest);
+
+        options.config_generation = config::ConfigManager::getInstance().generation();
+        options.on_key_echo = start_character_prebuild;
+
+        std::vector<speak_fragment> frags;
+        {
+            const TimelineSpan text_span("text conversion");
+            for (const SPVTEXTFRAG* f = pTextFragList; f; f = f->pNext) {
+                frags.push_back(to_speak_fragment(f));
             }
+        }
 
-            if (ctx.aborted) {
-                break;
-            }
+        config::ConfigSnapshot snapshot;
+        {
+            const TimelineSpan config_span("config");
+            snapshot = config::ConfigManager::getInstance().snapshot();
+        }
+        Timeline::instance().enable(snapshot->speak_timeline);
+        site_adapter site(pOutputSite);
+        trace_writer* trace = snapshot->speak_trace ? speak_trace_writer() : nullptr;
+        if (!trace) {
+            return session_.speak(site, frags, options, *snapshot) ? S_OK : E_FAIL;
         }
 
-        DEBUG_LOG("=== Speak Completed Successfully ===");
-        return S_OK;
+        trace_call call = make_trace_call(frags, options);
+        call.start_ms = trace->elapsed_ms();
+        recording_site recorder(site, call);
+        const bool ok = session_.speak(recorder, frags, options, *snapshot);
+        recorder.finish();
+        trace->write(call);
+        return ok ? S_OK : E_FAIL;
     }, "ISpTTSEngine::Speak");
+    dump_requested_timeline();
+    return hr;
 }
 }
 }
@@ -5,10 +5,10 @@
 #include <sapiddk.h>
 #include <comdef.h>
 #include <comip.h>
-#include <memory>
 #include "com.hpp"
 #include "voice_attributes.hpp"
 #include "espeak_wrapper.h"
+#include "speak_session.hpp"
 
 namespace Espeak {
 namespace sapi {
@@ -44,6 +44,8 @@ private:
 
     ISpObjectTokenPtr token_;
     std::string voice_name_;
+    bool init_pending_ = false;
+    speak_session session_;
 };
 }
 }
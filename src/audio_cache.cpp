@@ -0,0 +1,439 @@
+#include "audio_cache.hpp"
+#include "debug_log.h"
+#include "utils.hpp"
+#include <fstream>
+#include <utility>
+
+namespace Espeak {
+
+namespace {
+
+constexpr char CACHE_FILE_NAME[] = "audio_cache.bin";
+constexpr std::uint32_t CACHE_MAGIC = 0x43415345;
+constexpr std::uint32_t CACHE_FORMAT_VERSION = 2;
+constexpr std::size_t SAVE_INTERVAL = 32;
+constexpr std::uint32_t MAX_SERIALIZED_SIZE = 16 * 1024 * 1024;
+
+void writeU32(std::ostream& out, std::uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeI32(std::ostream& out, std::int32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeString(std::ostream& out, const std::string& value) {
+    writeU32(out, static_cast<std::uint32_t>(value.size()));
+    out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+bool readU32(std::istream& in, std::uint32_t& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+bool readI32(std::istream& in, std::int32_t& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+bool readString(std::istream& in, std::string& value) {
+    std::uint32_t size = 0;
+    if (!readU32(in, size) || size > MAX_SERIALIZED_SIZE) {
+        return false;
+    }
+    value.resize(size);
+    return size == 0 || static_cast<bool>(in.read(value.data(), size));
+}
+
+#ifdef _WIN32
+struct SaveThreadArgs {
+    AudioCache* cache = nullptr;
+    HMODULE module = nullptr;
+};
+#endif
+}
+
+AudioCache::AudioCache()
+    : max_bytes_(0)
+    , bytes_(0)
+    , persist_(false)
+    , loaded_(false)
+    , unsaved_(0)
+    , saving_(false)
+    , hits_(0)
+    , misses_(0)
+{
+}
+
+AudioCache::~AudioCache() {
+#ifdef _WIN32
+    // A background save holds a module reference, so the DLL only detaches at
+    // process exit, when that thread is already gone and may have died holding
+    // save_mutex_.
+    if (!save_mutex_.try_lock()) {
+        return;
+    }
+    save_mutex_.unlock();
+#else
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        saved_cv_.wait(lock, [this]() { return !saving_; });
+    }
+    if (save_thread_.joinable()) {
+        save_thread_.join();
+    }
+#endif
+    bool pending = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pending = persist_ && unsaved_ > 0;
+    }
+    if (pending) {
+        writeSnapshot();
+    }
+}
+
+void AudioCache::configure(std::size_t max_bytes, bool persist, std::string_view data_version) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (data_version_ != data_version) {
+        data_version_ = std::string(data_version);
+        lru_.clear();
+        index_.clear();
+        bytes_ = 0;
+        loaded_ = false;
+    }
+
+    max_bytes_ = max_bytes;
+    persist_ = persist && max_bytes > 0;
+    evictLocked();
+
+    if (persist_ && !loaded_) {
+        loaded_ = true;
+        loadLocked();
+    }
+}
+
+bool AudioCache::enabled() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_bytes_ > 0;
+}
+
+std::string AudioCache::makeKey(const AudioCacheKey& params, std::string_view text) {
+    std::string key;
+    key.reserve(params.voice.size() + text.size() + 48);
+    key += params.voice;
+    key += '\x1f';
+    key += std::to_string(params.rate);
+    key += ',';
+    key += std::to_string(params.pitch);
+    key += ',';
+    key += std::to_string(params.volume);
+    key += ',';
+    key += std::to_string(params.intonation);
+    key += ',';
+    key += std::to_string(params.wordgap);
+    key += ',';
+    key += params.rateboost ? '1' : '0';
+    if (!params.processing.empty()) {
+        key += ',';
+        key += params.processing;
+    }
+    key += '\x1f';
+    // The exact text: cached events carry positions into it.
+    key += text;
+    return key;
+}
+
+std::shared_ptr<const CachedAudio> AudioCache::lookup(const std::string& key) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    lru_.splice(lru_.begin(), lru_, it->second);
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return it->second->audio;
+}
+
+void AudioCache::insert(const std::string& key, CachedAudio audio) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (max_bytes_ == 0) {
+        return;
+    }
+
+    const std::size_t size = entrySize(key, audio);
+    if (size > max_bytes_) {
+        return;
+    }
+
+    auto it = index_.find(key);
+    if (it != index_.end()) {
+        bytes_ -= it->second->bytes;
+        lru_.erase(it->second);
+        index_.erase(it);
+    }
+
+    lru_.push_front(Entry{key, std::make_shared<const CachedAudio>(std::move(audio)), size});
+    index_[key] = lru_.begin();
+    bytes_ += size;
+    evictLocked();
+
+    if (persist_ && ++unsaved_ >= SAVE_INTERVAL && !saving_) {
+        saving_ = true;
+        lock.unlock();
+        startSave();
+    }
+}
+
+void AudioCache::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    lru_.clear();
+    index_.clear();
+    bytes_ = 0;
+}
+
+bool AudioCache::save() {
+    return writeSnapshot();
+}
+
+AudioCache::Stats AudioCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Stats s;
+    s.hits = hits_.load(std::memory_order_relaxed);
+    s.misses = misses_.load(std::memory_order_relaxed);
+    s.entries = lru_.size();
+    s.bytes = bytes_;
+    return s;
+}
+
+std::size_t AudioCache::entrySize(const std::string& key, const CachedAudio& audio) noexcept {
+    std::size_t size = sizeof(Entry) + key.size() + audio.samples.size() * sizeof(short);
+    for (const auto& event : audio.events) {
+        size += sizeof(SynthEvent) + event.name.size();
+    }
+    return size;
+}
+
+std::filesystem::path AudioCache::cachePath() {
+    utils::fs::path dir = utils::getEspeakConfigDir();
+    if (dir.empty()) {
+        return {};
+    }
+    return dir / CACHE_FILE_NAME;
+}
+
+void AudioCache::evictLocked() {
+    while (bytes_ > max_bytes_ && !lru_.empty()) {
+        const Entry& victim = lru_.back();
+        bytes_ -= victim.bytes;
+        index_.erase(victim.key);
+        lru_.pop_back();
+    }
+}
+
+bool AudioCache::loadLocked() {
+    const utils::fs::path path = cachePath();
+    std::error_code ec;
+    if (path.empty() || !utils::fs::exists(path, ec)) {
+        return false;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        DEBUG_LOG("AudioCache: Failed to open %S", path.c_str());
+        return false;
+    }
+
+    std::uint32_t magic = 0;
+    std::uint32_t format = 0;
+    std::string version;
+    std::uint32_t count = 0;
+    if (!readU32(file, magic) || magic != CACHE_MAGIC ||
+        !readU32(file, format) || format != CACHE_FORMAT_VERSION ||
+        !readString(file, version) || version != data_version_ ||
+        !readU32(file, count)) {
+        DEBUG_LOG("AudioCache: Ignoring stale or invalid cache file");
+        return false;
+    }
+
+    std::vector<Entry> loaded;
+    for (std::uint32_t i = 0; i < count; ++i) {
+        Entry entry;
+        CachedAudio audio;
+        std::uint32_t sample_count = 0;
+        if (!readString(file, entry.key) || !readU32(file, sample_count) ||
+            sample_count > MAX_SERIALIZED_SIZE) {
+            return false;
+        }
+        audio.samples.resize(sample_count);
+        if (sample_count > 0 &&
+            !file.read(reinterpret_cast<char*>(audio.samples.data()), sample_count * sizeof(short))) {
+            return false;
+        }
+
+        std::uint32_t event_count = 0;
+        if (!readU32(file, event_count) || event_count > MAX_SERIALIZED_SIZE) {
+            return false;
+        }
+        audio.events.resize(event_count);
+        for (auto& event : audio.events) {
+            std::int32_t type = 0;
+            if (!readI32(file, type) || !readI32(file, event.text_position) ||
+                !readI32(file, event.length) || !readI32(file, event.sample) ||
+                !readI32(file, event.number) || !readString(file, event.name)) {
+                return false;
+            }
+            event.type = static_cast<SynthEventType>(type);
+        }
+        entry.bytes = entrySize(entry.key, audio);
+        entry.audio = std::make_shared<const CachedAudio>(std::move(audio));
+        loaded.push_back(std::move(entry));
+    }
+
+    for (auto it = loaded.rbegin(); it != loaded.rend(); ++it) {
+        if (index_.count(it->key) > 0) {
+            continue;
+        }
+        bytes_ += it->bytes;
+        lru_.push_front(std::move(*it));
+        index_[lru_.front().key] = lru_.begin();
+    }
+    evictLocked();
+
+    DEBUG_LOG("AudioCache: Loaded %zu entries (%zu bytes) from disk", lru_.size(), bytes_);
+    return true;
+}
+
+void AudioCache::startSave() {
+#ifdef _WIN32
+    // The thread holds its own reference so the DLL cannot be unloaded under it.
+    auto args = std::make_unique<SaveThreadArgs>();
+    args->cache = this;
+    if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                           reinterpret_cast<LPCWSTR>(&AudioCache::saveThreadMain), &args->module)) {
+        const HMODULE module = args->module;
+        HANDLE thread = CreateThread(nullptr, 0, saveThreadMain, args.get(), 0, nullptr);
+        if (thread) {
+            args.release();
+            CloseHandle(thread);
+            return;
+        }
+        FreeLibrary(module);
+    }
+#else
+    if (save_thread_.joinable()) {
+        save_thread_.join();
+    }
+    try {
+        save_thread_ = std::thread([this]() { runSave(); });
+        return;
+    }
+    catch (...) {
+    }
+#endif
+    LOG_WARN("AudioCache: Failed to start a background save");
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        saving_ = false;
+    }
+    saved_cv_.notify_all();
+}
+
+#ifdef _WIN32
+DWORD WINAPI AudioCache::saveThreadMain(void* param) {
+    std::unique_ptr<SaveThreadArgs> args(static_cast<SaveThreadArgs*>(param));
+    const HMODULE module = args->module;
+    args->cache->runSave();
+    args.reset();
+    FreeLibraryAndExitThread(module, 0);
+}
+#endif
+
+void AudioCache::runSave() noexcept {
+    try {
+        writeSnapshot();
+    }
+    catch (...) {
+        LOG_WARN("AudioCache: Background save failed");
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        saving_ = false;
+    }
+    saved_cv_.notify_all();
+}
+
+// Copies the entry list under the cache lock and writes it without holding
+// that lock, so lookups and inserts carry on during the file I/O.
+bool AudioCache::writeSnapshot() {
+    std::lock_guard<std::mutex> save_lock(save_mutex_);
+
+    std::string data_version;
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!persist_) {
+            return false;
+        }
+        data_version = data_version_;
+        entries.assign(lru_.begin(), lru_.end());
+        unsaved_ = 0;
+    }
+
+    const utils::fs::path path = cachePath();
+    if (path.empty()) {
+        return false;
+    }
+
+    std::error_code ec;
+    utils::fs::create_directories(path.parent_path(), ec);
+
+    const utils::fs::path tmp_path = utils::uniqueTempPath(path);
+
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_WARN("AudioCache: Failed to open %S for writing", tmp_path.c_str());
+            return false;
+        }
+
+        writeU32(file, CACHE_MAGIC);
+        writeU32(file, CACHE_FORMAT_VERSION);
+        writeString(file, data_version);
+        writeU32(file, static_cast<std::uint32_t>(entries.size()));
+        for (const auto& entry : entries) {
+            writeString(file, entry.key);
+            const CachedAudio& audio = *entry.audio;
+            writeU32(file, static_cast<std::uint32_t>(audio.samples.size()));
+            file.write(reinterpret_cast<const char*>(audio.samples.data()),
+                       static_cast<std::streamsize>(audio.samples.size() * sizeof(short)));
+            writeU32(file, static_cast<std::uint32_t>(audio.events.size()));
+            for (const auto& event : audio.events) {
+                writeI32(file, static_cast<std::int32_t>(event.type));
+                writeI32(file, event.text_position);
+                writeI32(file, event.length);
+                writeI32(file, event.sample);
+                writeI32(file, event.number);
+                writeString(file, event.name);
+            }
+        }
+
+        if (!file) {
+            LOG_WARN("AudioCache: Failed to write cache file");
+            return false;
+        }
+    }
+
+    utils::fs::rename(tmp_path, path, ec);
+    if (ec) {
+        LOG_WARN("AudioCache: Failed to replace cache file: %s", ec.message().c_str());
+        utils::fs::remove(tmp_path, ec);
+        return false;
+    }
+
+    DEBUG_LOG("AudioCache: Saved %zu entries", entries.size());
+    return true;
+}
+}
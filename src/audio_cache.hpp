@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <thread>
+#endif
+
+namespace Espeak {
+
+enum class SynthEventType : std::int32_t {
+    Word = 1,
+    Sentence = 2,
+    Mark = 3
+};
+
+struct SynthEvent {
+    SynthEventType type;
+    int text_position;
+    int length;
+    int sample;
+    int number;
+    std::string name;
+};
+
+struct CachedAudio {
+    std::vector<short> samples;
+    std::vector<SynthEvent> events;
+};
+
+struct AudioCacheKey {
+    std::string voice;
+    int rate;
+    int pitch;
+    int volume;
+    int intonation;
+    int wordgap;
+    bool rateboost;
+    std::string processing;
+};
+
+class AudioCache {
+public:
+    struct Stats {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::size_t entries;
+        std::size_t bytes;
+    };
+
+    static constexpr std::size_t MAX_TEXT_LENGTH = 256;
+
+    AudioCache();
+    ~AudioCache();
+
+    AudioCache(const AudioCache&) = delete;
+    AudioCache& operator=(const AudioCache&) = delete;
+
+    void configure(std::size_t max_bytes, bool persist, std::string_view data_version);
+
+    [[nodiscard]] bool enabled() const noexcept;
+
+    [[nodiscard]] static std::string makeKey(const AudioCacheKey& params, std::string_view text);
+
+    [[nodiscard]] std::shared_ptr<const CachedAudio> lookup(const std::string& key);
+
+    void insert(const std::string& key, CachedAudio audio);
+
+    void clear();
+
+    // Writes the cache file on the calling thread. insert() only schedules
+    // background saves, so the synthesis path never waits on disk.
+    [[nodiscard]] bool save();
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    struct Entry {
+        std::string key;
+        std::shared_ptr<const CachedAudio> audio;
+        std::size_t bytes;
+    };
+
+    [[nodiscard]] static std::size_t entrySize(const std::string& key, const CachedAudio& audio) noexcept;
+
+    [[nodiscard]] static std::filesystem::path cachePath();
+
+    void evictLocked();
+
+    bool loadLocked();
+
+    void startSave();
+
+    void runSave() noexcept;
+
+    bool writeSnapshot();
+
+#ifdef _WIN32
+    static DWORD WINAPI saveThreadMain(void* param);
+#endif
+
+    mutable std::mutex mutex_;
+    std::mutex save_mutex_;
+    std::condition_variable saved_cv_;
+    std::list<Entry> lru_;
+    std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+    std::size_t max_bytes_;
+    std::size_t bytes_;
+    bool persist_;
+    bool loaded_;
+    std::size_t unsaved_;
+    bool saving_;
+    std::string data_version_;
+    std::atomic<std::uint64_t> hits_;
+    std::atomic<std::uint64_t> misses_;
+#ifndef _WIN32
+    std::thread save_thread_;
+#endif
+};
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <atomic>
+
+namespace Espeak {
+
+class CancelToken {
+public:
+    void cancel() noexcept { cancelled_.store(true, std::memory_order_release); }
+
+    void reset() noexcept { cancelled_.store(false, std::memory_order_release); }
+
+    [[nodiscard]] bool cancelled() const noexcept { return cancelled_.load(std::memory_order_acquire); }
+
+private:
+    std::atomic<bool> cancelled_{false};
+};
+}
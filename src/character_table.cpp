@@ -0,0 +1,149 @@
+#include "character_table.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace Espeak {
+
+namespace {
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool singleCodePoint(std::string_view text) noexcept {
+    const unsigned char lead = static_cast<unsigned char>(text[0]);
+    const std::size_t length = lead < 0x80 ? 1 : lead < 0xE0 ? 2 : lead < 0xF0 ? 3 : 4;
+    return text.size() == length;
+}
+
+std::size_t entrySize(const std::string& key, const CachedAudio& audio) noexcept {
+    std::size_t size = key.size() + audio.samples.size() * sizeof(short);
+    for (const auto& event : audio.events) {
+        size += sizeof(SynthEvent) + event.name.size();
+    }
+    return size;
+}
+}
+
+CharacterTable::CharacterTable()
+    : max_bytes_(0)
+    , bytes_(0)
+    , generation_(0)
+    , use_clock_(0)
+    , hits_(0)
+    , misses_(0)
+{
+}
+
+void CharacterTable::configure(std::size_t max_bytes, std::uint64_t generation) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (generation != generation_) {
+        generation_ = generation;
+        sets_.clear();
+        bytes_ = 0;
+    }
+    max_bytes_ = max_bytes;
+    evictLocked({});
+}
+
+bool CharacterTable::enabled() const noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return max_bytes_ > 0;
+}
+
+bool CharacterTable::eligible(std::string_view text) noexcept {
+    if (text.empty() || text.size() > MAX_TOKEN_LENGTH) {
+        return false;
+    }
+    return singleCodePoint(text) || std::none_of(text.begin(), text.end(), isSpace);
+}
+
+std::string CharacterTable::entryKey(std::string_view token, bool spelled) {
+    std::string key;
+    key.reserve(token.size() + 1);
+    key.push_back(spelled ? 's' : 'p');
+    key.append(token);
+    return key;
+}
+
+std::shared_ptr<const CachedAudio> CharacterTable::lookup(const std::string& set, std::string_view token,
+                                                          bool spelled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto set_it = sets_.find(set);
+    if (set_it != sets_.end()) {
+        set_it->second.last_used = ++use_clock_;
+        auto it = set_it->second.entries.find(entryKey(token, spelled));
+        if (it != set_it->second.entries.end()) {
+            hits_.fetch_add(1, std::memory_order_relaxed);
+            return it->second;
+        }
+    }
+    misses_.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+}
+
+bool CharacterTable::contains(const std::string& set, std::string_view token, bool spelled) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto set_it = sets_.find(set);
+    return set_it != sets_.end() && set_it->second.entries.count(entryKey(token, spelled)) != 0;
+}
+
+void CharacterTable::insert(const std::string& set, std::string_view token, bool spelled, CachedAudio audio) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string key = entryKey(token, spelled);
+    const std::size_t size = entrySize(key, audio);
+    if (size > max_bytes_) {
+        return;
+    }
+
+    Set& target = sets_[set];
+    target.last_used = ++use_clock_;
+    auto [it, inserted] = target.entries.try_emplace(std::move(key));
+    if (!inserted) {
+        return;
+    }
+    it->second = std::make_shared<const CachedAudio>(std::move(audio));
+    target.bytes += size;
+    bytes_ += size;
+    evictLocked(set);
+
+    // The current set alone can outgrow a small cap; stop adding to it then.
+    if (bytes_ > max_bytes_) {
+        target.bytes -= size;
+        bytes_ -= size;
+        target.entries.erase(it);
+    }
+}
+
+void CharacterTable::clear() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    sets_.clear();
+    bytes_ = 0;
+}
+
+CharacterTable::Stats CharacterTable::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t entries = 0;
+    for (const auto& [name, set] : sets_) {
+        entries += set.entries.size();
+    }
+    return {hits_.load(std::memory_order_relaxed), misses_.load(std::memory_order_relaxed),
+            sets_.size(), entries, bytes_};
+}
+
+void CharacterTable::evictLocked(const std::string& keep) {
+    while (bytes_ > max_bytes_) {
+        auto victim = sets_.end();
+        for (auto it = sets_.begin(); it != sets_.end(); ++it) {
+            if (it->first != keep && (victim == sets_.end() || it->second.last_used < victim->second.last_used)) {
+                victim = it;
+            }
+        }
+        if (victim == sets_.end()) {
+            return;
+        }
+        bytes_ -= victim->second.bytes;
+        sets_.erase(victim);
+    }
+}
+}
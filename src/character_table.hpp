@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "audio_cache.hpp"
+
+namespace Espeak {
+
+// Synthesized audio for single characters and short tokens such as key and
+// symbol names, grouped into one set per voice and parameter combination.
+// Unlike the audio cache it is not displaced by sentence traffic; when the
+// memory cap is reached whole sets are dropped, least recently used first.
+class CharacterTable {
+public:
+    struct Stats {
+        std::uint64_t hits;
+        std::uint64_t misses;
+        std::size_t sets;
+        std::size_t entries;
+        std::size_t bytes;
+    };
+
+    static constexpr std::size_t MAX_TOKEN_LENGTH = 16;
+
+    CharacterTable();
+
+    CharacterTable(const CharacterTable&) = delete;
+    CharacterTable& operator=(const CharacterTable&) = delete;
+
+    // A different generation drops every set, so the table follows
+    // configuration changes.
+    void configure(std::size_t max_bytes, std::uint64_t generation);
+
+    [[nodiscard]] bool enabled() const noexcept;
+
+    // One code point, or a short token without whitespace.
+    [[nodiscard]] static bool eligible(std::string_view text) noexcept;
+
+    [[nodiscard]] std::shared_ptr<const CachedAudio> lookup(const std::string& set, std::string_view token,
+                                                            bool spelled);
+
+    [[nodiscard]] bool contains(const std::string& set, std::string_view token, bool spelled) const;
+
+    void insert(const std::string& set, std::string_view token, bool spelled, CachedAudio audio);
+
+    void clear();
+
+    [[nodiscard]] Stats stats() const;
+
+private:
+    struct Set {
+        std::unordered_map<std::string, std::shared_ptr<const CachedAudio>> entries;
+        std::size_t bytes = 0;
+        std::uint64_t last_used = 0;
+    };
+
+    [[nodiscard]] static std::string entryKey(std::string_view token, bool spelled);
+
+    void evictLocked(const std::string& keep);
+
+    mutable std::mutex mutex_;
+    std::unordered_map<std::string, Set> sets_;
+    std::size_t max_bytes_;
+    std::size_t bytes_;
+    std::uint64_t generation_;
+    std::uint64_t use_clock_;
+    std::atomic<std::uint64_t> hits_;
+    std::atomic<std::uint64_t> misses_;
+};
+}
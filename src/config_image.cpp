@@ -0,0 +1,208 @@
+#include "config_image.hpp"
+#include <cstring>
+
+namespace Espeak {
+namespace config {
+
+namespace {
+
+class ImageWriter {
+public:
+    explicit ImageWriter(std::vector<std::uint8_t>& out) : out_(out) { out_.clear(); }
+
+    void putU32(std::uint32_t value) {
+        putRaw(&value, sizeof(value));
+    }
+
+    void putU64(std::uint64_t value) {
+        putRaw(&value, sizeof(value));
+    }
+
+    void putI32(int value) {
+        const std::int32_t fixed = value;
+        putRaw(&fixed, sizeof(fixed));
+    }
+
+    void putBool(bool value) {
+        out_.push_back(value ? 1 : 0);
+    }
+
+    void putString(const std::string& value) {
+        putU32(static_cast<std::uint32_t>(value.size()));
+        putRaw(value.data(), value.size());
+    }
+
+private:
+    void putRaw(const void* data, std::size_t size) {
+        const auto* bytes = static_cast<const std::uint8_t*>(data);
+        out_.insert(out_.end(), bytes, bytes + size);
+    }
+
+    std::vector<std::uint8_t>& out_;
+};
+
+class ImageReader {
+public:
+    ImageReader(const std::uint8_t* data, std::size_t size) : data_(data), size_(size), offset_(0) {}
+
+    [[nodiscard]] bool getU32(std::uint32_t& value) {
+        return getRaw(&value, sizeof(value));
+    }
+
+    [[nodiscard]] bool getU64(std::uint64_t& value) {
+        return getRaw(&value, sizeof(value));
+    }
+
+    [[nodiscard]] bool getI32(int& value) {
+        std::int32_t fixed = 0;
+        if (!getRaw(&fixed, sizeof(fixed))) {
+            return false;
+        }
+        value = fixed;
+        return true;
+    }
+
+    [[nodiscard]] bool getBool(bool& value) {
+        std::uint8_t byte = 0;
+        if (!getRaw(&byte, sizeof(byte))) {
+            return false;
+        }
+        value = byte != 0;
+        return true;
+    }
+
+    [[nodiscard]] bool getString(std::string& value) {
+        std::uint32_t length = 0;
+        if (!getU32(length) || length > size_ - offset_) {
+            return false;
+        }
+        value.assign(reinterpret_cast<const char*>(data_ + offset_), length);
+        offset_ += length;
+        return true;
+    }
+
+    [[nodiscard]] bool atEnd() const noexcept { return offset_ == size_; }
+
+private:
+    [[nodiscard]] bool getRaw(void* out, std::size_t size) {
+        if (size > size_ - offset_) {
+            return false;
+        }
+        std::memcpy(out, data_ + offset_, size);
+        offset_ += size;
+        return true;
+    }
+
+    const std::uint8_t* data_;
+    std::size_t size_;
+    std::size_t offset_;
+};
+}
+
+void encodeConfigImage(const Configuration& config, std::uint64_t source_stamp, std::vector<std::uint8_t>& out) {
+    ImageWriter writer(out);
+    writer.putU32(CONFIG_IMAGE_MAGIC);
+    writer.putU32(CONFIG_IMAGE_VERSION);
+    writer.putU64(source_stamp);
+
+    writer.putString(config.version);
+    writer.putBool(config.default_only);
+    writer.putU32(static_cast<std::uint32_t>(config.enabled_voices.size()));
+    for (const auto& voice : config.enabled_voices) {
+        writer.putString(voice);
+    }
+
+    writer.putString(config.global_variant);
+    writer.putI32(config.intonation);
+    writer.putI32(config.wordgap);
+    writer.putBool(config.rateboost);
+
+    writer.putU32(static_cast<std::uint32_t>(config.voice_profiles.size()));
+    for (const auto& profile : config.voice_profiles) {
+        writer.putString(profile.id);
+        writer.putString(profile.name);
+        writer.putString(profile.base_voice);
+        writer.putString(profile.variant);
+        writer.putBool(profile.enabled);
+    }
+
+    writer.putI32(config.write_buffer_ms);
+    writer.putI32(config.write_latency_ms);
+    writer.putI32(config.lookahead_fragments);
+    writer.putI32(config.audio_cache_mb);
+    writer.putBool(config.audio_cache_persist);
+    writer.putI32(config.worker_processes);
+    writer.putBool(config.negotiate_output_format);
+    writer.putI32(config.chunk_first_chars);
+    writer.putI32(config.chunk_max_chars);
+    writer.putBool(config.merge_fragments);
+    writer.putI32(config.synth_buffer_ms);
+    writer.putBool(config.silence_trim);
+    writer.putI32(config.silence_threshold);
+    writer.putI32(config.silence_lookahead_ms);
+    writer.putI32(config.silence_max_gap_ms);
+    writer.putBool(config.warm_up);
+    writer.putBool(config.live_prosody);
+    writer.putI32(config.character_table_mb);
+    writer.putBool(config.speak_trace);
+    writer.putBool(config.speak_timeline);
+    writer.putString(config.log_level);
+}
+
+bool decodeConfigImage(const std::uint8_t* data, std::size_t size,
+                       Configuration& config, std::uint64_t& source_stamp) {
+    ImageReader reader(data, size);
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    if (!reader.getU32(magic) || magic != CONFIG_IMAGE_MAGIC ||
+        !reader.getU32(version) || version != CONFIG_IMAGE_VERSION ||
+        !reader.getU64(source_stamp)) {
+        return false;
+    }
+
+    Configuration decoded;
+    std::uint32_t count = 0;
+    if (!reader.getString(decoded.version) || !reader.getBool(decoded.default_only) || !reader.getU32(count)) {
+        return false;
+    }
+    for (std::uint32_t i = 0; i < count; ++i) {
+        std::string voice;
+        if (!reader.getString(voice)) {
+            return false;
+        }
+        decoded.enabled_voices.push_back(std::move(voice));
+    }
+
+    if (!reader.getString(decoded.global_variant) || !reader.getI32(decoded.intonation) ||
+        !reader.getI32(decoded.wordgap) || !reader.getBool(decoded.rateboost) || !reader.getU32(count)) {
+        return false;
+    }
+    for (std::uint32_t i = 0; i < count; ++i) {
+        VoiceProfile profile;
+        if (!reader.getString(profile.id) || !reader.getString(profile.name) ||
+            !reader.getString(profile.base_voice) || !reader.getString(profile.variant) ||
+            !reader.getBool(profile.enabled)) {
+            return false;
+        }
+        decoded.voice_profiles.push_back(std::move(profile));
+    }
+
+    if (!reader.getI32(decoded.write_buffer_ms) || !reader.getI32(decoded.write_latency_ms) ||
+        !reader.getI32(decoded.lookahead_fragments) || !reader.getI32(decoded.audio_cache_mb) ||
+        !reader.getBool(decoded.audio_cache_persist) || !reader.getI32(decoded.worker_processes) ||
+        !reader.getBool(decoded.negotiate_output_format) || !reader.getI32(decoded.chunk_first_chars) ||
+        !reader.getI32(decoded.chunk_max_chars) || !reader.getBool(decoded.merge_fragments) ||
+        !reader.getI32(decoded.synth_buffer_ms) || !reader.getBool(decoded.silence_trim) ||
+        !reader.getI32(decoded.silence_threshold) || !reader.getI32(decoded.silence_lookahead_ms) ||
+        !reader.getI32(decoded.silence_max_gap_ms) || !reader.getBool(decoded.warm_up) ||
+        !reader.getBool(decoded.live_prosody) || !reader.getI32(decoded.character_table_mb) ||
+        !reader.getBool(decoded.speak_trace) || !reader.getBool(decoded.speak_timeline) ||
+        !reader.getString(decoded.log_level) || !reader.atEnd()) {
+        return false;
+    }
+
+    config = std::move(decoded);
+    return true;
+}
+}
+}
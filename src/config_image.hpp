@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "config_types.hpp"
+
+namespace Espeak {
+namespace config {
+
+constexpr std::uint32_t CONFIG_IMAGE_MAGIC = 0x47464345;
+constexpr std::uint32_t CONFIG_IMAGE_VERSION = 10;
+
+void encodeConfigImage(const Configuration& config, std::uint64_t source_stamp, std::vector<std::uint8_t>& out);
+
+[[nodiscard]] bool decodeConfigImage(const std::uint8_t* data, std::size_t size,
+                                     Configuration& config, std::uint64_t& source_stamp);
+}
+}
@@ -1,8 +1,8 @@
 #include "config_manager.hpp"
+#include "config_image.hpp"
 #include "debug_log.h"
 #include "utils.hpp"
 #include <nlohmann/json.hpp>
-#include <windows.h>
 #include <fstream>
 #include <sstream>
 
@@ -55,20 +55,90 @@ void parseVoiceProfilesSection(const json& j, Configuration& config) {
     }
 }
 
+void parsePerformanceSection(const json& j, Configuration& config) {
+    if (j.contains("performance")) {
+        auto& perf = j["performance"];
+        config.write_buffer_ms = perf.value("write_buffer_ms", 100);
+        config.write_latency_ms = perf.value("write_latency_ms", 30);
+        config.lookahead_fragments = perf.value("lookahead_fragments", 2);
+        config.audio_cache_mb = perf.value("audio_cache_mb", 4);
+        config.audio_cache_persist = perf.value("audio_cache_persist", false);
+        config.worker_processes = perf.value("worker_processes", 0);
+        config.negotiate_output_format = perf.value("negotiate_output_format", true);
+        config.chunk_first_chars = perf.value("chunk_first_chars", 80);
+        config.chunk_max_chars = perf.value("chunk_max_chars", 400);
+        config.merge_fragments = perf.value("merge_fragments", true);
+        config.synth_buffer_ms = perf.value("synth_buffer_ms", 20);
+        config.silence_trim = perf.value("silence_trim", false);
+        config.silence_threshold = perf.value("silence_threshold", 64);
+        config.silence_lookahead_ms = perf.value("silence_lookahead_ms", 5);
+        config.silence_max_gap_ms = perf.value("silence_max_gap_ms", 300);
+        config.warm_up = perf.value("warm_up", false);
+        config.live_prosody = perf.value("live_prosody", true);
+        config.character_table_mb = perf.value("character_table_mb", 2);
+        config.speak_trace = perf.value("speak_trace", false);
+        config.speak_timeline = perf.value("speak_timeline", false);
+        config.log_level = perf.value("log_level", "off");
+    }
+}
+
 void clampConfigValues(Configuration& config) {
     if (config.intonation < limits::INTONATION_MIN) config.intonation = limits::INTONATION_MIN;
     if (config.intonation > limits::INTONATION_MAX) config.intonation = limits::INTONATION_MAX;
 
     if (config.wordgap < limits::WORDGAP_MIN) config.wordgap = limits::WORDGAP_MIN;
     if (config.wordgap > limits::WORDGAP_MAX) config.wordgap = limits::WORDGAP_MAX;
+
+    if (config.write_buffer_ms < limits::WRITE_BUFFER_MS_MIN) config.write_buffer_ms = limits::WRITE_BUFFER_MS_MIN;
+    if (config.write_buffer_ms > limits::WRITE_BUFFER_MS_MAX) config.write_buffer_ms = limits::WRITE_BUFFER_MS_MAX;
+
+    if (config.write_latency_ms < limits::WRITE_LATENCY_MS_MIN) config.write_latency_ms = limits::WRITE_LATENCY_MS_MIN;
+    if (config.write_latency_ms > limits::WRITE_LATENCY_MS_MAX) config.write_latency_ms = limits::WRITE_LATENCY_MS_MAX;
+
+    if (config.lookahead_fragments < limits::LOOKAHEAD_FRAGMENTS_MIN) config.lookahead_fragments = limits::LOOKAHEAD_FRAGMENTS_MIN;
+    if (config.lookahead_fragments > limits::LOOKAHEAD_FRAGMENTS_MAX) config.lookahead_fragments = limits::LOOKAHEAD_FRAGMENTS_MAX;
+
+    if (config.audio_cache_mb < limits::AUDIO_CACHE_MB_MIN) config.audio_cache_mb = limits::AUDIO_CACHE_MB_MIN;
+    if (config.audio_cache_mb > limits::AUDIO_CACHE_MB_MAX) config.audio_cache_mb = limits::AUDIO_CACHE_MB_MAX;
+
+    if (config.worker_processes < limits::WORKER_PROCESSES_MIN) config.worker_processes = limits::WORKER_PROCESSES_MIN;
+    if (config.worker_processes > limits::WORKER_PROCESSES_MAX) config.worker_processes = limits::WORKER_PROCESSES_MAX;
+
+    if (config.chunk_first_chars < limits::CHUNK_FIRST_CHARS_MIN) config.chunk_first_chars = limits::CHUNK_FIRST_CHARS_MIN;
+    if (config.chunk_first_chars > limits::CHUNK_FIRST_CHARS_MAX) config.chunk_first_chars = limits::CHUNK_FIRST_CHARS_MAX;
+
+    if (config.chunk_max_chars < limits::CHUNK_MAX_CHARS_MIN) config.chunk_max_chars = limits::CHUNK_MAX_CHARS_MIN;
+    if (config.chunk_max_chars > limits::CHUNK_MAX_CHARS_MAX) config.chunk_max_chars = limits::CHUNK_MAX_CHARS_MAX;
+    if (config.synth_buffer_ms < limits::SYNTH_BUFFER_MS_MIN) config.synth_buffer_ms = limits::SYNTH_BUFFER_MS_MIN;
+    if (config.synth_buffer_ms > limits::SYNTH_BUFFER_MS_MAX) config.synth_buffer_ms = limits::SYNTH_BUFFER_MS_MAX;
+    if (config.silence_threshold < limits::SILENCE_THRESHOLD_MIN) config.silence_threshold = limits::SILENCE_THRESHOLD_MIN;
+    if (config.silence_threshold > limits::SILENCE_THRESHOLD_MAX) config.silence_threshold = limits::SILENCE_THRESHOLD_MAX;
+    if (config.silence_lookahead_ms < limits::SILENCE_LOOKAHEAD_MS_MIN) config.silence_lookahead_ms = limits::SILENCE_LOOKAHEAD_MS_MIN;
+    if (config.silence_lookahead_ms > limits::SILENCE_LOOKAHEAD_MS_MAX) config.silence_lookahead_ms = limits::SILENCE_LOOKAHEAD_MS_MAX;
+    if (config.silence_max_gap_ms < limits::SILENCE_MAX_GAP_MS_MIN) config.silence_max_gap_ms = limits::SILENCE_MAX_GAP_MS_MIN;
+    if (config.silence_max_gap_ms > limits::SILENCE_MAX_GAP_MS_MAX) config.silence_max_gap_ms = limits::SILENCE_MAX_GAP_MS_MAX;
+    if (config.character_table_mb < limits::CHARACTER_TABLE_MB_MIN) config.character_table_mb = limits::CHARACTER_TABLE_MB_MIN;
+    if (config.character_table_mb > limits::CHARACTER_TABLE_MB_MAX) config.character_table_mb = limits::CHARACTER_TABLE_MB_MAX;
 }
 
 void parseConfiguration(const json& j, Configuration& config) {
     parseVoicesSection(j, config);
     parseGlobalSettingsSection(j, config);
     parseVoiceProfilesSection(j, config);
+    parsePerformanceSection(j, config);
     clampConfigValues(config);
 }
+
+std::uint64_t fileStamp(const std::wstring& path) {
+    std::error_code ec;
+    const auto modified = utils::fs::last_write_time(path, ec);
+    if (ec) {
+        return 0;
+    }
+    const auto size = utils::fs::file_size(path, ec);
+    return static_cast<std::uint64_t>(modified.time_since_epoch().count()) * 1099511628211ULL ^
+           (ec ? 0 : static_cast<std::uint64_t>(size));
+}
 }
 
 ConfigManager& ConfigManager::getInstance() {
@@ -77,21 +147,37 @@ ConfigManager& ConfigManager::getInstance() {
 }
 
 ConfigManager::ConfigManager()
-    : configChangedEvent_(CreateEventW(nullptr, FALSE, FALSE, L"Global\\EspeakSAPIConfigChangedEvent"))
+    : generation_(0)
+#ifdef _WIN32
+    , configChangedEvent_(CreateEventW(nullptr, FALSE, FALSE, L"Global\\EspeakSAPIConfigChangedEvent"))
+#endif
+    , shared_(std::make_unique<SharedConfigRegion>())
+    , shared_generation_(0)
+    , shared_reloads_(0)
+    , shared_stall_(0)
 {
-    config_ = createDefaultConfig();
+    publish(createDefaultConfig());
 
+#ifdef _WIN32
     if (!configChangedEvent_) {
-        DEBUG_LOG("ConfigManager: Failed to create config change event, error=%d", GetLastError());
+        LOG_WARN("ConfigManager: Failed to create config change event, error=%d", GetLastError());
     } else {
         DEBUG_LOG("ConfigManager: Config change event created/opened successfully");
     }
+#endif
+
+    if (!shared_->isOpen()) {
+        DEBUG_LOG("ConfigManager: Shared config region unavailable");
+        shared_.reset();
+    } else {
+        shared_reloads_.store(shared_->reloadRequests(), std::memory_order_release);
+    }
 }
 
 std::wstring ConfigManager::getConfigPath() {
     utils::fs::path config_dir = utils::getEspeakConfigDir();
     if (config_dir.empty()) {
-        DEBUG_LOG("ConfigManager: Failed to get AppData path");
+        LOG_WARN("ConfigManager: Failed to get AppData path");
         return L"";
     }
 
@@ -100,7 +186,7 @@ std::wstring ConfigManager::getConfigPath() {
     std::error_code ec;
     utils::fs::create_directories(config_dir, ec);
     if (ec) {
-        DEBUG_LOG("ConfigManager: Failed to create directory: %s", ec.message().c_str());
+        LOG_WARN("ConfigManager: Failed to create directory: %s", ec.message().c_str());
     }
 
     return config_file.wstring();
@@ -123,20 +209,27 @@ bool ConfigManager::load() {
     std::wstring config_path = getConfigPath();
     if (config_path.empty()) {
         DEBUG_LOG("ConfigManager: Invalid config path");
-        config_ = createDefaultConfig();
+        publish(createDefaultConfig());
         return false;
     }
 
     if (!utils::fs::exists(config_path)) {
         DEBUG_LOG("ConfigManager: Config file doesn't exist, using defaults");
-        config_ = createDefaultConfig();
+        publish(createDefaultConfig());
         return false;
     }
 
-    std::ifstream file(config_path);
+    const std::uint64_t stamp = fileStamp(config_path);
+    if (loadSharedImage(stamp)) {
+        DEBUG_LOG("ConfigManager: Loaded config from shared image (generation=%llu)",
+                  static_cast<unsigned long long>(shared_generation_.load()));
+        return true;
+    }
+
+    std::ifstream file{utils::fs::path(config_path)};
     if (!file.is_open()) {
         DEBUG_LOG("ConfigManager: Failed to open config file");
-        config_ = createDefaultConfig();
+        publish(createDefaultConfig());
         return false;
     }
 
@@ -149,20 +242,21 @@ bool ConfigManager::load() {
 
         parseConfiguration(j, new_config);
 
-        config_ = new_config;
-
         DEBUG_LOG("ConfigManager: Successfully loaded config (default_only=%d, enabled_voices=%zu, profiles=%zu)",
-                  config_.default_only, config_.enabled_voices.size(), config_.voice_profiles.size());
+                  new_config.default_only, new_config.enabled_voices.size(), new_config.voice_profiles.size());
+
+        publishSharedImage(new_config, stamp);
+        publish(std::move(new_config));
         return true;
     }
     catch (const json::exception& e) {
-        DEBUG_LOG("ConfigManager: JSON parse error: %s", e.what());
-        config_ = createDefaultConfig();
+        LOG_ERROR("ConfigManager: JSON parse error: %s", e.what());
+        publish(createDefaultConfig());
         return false;
     }
     catch (const std::exception& e) {
-        DEBUG_LOG("ConfigManager: Error loading config: %s", e.what());
-        config_ = createDefaultConfig();
+        LOG_ERROR("ConfigManager: Error loading config: %s", e.what());
+        publish(createDefaultConfig());
         return false;
     }
 }
@@ -200,16 +294,39 @@ bool ConfigManager::save(const Configuration& config) {
         }
         j["voice_profiles"] = profiles;
 
-        std::ofstream file(config_path);
+        j["performance"]["write_buffer_ms"] = config.write_buffer_ms;
+        j["performance"]["write_latency_ms"] = config.write_latency_ms;
+        j["performance"]["lookahead_fragments"] = config.lookahead_fragments;
+        j["performance"]["audio_cache_mb"] = config.audio_cache_mb;
+        j["performance"]["audio_cache_persist"] = config.audio_cache_persist;
+        j["performance"]["worker_processes"] = config.worker_processes;
+        j["performance"]["negotiate_output_format"] = config.negotiate_output_format;
+        j["performance"]["chunk_first_chars"] = config.chunk_first_chars;
+        j["performance"]["chunk_max_chars"] = config.chunk_max_chars;
+        j["performance"]["merge_fragments"] = config.merge_fragments;
+        j["performance"]["synth_buffer_ms"] = config.synth_buffer_ms;
+        j["performance"]["silence_trim"] = config.silence_trim;
+        j["performance"]["silence_threshold"] = config.silence_threshold;
+        j["performance"]["silence_lookahead_ms"] = config.silence_lookahead_ms;
+        j["performance"]["silence_max_gap_ms"] = config.silence_max_gap_ms;
+        j["performance"]["warm_up"] = config.warm_up;
+        j["performance"]["live_prosody"] = config.live_prosody;
+        j["performance"]["character_table_mb"] = config.character_table_mb;
+        j["performance"]["speak_trace"] = config.speak_trace;
+        j["performance"]["speak_timeline"] = config.speak_timeline;
+        j["performance"]["log_level"] = config.log_level;
+
+        std::ofstream file{utils::fs::path(config_path)};
         if (!file.is_open()) {
-            DEBUG_LOG("ConfigManager: Failed to open config file for writing");
+            LOG_WARN("ConfigManager: Failed to open config file for writing");
             return false;
         }
 
         file << j.dump(2);
         file.close();
 
-        config_ = config;
+        publishSharedImage(config, fileStamp(config_path));
+        publish(config);
 
         signalConfigChanged();
 
@@ -217,75 +334,193 @@ bool ConfigManager::save(const Configuration& config) {
         return true;
     }
     catch (const json::exception& e) {
-        DEBUG_LOG("ConfigManager: JSON serialization error: %s", e.what());
+        LOG_ERROR("ConfigManager: JSON serialization error: %s", e.what());
         return false;
     }
     catch (const std::exception& e) {
-        DEBUG_LOG("ConfigManager: Error saving config: %s", e.what());
+        LOG_ERROR("ConfigManager: Error saving config: %s", e.what());
         return false;
     }
 }
 
 Configuration ConfigManager::getConfig() {
-    std::lock_guard<std::mutex> lock(mutex_);
+    return *snapshot();
+}
+
+ConfigSnapshot ConfigManager::snapshot() {
     checkAndReload();
-    return config_;
+
+    struct CachedSnapshot {
+        std::uint64_t generation = 0;
+        ConfigSnapshot config;
+    };
+    thread_local CachedSnapshot cached;
+
+    const std::uint64_t generation = generation_.load(std::memory_order_acquire);
+    if (cached.generation != generation || !cached.config) {
+        cached.config = std::atomic_load_explicit(&current_, std::memory_order_acquire);
+        cached.generation = generation;
+    }
+    return cached.config;
+}
+
+std::uint64_t ConfigManager::generation() const noexcept {
+    return generation_.load(std::memory_order_acquire);
+}
+
+void ConfigManager::publish(Configuration config) {
+    DebugLog::Configure(config.log_level);
+    std::atomic_store_explicit(&current_, ConfigSnapshot(std::make_shared<const Configuration>(std::move(config))),
+                               std::memory_order_release);
+    generation_.fetch_add(1, std::memory_order_acq_rel);
 }
 
 void ConfigManager::checkAndReload() {
+    if (shared_) {
+        const std::uint64_t generation = shared_->generation();
+        const std::uint64_t reloads = shared_->reloadRequests();
+        const std::uint64_t stall = shared_->stalledSince();
+        if (generation != shared_generation_.load(std::memory_order_acquire) ||
+            reloads != shared_reloads_.load(std::memory_order_acquire) ||
+            (stall != 0 && stall != shared_stall_.load(std::memory_order_acquire))) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            // The file is written before the image is published, so it is never
+            // older than the image and the image generation seen so far is
+            // covered by a reload from it.
+            if (reloads != shared_reloads_.load(std::memory_order_relaxed)) {
+                DEBUG_LOG("ConfigManager: Another process could not publish its config, reloading from file");
+                shared_reloads_.store(reloads, std::memory_order_release);
+                shared_generation_.store(generation, std::memory_order_release);
+                reloadFromFile();
+            } else if (stall != 0 && stall != shared_stall_.load(std::memory_order_relaxed)) {
+                LOG_WARN("ConfigManager: Shared config writer (pid %u) stalled, reloading from file",
+                         shared_->writerPid());
+                shared_stall_.store(stall, std::memory_order_release);
+                shared_generation_.store(generation, std::memory_order_release);
+                if (reloadFromFile()) {
+                    publishSharedImage(*std::atomic_load_explicit(&current_, std::memory_order_acquire),
+                                       fileStamp(getConfigPath()));
+                }
+            } else if (generation != shared_generation_.load(std::memory_order_relaxed) &&
+                       !loadSharedImage(std::nullopt)) {
+                LOG_WARN("ConfigManager: Shared config image unreadable, reloading from file");
+                shared_generation_.store(generation, std::memory_order_release);
+                reloadFromFile();
+            }
+        }
+    }
+
+#ifdef _WIN32
     if (configChangedEvent_) {
         DWORD result = WaitForSingleObject(configChangedEvent_.get(), 0);
 
         if (result == WAIT_OBJECT_0) {
+            std::lock_guard<std::mutex> lock(mutex_);
             DEBUG_LOG("ConfigManager: Config change event signaled, reloading...");
+            reloadFromFile();
+        }
+    }
+#endif
+}
 
-            std::wstring config_path = getConfigPath();
-            if (config_path.empty()) {
-                return;
-            }
+bool ConfigManager::reloadFromFile() {
+    std::wstring config_path = getConfigPath();
+    if (config_path.empty()) {
+        return false;
+    }
 
-            if (!utils::fs::exists(config_path)) {
-                DEBUG_LOG("ConfigManager: Config file not found during reload");
-                return;
-            }
+    if (!utils::fs::exists(config_path)) {
+        DEBUG_LOG("ConfigManager: Config file not found during reload");
+        return false;
+    }
 
-            std::ifstream file(config_path);
-            if (!file.is_open()) {
-                DEBUG_LOG("ConfigManager: Failed to open config file during reload");
-                return;
-            }
+    std::ifstream file{utils::fs::path(config_path)};
+    if (!file.is_open()) {
+        LOG_WARN("ConfigManager: Failed to open config file during reload");
+        return false;
+    }
 
-            try {
-                json j;
-                file >> j;
+    try {
+        json j;
+        file >> j;
 
-                Configuration new_config;
-                new_config.version = j.value("version", "1.0");
+        Configuration new_config;
+        new_config.version = j.value("version", "1.0");
 
-                parseConfiguration(j, new_config);
+        parseConfiguration(j, new_config);
 
-                config_ = new_config;
-                DEBUG_LOG("ConfigManager: Config reloaded successfully (intonation=%d, wordgap=%d, rateboost=%d)",
-                          config_.intonation, config_.wordgap, config_.rateboost);
-            }
-            catch (const json::exception& e) {
-                DEBUG_LOG("ConfigManager: JSON error during reload: %s", e.what());
-            }
-            catch (...) {
-                DEBUG_LOG("ConfigManager: Unknown error during reload");
-            }
+        DEBUG_LOG("ConfigManager: Config reloaded successfully (intonation=%d, wordgap=%d, rateboost=%d)",
+                  new_config.intonation, new_config.wordgap, new_config.rateboost);
+        publish(std::move(new_config));
+        return true;
+    }
+    catch (const json::exception& e) {
+        LOG_ERROR("ConfigManager: JSON error during reload: %s", e.what());
+    }
+    catch (...) {
+        LOG_ERROR("ConfigManager: Unknown error during reload");
+    }
+    return false;
+}
+
+bool ConfigManager::loadSharedImage(std::optional<std::uint64_t> expected_stamp) {
+    if (!shared_) {
+        return false;
+    }
+
+    std::vector<std::uint8_t> image;
+    std::uint64_t generation = 0;
+    if (!shared_->read(image, generation)) {
+        return false;
+    }
+
+    Configuration config;
+    std::uint64_t stamp = 0;
+    if (!decodeConfigImage(image.data(), image.size(), config, stamp)) {
+        DEBUG_LOG("ConfigManager: Shared config image has an unknown layout");
+        return false;
+    }
+    if (expected_stamp && *expected_stamp != stamp) {
+        return false;
+    }
+
+    shared_generation_.store(generation, std::memory_order_release);
+    publish(std::move(config));
+    return true;
+}
+
+void ConfigManager::publishSharedImage(const Configuration& config, std::uint64_t source_stamp) {
+    if (!shared_) {
+        return;
+    }
+
+    std::vector<std::uint8_t> image;
+    encodeConfigImage(config, source_stamp, image);
+    const std::uint64_t generation = shared_->publish(image);
+    if (generation == 0) {
+        LOG_WARN("ConfigManager: Failed to publish shared config image (%zu bytes), asking for a file reload",
+                 image.size());
+        const std::uint64_t requests = shared_->requestReload();
+        if (requests == shared_reloads_.load(std::memory_order_relaxed) + 1) {
+            shared_reloads_.store(requests, std::memory_order_release);
         }
+        return;
     }
+    shared_generation_.store(generation, std::memory_order_release);
+    DEBUG_LOG("ConfigManager: Published shared config image (generation=%llu, %zu bytes)",
+              static_cast<unsigned long long>(generation), image.size());
 }
 
 void ConfigManager::signalConfigChanged() {
+#ifdef _WIN32
     if (configChangedEvent_) {
         if (SetEvent(configChangedEvent_.get())) {
             DEBUG_LOG("ConfigManager: Config change event signaled to all processes");
         } else {
-            DEBUG_LOG("ConfigManager: Failed to signal config change event, error=%d", GetLastError());
+            LOG_WARN("ConfigManager: Failed to signal config change event, error=%d", GetLastError());
         }
     }
+#endif
 }
 }
 }
@@ -1,58 +1,23 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 #include <mutex>
+#include <optional>
+#include "config_types.hpp"
+#include "shared_config.hpp"
+#ifdef _WIN32
 #include <windows.h>
 #include "win32_utils.hpp"
+#endif
 
 namespace Espeak {
 namespace config {
 
-namespace limits {
-    constexpr int INTONATION_MIN = 0;
-    constexpr int INTONATION_MAX = 100;
-    constexpr int WORDGAP_MIN = 0;
-    constexpr int WORDGAP_MAX = 100;
-}
-
-struct VoiceProfile {
-    std::string id;
-    std::string name;
-    std::string base_voice;
-    std::string variant;
-    bool enabled;
-
-    VoiceProfile() : enabled(true) {}
-
-    VoiceProfile(std::string id_, std::string name_, std::string base_voice_,
-                 std::string variant_, bool enabled_ = true)
-        : id(std::move(id_))
-        , name(std::move(name_))
-        , base_voice(std::move(base_voice_))
-        , variant(std::move(variant_))
-        , enabled(enabled_)
-    {}
-};
-
-struct Configuration {
-    std::string version;
-    std::vector<std::string> enabled_voices;
-    bool default_only;
-    std::string global_variant;
-    int intonation;
-    int wordgap;
-    bool rateboost;
-    std::vector<VoiceProfile> voice_profiles;
-
-    Configuration()
-        : version("1.0")
-        , default_only(true)
-        , intonation(50)
-        , wordgap(0)
-        , rateboost(false)
-    {}
-};
+using ConfigSnapshot = std::shared_ptr<const Configuration>;
 
 class ConfigManager {
 public:
@@ -67,6 +32,10 @@ public:
 
     [[nodiscard]] Configuration getConfig();
 
+    [[nodiscard]] ConfigSnapshot snapshot();
+
+    [[nodiscard]] std::uint64_t generation() const noexcept;
+
     [[nodiscard]] static std::wstring getConfigPath();
 
     [[nodiscard]] static Configuration createDefaultConfig();
@@ -78,9 +47,24 @@ private:
 
     void signalConfigChanged();
 
-    Configuration config_;
+    void publish(Configuration config);
+
+    bool reloadFromFile();
+
+    [[nodiscard]] bool loadSharedImage(std::optional<std::uint64_t> expected_stamp);
+
+    void publishSharedImage(const Configuration& config, std::uint64_t source_stamp);
+
+    ConfigSnapshot current_;
+    std::atomic<std::uint64_t> generation_;
     mutable std::mutex mutex_;
+#ifdef _WIN32
     utils::unique_handle configChangedEvent_;
+#endif
+    std::unique_ptr<SharedConfigRegion> shared_;
+    std::atomic<std::uint64_t> shared_generation_;
+    std::atomic<std::uint64_t> shared_reloads_;
+    std::atomic<std::uint64_t> shared_stall_;
 };
 }
 }
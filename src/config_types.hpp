@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace Espeak {
+namespace config {
+
+namespace limits {
+    constexpr int INTONATION_MIN = 0;
+    constexpr int INTONATION_MAX = 100;
+    constexpr int WORDGAP_MIN = 0;
+    constexpr int WORDGAP_MAX = 100;
+    constexpr int WRITE_BUFFER_MS_MIN = 0;
+    constexpr int WRITE_BUFFER_MS_MAX = 1000;
+    constexpr int WRITE_LATENCY_MS_MIN = 0;
+    constexpr int WRITE_LATENCY_MS_MAX = 500;
+    constexpr int LOOKAHEAD_FRAGMENTS_MIN = 0;
+    constexpr int LOOKAHEAD_FRAGMENTS_MAX = 4;
+    constexpr int AUDIO_CACHE_MB_MIN = 0;
+    constexpr int AUDIO_CACHE_MB_MAX = 256;
+    constexpr int WORKER_PROCESSES_MIN = 0;
+    constexpr int WORKER_PROCESSES_MAX = 8;
+    constexpr int CHUNK_FIRST_CHARS_MIN = 0;
+    constexpr int CHUNK_FIRST_CHARS_MAX = 1000;
+    constexpr int CHUNK_MAX_CHARS_MIN = 50;
+    constexpr int CHUNK_MAX_CHARS_MAX = 4000;
+    constexpr int SYNTH_BUFFER_MS_MIN = 0;
+    constexpr int SYNTH_BUFFER_MS_MAX = 200;
+    constexpr int SILENCE_THRESHOLD_MIN = 0;
+    constexpr int SILENCE_THRESHOLD_MAX = 4096;
+    constexpr int SILENCE_LOOKAHEAD_MS_MIN = 0;
+    constexpr int SILENCE_LOOKAHEAD_MS_MAX = 50;
+    constexpr int SILENCE_MAX_GAP_MS_MIN = 20;
+    constexpr int SILENCE_MAX_GAP_MS_MAX = 2000;
+    constexpr int CHARACTER_TABLE_MB_MIN = 0;
+    constexpr int CHARACTER_TABLE_MB_MAX = 64;
+}
+
+struct VoiceProfile {
+    std::string id;
+    std::string name;
+    std::string base_voice;
+    std::string variant;
+    bool enabled;
+
+    VoiceProfile() : enabled(true) {}
+
+    VoiceProfile(std::string id_, std::string name_, std::string base_voice_,
+                 std::string variant_, bool enabled_ = true)
+        : id(std::move(id_))
+        , name(std::move(name_))
+        , base_voice(std::move(base_voice_))
+        , variant(std::move(variant_))
+        , enabled(enabled_)
+    {}
+};
+
+struct Configuration {
+    std::string version;
+    std::vector<std::string> enabled_voices;
+    bool default_only;
+    std::string global_variant;
+    int intonation;
+    int wordgap;
+    bool rateboost;
+    std::vector<VoiceProfile> voice_profiles;
+    int write_buffer_ms;
+    int write_latency_ms;
+    int lookahead_fragments;
+    int audio_cache_mb;
+    bool audio_cache_persist;
+    int worker_processes;
+    bool negotiate_output_format;
+    int chunk_first_chars;
+    int chunk_max_chars;
+    bool merge_fragments;
+    int synth_buffer_ms;
+    bool silence_trim;
+    int silence_threshold;
+    int silence_lookahead_ms;
+    int silence_max_gap_ms;
+    bool warm_up;
+    bool live_prosody;
+    int character_table_mb;
+    bool speak_trace;
+    bool speak_timeline;
+    std::string log_level;
+
+    Configuration()
+        : version("1.0")
+        , default_only(true)
+        , intonation(50)
+        , wordgap(0)
+        , rateboost(false)
+        , write_buffer_ms(100)
+        , write_latency_ms(30)
+        , lookahead_fragments(2)
+        , audio_cache_mb(4)
+        , audio_cache_persist(false)
+        , worker_processes(0)
+        , negotiate_output_format(true)
+        , chunk_first_chars(80)
+        , chunk_max_chars(400)
+        , merge_fragments(true)
+        , synth_buffer_ms(20)
+        , silence_trim(false)
+        , silence_threshold(64)
+        , silence_lookahead_ms(5)
+        , silence_max_gap_ms(300)
+        , warm_up(false)
+        , live_prosody(true)
+        , character_table_mb(2)
+        , speak_trace(false)
+        , speak_timeline(false)
+        , log_level("off")
+    {}
+};
+}
+}
@@ -0,0 +1,747 @@
+#include "debug_log.h"
+#include <cctype>
+#include <string>
+
+#if ENABLE_DEBUG_LOG
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <thread>
+#include <unistd.h>
+#endif
+#endif
+
+namespace DebugLog {
+
+namespace {
+
+constexpr const char* LEVEL_NAMES[] = {"off", "error", "warn", "info", "debug"};
+}
+
+Level ParseLevel(std::string_view name, Level fallback) noexcept {
+    std::string lower;
+    for (const char c : name) {
+        lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(c))));
+    }
+    if (lower == "warning") {
+        return Level::Warn;
+    }
+    for (int i = 0; i <= static_cast<int>(Level::Debug); ++i) {
+        if (lower == LEVEL_NAMES[i] || lower == std::to_string(i)) {
+            return static_cast<Level>(i);
+        }
+    }
+    return fallback;
+}
+}
+
+#if ENABLE_DEBUG_LOG
+
+namespace DebugLog {
+
+namespace detail {
+
+std::atomic<int> g_level{-1};
+}
+
+namespace {
+
+using detail::ArgType;
+using detail::RECORD_BYTES;
+
+constexpr std::size_t RING_BYTES = 64 * 1024;
+constexpr std::size_t MAX_RINGS = 64;
+constexpr auto DRAIN_INTERVAL = std::chrono::milliseconds(25);
+constexpr std::uint64_t ROTATE_BYTES = 4 * 1024 * 1024;
+constexpr int ROTATE_KEEP = 3;
+constexpr const char* LEVEL_ENV = "ESPEAK_SAPI_LOG";
+constexpr const char* FILE_ENV = "ESPEAK_SAPI_LOG_FILE";
+constexpr const char* LOG_FILE_NAME = "EspeakSAPI_debug.log";
+
+struct RecordHeader {
+    std::uint32_t size;
+    std::uint8_t level;
+    std::uint8_t count;
+    std::uint16_t reserved;
+    std::int64_t time_us;
+    const char* format;
+};
+
+// Single producer, single consumer. Positions only grow; a record that does
+// not fit is dropped rather than waiting for the drain.
+struct Ring {
+    std::atomic<std::uint64_t> head{0};
+    std::atomic<std::uint64_t> tail{0};
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<bool> in_use{false};
+    std::uint64_t reported = 0;
+    std::uint32_t thread = 0;
+    std::uint8_t data[RING_BYTES];
+
+    void copyIn(std::uint64_t position, const void* source, std::size_t size) noexcept {
+        const std::size_t offset = static_cast<std::size_t>(position % RING_BYTES);
+        const std::size_t first = std::min(size, RING_BYTES - offset);
+        std::memcpy(data + offset, source, first);
+        std::memcpy(data, static_cast<const std::uint8_t*>(source) + first, size - first);
+    }
+
+    void copyOut(std::uint64_t position, void* target, std::size_t size) const noexcept {
+        const std::size_t offset = static_cast<std::size_t>(position % RING_BYTES);
+        const std::size_t first = std::min(size, RING_BYTES - offset);
+        std::memcpy(target, data + offset, first);
+        std::memcpy(static_cast<std::uint8_t*>(target) + first, data, size - first);
+    }
+
+    bool push(const RecordHeader& header, const void* payload, std::size_t size) noexcept {
+        const std::uint64_t position = head.load(std::memory_order_relaxed);
+        if (RING_BYTES - (position - tail.load(std::memory_order_acquire)) < header.size) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        copyIn(position, &header, sizeof(header));
+        copyIn(position + sizeof(header), payload, size);
+        head.store(position + header.size, std::memory_order_release);
+        return true;
+    }
+};
+
+struct Line {
+    std::int64_t time_us;
+    std::string text;
+};
+
+class Logger {
+public:
+    static Logger& instance() {
+        // Never destroyed, so threads still logging at exit find it intact.
+        static Logger* logger = new Logger();
+        return *logger;
+    }
+
+    Ring* ring() noexcept;
+
+    void start() noexcept;
+
+    void drain() noexcept;
+
+    void shutdown() noexcept;
+
+    void wake() noexcept { cv_.notify_all(); }
+
+    [[nodiscard]] const std::string& path() const noexcept { return path_; }
+
+    std::atomic<std::uint64_t> lost{0};
+
+private:
+    Logger();
+
+    void run() noexcept;
+
+    void collect(Ring& ring, std::vector<Line>& lines);
+
+    void write(const std::vector<Line>& lines);
+
+    void rotate();
+
+#ifdef _WIN32
+    static DWORD WINAPI threadMain(void* param);
+#endif
+
+    std::mutex rings_mutex_;
+    std::unique_ptr<Ring> rings_[MAX_RINGS];
+    std::atomic<std::size_t> ring_count_{0};
+
+    std::mutex thread_mutex_;
+    std::condition_variable cv_;
+    bool running_ = false;
+    bool stopping_ = false;
+#ifndef _WIN32
+    std::thread thread_;
+#endif
+
+    std::mutex drain_mutex_;
+    std::string path_;
+    std::ofstream file_;
+    std::uint64_t file_bytes_ = 0;
+    std::uint64_t reported_lost_ = 0;
+    std::vector<std::uint8_t> scratch_;
+    std::vector<Line> lines_;
+    unsigned long pid_ = 0;
+};
+
+// Marks the ring of a thread free again when the thread ends.
+struct RingLease {
+    Ring* ring = nullptr;
+
+    ~RingLease() {
+        if (ring) {
+            ring->in_use.store(false, std::memory_order_release);
+        }
+    }
+};
+
+std::atomic<bool> g_started{false};
+
+// Drains what is left when the process exits normally.
+struct ExitFlush {
+    ~ExitFlush() {
+        if (g_started.load(std::memory_order_acquire)) {
+            Logger::instance().shutdown();
+        }
+    }
+};
+
+ExitFlush g_exit_flush;
+
+std::string environment(const char* name) {
+#ifdef _WIN32
+    char value[1024];
+    const DWORD length = GetEnvironmentVariableA(name, value, sizeof(value));
+    return length > 0 && length < sizeof(value) ? std::string(value, length) : std::string();
+#else
+    const char* value = std::getenv(name);
+    return value ? std::string(value) : std::string();
+#endif
+}
+
+std::string defaultPath() {
+    std::string path = environment(FILE_ENV);
+    if (!path.empty()) {
+        return path;
+    }
+#ifdef _WIN32
+    std::string dir = environment("USERPROFILE");
+    if (dir.empty()) {
+        char temp[MAX_PATH];
+        const DWORD length = GetTempPathA(MAX_PATH, temp);
+        dir = length > 0 && length < MAX_PATH ? std::string(temp, length) : std::string(".");
+    }
+    return (std::filesystem::u8path(dir) / LOG_FILE_NAME).u8string();
+#else
+    std::string dir = environment("HOME");
+    return (std::filesystem::path(dir.empty() ? "/tmp" : dir) / LOG_FILE_NAME).string();
+#endif
+}
+
+std::int64_t nowMicroseconds() noexcept {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+template <typename T>
+void appendFormatted(std::string& out, const std::string& spec, T value) {
+    const int length = std::snprintf(nullptr, 0, spec.c_str(), value);
+    if (length <= 0) {
+        return;
+    }
+    const std::size_t start = out.size();
+    out.resize(start + static_cast<std::size_t>(length) + 1);
+    std::snprintf(&out[start], static_cast<std::size_t>(length) + 1, spec.c_str(), value);
+    out.resize(start + static_cast<std::size_t>(length));
+}
+
+struct Arg {
+    ArgType type = ArgType::Signed;
+    std::uint64_t bits = 0;
+    std::string_view text;
+
+    [[nodiscard]] long long asSigned() const noexcept {
+        return type == ArgType::Double ? static_cast<long long>(asDouble()) : static_cast<long long>(bits);
+    }
+
+    [[nodiscard]] double asDouble() const noexcept {
+        if (type == ArgType::Double) {
+            double value = 0.0;
+            std::memcpy(&value, &bits, sizeof(value));
+            return value;
+        }
+        return type == ArgType::Signed ? static_cast<double>(static_cast<std::int64_t>(bits))
+                                       : static_cast<double>(bits);
+    }
+};
+
+bool readArgs(const std::uint8_t* data, std::size_t size, std::size_t count, std::vector<Arg>& args) {
+    args.clear();
+    std::size_t offset = 0;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (offset >= size) {
+            return false;
+        }
+        Arg arg;
+        arg.type = static_cast<ArgType>(data[offset++]);
+        if (arg.type == ArgType::String) {
+            std::uint16_t length = 0;
+            if (offset + sizeof(length) > size) {
+                return false;
+            }
+            std::memcpy(&length, data + offset, sizeof(length));
+            offset += sizeof(length);
+            if (offset + length > size) {
+                return false;
+            }
+            arg.text = std::string_view(reinterpret_cast<const char*>(data + offset), length);
+            offset += length;
+        } else {
+            if (offset + sizeof(arg.bits) > size) {
+                return false;
+            }
+            std::memcpy(&arg.bits, data + offset, sizeof(arg.bits));
+            offset += sizeof(arg.bits);
+        }
+        args.push_back(arg);
+    }
+    return true;
+}
+
+// Formats a printf-style message from captured arguments. Conversions are
+// driven by the type each argument had at the call, so a mismatched length
+// modifier or %S for a narrow string still prints the value.
+void format(const char* fmt, const std::vector<Arg>& args, std::string& out) {
+    std::size_t next = 0;
+    for (const char* p = fmt; *p; ++p) {
+        if (*p != '%') {
+            out.push_back(*p);
+            continue;
+        }
+        if (p[1] == '%') {
+            out.push_back('%');
+            ++p;
+            continue;
+        }
+
+        const char* const start = p++;
+        std::string spec = "%";
+        while (*p && std::strchr("-+ #0", *p)) {
+            spec.push_back(*p++);
+        }
+        for (int part = 0; part < 2; ++part) {
+            if (part == 1) {
+                if (*p != '.') {
+                    break;
+                }
+                spec.push_back(*p++);
+            }
+            if (*p == '*') {
+                spec += next < args.size() ? std::to_string(args[next++].asSigned()) : "0";
+                ++p;
+            }
+            while (std::isdigit(static_cast<unsigned char>(*p))) {
+                spec.push_back(*p++);
+            }
+        }
+        while (*p && std::strchr("hlLqjztIw", *p)) {
+            if (*p == 'I' && std::isdigit(static_cast<unsigned char>(p[1]))) {
+                p += 2;
+            }
+            ++p;
+        }
+        if (!*p) {
+            out.append(start);
+            return;
+        }
+
+        const char conversion = *p;
+        if (conversion == 'n') {
+            continue;
+        }
+        if (next >= args.size()) {
+            out.append(start, static_cast<std::size_t>(p - start + 1));
+            continue;
+        }
+
+        const Arg& arg = args[next++];
+        if (arg.type == ArgType::String) {
+            if (spec == "%") {
+                out.append(arg.text);
+            } else {
+                appendFormatted(out, spec + "s", std::string(arg.text).c_str());
+            }
+        } else if (std::strchr("di", conversion)) {
+            appendFormatted(out, spec + "lld", arg.asSigned());
+        } else if (std::strchr("ouxX", conversion)) {
+            appendFormatted(out, spec + "ll" + conversion, static_cast<unsigned long long>(arg.asSigned()));
+        } else if (conversion == 'c' || conversion == 'C') {
+            appendFormatted(out, spec + "c", static_cast<int>(arg.bits));
+        } else if (std::strchr("fFeEgGaA", conversion)) {
+            appendFormatted(out, spec + conversion, arg.asDouble());
+        } else if (conversion == 'p' || arg.type == ArgType::Pointer) {
+            appendFormatted(out, spec + "p", reinterpret_cast<const void*>(static_cast<std::uintptr_t>(arg.bits)));
+        } else if (arg.type == ArgType::Double) {
+            appendFormatted(out, spec + "g", arg.asDouble());
+        } else if (arg.type == ArgType::Signed) {
+            appendFormatted(out, spec + "lld", arg.asSigned());
+        } else {
+            appendFormatted(out, spec + "llu", static_cast<unsigned long long>(arg.bits));
+        }
+    }
+}
+
+void timestamp(std::int64_t time_us, std::string& out) {
+    const std::time_t seconds = static_cast<std::time_t>(time_us / 1000000);
+    std::tm local = {};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+    char text[40];
+    const std::size_t length = std::strftime(text, sizeof(text), "%Y-%m-%d %H:%M:%S", &local);
+    std::snprintf(text + length, sizeof(text) - length, ".%03d", static_cast<int>(time_us / 1000 % 1000));
+    out += text;
+}
+
+Logger::Logger()
+    : path_(defaultPath())
+{
+#ifdef _WIN32
+    pid_ = GetCurrentProcessId();
+#else
+    pid_ = static_cast<unsigned long>(getpid());
+#endif
+}
+
+Ring* Logger::ring() noexcept {
+    thread_local RingLease lease;
+    if (lease.ring) {
+        return lease.ring;
+    }
+
+    const std::size_t count = ring_count_.load(std::memory_order_acquire);
+    for (std::size_t i = 0; i < count; ++i) {
+        bool expected = false;
+        if (rings_[i]->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+            lease.ring = rings_[i].get();
+            return lease.ring;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    const std::size_t index = ring_count_.load(std::memory_order_relaxed);
+    if (index >= MAX_RINGS) {
+        return nullptr;
+    }
+    try {
+        rings_[index] = std::make_unique<Ring>();
+    }
+    catch (...) {
+        return nullptr;
+    }
+    rings_[index]->in_use.store(true, std::memory_order_relaxed);
+    rings_[index]->thread = static_cast<std::uint32_t>(index + 1);
+    ring_count_.store(index + 1, std::memory_order_release);
+    lease.ring = rings_[index].get();
+    return lease.ring;
+}
+
+void Logger::start() noexcept {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    if (running_ || stopping_) {
+        return;
+    }
+#ifdef _WIN32
+    // The thread holds its own reference so the DLL cannot be unloaded under it.
+    HMODULE module = nullptr;
+    if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                            reinterpret_cast<LPCWSTR>(&Logger::threadMain), &module)) {
+        return;
+    }
+    HANDLE thread = CreateThread(nullptr, 0, threadMain, module, 0, nullptr);
+    if (!thread) {
+        FreeLibrary(module);
+        return;
+    }
+    CloseHandle(thread);
+#else
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    try {
+        thread_ = std::thread([this]() { run(); });
+    }
+    catch (...) {
+        return;
+    }
+#endif
+    running_ = true;
+    g_started.store(true, std::memory_order_release);
+}
+
+#ifdef _WIN32
+DWORD WINAPI Logger::threadMain(void* param) {
+    Logger::instance().run();
+    FreeLibraryAndExitThread(static_cast<HMODULE>(param), 0);
+}
+#endif
+
+// Drains until logging is turned off, then exits and releases the module.
+void Logger::run() noexcept {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(thread_mutex_);
+            cv_.wait_for(lock, DRAIN_INTERVAL);
+            if (stopping_ || detail::g_level.load(std::memory_order_relaxed) <= 0) {
+                running_ = false;
+                break;
+            }
+        }
+        drain();
+    }
+    drain();
+}
+
+void Logger::drain() noexcept {
+    std::lock_guard<std::mutex> lock(drain_mutex_);
+    try {
+        lines_.clear();
+        const std::size_t count = ring_count_.load(std::memory_order_acquire);
+        for (std::size_t i = 0; i < count; ++i) {
+            collect(*rings_[i], lines_);
+        }
+        const std::uint64_t lost_now = lost.load(std::memory_order_relaxed);
+        if (lost_now != reported_lost_) {
+            Line line{nowMicroseconds(), std::string()};
+            timestamp(line.time_us, line.text);
+            line.text += " [" + std::to_string(pid_) + "] warn  " + std::to_string(lost_now - reported_lost_) +
+                         " records dropped, no free thread ring\n";
+            lines_.push_back(std::move(line));
+            reported_lost_ = lost_now;
+        }
+        if (!lines_.empty()) {
+            std::stable_sort(lines_.begin(), lines_.end(),
+                             [](const Line& a, const Line& b) { return a.time_us < b.time_us; });
+            write(lines_);
+        }
+    }
+    catch (...) {
+    }
+}
+
+void Logger::collect(Ring& ring, std::vector<Line>& lines) {
+    std::vector<Arg> args;
+    const std::uint64_t head = ring.head.load(std::memory_order_acquire);
+    std::uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+    while (tail < head) {
+        RecordHeader header;
+        ring.copyOut(tail, &header, sizeof(header));
+        const std::size_t payload = header.size - sizeof(header);
+        scratch_.resize(payload);
+        ring.copyOut(tail + sizeof(header), scratch_.data(), payload);
+        tail += header.size;
+
+        Line line{header.time_us, std::string()};
+        timestamp(header.time_us, line.text);
+        char prefix[48];
+        std::snprintf(prefix, sizeof(prefix), " [%lu:%u] %-5s ", pid_, ring.thread, LEVEL_NAMES[header.level]);
+        line.text += prefix;
+        if (readArgs(scratch_.data(), payload, header.count, args)) {
+            format(header.format, args, line.text);
+        } else {
+            line.text += header.format;
+        }
+        line.text.push_back('\n');
+        lines.push_back(std::move(line));
+    }
+    ring.tail.store(tail, std::memory_order_release);
+
+    const std::uint64_t dropped = ring.dropped.load(std::memory_order_relaxed);
+    if (dropped != ring.reported) {
+        Line line{nowMicroseconds(), std::string()};
+        timestamp(line.time_us, line.text);
+        char text[96];
+        std::snprintf(text, sizeof(text), " [%lu:%u] warn  %llu records dropped, ring full\n", pid_, ring.thread,
+                      static_cast<unsigned long long>(dropped - ring.reported));
+        line.text += text;
+        lines.push_back(std::move(line));
+        ring.reported = dropped;
+    }
+}
+
+void Logger::write(const std::vector<Line>& lines) {
+    if (!file_.is_open()) {
+        const std::filesystem::path path = std::filesystem::u8path(path_);
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(path, ec);
+        file_bytes_ = ec ? 0 : static_cast<std::uint64_t>(size);
+        file_.open(path, std::ios::binary | std::ios::app);
+        if (!file_.is_open()) {
+            return;
+        }
+    }
+    for (const Line& line : lines) {
+        file_.write(line.text.data(), static_cast<std::streamsize>(line.text.size()));
+        file_bytes_ += line.text.size();
+    }
+    file_.flush();
+    if (file_bytes_ >= ROTATE_BYTES) {
+        rotate();
+    }
+}
+
+// Keeps ROTATE_KEEP older files as .1 (newest) to .N. Another process may
+// hold the file open; if a rename fails the log simply grows until the next try.
+void Logger::rotate() {
+    file_.close();
+    const std::filesystem::path path = std::filesystem::u8path(path_);
+    std::error_code ec;
+    for (int i = ROTATE_KEEP; i > 0; --i) {
+        std::filesystem::path from = path;
+        from += i > 1 ? "." + std::to_string(i - 1) : std::string();
+        std::filesystem::path to = path;
+        to += "." + std::to_string(i);
+        std::filesystem::remove(to, ec);
+        std::filesystem::rename(from, to, ec);
+    }
+}
+
+void Logger::shutdown() noexcept {
+#ifdef _WIN32
+    // The drain thread holds a module reference, so the DLL only detaches at
+    // process exit, when the thread is already gone and may have died holding
+    // a lock.
+#else
+    {
+        std::lock_guard<std::mutex> lock(thread_mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+#endif
+    if (drain_mutex_.try_lock()) {
+        drain_mutex_.unlock();
+        drain();
+    }
+}
+}
+
+namespace detail {
+
+int InitLevel() noexcept {
+    const std::string configured = environment(LEVEL_ENV);
+    const int level = static_cast<int>(ParseLevel(configured));
+    int expected = -1;
+    if (!g_level.compare_exchange_strong(expected, level, std::memory_order_relaxed)) {
+        return expected;
+    }
+    if (level > static_cast<int>(Level::Off)) {
+        Logger::instance().start();
+    }
+    return level;
+}
+
+void Record::putString(const char* value) noexcept {
+    if (!value) {
+        value = "(null)";
+    }
+    putBytes(value, std::strlen(value));
+}
+
+void Record::putWide(const wchar_t* value) noexcept {
+    if (!value) {
+        putString(nullptr);
+        return;
+    }
+    char text[RECORD_BYTES];
+    std::size_t length = 0;
+    for (const wchar_t* p = value; *p && length + 4 < sizeof(text); ++p) {
+        std::uint32_t c = static_cast<std::uint32_t>(*p);
+        if (sizeof(wchar_t) == 2 && c >= 0xD800 && c < 0xDC00 && p[1] >= 0xDC00 && p[1] < 0xE000) {
+            c = 0x10000 + ((c - 0xD800) << 10) + (static_cast<std::uint32_t>(*++p) - 0xDC00);
+        }
+        if (c < 0x80) {
+            text[length++] = static_cast<char>(c);
+        } else if (c < 0x800) {
+            text[length++] = static_cast<char>(0xC0 | (c >> 6));
+            text[length++] = static_cast<char>(0x80 | (c & 0x3F));
+        } else if (c < 0x10000) {
+            text[length++] = static_cast<char>(0xE0 | (c >> 12));
+            text[length++] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            text[length++] = static_cast<char>(0x80 | (c & 0x3F));
+        } else {
+            text[length++] = static_cast<char>(0xF0 | (c >> 18));
+            text[length++] = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+            text[length++] = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+            text[length++] = static_cast<char>(0x80 | (c & 0x3F));
+        }
+    }
+    putBytes(text, length);
+}
+
+void Record::putBytes(const char* value, std::size_t length) noexcept {
+    const std::uint16_t room = static_cast<std::uint16_t>(
+        size_ + 1 + sizeof(std::uint16_t) < RECORD_BYTES ? RECORD_BYTES - size_ - 1 - sizeof(std::uint16_t) : 0);
+    if (room == 0) {
+        return;
+    }
+    const std::uint16_t stored = static_cast<std::uint16_t>(std::min<std::size_t>(length, room));
+    data_[size_++] = static_cast<std::uint8_t>(ArgType::String);
+    std::memcpy(data_ + size_, &stored, sizeof(stored));
+    size_ += sizeof(stored);
+    std::memcpy(data_ + size_, value, stored);
+    size_ += stored;
+    ++count_;
+}
+
+void Submit(Level level, const char* format, const Record& record) noexcept {
+    Logger& logger = Logger::instance();
+    Ring* ring = logger.ring();
+    if (!ring) {
+        logger.lost.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    RecordHeader header;
+    header.size = static_cast<std::uint32_t>(sizeof(header) + record.size());
+    header.level = static_cast<std::uint8_t>(level);
+    header.count = static_cast<std::uint8_t>(record.count());
+    header.reserved = 0;
+    header.time_us = nowMicroseconds();
+    header.format = format;
+    ring->push(header, record.data(), record.size());
+}
+}
+
+void SetLevel(Level level) noexcept {
+    detail::g_level.store(static_cast<int>(level), std::memory_order_relaxed);
+    if (level > Level::Off) {
+        Logger::instance().start();
+    } else {
+        Logger::instance().wake();
+    }
+}
+
+Level CurrentLevel() noexcept {
+    int current = detail::g_level.load(std::memory_order_relaxed);
+    if (current < 0) {
+        current = detail::InitLevel();
+    }
+    return static_cast<Level>(current);
+}
+
+void Configure(std::string_view level) noexcept {
+    if (environment(LEVEL_ENV).empty()) {
+        SetLevel(ParseLevel(level));
+    }
+}
+
+void Flush() noexcept {
+    Logger::instance().drain();
+}
+
+std::string LogPath() {
+    return Logger::instance().path();
+}
+}
+#endif
@@ -1,58 +1,171 @@
 #pragma once
 
-#include <windows.h>
-#include <cstdio>
-#include <ctime>
+#ifndef ENABLE_DEBUG_LOG
+#define ENABLE_DEBUG_LOG 1
+#endif
+
+#include <string_view>
+
+namespace DebugLog {
+
+enum class Level : int {
+    Off,
+    Error,
+    Warn,
+    Info,
+    Debug
+};
 
-#define ENABLE_DEBUG_LOG 0
+[[nodiscard]] Level ParseLevel(std::string_view name, Level fallback = Level::Off) noexcept;
+
+}
 
 #if ENABLE_DEBUG_LOG
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+// Log calls are cheap enough for the audio path: a call below the current
+// level is one relaxed load, and an enabled one copies its arguments into a
+// per-thread ring without locking. Formatting and file I/O happen on a
+// background thread. The level comes from ESPEAK_SAPI_LOG, or else from the
+// "log_level" setting.
+
 namespace DebugLog {
 
-inline void GetLogPath(wchar_t* path, size_t size) {
-    wchar_t userProfile[MAX_PATH];
-    DWORD result = GetEnvironmentVariableW(L"USERPROFILE", userProfile, MAX_PATH);
+namespace detail {
 
-    if (result > 0 && result < MAX_PATH) {
-        swprintf_s(path, size, L"%s\\EspeakSAPI_debug.log", userProfile);
-    } else {
-        wchar_t tempPath[MAX_PATH];
-        if (GetTempPathW(MAX_PATH, tempPath) > 0) {
-            swprintf_s(path, size, L"%sEspeakSAPI_debug.log", tempPath);
+constexpr std::size_t RECORD_BYTES = 1024;
+
+enum class ArgType : std::uint8_t {
+    Signed,
+    Unsigned,
+    Double,
+    Pointer,
+    String
+};
+
+extern std::atomic<int> g_level;
+
+int InitLevel() noexcept;
+
+// The arguments of one call, copied so that the caller's strings may go away
+// before the record is formatted.
+class Record {
+public:
+    template <typename T>
+    void put(const T& value) noexcept {
+        using Arg = std::decay_t<T>;
+        if constexpr (std::is_same_v<Arg, bool>) {
+            putValue(ArgType::Unsigned, static_cast<std::uint64_t>(value));
+        } else if constexpr (std::is_enum_v<Arg>) {
+            put(static_cast<std::underlying_type_t<Arg>>(value));
+        } else if constexpr (std::is_integral_v<Arg> && std::is_signed_v<Arg>) {
+            putValue(ArgType::Signed, static_cast<std::int64_t>(value));
+        } else if constexpr (std::is_integral_v<Arg>) {
+            putValue(ArgType::Unsigned, static_cast<std::uint64_t>(value));
+        } else if constexpr (std::is_floating_point_v<Arg>) {
+            putValue(ArgType::Double, static_cast<double>(value));
+        } else if constexpr (std::is_same_v<Arg, const char*> || std::is_same_v<Arg, char*>) {
+            putString(value);
+        } else if constexpr (std::is_same_v<Arg, const wchar_t*> || std::is_same_v<Arg, wchar_t*>) {
+            putWide(value);
+        } else if constexpr (std::is_pointer_v<Arg> || std::is_null_pointer_v<Arg>) {
+            putValue(ArgType::Pointer,
+                     static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(static_cast<const void*>(value))));
         } else {
-            wcscpy_s(path, size, L"EspeakSAPI_debug.log");
+            static_assert(std::is_pointer_v<Arg>, "DEBUG_LOG takes printf arguments; pass strings as c_str()");
         }
     }
-}
 
-inline void Log(const char* format, ...) {
-    wchar_t logPath[MAX_PATH];
-    GetLogPath(logPath, MAX_PATH);
+    void putString(const char* value) noexcept;
+
+    void putWide(const wchar_t* value) noexcept;
 
-    FILE* file = nullptr;
-    if (_wfopen_s(&file, logPath, L"a") == 0 && file) {
-        time_t now = time(nullptr);
-        struct tm timeinfo;
-        localtime_s(&timeinfo, &now);
+    [[nodiscard]] const std::uint8_t* data() const noexcept { return data_; }
+    [[nodiscard]] std::size_t size() const noexcept { return size_; }
+    [[nodiscard]] std::size_t count() const noexcept { return count_; }
 
-        char timeStr[32];
-        strftime(timeStr, sizeof(timeStr), "%Y-%m-%d %H:%M:%S", &timeinfo);
+private:
+    // Every scalar takes eight bytes, whatever the pointer size of the build.
+    template <typename T>
+    void putValue(ArgType type, T value) noexcept {
+        static_assert(sizeof(T) == sizeof(std::uint64_t), "log arguments are encoded in eight bytes");
+        if (size_ + 1 + sizeof(value) > RECORD_BYTES) {
+            return;
+        }
+        data_[size_++] = static_cast<std::uint8_t>(type);
+        std::memcpy(data_ + size_, &value, sizeof(value));
+        size_ += sizeof(value);
+        ++count_;
+    }
 
-        fprintf(file, "[%s] ", timeStr);
+    void putBytes(const char* value, std::size_t length) noexcept;
 
-        va_list args;
-        va_start(args, format);
-        vfprintf(file, format, args);
-        va_end(args);
+    std::uint8_t data_[RECORD_BYTES];
+    std::size_t size_ = 0;
+    std::size_t count_ = 0;
+};
 
-        fprintf(file, "\n");
-        fclose(file);
+void Submit(Level level, const char* format, const Record& record) noexcept;
+}
+
+inline bool Enabled(Level level) noexcept {
+    int current = detail::g_level.load(std::memory_order_relaxed);
+    if (current < 0) {
+        current = detail::InitLevel();
     }
+    return static_cast<int>(level) <= current;
+}
+
+// Queues a record; the format must be a string literal.
+template <typename... Args>
+void Log(Level level, const char* format, const Args&... args) noexcept {
+    detail::Record record;
+    (record.put(args), ...);
+    detail::Submit(level, format, record);
 }
+
+void SetLevel(Level level) noexcept;
+
+[[nodiscard]] Level CurrentLevel() noexcept;
+
+// Applies the configured level unless ESPEAK_SAPI_LOG overrides it.
+void Configure(std::string_view level) noexcept;
+
+// Writes out everything queued so far.
+void Flush() noexcept;
+
+// The log file; ESPEAK_SAPI_LOG_FILE overrides the default in the profile.
+[[nodiscard]] std::string LogPath();
 }
 
-#define DEBUG_LOG(...) DebugLog::Log(__VA_ARGS__)
+#define LOG_AT(level, ...)                                 \
+    do {                                                   \
+        if (::DebugLog::Enabled(level)) {                  \
+            ::DebugLog::Log(level, __VA_ARGS__);           \
+        }                                                  \
+    } while (0)
+
+#define LOG_ERROR(...) LOG_AT(::DebugLog::Level::Error, __VA_ARGS__)
+#define LOG_WARN(...) LOG_AT(::DebugLog::Level::Warn, __VA_ARGS__)
+#define LOG_INFO(...) LOG_AT(::DebugLog::Level::Info, __VA_ARGS__)
+#define DEBUG_LOG(...) LOG_AT(::DebugLog::Level::Debug, __VA_ARGS__)
 #else
+
+namespace DebugLog {
+
+inline void Configure(std::string_view) noexcept {}
+
+inline void Flush() noexcept {}
+}
+
+#define LOG_ERROR(...) ((void)0)
+#define LOG_WARN(...) ((void)0)
+#define LOG_INFO(...) ((void)0)
 #define DEBUG_LOG(...) ((void)0)
 #endif
@@ -0,0 +1,276 @@
+#include "engine_warmup.hpp"
+#include "config_manager.hpp"
+#include "espeak_wrapper.h"
+#include "debug_log.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace Espeak {
+namespace sapi {
+
+namespace {
+
+constexpr char WARMUP_TEXT[] = "a";
+
+HMODULE g_module = nullptr;
+std::chrono::steady_clock::time_point g_attached;
+
+std::mutex g_mutex;
+std::condition_variable g_done_cv;
+bool g_pending = false;
+
+// Background work that must not hold up Speak: voices to pull into the file
+// cache, then either the character table for one key-echo setting or, when
+// the table is off, a short utterance to warm the synthesizer.
+struct prebuild_request {
+    std::vector<std::string> voices;
+    bool characters = false;
+    synth_job job;
+    std::string signature;
+    HMODULE module = nullptr;
+};
+
+std::atomic<bool> g_prebuilding{false};
+std::mutex g_prebuilt_mutex;
+std::string g_prebuilt;
+
+std::string prebuild_signature(const synth_job& job) {
+    return job.voice + "|" + std::to_string(job.rate) + "|" + std::to_string(job.pitch) + "|" +
+           std::to_string(job.volume) + "|" + std::to_string(job.intonation) + "|" + std::to_string(job.wordgap) +
+           "|" + std::to_string(job.rateboost) + "|" + std::to_string(config::ConfigManager::getInstance().generation());
+}
+
+std::vector<std::string> configured_voices(const config::Configuration& cfg) {
+    std::vector<std::string> voices;
+    const std::string suffix = cfg.global_variant.empty() ? std::string() : "+" + cfg.global_variant;
+    if (cfg.default_only) {
+        voices.push_back("en" + suffix);
+    } else {
+        for (const std::string& voice : cfg.enabled_voices) {
+            voices.push_back(voice + suffix);
+        }
+    }
+    for (const config::VoiceProfile& profile : cfg.voice_profiles) {
+        if (profile.enabled) {
+            voices.push_back(profile.variant.empty() ? profile.base_voice : profile.base_voice + "+" + profile.variant);
+        }
+    }
+    return voices;
+}
+
+DWORD WINAPI prebuild_thread(void* param) {
+    std::unique_ptr<prebuild_request> request(static_cast<prebuild_request*>(param));
+    const HMODULE module = request->module;
+    try {
+        EspeakEngine& engine = EspeakEngine::getInstance();
+        if (!request->voices.empty() && !engine.preloadVoices(request->voices, nullptr)) {
+            LOG_WARN("Warm-up: Voice preload stopped early");
+        }
+        const synth_job& job = request->job;
+        if (request->characters) {
+            if (engine.prebuildCharacters(job.rate, job.pitch, job.volume, job.intonation, job.wordgap,
+                                          job.rateboost, job.voice, nullptr)) {
+                std::lock_guard<std::mutex> lock(g_prebuilt_mutex);
+                g_prebuilt = std::move(request->signature);
+            }
+        } else {
+            [[maybe_unused]] const bool spoken = engine.speak(WARMUP_TEXT, job.rate, job.pitch, 0, job.intonation,
+                                                              job.wordgap, job.rateboost,
+                                                              [](const short*, int, void*) { return true; }, nullptr);
+        }
+    }
+    catch (const std::exception& e) {
+        [[maybe_unused]] const char* what = e.what();
+        LOG_ERROR("Character prebuild: Exception - %s", what);
+    }
+    catch (...) {
+        LOG_ERROR("Character prebuild: Unknown exception");
+    }
+
+    request.reset();
+    g_prebuilding.store(false, std::memory_order_release);
+    FreeLibraryAndExitThread(module, 0);
+}
+
+// Runs the request on its own thread unless another build is running or the
+// same character set was already built.
+void start_prebuild(std::unique_ptr<prebuild_request> request) noexcept {
+    bool expected = false;
+    if (!g_prebuilding.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+        return;
+    }
+
+    try {
+        if (request->characters) {
+            request->signature = prebuild_signature(request->job);
+            std::lock_guard<std::mutex> lock(g_prebuilt_mutex);
+            if (request->voices.empty() && request->signature == g_prebuilt) {
+                g_prebuilding.store(false, std::memory_order_release);
+                return;
+            }
+        }
+
+        if (GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                               reinterpret_cast<LPCWSTR>(&start_prebuild), &request->module)) {
+            const HMODULE module = request->module;
+            DEBUG_LOG("Character prebuild: Starting for '%s', %zu voices to preload",
+                      request->job.voice.c_str(), request->voices.size());
+            HANDLE thread = CreateThread(nullptr, 0, prebuild_thread, request.get(), 0, nullptr);
+            if (thread) {
+                request.release();
+                CloseHandle(thread);
+                return;
+            }
+            FreeLibrary(module);
+        }
+    }
+    catch (...) {
+        LOG_WARN("Character prebuild: Failed to start");
+    }
+    g_prebuilding.store(false, std::memory_order_release);
+}
+
+// Loads what the first Speak needs and returns the rest as background work.
+std::unique_ptr<prebuild_request> warm_up() {
+    const config::ConfigSnapshot snapshot = config::ConfigManager::getInstance().snapshot();
+    const config::Configuration& cfg = *snapshot;
+
+    EspeakEngine& engine = EspeakEngine::getInstance();
+    if (!engine.initialize()) {
+        LOG_WARN("Warm-up: Engine failed to initialize");
+        return nullptr;
+    }
+    engine.configureBuffer(cfg.synth_buffer_ms);
+
+    std::vector<std::string> voices = configured_voices(cfg);
+    if (voices.empty()) {
+        return nullptr;
+    }
+    if (!engine.setVoice(voices.front())) {
+        LOG_WARN("Warm-up: Failed to load voice '%s'", voices.front().c_str());
+    }
+
+    auto request = std::make_unique<prebuild_request>();
+    request->job.voice = voices.front();
+    request->job.intonation = cfg.intonation;
+    request->job.wordgap = cfg.wordgap;
+    request->voices.assign(voices.begin() + 1, voices.end());
+
+    // Key echo at the default rate and volume is the most likely first request.
+    if (cfg.character_table_mb > 0) {
+        engine.configureSilenceTrim(cfg.silence_trim, cfg.silence_threshold, cfg.silence_lookahead_ms,
+                                    cfg.silence_max_gap_ms);
+        engine.configureCharacterTable(static_cast<std::size_t>(cfg.character_table_mb) * 1024 * 1024,
+                                       config::ConfigManager::getInstance().generation());
+        request->characters = true;
+        request->job.rateboost = cfg.rateboost;
+    }
+    return request;
+}
+
+DWORD WINAPI warmup_thread(void*) {
+    std::unique_ptr<prebuild_request> background;
+    try {
+        background = warm_up();
+    }
+    catch (const std::exception& e) {
+        [[maybe_unused]] const char* what = e.what();
+        LOG_ERROR("Warm-up: Exception - %s", what);
+    }
+    catch (...) {
+        LOG_ERROR("Warm-up: Unknown exception");
+    }
+
+    note_cold_start(PerfStage::WarmupReady);
+    {
+        std::lock_guard<std::mutex> lock(g_mutex);
+        g_pending = false;
+    }
+    g_done_cv.notify_all();
+
+    if (background) {
+        start_prebuild(std::move(background));
+    }
+    FreeLibraryAndExitThread(g_module, 0);
+}
+}
+
+void note_dll_attach() noexcept {
+    g_attached = std::chrono::steady_clock::now();
+}
+
+void start_warmup() noexcept {
+    static std::atomic<bool> started{false};
+    if (started.exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    try {
+        if (!config::ConfigManager::getInstance().snapshot()->warm_up) {
+            return;
+        }
+    }
+    catch (...) {
+        LOG_WARN("Warm-up: Failed to read the configuration");
+        return;
+    }
+
+    // The thread holds its own reference so the DLL cannot be unloaded under it.
+    if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS,
+                            reinterpret_cast<LPCWSTR>(&start_warmup), &g_module)) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_pending = true;
+    HANDLE thread = CreateThread(nullptr, 0, warmup_thread, nullptr, 0, nullptr);
+    if (!thread) {
+        g_pending = false;
+        FreeLibrary(g_module);
+        return;
+    }
+    CloseHandle(thread);
+}
+
+void start_character_prebuild(const synth_job& job) noexcept {
+    if (g_prebuilding.load(std::memory_order_acquire)) {
+        return;
+    }
+    try {
+        auto request = std::make_unique<prebuild_request>();
+        request->characters = true;
+        request->job = job;
+        request->job.text.clear();
+        request->job.cancel = nullptr;
+        start_prebuild(std::move(request));
+    }
+    catch (...) {
+        LOG_WARN("Character prebuild: Failed to start");
+    }
+}
+
+bool warmup_pending() noexcept {
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_pending;
+}
+
+void wait_for_warmup() {
+    std::unique_lock<std::mutex> lock(g_mutex);
+    if (g_pending) {
+        DEBUG_LOG("Warm-up: Waiting for background initialization");
+        g_done_cv.wait(lock, []() { return !g_pending; });
+    }
+}
+
+void note_cold_start(PerfStage stage) noexcept {
+    const long long elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - g_attached).count();
+    if (PerfCounters::local().markStage(stage, static_cast<std::uint64_t>(elapsed > 0 ? elapsed : 0))) {
+        DEBUG_LOG("Cold start: %s at %.1f ms after DLL attach", PerfCounters::name(stage), elapsed / 1000.0);
+    }
+}
+}
+}
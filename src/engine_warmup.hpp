@@ -0,0 +1,33 @@
+#pragma once
+
+#include <windows.h>
+#include "perf_counters.hpp"
+#include "synth_pipeline.hpp"
+
+namespace Espeak {
+namespace sapi {
+
+// Called from DllMain; only records the time cold-start stages count from.
+void note_dll_attach() noexcept;
+
+// Called when a client asks for the engine's class object, so processes that
+// only enumerate voices never start a thread. The first call starts the
+// warm-up thread if "warm_up" is set; later calls do nothing. Waiters are
+// released once the engine and the default voice are loaded; the other
+// voices and the character table are filled in behind them.
+void start_warmup() noexcept;
+
+[[nodiscard]] bool warmup_pending() noexcept;
+
+void wait_for_warmup();
+
+// Fills the character table for the voice and prosody of a key echo on a
+// background thread. Does nothing while a build is running or when the same
+// parameters were already built under the current configuration.
+void start_character_prebuild(const synth_job& job) noexcept;
+
+// Publishes the time since DLL attach in the process's performance counters
+// the first time a stage is reached.
+void note_cold_start(PerfStage stage) noexcept;
+}
+}
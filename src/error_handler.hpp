@@ -12,16 +12,16 @@ inline HRESULT safe_com_call(F&& func, const char* context_label) {
         return func();
     }
     catch (const std::bad_alloc&) {
-        DEBUG_LOG("%s: Out of memory", context_label);
+        LOG_ERROR("%s: Out of memory", context_label);
         return E_OUTOFMEMORY;
     }
     catch (const std::exception& e) {
         [[maybe_unused]] const char* what = e.what();
-        DEBUG_LOG("%s: Exception - %s", context_label, what);
+        LOG_ERROR("%s: Exception - %s", context_label, what);
         return E_UNEXPECTED;
     }
     catch (...) {
-        DEBUG_LOG("%s: Unexpected exception", context_label);
+        LOG_ERROR("%s: Unexpected exception", context_label);
         return E_UNEXPECTED;
     }
 }
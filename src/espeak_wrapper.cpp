@@ -1,10 +1,15 @@
 #include "espeak_wrapper.h"
 #include "debug_log.h"
+#include "perf_counters.hpp"
+#include "silence_trimmer.hpp"
+#include "speak_timeline.hpp"
+#include "utf16_transcoder.hpp"
 #include "utils.hpp"
 #include <espeak-ng/speak_lib.h>
-#include <windows.h>
 #include <cstring>
 #include <algorithm>
+#include <chrono>
+#include <thread>
 
 namespace Espeak {
 
@@ -29,22 +34,94 @@ constexpr int MAX_INTONATION = 100;
 constexpr int MIN_WORDGAP = 0;
 constexpr int MAX_WORDGAP = 100;
 
+constexpr int REPLAY_CHUNK_SAMPLES = 2048;
+
+constexpr int TRIM_FADE_MS = 2;
+constexpr int TRIM_WINDOW_MS = 10;
+
+constexpr char FIRST_PRINTABLE = ' ';
+constexpr char LAST_PRINTABLE = '~';
+constexpr auto PREBUILD_BACKOFF = std::chrono::milliseconds(5);
+
+constexpr char SPELL_PREFIX[] = "<speak><say-as interpret-as=\"characters\">";
+constexpr char SPELL_SUFFIX[] = "</say-as></speak>";
+
+// espeakCHARS_WCHAR reads wchar_t code points, so UTF-16 can only be handed over
+// directly where wchar_t is 16 bits wide and the text has no surrogate pairs.
+constexpr bool WIDE_INPUT_IS_UTF16 = sizeof(wchar_t) == sizeof(char16_t);
+
 struct CallbackContext {
     SpeakCallback callback;
+    EventCallback event_callback;
     void* user_data;
+    const CancelToken* cancel;
     bool aborted;
+    int sample_rate;
+    CachedAudio* recording;
+    SilenceTrimmer* trimmer;
+    std::vector<short>* trimmed;
+    int char_offset;
+    long long sample_base;
+    long long samples_emitted;
 };
 
 thread_local CallbackContext* g_callback_context = nullptr;
 
+bool cancelRequested(const CancelToken* cancel) noexcept {
+    return cancel && cancel->cancelled();
+}
+
+bool deliverAudio(CallbackContext& ctx, const short* samples, std::size_t count) {
+    if (count == 0) {
+        return true;
+    }
+    if (ctx.recording) {
+        ctx.recording->samples.insert(ctx.recording->samples.end(), samples, samples + count);
+    }
+    if (!ctx.callback(samples, static_cast<int>(count), ctx.user_data)) {
+        ctx.aborted = true;
+        return false;
+    }
+    return true;
+}
+
+void appendEscaped(std::string& out, std::string_view text) {
+    for (const char c : text) {
+        switch (c) {
+            case '&': out += "&amp;"; break;
+            case '<': out += "&lt;"; break;
+            case '>': out += "&gt;"; break;
+            default: out.push_back(c); break;
+        }
+    }
+}
+
 int espeak_callback(short* wav, int numsamples, espeak_EVENT* events) {
     if (!g_callback_context || g_callback_context->aborted) {
         return 1;
     }
+    const TimelineSpan span("synth callback", "samples", numsamples);
+    if (cancelRequested(g_callback_context->cancel)) {
+        g_callback_context->aborted = true;
+        return 1;
+    }
+
+    CachedAudio* recording = g_callback_context->recording;
+
+    SilenceTrimmer* trimmer = g_callback_context->trimmer;
 
     if (numsamples > 0 && wav) {
-        if (!g_callback_context->callback(wav, numsamples, g_callback_context->user_data)) {
-            g_callback_context->aborted = true;
+        g_callback_context->samples_emitted += numsamples;
+        bool delivered = true;
+        if (trimmer) {
+            std::vector<short>& trimmed = *g_callback_context->trimmed;
+            trimmed.clear();
+            trimmer->process(wav, static_cast<std::size_t>(numsamples), trimmed);
+            delivered = deliverAudio(*g_callback_context, trimmed.data(), trimmed.size());
+        } else {
+            delivered = deliverAudio(*g_callback_context, wav, static_cast<std::size_t>(numsamples));
+        }
+        if (!delivered) {
             return 1;
         }
     }
@@ -54,6 +131,41 @@ int espeak_callback(short* wav, int numsamples, espeak_EVENT* events) {
             if (event->type == espeakEVENT_MSG_TERMINATED) {
                 break;
             }
+            if (!recording && !g_callback_context->event_callback) {
+                continue;
+            }
+
+            SynthEvent synth_event{};
+            switch (event->type) {
+                case espeakEVENT_WORD:
+                    synth_event.type = SynthEventType::Word;
+                    synth_event.number = event->id.number;
+                    break;
+                case espeakEVENT_SENTENCE:
+                    synth_event.type = SynthEventType::Sentence;
+                    synth_event.number = event->id.number;
+                    break;
+                case espeakEVENT_MARK:
+                    synth_event.type = SynthEventType::Mark;
+                    synth_event.name = event->id.name ? event->id.name : "";
+                    break;
+                default:
+                    continue;
+            }
+            synth_event.text_position = event->text_position + g_callback_context->char_offset;
+            synth_event.length = event->length;
+            long long sample = g_callback_context->sample_base +
+                static_cast<long long>(event->audio_position) * g_callback_context->sample_rate / 1000;
+            if (trimmer) {
+                sample = trimmer->map(sample);
+            }
+            synth_event.sample = static_cast<int>(sample);
+            if (g_callback_context->event_callback) {
+                g_callback_context->event_callback(synth_event, g_callback_context->user_data);
+            }
+            if (recording) {
+                recording->events.push_back(std::move(synth_event));
+            }
         }
     }
 
@@ -68,6 +180,16 @@ EspeakEngine& EspeakEngine::getInstance() {
 
 EspeakEngine::EspeakEngine()
     : initialized_(false)
+    , sample_rate_(22050)
+    , config_generation_(0)
+    , chunk_first_chars_(TextChunker::DEFAULT_FIRST_CHARS)
+    , chunk_max_chars_(TextChunker::DEFAULT_MAX_CHARS)
+    , buffer_ms_(0)
+    , trim_enabled_(false)
+    , trim_threshold_(0)
+    , trim_lookahead_ms_(0)
+    , trim_max_gap_ms_(0)
+    , waiting_speakers_(0)
 {
 }
 
@@ -78,55 +200,67 @@ EspeakEngine::~EspeakEngine() {
 }
 
 bool EspeakEngine::initialize() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return initializeLocked();
+}
+
+bool EspeakEngine::initializeLocked() {
     if (initialized_) {
         return true;
     }
+    failed_voices_.clear();
 
     utils::fs::path data_path = utils::getEspeakDataDir();
     if (!data_path.empty()) {
         std::string data_path_utf8 = data_path.u8string();
 
-        int sample_rate = espeak_Initialize(AUDIO_OUTPUT_SYNCHRONOUS, 0, data_path_utf8.c_str(), 0);
+        int sample_rate = espeak_Initialize(AUDIO_OUTPUT_SYNCHRONOUS, buffer_ms_, data_path_utf8.c_str(), 0);
         if (sample_rate != -1) {
-            DEBUG_LOG("EspeakEngine: Initialized with sample rate %d Hz using data path: %S", sample_rate, data_path.c_str());
+            DEBUG_LOG("EspeakEngine: Initialized with sample rate %d Hz, %d ms buffer using data path: %S",
+                      sample_rate, buffer_ms_, data_path.c_str());
             espeak_SetSynthCallback(espeak_callback);
             initialized_ = true;
+            sample_rate_ = sample_rate;
+            data_version_ = std::string(espeak_Info(nullptr)) + "|" + data_path_utf8;
 
             if (espeak_SetVoiceByName("en") == EE_OK) {
                 current_voice_ = "en";
                 DEBUG_LOG("EspeakEngine: Set default voice to 'en'");
             } else {
-                DEBUG_LOG("EspeakEngine: Warning - Failed to set default voice");
+                LOG_WARN("EspeakEngine: Warning - Failed to set default voice");
             }
 
             return true;
         }
-        DEBUG_LOG("EspeakEngine: Failed to initialize with ProgramData path, trying default");
+        LOG_WARN("EspeakEngine: Failed to initialize with ProgramData path, trying default");
     }
 
-    int sample_rate = espeak_Initialize(AUDIO_OUTPUT_SYNCHRONOUS, 0, nullptr, 0);
+    int sample_rate = espeak_Initialize(AUDIO_OUTPUT_SYNCHRONOUS, buffer_ms_, nullptr, 0);
     if (sample_rate == -1) {
-        DEBUG_LOG("EspeakEngine: Failed to initialize espeak-ng");
+        LOG_ERROR("EspeakEngine: Failed to initialize espeak-ng");
         return false;
     }
 
-    DEBUG_LOG("EspeakEngine: Initialized with sample rate %d Hz (default path)", sample_rate);
+    DEBUG_LOG("EspeakEngine: Initialized with sample rate %d Hz, %d ms buffer (default path)", sample_rate, buffer_ms_);
 
     espeak_SetSynthCallback(espeak_callback);
 
     initialized_ = true;
+    sample_rate_ = sample_rate;
+    data_version_ = espeak_Info(nullptr);
 
     if (espeak_SetVoiceByName("en") == EE_OK) {
         current_voice_ = "en";
         DEBUG_LOG("EspeakEngine: Set default voice to 'en'");
     } else {
-        DEBUG_LOG("EspeakEngine: Warning - Failed to set default voice");
+        LOG_WARN("EspeakEngine: Warning - Failed to set default voice");
     }
 
     return true;
 }
 
 std::vector<VoiceInfo> EspeakEngine::getVoices() const {
+    std::lock_guard<std::mutex> lock(mutex_);
     std::vector<VoiceInfo> voices;
 
     if (!initialized_) {
@@ -156,21 +290,37 @@ std::vector<VoiceInfo> EspeakEngine::getVoices() const {
 }
 
 bool EspeakEngine::setVoice(const std::string& voice_name) {
+    std::lock_guard<std::mutex> lock(mutex_);
     if (!initialized_) {
         return false;
     }
+    return voice_name == current_voice_ || setVoiceLocked(voice_name);
+}
 
+bool EspeakEngine::setVoiceLocked(const std::string& voice_name) {
     espeak_ERROR result = espeak_SetVoiceByName(voice_name.c_str());
     if (result != EE_OK) {
-        DEBUG_LOG("EspeakEngine: Failed to set voice '%s', error %d", voice_name.c_str(), result);
+        LOG_WARN("EspeakEngine: Failed to set voice '%s', error %d", voice_name.c_str(), result);
+        failed_voices_.insert(voice_name);
         return false;
     }
 
     current_voice_ = voice_name;
+    PerfCounters::local().add(PerfCounter::VoiceSwitches);
     DEBUG_LOG("EspeakEngine: Set voice to '%s'", voice_name.c_str());
     return true;
 }
 
+void EspeakEngine::selectVoiceLocked(std::string_view voice) {
+    if (!voice.empty() && voice != current_voice_ && !voiceFailedLocked(voice) && !setVoiceLocked(std::string(voice))) {
+        DEBUG_LOG("EspeakEngine: Keeping voice '%s'", current_voice_.c_str());
+    }
+}
+
+bool EspeakEngine::voiceFailedLocked(std::string_view voice) const {
+    return !failed_voices_.empty() && failed_voices_.find(voice) != failed_voices_.end();
+}
+
 bool EspeakEngine::speak(const std::string& text,
                          int rate,
                          int pitch,
@@ -179,75 +329,441 @@ bool EspeakEngine::speak(const std::string& text,
                          int wordgap,
                          bool rateboost,
                          SpeakCallback callback,
-                         void* user_data) {
+                         void* user_data,
+                         EventCallback event_callback,
+                         TextFormat format,
+                         const CancelToken* cancel,
+                         std::string_view voice) {
+    waiting_speakers_.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    waiting_speakers_.fetch_sub(1, std::memory_order_relaxed);
+    return speakLocked(text, nullptr, rate, pitch, volume, intonation, wordgap, rateboost,
+                       std::move(callback), user_data, std::move(event_callback), format, cancel, voice);
+}
+
+bool EspeakEngine::speak(std::u16string_view text,
+                         int rate,
+                         int pitch,
+                         int volume,
+                         int intonation,
+                         int wordgap,
+                         bool rateboost,
+                         SpeakCallback callback,
+                         void* user_data,
+                         EventCallback event_callback,
+                         TextFormat format,
+                         const CancelToken* cancel,
+                         std::string_view voice) {
+    waiting_speakers_.fetch_add(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(mutex_);
+    waiting_speakers_.fetch_sub(1, std::memory_order_relaxed);
+
+    const bool needs_utf8 = format == TextFormat::Characters || (format == TextFormat::Plain &&
+        (cache_.enabled() || characters_.enabled() || (chunk_first_chars_ != 0 && text.size() > chunk_first_chars_)));
+    if (WIDE_INPUT_IS_UTF16 && !needs_utf8 && !containsSurrogates(text)) {
+        wide_buffer_.assign(text.begin(), text.end());
+        return speakLocked(utf8_buffer_, &wide_buffer_, rate, pitch, volume, intonation, wordgap, rateboost,
+                           std::move(callback), user_data, std::move(event_callback), format, cancel, voice);
+    }
+
+    {
+        const TimelineSpan span("text conversion", "chars", static_cast<std::int64_t>(text.size()));
+        utf16ToUtf8(text, utf8_buffer_);
+    }
+    return speakLocked(utf8_buffer_, nullptr, rate, pitch, volume, intonation, wordgap, rateboost,
+                       std::move(callback), user_data, std::move(event_callback), format, cancel, voice);
+}
+
+bool EspeakEngine::speakLocked(const std::string& text,
+                               const std::wstring* wide_text,
+                               int rate,
+                               int pitch,
+                               int volume,
+                               int intonation,
+                               int wordgap,
+                               bool rateboost,
+                               SpeakCallback callback,
+                               void* user_data,
+                               EventCallback event_callback,
+                               TextFormat format,
+                               const CancelToken* cancel,
+                               std::string_view voice) {
     if (!initialized_) {
         DEBUG_LOG("EspeakEngine: Not initialized");
         return false;
     }
 
-    if (text.empty()) {
-        DEBUG_LOG("EspeakEngine: Empty text");
-        return true;
-    }
+    // Cached audio does not need the voice loaded, so the switch waits until
+    // something has to be synthesized.
+    const std::string_view wanted = voice.empty() || voiceFailedLocked(voice) ? std::string_view(current_voice_) : voice;
 
-    int espeak_rate;
-    if (rate < 0) {
-        espeak_rate = BASE_RATE + (rate * SLOW_RATE_SCALE_FACTOR / RATE_SCALE_DIVISOR);
-    } else {
-        espeak_rate = BASE_RATE + (rate * FAST_RATE_SCALE_FACTOR / RATE_SCALE_DIVISOR);
+    if (cancelRequested(cancel)) {
+        DEBUG_LOG("EspeakEngine: Synthesis cancelled before start");
+        return false;
     }
-    espeak_rate = std::clamp(espeak_rate, MIN_RATE, MAX_RATE);
 
-    if (rateboost) {
-        espeak_rate = (std::min)(espeak_rate * RATE_BOOST_MULTIPLIER, MAX_BOOSTED_RATE);
+    if (wide_text ? wide_text->empty() : text.empty()) {
+        DEBUG_LOG("EspeakEngine: Empty text");
+        return true;
     }
 
-    espeak_SetParameter(espeakRATE, espeak_rate, 0);
-
-    int espeak_pitch = std::clamp(pitch, MIN_PITCH, MAX_PITCH);
-    espeak_SetParameter(espeakPITCH, espeak_pitch, 0);
+    int espeak_rate = espeakRate(rate, rateboost);
+    int espeak_pitch = espeakPitch(pitch);
+    int espeak_volume = espeakVolume(volume);
+    int espeak_intonation = std::clamp(intonation, MIN_INTONATION, MAX_INTONATION);
+    int espeak_wordgap = std::clamp(wordgap, MIN_WORDGAP, MAX_WORDGAP);
 
-    int espeak_volume = std::clamp(volume * VOLUME_MULTIPLIER, MIN_VOLUME, MAX_VOLUME);
-    espeak_SetParameter(espeakVOLUME, espeak_volume, 0);
+    const bool ssml = format == TextFormat::Ssml;
+    const bool spelled = format == TextFormat::Characters;
+    const bool tabled = !ssml && !wide_text && CharacterTable::eligible(text) && characters_.enabled();
+    const bool cacheable = format == TextFormat::Plain && !tabled && !wide_text &&
+                           text.size() <= AudioCache::MAX_TEXT_LENGTH && cache_.enabled();
+    std::string character_set;
+    if (tabled) {
+        character_set = characterSetLocked(wanted, rate, pitch, volume, intonation, wordgap, rateboost);
+        if (std::shared_ptr<const CachedAudio> entry = characters_.lookup(character_set, text, spelled)) {
+            PerfCounters::local().add(PerfCounter::TableHits);
+            DEBUG_LOG("EspeakEngine: Character table hit (%zu samples)", entry->samples.size());
+            return replay(*entry, callback, event_callback, user_data, cancel);
+        }
+        PerfCounters::local().add(PerfCounter::TableMisses);
+    }
+    std::string cache_key;
+    if (cacheable) {
+        cache_key = AudioCache::makeKey({std::string(wanted), espeak_rate, espeak_pitch, espeak_volume,
+                                         espeak_intonation, espeak_wordgap, rateboost, trimKey()}, text);
+        if (std::shared_ptr<const CachedAudio> cached = cache_.lookup(cache_key)) {
+            PerfCounters::local().add(PerfCounter::CacheHits);
+            DEBUG_LOG("EspeakEngine: Cache hit (%zu samples, %zu events)",
+                      cached->samples.size(), cached->events.size());
+            return replay(*cached, callback, event_callback, user_data, cancel);
+        }
+        PerfCounters::local().add(PerfCounter::CacheMisses);
+    }
 
-    int espeak_intonation = std::clamp(intonation, MIN_INTONATION, MAX_INTONATION);
-    espeak_SetParameter(espeakRANGE, espeak_intonation, 0);
+    selectVoiceLocked(voice);
+    if (wanted != current_voice_) {
+        // The voice failed to load; what is synthesized is in the old one.
+        if (tabled) {
+            character_set = characterSetLocked(current_voice_, rate, pitch, volume, intonation, wordgap, rateboost);
+        }
+        if (cacheable) {
+            cache_key = AudioCache::makeKey({current_voice_, espeak_rate, espeak_pitch, espeak_volume,
+                                             espeak_intonation, espeak_wordgap, rateboost, trimKey()}, text);
+        }
+    }
 
-    int espeak_wordgap = std::clamp(wordgap, MIN_WORDGAP, MAX_WORDGAP);
-    espeak_SetParameter(espeakWORDGAP, espeak_wordgap, 0);
+    {
+        const TimelineSpan span("parameters");
+        espeak_SetParameter(espeakRATE, espeak_rate, 0);
+        espeak_SetParameter(espeakPITCH, espeak_pitch, 0);
+        espeak_SetParameter(espeakVOLUME, espeak_volume, 0);
+        espeak_SetParameter(espeakRANGE, espeak_intonation, 0);
+        espeak_SetParameter(espeakWORDGAP, espeak_wordgap, 0);
+    }
 
     DEBUG_LOG("EspeakEngine: Speaking text (rate=%d->%dwpm%s, pitch=%d, volume=%d->%d, intonation=%d, wordgap=%d)",
               rate, espeak_rate, rateboost ? " (boosted x3)" : "", espeak_pitch, volume, espeak_volume, espeak_intonation, espeak_wordgap);
 
+    CachedAudio recording;
     CallbackContext ctx;
     ctx.callback = callback;
+    ctx.event_callback = event_callback;
     ctx.user_data = user_data;
+    ctx.cancel = cancel;
     ctx.aborted = false;
+    ctx.sample_rate = sample_rate_;
+    ctx.recording = cacheable || tabled ? &recording : nullptr;
+    ctx.trimmer = nullptr;
+    ctx.trimmed = &trimmed_;
+    if (trim_enabled_) {
+        const long long sample_rate = sample_rate_;
+        SilenceTrimSettings settings;
+        settings.threshold = trim_threshold_;
+        settings.fade_samples = static_cast<int>(sample_rate * TRIM_FADE_MS / 1000);
+        settings.window_samples = static_cast<int>(sample_rate * TRIM_WINDOW_MS / 1000);
+        settings.max_gap_samples = static_cast<int>(sample_rate * trim_max_gap_ms_ / 1000);
+        settings.lookahead_samples = (std::min)(static_cast<int>(sample_rate * trim_lookahead_ms_ / 1000),
+                                                (std::max)(settings.max_gap_samples - settings.fade_samples, 0));
+        // SSML breaks are explicit pauses, so only the edges of a document are trimmed.
+        trimmer_.reset(settings, !ssml);
+        ctx.trimmer = &trimmer_;
+    }
+    ctx.char_offset = 0;
+    ctx.sample_base = 0;
+    ctx.samples_emitted = 0;
     g_callback_context = &ctx;
 
-    espeak_ERROR result = espeak_Synth(text.c_str(), text.length() + 1,
-                                       0, POS_CHARACTER, 0,
-                                       espeakCHARS_UTF8, nullptr, nullptr);
+    espeak_ERROR result = EE_OK;
+    if (wide_text) {
+        const TimelineSpan span("espeak_Synth", "chars", static_cast<std::int64_t>(wide_text->length()));
+        result = espeak_Synth(wide_text->c_str(), (wide_text->length() + 1) * sizeof(wchar_t),
+                              0, POS_CHARACTER, 0,
+                              espeakCHARS_WCHAR | (ssml ? espeakSSML : 0), nullptr, nullptr);
+    } else if (spelled) {
+        spell_buffer_.assign(SPELL_PREFIX);
+        appendEscaped(spell_buffer_, text);
+        spell_buffer_.append(SPELL_SUFFIX);
+        // Report positions relative to the token rather than the wrapper document.
+        ctx.char_offset = -static_cast<int>(sizeof(SPELL_PREFIX) - 1);
+        const TimelineSpan span("espeak_Synth", "bytes", static_cast<std::int64_t>(spell_buffer_.length()));
+        result = espeak_Synth(spell_buffer_.c_str(), spell_buffer_.length() + 1,
+                              0, POS_CHARACTER, 0, espeakCHARS_UTF8 | espeakSSML, nullptr, nullptr);
+    } else if (ssml || chunk_first_chars_ == 0 || text.size() <= chunk_first_chars_) {
+        const TimelineSpan span("espeak_Synth", "bytes", static_cast<std::int64_t>(text.length()));
+        result = espeak_Synth(text.c_str(), text.length() + 1,
+                              0, POS_CHARACTER, 0,
+                              espeakCHARS_UTF8 | (ssml ? espeakSSML : 0), nullptr, nullptr);
+    } else {
+        TextChunker chunker(TextChunker::languageOf(current_voice_), chunk_first_chars_, chunk_max_chars_);
+        chunker.reset(text);
+
+        std::string chunk_text;
+        TextChunk chunk{};
+        int chunk_count = 0;
+        while (result == EE_OK && !ctx.aborted && chunker.next(chunk)) {
+            chunk_text.assign(text, chunk.offset, chunk.length);
+            ctx.char_offset = static_cast<int>(chunk.char_offset);
+            ctx.sample_base = ctx.samples_emitted;
+            const TimelineSpan span("espeak_Synth", "bytes", static_cast<std::int64_t>(chunk_text.length()));
+            result = espeak_Synth(chunk_text.c_str(), chunk_text.length() + 1,
+                                  0, POS_CHARACTER, 0,
+                                  espeakCHARS_UTF8 | (chunk.sentence_end ? espeakENDPAUSE : 0),
+                                  nullptr, nullptr);
+            ++chunk_count;
+        }
+        DEBUG_LOG("EspeakEngine: Synthesized %d chunks", chunk_count);
+    }
+
+    if (ctx.trimmer && result == EE_OK && !ctx.aborted) {
+        trimmed_.clear();
+        trimmer_.finish(trimmed_);
+        deliverAudio(ctx, trimmed_.data(), trimmed_.size());
+        DEBUG_LOG("EspeakEngine: Trimmed %lld of %lld samples", trimmer_.removedSamples(), ctx.samples_emitted);
+    }
 
     g_callback_context = nullptr;
 
     if (result != EE_OK) {
-        DEBUG_LOG("EspeakEngine: Synthesis failed with error %d", result);
+        LOG_ERROR("EspeakEngine: Synthesis failed with error %d", result);
         return false;
     }
 
     if (ctx.aborted) {
-        DEBUG_LOG("EspeakEngine: Synthesis aborted by callback");
+        DEBUG_LOG("EspeakEngine: Synthesis aborted");
         return false;
     }
 
+    if (tabled) {
+        characters_.insert(character_set, text, spelled, std::move(recording));
+    } else if (cacheable) {
+        cache_.insert(cache_key, std::move(recording));
+    }
+
     DEBUG_LOG("EspeakEngine: Synthesis completed successfully");
     return true;
 }
 
-void EspeakEngine::stop() noexcept {
-    if (initialized_) {
-        espeak_Cancel();
+int EspeakEngine::espeakRate(int rate, bool rateboost) noexcept {
+    int espeak_rate;
+    if (rate < 0) {
+        espeak_rate = BASE_RATE + (rate * SLOW_RATE_SCALE_FACTOR / RATE_SCALE_DIVISOR);
+    } else {
+        espeak_rate = BASE_RATE + (rate * FAST_RATE_SCALE_FACTOR / RATE_SCALE_DIVISOR);
+    }
+    espeak_rate = std::clamp(espeak_rate, MIN_RATE, MAX_RATE);
+
+    if (rateboost) {
+        espeak_rate = (std::min)(espeak_rate * RATE_BOOST_MULTIPLIER, MAX_BOOSTED_RATE);
+    }
+    return espeak_rate;
+}
+
+int EspeakEngine::espeakPitch(int pitch) noexcept {
+    return std::clamp(pitch, MIN_PITCH, MAX_PITCH);
+}
+
+int EspeakEngine::espeakVolume(int volume) noexcept {
+    return std::clamp(volume * VOLUME_MULTIPLIER, MIN_VOLUME, MAX_VOLUME);
+}
+
+bool EspeakEngine::replay(const CachedAudio& audio, const SpeakCallback& callback,
+                          const EventCallback& event_callback, void* user_data,
+                          const CancelToken* cancel) const {
+    const TimelineSpan span("cached replay", "samples", static_cast<std::int64_t>(audio.samples.size()));
+    const short* samples = audio.samples.data();
+    const std::size_t total = audio.samples.size();
+    std::size_t next_event = 0;
+
+    for (std::size_t offset = 0; offset < total; offset += REPLAY_CHUNK_SAMPLES) {
+        if (cancelRequested(cancel)) {
+            DEBUG_LOG("EspeakEngine: Cached playback cancelled");
+            return false;
+        }
+        const int count = static_cast<int>((std::min)(total - offset, static_cast<std::size_t>(REPLAY_CHUNK_SAMPLES)));
+        if (event_callback) {
+            for (; next_event < audio.events.size() &&
+                   static_cast<std::size_t>(audio.events[next_event].sample) < offset + count; ++next_event) {
+                event_callback(audio.events[next_event], user_data);
+            }
+        }
+        if (!callback(samples + offset, count, user_data)) {
+            DEBUG_LOG("EspeakEngine: Cached playback aborted by callback");
+            return false;
+        }
+    }
+    if (event_callback) {
+        for (; next_event < audio.events.size(); ++next_event) {
+            event_callback(audio.events[next_event], user_data);
+        }
+    }
+    return true;
+}
+
+void EspeakEngine::configureCache(std::size_t max_bytes, bool persist) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!initialized_) {
+        return;
+    }
+    cache_.configure(max_bytes, persist, data_version_);
+}
+
+void EspeakEngine::configureChunking(std::size_t first_chars, std::size_t max_chars) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    chunk_first_chars_ = first_chars;
+    chunk_max_chars_ = max_chars;
+}
+
+void EspeakEngine::configureSilenceTrim(bool enabled, int threshold, int lookahead_ms, int max_gap_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    trim_enabled_ = enabled;
+    trim_threshold_ = threshold;
+    trim_lookahead_ms_ = lookahead_ms;
+    trim_max_gap_ms_ = max_gap_ms;
+}
+
+std::string EspeakEngine::trimKey() const {
+    if (!trim_enabled_) {
+        return {};
+    }
+    return "trim:" + std::to_string(trim_threshold_) + "/" + std::to_string(trim_lookahead_ms_) + "/" +
+           std::to_string(trim_max_gap_ms_);
+}
+
+std::string EspeakEngine::characterSetLocked(std::string_view voice, int rate, int pitch, int volume,
+                                             int intonation, int wordgap, bool rateboost) const {
+    return AudioCache::makeKey({std::string(voice), espeakRate(rate, rateboost), espeakPitch(pitch), espeakVolume(volume),
+                                std::clamp(intonation, MIN_INTONATION, MAX_INTONATION),
+                                std::clamp(wordgap, MIN_WORDGAP, MAX_WORDGAP), rateboost, trimKey()}, {});
+}
+
+void EspeakEngine::configureCharacterTable(std::size_t max_bytes, std::uint64_t generation) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (generation != config_generation_) {
+            // A new configuration may point at voices that load now.
+            config_generation_ = generation;
+            failed_voices_.clear();
+        }
+    }
+    characters_.configure(max_bytes, generation);
+}
+
+bool EspeakEngine::prebuildCharacters(int rate, int pitch, int volume, int intonation, int wordgap,
+                                      bool rateboost, std::string_view voice, const CancelToken* cancel) {
+    const auto discard = [](const short*, int, void*) { return true; };
+    int built = 0;
+    for (char c = FIRST_PRINTABLE; c <= LAST_PRINTABLE; ++c) {
+        while (waiting_speakers_.load(std::memory_order_relaxed) > 0) {
+            std::this_thread::sleep_for(PREBUILD_BACKOFF);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!initialized_ || !characters_.enabled() || (cancel && cancel->cancelled())) {
+            DEBUG_LOG("EspeakEngine: Character table prebuild stopped after %d characters", built);
+            return false;
+        }
+        // Switching voices here would cost every interleaved Speak in another
+        // voice a switch back, so stop and let the next key echo resume.
+        if (!voice.empty() && voice != current_voice_) {
+            DEBUG_LOG("EspeakEngine: Character table prebuild paused after %d characters, voice is '%s'",
+                      built, current_voice_.c_str());
+            return false;
+        }
+        const std::string token(1, c);
+        if (characters_.contains(characterSetLocked(current_voice_, rate, pitch, volume, intonation, wordgap, rateboost), token, false)) {
+            continue;
+        }
+        if (!speakLocked(token, nullptr, rate, pitch, volume, intonation, wordgap, rateboost, discard, nullptr,
+                         nullptr, TextFormat::Plain, cancel, voice)) {
+            DEBUG_LOG("EspeakEngine: Character table prebuild failed at '%c'", c);
+            return false;
+        }
+        ++built;
+    }
+    DEBUG_LOG("EspeakEngine: Character table prebuilt %d characters for '%s'", built, current_voice_.c_str());
+    return true;
+}
+
+bool EspeakEngine::preloadVoices(const std::vector<std::string>& voices, const CancelToken* cancel) {
+    int loaded = 0;
+    for (const std::string& voice : voices) {
+        while (waiting_speakers_.load(std::memory_order_relaxed) > 0) {
+            std::this_thread::sleep_for(PREBUILD_BACKOFF);
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!initialized_ || (cancel && cancel->cancelled())) {
+            DEBUG_LOG("EspeakEngine: Voice preload stopped after %d voices", loaded);
+            return false;
+        }
+        if (voice == current_voice_ || voiceFailedLocked(voice)) {
+            continue;
+        }
+        const std::string selected = current_voice_;
+        if (setVoiceLocked(voice)) {
+            ++loaded;
+        }
+        if (!setVoiceLocked(selected)) {
+            LOG_WARN("EspeakEngine: Failed to reselect voice '%s' after preload", selected.c_str());
+        }
+    }
+    DEBUG_LOG("EspeakEngine: Preloaded %d voices", loaded);
+    return true;
+}
+
+AudioCache::Stats EspeakEngine::cacheStats() const {
+    return cache_.stats();
+}
+
+CharacterTable::Stats EspeakEngine::characterTableStats() const {
+    return characters_.stats();
+}
+
+int EspeakEngine::sampleRate() const noexcept {
+    return sample_rate_;
+}
+
+void EspeakEngine::configureBuffer(int buffer_ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (buffer_ms == buffer_ms_) {
+        return;
+    }
+    buffer_ms_ = buffer_ms;
+    if (!initialized_) {
+        return;
+    }
+
+    // espeak-ng only takes the buffer length at initialization.
+    const std::string voice = current_voice_;
+    espeak_Terminate();
+    initialized_ = false;
+    if (!initializeLocked()) {
+        LOG_WARN("EspeakEngine: Failed to reinitialize with %d ms buffer", buffer_ms);
+        return;
+    }
+    if (!voice.empty() && voice != current_voice_ && espeak_SetVoiceByName(voice.c_str()) == EE_OK) {
+        current_voice_ = voice;
     }
 }
 }
@@ -1,10 +1,19 @@
 #pragma once
 
-#include <windows.h>
+#include <atomic>
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <functional>
+#include <mutex>
+#include <set>
+#include "audio_cache.hpp"
+#include "cancel_token.hpp"
+#include "character_table.hpp"
+#include "silence_trimmer.hpp"
+#include "text_chunker.hpp"
 
 namespace Espeak {
 
@@ -16,7 +25,15 @@ struct VoiceInfo {
     int age;
 };
 
+enum class TextFormat {
+    Plain,
+    Ssml,
+    // Plain text spelled out character by character.
+    Characters
+};
+
 using SpeakCallback = std::function<bool(const short* audio, int sample_count, void* user_data)>;
+using EventCallback = std::function<void(const SynthEvent& event, void* user_data)>;
 
 class EspeakEngine {
 public:
@@ -39,15 +56,119 @@ public:
                              int wordgap,
                              bool rateboost,
                              SpeakCallback callback,
-                             void* user_data);
+                             void* user_data,
+                             EventCallback event_callback = nullptr,
+                             TextFormat format = TextFormat::Plain,
+                             const CancelToken* cancel = nullptr,
+                             std::string_view voice = {});
+
+    [[nodiscard]] bool speak(std::u16string_view text,
+                             int rate,
+                             int pitch,
+                             int volume,
+                             int intonation,
+                             int wordgap,
+                             bool rateboost,
+                             SpeakCallback callback,
+                             void* user_data,
+                             EventCallback event_callback = nullptr,
+                             TextFormat format = TextFormat::Plain,
+                             const CancelToken* cancel = nullptr,
+                             std::string_view voice = {});
+
+    [[nodiscard]] static int espeakRate(int rate, bool rateboost) noexcept;
+
+    [[nodiscard]] static int espeakPitch(int pitch) noexcept;
+
+    [[nodiscard]] static int espeakVolume(int volume) noexcept;
+
+    [[nodiscard]] int sampleRate() const noexcept;
+
+    void configureCache(std::size_t max_bytes, bool persist);
 
-    void stop() noexcept;
+    void configureChunking(std::size_t first_chars, std::size_t max_chars);
+
+    void configureBuffer(int buffer_ms);
+
+    void configureSilenceTrim(bool enabled, int threshold, int lookahead_ms, int max_gap_ms);
+
+    void configureCharacterTable(std::size_t max_bytes, std::uint64_t generation);
+
+    // Fills the character table with printable ASCII for one voice and
+    // parameter set. Each character takes the engine lock on its own and
+    // waits while a foreground speak() is queued, so it can run in the
+    // background. Returns false if it was cancelled or the table is off.
+    [[nodiscard]] bool prebuildCharacters(int rate, int pitch, int volume, int intonation, int wordgap,
+                                          bool rateboost, std::string_view voice, const CancelToken* cancel);
+
+    // Loads each voice and then the selected one again, so their files are in
+    // the OS cache before first use. Yields to speak() the same way as
+    // prebuildCharacters. Returns false if it was cancelled.
+    [[nodiscard]] bool preloadVoices(const std::vector<std::string>& voices, const CancelToken* cancel);
+
+    [[nodiscard]] AudioCache::Stats cacheStats() const;
+
+    [[nodiscard]] CharacterTable::Stats characterTableStats() const;
 
 private:
     EspeakEngine();
     ~EspeakEngine();
 
+    bool initializeLocked();
+
+    bool speakLocked(const std::string& text,
+                     const std::wstring* wide_text,
+                     int rate,
+                     int pitch,
+                     int volume,
+                     int intonation,
+                     int wordgap,
+                     bool rateboost,
+                     SpeakCallback callback,
+                     void* user_data,
+                     EventCallback event_callback,
+                     TextFormat format,
+                     const CancelToken* cancel,
+                     std::string_view voice);
+
+    bool setVoiceLocked(const std::string& voice_name);
+
+    void selectVoiceLocked(std::string_view voice);
+
+    [[nodiscard]] bool voiceFailedLocked(std::string_view voice) const;
+
+    std::string trimKey() const;
+
+    std::string characterSetLocked(std::string_view voice, int rate, int pitch, int volume, int intonation,
+                                   int wordgap, bool rateboost) const;
+
+    bool replay(const CachedAudio& audio, const SpeakCallback& callback,
+                const EventCallback& event_callback, void* user_data,
+                const CancelToken* cancel) const;
+
     bool initialized_;
+    int sample_rate_;
     std::string current_voice_;
+    // Voices espeak-ng refused to load. Cleared when the engine is
+    // reinitialized or the configuration generation changes.
+    std::set<std::string, std::less<>> failed_voices_;
+    std::uint64_t config_generation_;
+    std::string data_version_;
+    std::size_t chunk_first_chars_;
+    std::size_t chunk_max_chars_;
+    int buffer_ms_;
+    bool trim_enabled_;
+    int trim_threshold_;
+    int trim_lookahead_ms_;
+    int trim_max_gap_ms_;
+    SilenceTrimmer trimmer_;
+    std::vector<short> trimmed_;
+    AudioCache cache_;
+    CharacterTable characters_;
+    std::atomic<int> waiting_speakers_;
+    std::string spell_buffer_;
+    std::string utf8_buffer_;
+    std::wstring wide_buffer_;
+    mutable std::mutex mutex_;
 };
 }
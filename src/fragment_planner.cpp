@@ -0,0 +1,294 @@
+#include "fragment_planner.hpp"
+#include "espeak_wrapper.h"
+#include <cmath>
+
+namespace Espeak {
+namespace sapi {
+
+namespace {
+
+constexpr std::size_t NO_FRAGMENT = static_cast<std::size_t>(-1);
+constexpr std::uint32_t NO_SOURCE = UINT32_MAX;
+constexpr int NEUTRAL_PERCENT = 100;
+
+bool is_voiced(const plan_fragment& fragment) {
+    return (fragment.kind == fragment_kind::speak || fragment.kind == fragment_kind::spell_out) &&
+           !fragment.text.empty();
+}
+
+bool is_space(char16_t c) {
+    return c == u' ' || c == u'\t' || c == u'\r' || c == u'\n' || c == 0x00A0 || c == 0x3000;
+}
+
+int relative_percent(int value, int base) {
+    return static_cast<int>(std::lround(100.0 * value / base));
+}
+
+// espeak-ng scales prosody percentages against the parameters set for the
+// call, so a fragment can only join a run whose base it can be expressed in.
+bool expressible(const plan_fragment& fragment, const plan_fragment& base) {
+    return (EspeakEngine::espeakPitch(base.pitch) != 0 ||
+            EspeakEngine::espeakPitch(fragment.pitch) == 0) &&
+           (EspeakEngine::espeakVolume(base.volume) != 0 ||
+            EspeakEngine::espeakVolume(fragment.volume) == 0);
+}
+
+bool is_surrogate_pair(const std::u16string& text, std::size_t i) {
+    return i > 0 && text[i] >= 0xDC00 && text[i] <= 0xDFFF && text[i - 1] >= 0xD800 && text[i - 1] <= 0xDBFF;
+}
+
+// espeak-ng reports text positions in code points and counts markup, so the
+// table is indexed by code point; markup inherits the position of the text after it.
+void finish_positions(const std::u16string& text, const std::vector<std::uint32_t>& sources,
+                      std::uint32_t end_source, std::vector<std::uint32_t>& positions) {
+    positions.clear();
+    positions.reserve(text.size() + 1);
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        if (!is_surrogate_pair(text, i)) {
+            positions.push_back(sources[i]);
+        }
+    }
+    positions.push_back(end_source);
+    for (std::size_t i = positions.size() - 1; i-- > 0;) {
+        if (positions[i] == NO_SOURCE) {
+            positions[i] = positions[i + 1];
+        }
+    }
+}
+
+void track(std::vector<std::uint32_t>* sources, std::size_t size, std::uint32_t source) {
+    if (sources) {
+        sources->resize(size, source);
+    }
+}
+
+void append_ascii(std::u16string& out, const char* text) {
+    for (; *text; ++text) {
+        out.push_back(static_cast<char16_t>(*text));
+    }
+}
+
+void append_number(std::u16string& out, unsigned long value) {
+    append_ascii(out, std::to_string(value).c_str());
+}
+
+void append_escaped(std::u16string& out, std::u16string_view text,
+                    std::vector<std::uint32_t>* sources, std::uint32_t source_offset) {
+    for (std::size_t i = 0; i < text.size(); ++i) {
+        switch (text[i]) {
+            case u'&': append_ascii(out, "&amp;"); break;
+            case u'<': append_ascii(out, "&lt;"); break;
+            case u'>': append_ascii(out, "&gt;"); break;
+            case u'"': append_ascii(out, "&quot;"); break;
+            default: out.push_back(text[i]); break;
+        }
+        track(sources, out.size(), source_offset + static_cast<std::uint32_t>(i));
+    }
+}
+
+void append_percent_attribute(std::u16string& out, const char* name, int percent) {
+    if (percent == NEUTRAL_PERCENT) {
+        return;
+    }
+    out.push_back(u' ');
+    append_ascii(out, name);
+    append_ascii(out, "=\"");
+    append_number(out, static_cast<unsigned long>(percent));
+    append_ascii(out, "%\"");
+}
+
+void build_document(const std::vector<plan_fragment>& fragments, std::size_t first, std::size_t end,
+                    const plan_options& options, synth_unit& unit) {
+    const plan_fragment& base = fragments[unit.base];
+    const int base_rate = EspeakEngine::espeakRate(base.rate, options.rateboost);
+    const int base_pitch = EspeakEngine::espeakPitch(base.pitch);
+    const int base_volume = EspeakEngine::espeakVolume(base.volume);
+
+    std::vector<std::uint32_t> source_table;
+    std::vector<std::uint32_t>* sources = options.map_positions ? &source_table : nullptr;
+    std::uint32_t end_source = 0;
+
+    std::u16string& out = unit.text;
+    append_ascii(out, "<speak>");
+    char16_t last_spoken = u' ';
+
+    for (std::size_t i = first; i < end; ++i) {
+        const plan_fragment& fragment = fragments[i];
+        if (fragment.kind == fragment_kind::bookmark) {
+            append_ascii(out, "<mark name=\"");
+            append_number(out, static_cast<unsigned long>(unit.marks.size()));
+            append_ascii(out, "\"/>");
+            unit.marks.push_back(i);
+            continue;
+        }
+        if (fragment.kind == fragment_kind::silence) {
+            if (fragment.silence_ms > 0) {
+                append_ascii(out, "<break time=\"");
+                append_number(out, fragment.silence_ms);
+                append_ascii(out, "ms\"/>");
+            }
+            continue;
+        }
+        if (!is_voiced(fragment)) {
+            continue;
+        }
+
+        if (!is_space(last_spoken) && !is_space(fragment.text.front())) {
+            out.push_back(u' ');
+        }
+        last_spoken = fragment.text.back();
+        unit.spoken.push_back(i);
+
+        const int rate = relative_percent(EspeakEngine::espeakRate(fragment.rate, options.rateboost), base_rate);
+        const int pitch = base_pitch == 0 ? NEUTRAL_PERCENT
+                                          : relative_percent(EspeakEngine::espeakPitch(fragment.pitch), base_pitch);
+        const int volume = base_volume == 0 ? NEUTRAL_PERCENT
+                                            : relative_percent(EspeakEngine::espeakVolume(fragment.volume), base_volume);
+        const bool prosody = rate != NEUTRAL_PERCENT || pitch != NEUTRAL_PERCENT || volume != NEUTRAL_PERCENT;
+
+        if (prosody) {
+            append_ascii(out, "<prosody");
+            append_percent_attribute(out, "rate", rate);
+            append_percent_attribute(out, "pitch", pitch);
+            append_percent_attribute(out, "volume", volume);
+            out.push_back(u'>');
+        }
+        if (fragment.emphasis) {
+            append_ascii(out, "<emphasis>");
+        }
+        if (fragment.kind == fragment_kind::spell_out) {
+            append_ascii(out, "<say-as interpret-as=\"characters\">");
+        }
+        track(sources, out.size(), NO_SOURCE);
+
+        append_escaped(out, fragment.text, sources, fragment.source_offset);
+        end_source = fragment.source_offset + static_cast<std::uint32_t>(fragment.text.size());
+
+        if (fragment.kind == fragment_kind::spell_out) {
+            append_ascii(out, "</say-as>");
+        }
+        if (fragment.emphasis) {
+            append_ascii(out, "</emphasis>");
+        }
+        if (prosody) {
+            append_ascii(out, "</prosody>");
+        }
+    }
+
+    append_ascii(out, "</speak>");
+    unit.ssml = true;
+
+    if (sources) {
+        track(sources, out.size(), NO_SOURCE);
+        finish_positions(out, source_table, end_source, unit.positions);
+    }
+}
+
+void add_bookmarks(std::vector<synth_unit>& units, const std::vector<std::size_t>& marks) {
+    if (marks.empty()) {
+        return;
+    }
+    synth_unit unit;
+    unit.marks = marks;
+    units.push_back(std::move(unit));
+}
+
+void add_plain(const std::vector<plan_fragment>& fragments, std::size_t index, const plan_options& options,
+               std::vector<synth_unit>& units) {
+    const plan_fragment& fragment = fragments[index];
+    synth_unit unit;
+    unit.base = index;
+    unit.spoken.push_back(index);
+    unit.spell = fragment.kind == fragment_kind::spell_out;
+    unit.text.assign(fragment.text);
+    if (options.map_positions) {
+        std::vector<std::uint32_t> sources(unit.text.size());
+        for (std::size_t i = 0; i < sources.size(); ++i) {
+            sources[i] = fragment.source_offset + static_cast<std::uint32_t>(i);
+        }
+        finish_positions(unit.text, sources,
+                         fragment.source_offset + static_cast<std::uint32_t>(unit.text.size()), unit.positions);
+    }
+    units.push_back(std::move(unit));
+}
+
+void plan_run(const std::vector<plan_fragment>& fragments, std::size_t first, std::size_t end,
+              std::size_t base, const plan_options& options, std::vector<synth_unit>& units) {
+    std::size_t voiced = 0;
+    for (std::size_t i = first; i < end; ++i) {
+        if (is_voiced(fragments[i])) {
+            ++voiced;
+        }
+    }
+
+    if (voiced > 1) {
+        synth_unit unit;
+        unit.base = base;
+        build_document(fragments, first, end, options, unit);
+        units.push_back(std::move(unit));
+        return;
+    }
+
+    // A lone spoken fragment goes out as plain text so it stays cacheable and chunkable;
+    // a lone spelled one is spelled by the engine, which can serve it from the character table.
+    std::vector<std::size_t> marks;
+    for (std::size_t i = first; i < end; ++i) {
+        if (fragments[i].kind == fragment_kind::bookmark) {
+            marks.push_back(i);
+        } else if (is_voiced(fragments[i])) {
+            add_bookmarks(units, marks);
+            marks.clear();
+            add_plain(fragments, i, options, units);
+        }
+    }
+    add_bookmarks(units, marks);
+}
+}
+
+void plan_fragments(const std::vector<plan_fragment>& fragments, const plan_options& options,
+                    std::vector<synth_unit>& units) {
+    units.clear();
+
+    if (!options.merge) {
+        for (std::size_t i = 0; i < fragments.size(); ++i) {
+            if (fragments[i].kind == fragment_kind::bookmark) {
+                add_bookmarks(units, {i});
+            } else if (is_voiced(fragments[i])) {
+                add_plain(fragments, i, options, units);
+            }
+        }
+        return;
+    }
+
+    std::size_t first = 0;
+    while (first < fragments.size()) {
+        std::size_t end = first;
+        std::size_t base = NO_FRAGMENT;
+        std::size_t chars = 0;
+        for (; end < fragments.size(); ++end) {
+            const plan_fragment& fragment = fragments[end];
+            if (fragment.kind == fragment_kind::ignored) {
+                break;
+            }
+            if (!is_voiced(fragment)) {
+                continue;
+            }
+            if (base == NO_FRAGMENT) {
+                base = end;
+            } else if (chars + fragment.text.size() > options.max_chars ||
+                       !expressible(fragment, fragments[base])) {
+                break;
+            }
+            chars += fragment.text.size();
+        }
+
+        if (end == first) {
+            ++first;
+            continue;
+        }
+        plan_run(fragments, first, end, base, options, units);
+        first = end;
+    }
+}
+}
+}
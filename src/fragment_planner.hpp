@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Espeak {
+namespace sapi {
+
+enum class fragment_kind {
+    speak,
+    spell_out,
+    silence,
+    bookmark,
+    ignored
+};
+
+struct plan_fragment {
+    fragment_kind kind = fragment_kind::ignored;
+    std::u16string_view text;
+    std::uint32_t source_offset = 0;
+    int rate = 0;
+    int pitch = 50;
+    int volume = 100;
+    bool emphasis = false;
+    unsigned long silence_ms = 0;
+};
+
+// One espeak_Synth call. Units without spoken fragments only carry bookmarks,
+// which are emitted at the current stream position. When positions are mapped,
+// positions[i] is the SAPI source offset of the i-th code point of text, with
+// one extra entry for the end of the text.
+struct synth_unit {
+    std::size_t base = 0;
+    std::vector<std::size_t> spoken;
+    std::vector<std::size_t> marks;
+    bool ssml = false;
+    bool spell = false;
+    std::u16string text;
+    std::vector<std::uint32_t> positions;
+};
+
+struct plan_options {
+    bool merge = true;
+    bool rateboost = false;
+    std::size_t max_chars = 400;
+    bool map_positions = false;
+};
+
+void plan_fragments(const std::vector<plan_fragment>& fragments, const plan_options& options,
+                    std::vector<synth_unit>& units);
+}
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+namespace Espeak {
+
+// Applies a gain that moves linearly to a new target over ramp_samples, so
+// volume changes in the middle of speech do not click.
+class GainRamp {
+public:
+    explicit GainRamp(std::size_t ramp_samples) noexcept
+        : ramp_samples_((std::max)(ramp_samples, std::size_t{1}))
+    {}
+
+    void setTarget(float gain) noexcept
+    {
+        if (gain != target_) {
+            target_ = gain;
+            step_ = (target_ - current_) / static_cast<float>(ramp_samples_);
+        }
+    }
+
+    void reset(float gain = 1.0f) noexcept
+    {
+        current_ = gain;
+        target_ = gain;
+        step_ = 0.0f;
+    }
+
+    [[nodiscard]] bool unity() const noexcept { return current_ == 1.0f && target_ == 1.0f; }
+
+    void apply(short* samples, std::size_t count) noexcept
+    {
+        for (std::size_t i = 0; i < count; ++i) {
+            if (current_ != target_) {
+                current_ += step_;
+                if ((step_ > 0.0f && current_ > target_) || (step_ < 0.0f && current_ < target_)) {
+                    current_ = target_;
+                }
+            }
+            const float scaled = static_cast<float>(samples[i]) * current_;
+            samples[i] = static_cast<short>(std::clamp(scaled, -32768.0f, 32767.0f));
+        }
+    }
+
+private:
+    std::size_t ramp_samples_;
+    float current_ = 1.0f;
+    float target_ = 1.0f;
+    float step_ = 0.0f;
+};
+}
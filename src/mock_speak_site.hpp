@@ -0,0 +1,176 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "speak_site.hpp"
+
+namespace Espeak {
+namespace sapi {
+
+// An in-memory speak_site for headless runs: records the audio and events it
+// receives and raises action flags the way ISpTTSEngineSite does. Rate and
+// volume flags clear when the engine reads the new value.
+class mock_speak_site : public speak_site
+{
+public:
+    struct recorded_event {
+        site_event_type type = site_event_type::bookmark;
+        std::uint64_t offset = 0;
+        std::uint32_t source_start = 0;
+        std::uint32_t source_length = 0;
+        long bookmark_id = 0;
+        std::u16string bookmark;
+    };
+
+    // Called after each write with the total number of bytes received.
+    std::function<void(mock_speak_site& site, std::size_t total)> on_write;
+
+    unsigned actions() override
+    {
+        return actions_;
+    }
+
+    bool write(const void* data, std::size_t size, std::size_t& written) override
+    {
+        ++write_calls_;
+        if (fail_writes_) {
+            return false;
+        }
+        written = write_limit_ > 0 && size > write_limit_ ? write_limit_ : size;
+        const auto* bytes = static_cast<const std::uint8_t*>(data);
+        audio_.insert(audio_.end(), bytes, bytes + written);
+        if (abort_after_ > 0 && audio_.size() >= abort_after_) {
+            actions_ |= SITE_ACTION_ABORT;
+        }
+        if (skip_after_ > 0 && audio_.size() >= skip_after_) {
+            actions_ |= SITE_ACTION_SKIP;
+            skip_after_ = 0;
+        }
+        if (on_write) {
+            on_write(*this, audio_.size());
+        }
+        return true;
+    }
+
+    void add_events(const site_event* events, std::size_t count) override
+    {
+        ++event_calls_;
+        for (std::size_t i = 0; i < count; ++i) {
+            recorded_event event;
+            event.type = events[i].type;
+            event.offset = events[i].offset;
+            event.source_start = events[i].source_start;
+            event.source_length = events[i].source_length;
+            event.bookmark_id = events[i].bookmark_id;
+            if (events[i].bookmark) {
+                event.bookmark = events[i].bookmark;
+            }
+            events_.push_back(std::move(event));
+        }
+    }
+
+    long rate() override
+    {
+        actions_ &= ~SITE_ACTION_RATE;
+        return rate_;
+    }
+
+    unsigned short volume() override
+    {
+        actions_ &= ~SITE_ACTION_VOLUME;
+        return volume_;
+    }
+
+    void complete_skip() override
+    {
+        actions_ &= ~SITE_ACTION_SKIP;
+        ++skips_;
+    }
+
+    // The rate and volume in effect when a call starts, without raising flags.
+    void set_initial(long rate, unsigned short volume)
+    {
+        rate_ = rate;
+        volume_ = volume;
+    }
+
+    void set_rate(long rate)
+    {
+        rate_ = rate;
+        actions_ |= SITE_ACTION_RATE;
+    }
+
+    void set_volume(unsigned short volume)
+    {
+        volume_ = volume;
+        actions_ |= SITE_ACTION_VOLUME;
+    }
+
+    void abort()
+    {
+        actions_ |= SITE_ACTION_ABORT;
+    }
+
+    void skip()
+    {
+        actions_ |= SITE_ACTION_SKIP;
+    }
+
+    void abort_after(std::size_t bytes)
+    {
+        abort_after_ = bytes;
+    }
+
+    void skip_after(std::size_t bytes)
+    {
+        skip_after_ = bytes;
+    }
+
+    // Accepts at most this many bytes per write, like a site with a small buffer.
+    void set_write_limit(std::size_t bytes)
+    {
+        write_limit_ = bytes;
+    }
+
+    void set_fail_writes(bool fail)
+    {
+        fail_writes_ = fail;
+    }
+
+    void reset()
+    {
+        actions_ = 0;
+        abort_after_ = 0;
+        skip_after_ = 0;
+        audio_.clear();
+        events_.clear();
+        write_calls_ = 0;
+        event_calls_ = 0;
+        skips_ = 0;
+    }
+
+    [[nodiscard]] const std::vector<std::uint8_t>& audio() const noexcept { return audio_; }
+    [[nodiscard]] const std::vector<recorded_event>& events() const noexcept { return events_; }
+    [[nodiscard]] std::size_t write_calls() const noexcept { return write_calls_; }
+    [[nodiscard]] std::size_t event_calls() const noexcept { return event_calls_; }
+    [[nodiscard]] std::size_t skips() const noexcept { return skips_; }
+
+private:
+    unsigned actions_ = 0;
+    long rate_ = 0;
+    unsigned short volume_ = 100;
+    std::size_t abort_after_ = 0;
+    std::size_t skip_after_ = 0;
+    std::size_t write_limit_ = 0;
+    bool fail_writes_ = false;
+    std::vector<std::uint8_t> audio_;
+    std::vector<recorded_event> events_;
+    std::size_t write_calls_ = 0;
+    std::size_t event_calls_ = 0;
+    std::size_t skips_ = 0;
+};
+}
+}
@@ -0,0 +1,61 @@
+#include "pcm_write_buffer.hpp"
+#include <utility>
+
+namespace Espeak {
+namespace sapi {
+
+pcm_write_buffer::pcm_write_buffer(sink_type sink, std::size_t capacity_bytes,
+                                   std::chrono::milliseconds max_latency)
+    : sink_(std::move(sink))
+    , capacity_(capacity_bytes)
+    , max_latency_(max_latency)
+    , flush_count_(0)
+{
+    buffer_.reserve(capacity_);
+}
+
+bool pcm_write_buffer::append(const std::uint8_t* data, std::size_t size)
+{
+    if (!data || size == 0) {
+        return true;
+    }
+
+    if (capacity_ == 0) {
+        ++flush_count_;
+        return sink_(data, size);
+    }
+
+    if (buffer_.empty()) {
+        if (size >= capacity_) {
+            ++flush_count_;
+            return sink_(data, size);
+        }
+        first_pending_ = clock::now();
+    }
+
+    buffer_.insert(buffer_.end(), data, data + size);
+
+    if (buffer_.size() >= capacity_ || clock::now() - first_pending_ >= max_latency_) {
+        return flush();
+    }
+    return true;
+}
+
+bool pcm_write_buffer::flush()
+{
+    if (buffer_.empty()) {
+        return true;
+    }
+
+    ++flush_count_;
+    const bool ok = sink_(buffer_.data(), buffer_.size());
+    buffer_.clear();
+    return ok;
+}
+
+void pcm_write_buffer::discard() noexcept
+{
+    buffer_.clear();
+}
+}
+}
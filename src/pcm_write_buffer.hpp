@@ -0,0 +1,48 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Espeak {
+namespace sapi {
+
+class pcm_write_buffer
+{
+public:
+    using sink_type = std::function<bool(const std::uint8_t* data, std::size_t size)>;
+    using clock = std::chrono::steady_clock;
+
+    pcm_write_buffer(sink_type sink, std::size_t capacity_bytes, std::chrono::milliseconds max_latency);
+
+    pcm_write_buffer(const pcm_write_buffer&) = delete;
+    pcm_write_buffer& operator=(const pcm_write_buffer&) = delete;
+
+    [[nodiscard]] bool append(const std::uint8_t* data, std::size_t size);
+
+    [[nodiscard]] bool flush();
+
+    void discard() noexcept;
+
+    [[nodiscard]] std::size_t pending() const noexcept
+    {
+        return buffer_.size();
+    }
+
+    [[nodiscard]] std::uint64_t flush_count() const noexcept
+    {
+        return flush_count_;
+    }
+
+private:
+    sink_type sink_;
+    std::size_t capacity_;
+    std::chrono::milliseconds max_latency_;
+    std::vector<std::uint8_t> buffer_;
+    clock::time_point first_pending_;
+    std::uint64_t flush_count_;
+};
+}
+}
@@ -0,0 +1,300 @@
+#include "perf_counters.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <tlhelp32.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "debug_log.h"
+
+namespace Espeak {
+
+namespace {
+
+constexpr const char* COUNTER_NAMES[PERF_COUNTER_COUNT] = {
+    "speak_calls",
+    "fragments",
+    "synth_us",
+    "write_blocked_us",
+    "bytes_produced",
+    "aborts",
+    "voice_switches",
+    "cache_hits",
+    "cache_misses",
+    "table_hits",
+    "table_misses",
+};
+
+constexpr const char* STAGE_NAMES[PERF_STAGE_COUNT] = {
+    "warm-up ready",
+    "engine created",
+    "first Speak",
+    "first audio",
+};
+
+#ifndef _WIN32
+constexpr const char* SHM_DIR = "/dev/shm";
+#endif
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+static_assert(std::is_standard_layout_v<PerfCounterBlock>);
+
+std::uint32_t currentPid() {
+#ifdef _WIN32
+    return static_cast<std::uint32_t>(GetCurrentProcessId());
+#else
+    return static_cast<std::uint32_t>(getpid());
+#endif
+}
+
+std::string namePrefix() {
+#ifdef _WIN32
+    return "Local\\EspeakSAPIPerf.v2.";
+#else
+    return "/espeak-sapi-perf.v2-" + std::to_string(getuid()) + "-";
+#endif
+}
+
+bool validBlock(const PerfCounterBlock* block) {
+    return block->magic.load(std::memory_order_acquire) == PERF_BLOCK_MAGIC &&
+           block->version.load(std::memory_order_relaxed) == PERF_BLOCK_VERSION;
+}
+}
+
+PerfCounters& PerfCounters::local() {
+    static PerfCounters counters;
+    return counters;
+}
+
+PerfCounters::PerfCounters()
+    : block_(nullptr)
+    , mapping_(nullptr)
+    , owner_(true)
+    , writable_(true)
+    , name_(blockName(currentPid()))
+{
+    void* view = nullptr;
+
+#ifdef _WIN32
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0,
+                                        static_cast<DWORD>(sizeof(PerfCounterBlock)), name_.c_str());
+    if (mapping) {
+        view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(PerfCounterBlock));
+        if (view) {
+            mapping_ = mapping;
+        } else {
+            CloseHandle(mapping);
+        }
+    }
+#else
+    // A block left behind by a crashed process with the same pid is reused.
+    const int fd = shm_open(name_.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd >= 0) {
+        if (ftruncate(fd, static_cast<off_t>(sizeof(PerfCounterBlock))) == 0) {
+            view = mmap(nullptr, sizeof(PerfCounterBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (view == MAP_FAILED) {
+                view = nullptr;
+            } else {
+                mapping_ = view;
+            }
+        }
+        close(fd);
+    }
+#endif
+
+    if (view) {
+        std::memset(view, 0, sizeof(PerfCounterBlock));
+        block_ = static_cast<PerfCounterBlock*>(view);
+    } else {
+        LOG_WARN("PerfCounters: Cannot share '%s', keeping counters local", name_.c_str());
+        fallback_.reset(new PerfCounterBlock());
+        block_ = fallback_.get();
+    }
+
+    block_->pid.store(currentPid(), std::memory_order_relaxed);
+    block_->started_unix.store(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                                   std::chrono::system_clock::now().time_since_epoch()).count()),
+                               std::memory_order_relaxed);
+    block_->version.store(PERF_BLOCK_VERSION, std::memory_order_relaxed);
+    block_->magic.store(PERF_BLOCK_MAGIC, std::memory_order_release);
+}
+
+PerfCounters::PerfCounters(std::uint32_t pid, bool writable)
+    : block_(nullptr)
+    , mapping_(nullptr)
+    , owner_(false)
+    , writable_(writable)
+    , name_(blockName(pid))
+{
+    void* view = nullptr;
+
+#ifdef _WIN32
+    const DWORD access = writable ? FILE_MAP_READ | FILE_MAP_WRITE : FILE_MAP_READ;
+    HANDLE mapping = OpenFileMappingA(access, FALSE, name_.c_str());
+    if (!mapping) {
+        return;
+    }
+    view = MapViewOfFile(mapping, access, 0, 0, sizeof(PerfCounterBlock));
+    if (!view) {
+        CloseHandle(mapping);
+        return;
+    }
+    mapping_ = mapping;
+#else
+    const int fd = shm_open(name_.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info = {};
+    if (fstat(fd, &info) == 0 && static_cast<std::size_t>(info.st_size) >= sizeof(PerfCounterBlock)) {
+        view = mmap(nullptr, sizeof(PerfCounterBlock), writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                    MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED) {
+            view = nullptr;
+        }
+    }
+    close(fd);
+    if (!view) {
+        return;
+    }
+    mapping_ = view;
+#endif
+
+    block_ = static_cast<PerfCounterBlock*>(view);
+    if (!validBlock(block_)) {
+        unmap();
+    }
+}
+
+PerfCounters::~PerfCounters() {
+    unmap();
+}
+
+void PerfCounters::unmap() noexcept {
+    if (!mapping_) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(block_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+#else
+    munmap(mapping_, sizeof(PerfCounterBlock));
+    if (owner_) {
+        shm_unlink(name_.c_str());
+    }
+#endif
+    block_ = nullptr;
+    mapping_ = nullptr;
+}
+
+std::array<std::uint64_t, PERF_HISTOGRAM_BUCKETS> PerfCounters::histogram(PerfHistogram histogram) const noexcept {
+    std::array<std::uint64_t, PERF_HISTOGRAM_BUCKETS> out{};
+    const auto& buckets = block_->histograms[static_cast<std::size_t>(histogram)];
+    for (std::size_t i = 0; i < PERF_HISTOGRAM_BUCKETS; ++i) {
+        out[i] = buckets[i].load(std::memory_order_relaxed);
+    }
+    return out;
+}
+
+std::uint32_t PerfCounters::pid() const noexcept {
+    return block_->pid.load(std::memory_order_relaxed);
+}
+
+bool PerfCounters::requestTimeline() noexcept {
+    if (!writable_ || !block_) {
+        return false;
+    }
+    block_->timeline_requests.fetch_add(1, std::memory_order_acq_rel);
+    return true;
+}
+
+std::uint64_t PerfCounters::startedUnix() const noexcept {
+    return block_->started_unix.load(std::memory_order_relaxed);
+}
+
+std::size_t PerfCounters::bucket(double ms) noexcept {
+    std::size_t index = 0;
+    for (double limit = 1.0; index + 1 < PERF_HISTOGRAM_BUCKETS && ms >= limit; limit *= 2.0) {
+        ++index;
+    }
+    return index;
+}
+
+double PerfCounters::bucketLimit(std::size_t bucket) noexcept {
+    return bucket + 1 < PERF_HISTOGRAM_BUCKETS ? std::ldexp(1.0, static_cast<int>(bucket)) : 0.0;
+}
+
+const char* PerfCounters::name(PerfCounter counter) noexcept {
+    const auto index = static_cast<std::size_t>(counter);
+    return index < PERF_COUNTER_COUNT ? COUNTER_NAMES[index] : "unknown";
+}
+
+const char* PerfCounters::name(PerfStage stage) noexcept {
+    const auto index = static_cast<std::size_t>(stage);
+    return index < PERF_STAGE_COUNT ? STAGE_NAMES[index] : "unknown";
+}
+
+std::string PerfCounters::blockName(std::uint32_t pid) {
+    return namePrefix() + std::to_string(pid);
+}
+
+std::vector<std::uint32_t> PerfCounters::processes() {
+    std::vector<std::uint32_t> pids;
+
+#ifdef _WIN32
+    HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPPROCESS, 0);
+    if (snapshot == INVALID_HANDLE_VALUE) {
+        return pids;
+    }
+    PROCESSENTRY32 entry = {};
+    entry.dwSize = sizeof(entry);
+    for (BOOL more = Process32First(snapshot, &entry); more; more = Process32Next(snapshot, &entry)) {
+        HANDLE mapping = OpenFileMappingA(FILE_MAP_READ, FALSE, blockName(entry.th32ProcessID).c_str());
+        if (mapping) {
+            CloseHandle(mapping);
+            pids.push_back(static_cast<std::uint32_t>(entry.th32ProcessID));
+        }
+    }
+    CloseHandle(snapshot);
+#else
+    // shm_open names live in /dev/shm on Linux; elsewhere pass pids explicitly.
+    const std::string prefix = namePrefix().substr(1);
+    DIR* dir = opendir(SHM_DIR);
+    if (!dir) {
+        return pids;
+    }
+    while (const dirent* entry = readdir(dir)) {
+        if (std::strncmp(entry->d_name, prefix.c_str(), prefix.size()) != 0) {
+            continue;
+        }
+        char* end = nullptr;
+        const unsigned long pid = std::strtoul(entry->d_name + prefix.size(), &end, 10);
+        if (*end != '\0' || pid == 0) {
+            continue;
+        }
+        if (kill(static_cast<pid_t>(pid), 0) == 0 || errno == EPERM) {
+            pids.push_back(static_cast<std::uint32_t>(pid));
+        } else {
+            shm_unlink(("/" + std::string(entry->d_name)).c_str());
+        }
+    }
+    closedir(dir);
+#endif
+
+    return pids;
+}
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Espeak {
+
+enum class PerfCounter : std::uint32_t {
+    SpeakCalls,
+    Fragments,
+    SynthMicroseconds,
+    WriteBlockedMicroseconds,
+    BytesProduced,
+    Aborts,
+    VoiceSwitches,
+    CacheHits,
+    CacheMisses,
+    TableHits,
+    TableMisses,
+    Count
+};
+
+enum class PerfHistogram : std::uint32_t {
+    FirstAudio,
+    AbortLatency,
+    Count
+};
+
+// Points in a host's cold start, timed from DLL attach.
+enum class PerfStage : std::uint32_t {
+    WarmupReady,
+    EngineCreated,
+    FirstSpeak,
+    FirstAudio,
+    Count
+};
+
+constexpr std::size_t PERF_COUNTER_COUNT = static_cast<std::size_t>(PerfCounter::Count);
+constexpr std::size_t PERF_HISTOGRAM_COUNT = static_cast<std::size_t>(PerfHistogram::Count);
+constexpr std::size_t PERF_STAGE_COUNT = static_cast<std::size_t>(PerfStage::Count);
+
+// Bucket i counts samples below 2^i ms; the last bucket takes the rest.
+constexpr std::size_t PERF_HISTOGRAM_BUCKETS = 12;
+
+constexpr std::uint32_t PERF_BLOCK_MAGIC = 0x46524550;
+constexpr std::uint32_t PERF_BLOCK_VERSION = 2;
+
+// The shared layout. Writers update it with relaxed atomics; readers in other
+// processes see each value torn-free but not a consistent snapshot.
+struct PerfCounterBlock {
+    std::atomic<std::uint32_t> magic;
+    std::atomic<std::uint32_t> version;
+    std::atomic<std::uint32_t> pid;
+    std::atomic<std::uint32_t> timeline_requests;
+    std::atomic<std::uint64_t> started_unix;
+    std::array<std::atomic<std::uint64_t>, PERF_COUNTER_COUNT> counters;
+    std::array<std::array<std::atomic<std::uint64_t>, PERF_HISTOGRAM_BUCKETS>, PERF_HISTOGRAM_COUNT> histograms;
+    // Microseconds from DLL attach, 0 until the stage is reached.
+    std::array<std::atomic<std::uint64_t>, PERF_STAGE_COUNT> stages;
+};
+
+// Per-process performance counters in a named shared-memory block, so a
+// viewer can attach to running hosts. If the block cannot be created the
+// counters stay process-local and are still safe to update.
+class PerfCounters {
+public:
+    // The counters of this process.
+    static PerfCounters& local();
+
+    // Opens the block of another process, for reading unless writable.
+    explicit PerfCounters(std::uint32_t pid, bool writable = false);
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    [[nodiscard]] bool isOpen() const noexcept { return block_ != nullptr; }
+
+    [[nodiscard]] bool isShared() const noexcept { return mapping_ != nullptr; }
+
+    void add(PerfCounter counter, std::uint64_t value = 1) noexcept {
+        block_->counters[static_cast<std::size_t>(counter)].fetch_add(value, std::memory_order_relaxed);
+    }
+
+    void record(PerfHistogram histogram, double ms) noexcept {
+        block_->histograms[static_cast<std::size_t>(histogram)][bucket(ms)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Keeps the first time a stage is reached; returns false for later calls.
+    bool markStage(PerfStage stage, std::uint64_t us) noexcept {
+        std::uint64_t unset = 0;
+        return block_->stages[static_cast<std::size_t>(stage)].compare_exchange_strong(
+            unset, us > 0 ? us : 1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::uint64_t stage(PerfStage stage) const noexcept {
+        return block_->stages[static_cast<std::size_t>(stage)].load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::uint64_t get(PerfCounter counter) const noexcept {
+        return block_->counters[static_cast<std::size_t>(counter)].load(std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] std::array<std::uint64_t, PERF_HISTOGRAM_BUCKETS> histogram(PerfHistogram histogram) const noexcept;
+
+    [[nodiscard]] std::uint32_t pid() const noexcept;
+
+    // Asks the process to write out its span timeline; needs a writable block.
+    bool requestTimeline() noexcept;
+
+    // Bumped by each request; the owner compares it with the last one served.
+    [[nodiscard]] std::uint32_t timelineRequests() const noexcept {
+        return block_->timeline_requests.load(std::memory_order_acquire);
+    }
+
+    [[nodiscard]] std::uint64_t startedUnix() const noexcept;
+
+    [[nodiscard]] static std::size_t bucket(double ms) noexcept;
+
+    // Upper bound of a bucket in ms; the last bucket has none and returns 0.
+    [[nodiscard]] static double bucketLimit(std::size_t bucket) noexcept;
+
+    [[nodiscard]] static const char* name(PerfCounter counter) noexcept;
+
+    [[nodiscard]] static const char* name(PerfStage stage) noexcept;
+
+    [[nodiscard]] static std::string blockName(std::uint32_t pid);
+
+    // Running processes of this user that publish counters.
+    [[nodiscard]] static std::vector<std::uint32_t> processes();
+
+private:
+    PerfCounters();
+
+    void unmap() noexcept;
+
+    PerfCounterBlock* block_;
+    void* mapping_;
+    bool owner_;
+    bool writable_;
+    std::string name_;
+    std::unique_ptr<PerfCounterBlock> fallback_;
+};
+}
@@ -0,0 +1,275 @@
+#include "resampler.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define ESPEAK_RESAMPLER_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#else
+#define ESPEAK_RESAMPLER_X86 0
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define ESPEAK_TARGET(isa) __attribute__((target(isa)))
+#else
+#define ESPEAK_TARGET(isa)
+#endif
+
+namespace Espeak {
+
+namespace {
+
+constexpr double PI = 3.14159265358979323846;
+constexpr double ROLLOFF = 0.92;
+constexpr double KAISER_BETA = 8.0;
+constexpr int TAP_ALIGNMENT = 8;
+constexpr float PCM16_SCALE = 1.0f / 32768.0f;
+
+float dotScalar(const float* a, const float* b, int n) {
+    float acc0 = 0.0f;
+    float acc1 = 0.0f;
+    float acc2 = 0.0f;
+    float acc3 = 0.0f;
+    for (int i = 0; i < n; i += 4) {
+        acc0 += a[i] * b[i];
+        acc1 += a[i + 1] * b[i + 1];
+        acc2 += a[i + 2] * b[i + 2];
+        acc3 += a[i + 3] * b[i + 3];
+    }
+    return (acc0 + acc1) + (acc2 + acc3);
+}
+
+#if ESPEAK_RESAMPLER_X86
+ESPEAK_TARGET("sse2")
+float dotSse2(const float* a, const float* b, int n) {
+    __m128 acc0 = _mm_setzero_ps();
+    __m128 acc1 = _mm_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    __m128 sum = _mm_add_ps(acc0, acc1);
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+}
+
+ESPEAK_TARGET("avx2")
+float dotAvx2(const float* a, const float* b, int n) {
+    __m256 acc = _mm256_setzero_ps();
+    for (int i = 0; i < n; i += 8) {
+        acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+    }
+    __m128 sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+    sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 0x55));
+    return _mm_cvtss_f32(sum);
+}
+
+bool cpuHasAvx2() noexcept {
+#if defined(_MSC_VER)
+    int info[4] = {};
+    __cpuid(info, 0);
+    if (info[0] < 7) {
+        return false;
+    }
+    __cpuid(info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 0x6) != 0x6) {
+        return false;
+    }
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+double besselI0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    const double half_sq = x * x / 4.0;
+    for (int k = 1; k < 50; ++k) {
+        term *= half_sq / (static_cast<double>(k) * k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+}
+
+Resampler::Resampler(int input_rate, int output_rate, SampleFormat format,
+                     int taps_per_phase, ResamplerKernel kernel)
+    : input_rate_(input_rate)
+    , output_rate_(output_rate)
+    , format_(format)
+    , kernel_(kernel == ResamplerKernel::Auto ? bestKernel() : kernel)
+    , dot_(dotScalar)
+    , up_(1)
+    , down_(1)
+    , taps_((std::max)(TAP_ALIGNMENT, (taps_per_phase + TAP_ALIGNMENT - 1) / TAP_ALIGNMENT * TAP_ALIGNMENT))
+    , history_base_(0)
+    , consumed_(0)
+    , produced_(0)
+    , phase_(0)
+    , position_(0)
+{
+#if ESPEAK_RESAMPLER_X86
+    if (kernel_ == ResamplerKernel::Avx2) {
+        dot_ = dotAvx2;
+    } else if (kernel_ == ResamplerKernel::Sse2) {
+        dot_ = dotSse2;
+    }
+#else
+    kernel_ = ResamplerKernel::Scalar;
+#endif
+
+    const int divisor = std::gcd(input_rate_, output_rate_);
+    up_ = output_rate_ / divisor;
+    down_ = input_rate_ / divisor;
+    if (up_ != down_) {
+        buildFilter();
+    }
+    reset();
+}
+
+ResamplerKernel Resampler::bestKernel() noexcept {
+#if ESPEAK_RESAMPLER_X86
+    static const ResamplerKernel best = cpuHasAvx2() ? ResamplerKernel::Avx2 : ResamplerKernel::Sse2;
+    return best;
+#else
+    return ResamplerKernel::Scalar;
+#endif
+}
+
+const char* Resampler::kernelName(ResamplerKernel kernel) noexcept {
+    switch (kernel) {
+        case ResamplerKernel::Auto: return "auto";
+        case ResamplerKernel::Scalar: return "scalar";
+        case ResamplerKernel::Sse2: return "sse2";
+        case ResamplerKernel::Avx2: return "avx2";
+    }
+    return "unknown";
+}
+
+void Resampler::buildFilter() {
+    const int length = up_ * taps_;
+    const double cutoff = 0.5 / (std::max)(up_, down_) * ROLLOFF;
+    const double center = length / 2.0;
+    const double window_norm = besselI0(KAISER_BETA);
+
+    std::vector<double> prototype(length);
+    for (int j = 0; j < length; ++j) {
+        const double t = j - center;
+        const double x = 2.0 * PI * cutoff * t;
+        const double sinc = t == 0.0 ? 1.0 : std::sin(x) / x;
+        const double r = t / center;
+        const double window = besselI0(KAISER_BETA * std::sqrt((std::max)(0.0, 1.0 - r * r))) / window_norm;
+        prototype[j] = 2.0 * cutoff * sinc * window;
+    }
+
+    coeffs_.assign(static_cast<std::size_t>(length), 0.0f);
+    for (int p = 0; p < up_; ++p) {
+        double sum = 0.0;
+        for (int k = 0; k < taps_; ++k) {
+            sum += prototype[p + k * up_];
+        }
+        const double gain = sum != 0.0 ? 1.0 / sum : 0.0;
+        for (int k = 0; k < taps_; ++k) {
+            coeffs_[static_cast<std::size_t>(p) * taps_ + (taps_ - 1 - k)] =
+                static_cast<float>(prototype[p + k * up_] * gain);
+        }
+    }
+}
+
+void Resampler::reset() {
+    history_.assign(static_cast<std::size_t>(taps_ - 1), 0.0f);
+    history_base_ = -(taps_ - 1);
+    consumed_ = 0;
+    produced_ = 0;
+    phase_ = 0;
+    position_ = taps_ / 2;
+}
+
+void Resampler::process(const short* input, int sample_count, std::vector<std::uint8_t>& out) {
+    if (!input || sample_count <= 0) {
+        return;
+    }
+
+    if (up_ == down_) {
+        scratch_.resize(static_cast<std::size_t>(sample_count));
+        std::copy(input, input + sample_count, scratch_.begin());
+        emit(scratch_.data(), scratch_.size(), out);
+        return;
+    }
+
+    history_.insert(history_.end(), input, input + sample_count);
+    consumed_ += static_cast<std::uint64_t>(sample_count);
+    produce(out, UINT64_MAX);
+}
+
+void Resampler::flush(std::vector<std::uint8_t>& out) {
+    if (up_ != down_ && consumed_ > 0) {
+        const std::uint64_t expected = (consumed_ * up_ + down_ - 1) / down_;
+        history_.insert(history_.end(), static_cast<std::size_t>(taps_ / 2), 0.0f);
+        produce(out, expected);
+    }
+    reset();
+}
+
+void Resampler::produce(std::vector<std::uint8_t>& out, std::uint64_t limit) {
+    const std::int64_t last = history_base_ + static_cast<std::int64_t>(history_.size()) - 1;
+
+    scratch_.clear();
+    while (position_ <= last && produced_ < limit) {
+        const float* window = history_.data() + (position_ - (taps_ - 1) - history_base_);
+        scratch_.push_back(dot_(coeffs_.data() + static_cast<std::size_t>(phase_) * taps_, window, taps_));
+        ++produced_;
+        phase_ += down_;
+        position_ += phase_ / up_;
+        phase_ %= up_;
+    }
+    emit(scratch_.data(), scratch_.size(), out);
+
+    const std::int64_t keep_from = position_ - (taps_ - 1);
+    if (keep_from > history_base_) {
+        const std::size_t drop = static_cast<std::size_t>(
+            (std::min)(keep_from - history_base_, static_cast<std::int64_t>(history_.size())));
+        history_.erase(history_.begin(), history_.begin() + static_cast<std::ptrdiff_t>(drop));
+        history_base_ += static_cast<std::int64_t>(drop);
+    }
+}
+
+void Resampler::emit(const float* samples, std::size_t count, std::vector<std::uint8_t>& out) const {
+    if (count == 0) {
+        return;
+    }
+
+    const std::size_t offset = out.size();
+    out.resize(offset + count * bytesPerSample());
+    std::uint8_t* dest = out.data() + offset;
+
+    if (format_ == SampleFormat::Float32) {
+        for (std::size_t i = 0; i < count; ++i) {
+            const float value = samples[i] * PCM16_SCALE;
+            std::memcpy(dest + i * sizeof(float), &value, sizeof(float));
+        }
+        return;
+    }
+
+    for (std::size_t i = 0; i < count; ++i) {
+        const float clamped = (std::min)(32767.0f, (std::max)(-32768.0f, samples[i]));
+        const std::int16_t value = static_cast<std::int16_t>(std::lrint(clamped));
+        std::memcpy(dest + i * sizeof(std::int16_t), &value, sizeof(std::int16_t));
+    }
+}
+}
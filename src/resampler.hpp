@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Espeak {
+
+enum class SampleFormat {
+    Pcm16,
+    Float32
+};
+
+enum class ResamplerKernel {
+    Auto,
+    Scalar,
+    Sse2,
+    Avx2
+};
+
+class Resampler {
+public:
+    static constexpr int DEFAULT_TAPS = 32;
+    static constexpr int MIN_RATE = 8000;
+    static constexpr int MAX_RATE = 48000;
+
+    Resampler(int input_rate, int output_rate, SampleFormat format,
+              int taps_per_phase = DEFAULT_TAPS, ResamplerKernel kernel = ResamplerKernel::Auto);
+
+    [[nodiscard]] int inputRate() const noexcept { return input_rate_; }
+    [[nodiscard]] int outputRate() const noexcept { return output_rate_; }
+    [[nodiscard]] SampleFormat format() const noexcept { return format_; }
+    [[nodiscard]] ResamplerKernel kernel() const noexcept { return kernel_; }
+
+    [[nodiscard]] std::size_t bytesPerSample() const noexcept
+    {
+        return format_ == SampleFormat::Float32 ? sizeof(float) : sizeof(std::int16_t);
+    }
+
+    [[nodiscard]] bool passthrough() const noexcept
+    {
+        return input_rate_ == output_rate_ && format_ == SampleFormat::Pcm16;
+    }
+
+    void process(const short* input, int sample_count, std::vector<std::uint8_t>& out);
+
+    void flush(std::vector<std::uint8_t>& out);
+
+    void reset();
+
+    [[nodiscard]] static ResamplerKernel bestKernel() noexcept;
+
+    [[nodiscard]] static const char* kernelName(ResamplerKernel kernel) noexcept;
+
+private:
+    using dot_function = float (*)(const float* a, const float* b, int n);
+
+    void buildFilter();
+
+    void produce(std::vector<std::uint8_t>& out, std::uint64_t limit);
+
+    void emit(const float* samples, std::size_t count, std::vector<std::uint8_t>& out) const;
+
+    int input_rate_;
+    int output_rate_;
+    SampleFormat format_;
+    ResamplerKernel kernel_;
+    dot_function dot_;
+
+    int up_;
+    int down_;
+    int taps_;
+    std::vector<float> coeffs_;
+
+    std::vector<float> history_;
+    std::vector<float> scratch_;
+    std::int64_t history_base_;
+    std::uint64_t consumed_;
+    std::uint64_t produced_;
+    int phase_;
+    std::int64_t position_;
+};
+}
@@ -4,6 +4,7 @@
 #include "registry.hpp"
 #include "ISpTTSEngineImpl.hpp"
 #include "IEnumSpObjectTokensImpl.hpp"
+#include "engine_warmup.hpp"
 #include "error_handler.hpp"
 #include "debug_log.h"
 #include <array>
@@ -57,10 +58,10 @@ void unregister_token_enumerator() noexcept
     }
     catch (const std::exception& e) {
         [[maybe_unused]] const char* what = e.what();
-        DEBUG_LOG("DllUnregisterServer: Exception during cleanup: %s", what);
+        LOG_ERROR("DllUnregisterServer: Exception during cleanup: %s", what);
     }
     catch (...) {
-        DEBUG_LOG("DllUnregisterServer: Unknown exception during cleanup");
+        LOG_ERROR("DllUnregisterServer: Unknown exception during cleanup");
     }
 }
 }
@@ -77,19 +78,25 @@ BOOL APIENTRY DllMain(HINSTANCE hInstance, DWORD dwReason, LPVOID /*lpReserved*/
         }
         catch (const std::exception& e) {
             [[maybe_unused]] const char* what = e.what();
-            DEBUG_LOG("DllMain: Failed to register classes: %s", what);
+            LOG_ERROR("DllMain: Failed to register classes: %s", what);
             return FALSE;
         }
         catch (...) {
-            DEBUG_LOG("DllMain: Failed to register classes: Unknown exception");
+            LOG_ERROR("DllMain: Failed to register classes: Unknown exception");
             return FALSE;
         }
+
+        Espeak::sapi::note_dll_attach();
     }
     return TRUE;
 }
 
 STDAPI DllGetClassObject(REFCLSID rclsid, REFIID riid, void** ppv)
 {
+    // Outside the loader lock, and only for clients about to create an engine.
+    if (IsEqualCLSID(rclsid, __uuidof(Espeak::sapi::ISpTTSEngineImpl))) {
+        Espeak::sapi::start_warmup();
+    }
     return g_cls_obj_factory.create(rclsid, riid, ppv);
 }
 
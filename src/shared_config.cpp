@@ -0,0 +1,232 @@
+#include "shared_config.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace Espeak {
+namespace config {
+
+struct SharedConfigRegion::Header {
+    std::atomic<std::uint64_t> sequence;
+    std::atomic<std::uint32_t> size;
+    std::atomic<std::uint32_t> writer_pid;
+    // Wall-clock ms at which the current writer took the region; zero when free.
+    std::atomic<std::uint64_t> writer_since;
+    std::atomic<std::uint64_t> reload_requests;
+};
+
+namespace {
+
+constexpr std::size_t DATA_OFFSET = 64;
+constexpr int MAX_WRITE_SPINS = 1000;
+constexpr int MAX_READ_SPINS = 1000;
+// A publish copies at most DEFAULT_CAPACITY bytes; a writer holding the
+// region this long has died or hung.
+constexpr std::uint64_t STALE_WRITE_MS = 2000;
+
+static_assert(std::atomic<std::uint64_t>::is_always_lock_free);
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+// Compared across processes, so wall-clock time rather than a steady clock.
+std::uint64_t nowMs() noexcept {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+bool isStale(std::uint64_t since, std::uint64_t now) noexcept {
+    return now > since + STALE_WRITE_MS || since > now + STALE_WRITE_MS;
+}
+
+std::uint32_t currentPid() noexcept {
+#ifdef _WIN32
+    return static_cast<std::uint32_t>(GetCurrentProcessId());
+#else
+    return static_cast<std::uint32_t>(getpid());
+#endif
+}
+}
+
+SharedConfigRegion::SharedConfigRegion(const std::string& name, std::size_t capacity)
+    : header_(nullptr)
+    , data_(nullptr)
+    , capacity_(capacity)
+    , mapped_size_(DATA_OFFSET + capacity)
+    , mapping_(nullptr)
+{
+    static_assert(sizeof(Header) <= DATA_OFFSET);
+
+    void* view = nullptr;
+
+#ifdef _WIN32
+    const auto size = static_cast<unsigned long long>(mapped_size_);
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                        static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF),
+                                        name.c_str());
+    if (!mapping) {
+        return;
+    }
+    view = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, mapped_size_);
+    if (!view) {
+        CloseHandle(mapping);
+        return;
+    }
+    mapping_ = mapping;
+#else
+    const int fd = shm_open(name.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info = {};
+    bool sized = fstat(fd, &info) == 0;
+    if (sized && info.st_size == 0) {
+        sized = ftruncate(fd, static_cast<off_t>(mapped_size_)) == 0;
+    } else if (sized) {
+        sized = static_cast<std::size_t>(info.st_size) >= mapped_size_;
+    }
+    if (sized) {
+        view = mmap(nullptr, mapped_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (view == MAP_FAILED) {
+            view = nullptr;
+        }
+    }
+    close(fd);
+    if (!view) {
+        return;
+    }
+#endif
+
+    header_ = static_cast<Header*>(view);
+    data_ = static_cast<std::uint8_t*>(view) + DATA_OFFSET;
+}
+
+SharedConfigRegion::~SharedConfigRegion() {
+    if (!header_) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(header_);
+    CloseHandle(static_cast<HANDLE>(mapping_));
+#else
+    munmap(header_, mapped_size_);
+#endif
+}
+
+std::string SharedConfigRegion::defaultName() {
+#ifdef _WIN32
+    return "Local\\EspeakSAPIConfig.v2";
+#else
+    return "/espeak-sapi-config.v2-" + std::to_string(getuid());
+#endif
+}
+
+void SharedConfigRegion::remove(const std::string& name) {
+#ifdef _WIN32
+    (void)name;
+#else
+    shm_unlink(name.c_str());
+#endif
+}
+
+std::uint64_t SharedConfigRegion::generation() const noexcept {
+    return header_ ? header_->sequence.load(std::memory_order_acquire) / 2 : 0;
+}
+
+std::uint64_t SharedConfigRegion::publish(const std::vector<std::uint8_t>& image) {
+    if (!header_ || image.size() > capacity_) {
+        return 0;
+    }
+
+    const std::uint64_t since = nowMs();
+    std::uint64_t holder = header_->writer_since.load(std::memory_order_relaxed);
+    for (int spins = 0;; ++spins) {
+        if ((holder == 0 || isStale(holder, since)) &&
+            header_->writer_since.compare_exchange_weak(holder, since,
+                                                        std::memory_order_acquire, std::memory_order_relaxed)) {
+            break;
+        }
+        if (spins >= MAX_WRITE_SPINS) {
+            return 0;
+        }
+        std::this_thread::yield();
+        holder = header_->writer_since.load(std::memory_order_relaxed);
+    }
+    header_->writer_pid.store(currentPid(), std::memory_order_relaxed);
+
+    // A writer that died mid-publish left the sequence odd; stepping past it
+    // keeps it odd and still tells readers it moved.
+    std::uint64_t sequence = header_->sequence.load(std::memory_order_relaxed);
+    sequence += (sequence & 1) ? 2 : 1;
+    header_->sequence.store(sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(data_, image.data(), image.size());
+    header_->size.store(static_cast<std::uint32_t>(image.size()), std::memory_order_relaxed);
+
+    // Both fail only if this writer stalled long enough to be taken over.
+    std::uint64_t expected = sequence;
+    const bool finished = header_->sequence.compare_exchange_strong(expected, sequence + 1,
+                                                                    std::memory_order_release,
+                                                                    std::memory_order_relaxed);
+    std::uint64_t held = since;
+    header_->writer_since.compare_exchange_strong(held, 0, std::memory_order_release, std::memory_order_relaxed);
+    return finished ? (sequence + 1) / 2 : 0;
+}
+
+bool SharedConfigRegion::read(std::vector<std::uint8_t>& image, std::uint64_t& generation) const {
+    if (!header_) {
+        return false;
+    }
+
+    for (int spins = 0; spins < MAX_READ_SPINS; ++spins) {
+        const std::uint64_t before = header_->sequence.load(std::memory_order_acquire);
+        if (before == 0) {
+            return false;
+        }
+        if ((before & 1) == 0) {
+            const std::size_t size = header_->size.load(std::memory_order_relaxed);
+            if (size <= capacity_) {
+                image.resize(size);
+                std::memcpy(image.data(), data_, size);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (header_->sequence.load(std::memory_order_relaxed) == before) {
+                    generation = before / 2;
+                    return true;
+                }
+            }
+        }
+        std::this_thread::yield();
+    }
+    return false;
+}
+
+std::uint64_t SharedConfigRegion::stalledSince() const noexcept {
+    if (!header_) {
+        return 0;
+    }
+    const std::uint64_t since = header_->writer_since.load(std::memory_order_acquire);
+    return since != 0 && isStale(since, nowMs()) ? since : 0;
+}
+
+std::uint32_t SharedConfigRegion::writerPid() const noexcept {
+    return header_ ? header_->writer_pid.load(std::memory_order_relaxed) : 0;
+}
+
+std::uint64_t SharedConfigRegion::requestReload() noexcept {
+    return header_ ? header_->reload_requests.fetch_add(1, std::memory_order_acq_rel) + 1 : 0;
+}
+
+std::uint64_t SharedConfigRegion::reloadRequests() const noexcept {
+    return header_ ? header_->reload_requests.load(std::memory_order_acquire) : 0;
+}
+}
+}
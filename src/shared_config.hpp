@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace Espeak {
+namespace config {
+
+class SharedConfigRegion {
+public:
+    static constexpr std::size_t DEFAULT_CAPACITY = 256 * 1024;
+
+    explicit SharedConfigRegion(const std::string& name = defaultName(), std::size_t capacity = DEFAULT_CAPACITY);
+    ~SharedConfigRegion();
+
+    SharedConfigRegion(const SharedConfigRegion&) = delete;
+    SharedConfigRegion& operator=(const SharedConfigRegion&) = delete;
+
+    [[nodiscard]] bool isOpen() const noexcept { return header_ != nullptr; }
+
+    [[nodiscard]] std::uint64_t generation() const noexcept;
+
+    [[nodiscard]] std::uint64_t publish(const std::vector<std::uint8_t>& image);
+
+    [[nodiscard]] bool read(std::vector<std::uint8_t>& image, std::uint64_t& generation) const;
+
+    // When a writer has held the region past the stale deadline, the time it
+    // took it (ms since the epoch); zero otherwise. The next publish takes over.
+    [[nodiscard]] std::uint64_t stalledSince() const noexcept;
+
+    [[nodiscard]] std::uint32_t writerPid() const noexcept;
+
+    // Tells other processes to reload from the file, for changes that could
+    // not be published. Returns the new request count.
+    std::uint64_t requestReload() noexcept;
+
+    [[nodiscard]] std::uint64_t reloadRequests() const noexcept;
+
+    [[nodiscard]] static std::string defaultName();
+
+    static void remove(const std::string& name);
+
+private:
+    struct Header;
+
+    Header* header_;
+    std::uint8_t* data_;
+    std::size_t capacity_;
+    std::size_t mapped_size_;
+    void* mapping_;
+};
+}
+}
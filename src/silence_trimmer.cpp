@@ -0,0 +1,179 @@
+#include "silence_trimmer.hpp"
+#include <algorithm>
+
+namespace Espeak {
+
+namespace {
+
+constexpr std::size_t COMPACT_THRESHOLD = 4096;
+
+void fadeIn(short* samples, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        samples[i] = static_cast<short>(static_cast<long>(samples[i]) * static_cast<long>(i + 1) /
+                                        static_cast<long>(count + 1));
+    }
+}
+
+void fadeOut(short* samples, std::size_t count) {
+    for (std::size_t i = 0; i < count; ++i) {
+        samples[i] = static_cast<short>(static_cast<long>(samples[i]) * static_cast<long>(count - i) /
+                                        static_cast<long>(count + 1));
+    }
+}
+}
+
+void SilenceTrimmer::reset(const SilenceTrimSettings& settings, bool trim_gaps) {
+    settings_ = settings;
+    settings_.lookahead_samples = (std::max)(settings_.lookahead_samples, 0);
+    settings_.fade_samples = (std::max)(settings_.fade_samples, 0);
+    settings_.window_samples = (std::max)(settings_.window_samples, 1);
+    trim_gaps_ = trim_gaps;
+    state_ = State::Leading;
+    head_samples_ = static_cast<std::size_t>((std::max)(
+        settings_.max_gap_samples - settings_.lookahead_samples - settings_.fade_samples, 0));
+    run_ = 0;
+    cutting_ = false;
+    clearHeld();
+    position_ = 0;
+    removed_ = 0;
+    cuts_.clear();
+    window_.assign(static_cast<std::size_t>(settings_.window_samples), 0);
+    window_pos_ = 0;
+    energy_ = 0;
+    const long long threshold = settings_.threshold;
+    energy_limit_ = threshold * threshold * settings_.window_samples;
+}
+
+bool SilenceTrimmer::voiced(short sample) noexcept {
+    const long long incoming = sample;
+    const long long outgoing = window_[window_pos_];
+    energy_ += incoming * incoming - outgoing * outgoing;
+    window_[window_pos_] = sample;
+    if (++window_pos_ == window_.size()) {
+        window_pos_ = 0;
+    }
+    return energy_ > energy_limit_;
+}
+
+void SilenceTrimmer::process(const short* samples, std::size_t count, std::vector<short>& out) {
+    const std::size_t lookahead = static_cast<std::size_t>(settings_.lookahead_samples);
+    const std::size_t fade = static_cast<std::size_t>(settings_.fade_samples);
+
+    for (std::size_t i = 0; i < count; ++i, ++position_) {
+        const short sample = samples[i];
+        const bool loud = voiced(sample);
+
+        if (state_ == State::Leading) {
+            if (loud) {
+                emitHeld(out, heldSize(), true, false);
+                state_ = State::Voiced;
+                out.push_back(sample);
+                continue;
+            }
+            held_.push_back(sample);
+            if (heldSize() > lookahead) {
+                drop(position_ - static_cast<long long>(lookahead), 1);
+            }
+            continue;
+        }
+
+        if (loud) {
+            if (heldSize() > 0) {
+                emitHeld(out, heldSize(), cutting_, false);
+            }
+            cutting_ = false;
+            run_ = 0;
+            out.push_back(sample);
+            continue;
+        }
+
+        if (++run_ <= head_samples_) {
+            out.push_back(sample);
+            continue;
+        }
+        held_.push_back(sample);
+        if (!trim_gaps_) {
+            continue;
+        }
+        if (!cutting_) {
+            if (heldSize() <= fade + lookahead) {
+                continue;
+            }
+            emitHeld(out, fade, false, true);
+            cutting_ = true;
+        }
+        if (heldSize() > lookahead) {
+            drop(position_ - static_cast<long long>(lookahead), 1);
+        }
+    }
+}
+
+void SilenceTrimmer::finish(std::vector<short>& out) {
+    const std::size_t lookahead = static_cast<std::size_t>(settings_.lookahead_samples);
+    const std::size_t fade = static_cast<std::size_t>(settings_.fade_samples);
+
+    if (state_ == State::Voiced && !cutting_ && heldSize() <= fade + lookahead) {
+        emitHeld(out, heldSize(), false, false);
+        return;
+    }
+    if (state_ == State::Voiced && !cutting_) {
+        emitHeld(out, fade, false, true);
+    }
+    if (heldSize() > 0) {
+        drop(position_ - static_cast<long long>(heldSize()), heldSize());
+    }
+    clearHeld();
+}
+
+long long SilenceTrimmer::map(long long raw_sample) const noexcept {
+    auto it = std::upper_bound(cuts_.begin(), cuts_.end(), raw_sample,
+                               [](long long sample, const Cut& cut) { return sample < cut.raw_begin; });
+    if (it == cuts_.begin()) {
+        return raw_sample;
+    }
+    --it;
+    if (raw_sample < it->raw_end) {
+        return it->raw_begin - it->removed_before;
+    }
+    return raw_sample - it->removed_before - (it->raw_end - it->raw_begin);
+}
+
+void SilenceTrimmer::drop(long long raw_begin, std::size_t count) {
+    if (!cuts_.empty() && cuts_.back().raw_end == raw_begin) {
+        cuts_.back().raw_end += static_cast<long long>(count);
+    } else {
+        cuts_.push_back({raw_begin, raw_begin + static_cast<long long>(count), removed_});
+    }
+    removed_ += static_cast<long long>(count);
+    held_begin_ += count;
+
+    if (held_begin_ >= COMPACT_THRESHOLD && held_begin_ * 2 >= held_.size()) {
+        held_.erase(held_.begin(), held_.begin() + static_cast<std::ptrdiff_t>(held_begin_));
+        held_begin_ = 0;
+    }
+}
+
+void SilenceTrimmer::emitHeld(std::vector<short>& out, std::size_t count, bool fade_in, bool fade_out) {
+    const std::size_t start = out.size();
+    const short* held = held_.data() + held_begin_;
+    out.insert(out.end(), held, held + count);
+
+    const std::size_t fade = (std::min)(static_cast<std::size_t>(settings_.fade_samples), count);
+    if (fade_in) {
+        fadeIn(out.data() + start, fade);
+    }
+    if (fade_out) {
+        fadeOut(out.data() + out.size() - fade, fade);
+    }
+
+    held_begin_ += count;
+    if (heldSize() == 0) {
+        clearHeld();
+    }
+}
+
+void SilenceTrimmer::clearHeld() {
+    held_.clear();
+    held_begin_ = 0;
+}
+}
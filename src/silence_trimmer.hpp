@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace Espeak {
+
+struct SilenceTrimSettings {
+    int threshold = 64;
+    int lookahead_samples = 0;
+    int max_gap_samples = 0;
+    int fade_samples = 0;
+    int window_samples = 1;
+};
+
+// Streams 16-bit PCM through an energy gate: a sample counts as voiced while
+// the RMS of the last window_samples is above the threshold, so a lone click
+// or a zero crossing does not flip the gate. Silence before the first voiced
+// sample is dropped except for lookahead_samples of pre-roll, and runs of
+// silence after it are capped at max_gap_samples, with
+// short fades on both sides of every cut. With trim_gaps off only the leading
+// and trailing silence are touched, which keeps explicit SSML breaks intact.
+class SilenceTrimmer {
+public:
+    void reset(const SilenceTrimSettings& settings, bool trim_gaps);
+
+    void process(const short* samples, std::size_t count, std::vector<short>& out);
+
+    void finish(std::vector<short>& out);
+
+    // Maps a sample position in the untrimmed stream to the output stream.
+    [[nodiscard]] long long map(long long raw_sample) const noexcept;
+
+    [[nodiscard]] long long removedSamples() const noexcept { return removed_; }
+
+private:
+    enum class State {
+        Leading,
+        Voiced
+    };
+
+    struct Cut {
+        long long raw_begin;
+        long long raw_end;
+        long long removed_before;
+    };
+
+    [[nodiscard]] std::size_t heldSize() const noexcept { return held_.size() - held_begin_; }
+
+    [[nodiscard]] bool voiced(short sample) noexcept;
+
+    void drop(long long raw_begin, std::size_t count);
+
+    void emitHeld(std::vector<short>& out, std::size_t count, bool fade_in, bool fade_out);
+
+    void clearHeld();
+
+    SilenceTrimSettings settings_;
+    bool trim_gaps_ = true;
+    State state_ = State::Leading;
+    std::size_t head_samples_ = 0;
+    std::size_t run_ = 0;
+    bool cutting_ = false;
+    std::vector<short> held_;
+    std::size_t held_begin_ = 0;
+    long long position_ = 0;
+    long long removed_ = 0;
+    std::vector<Cut> cuts_;
+    std::vector<short> window_;
+    std::size_t window_pos_ = 0;
+    long long energy_ = 0;
+    long long energy_limit_ = 0;
+};
+}
@@ -0,0 +1,872 @@
+#include "speak_session.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+#include "espeak_wrapper.h"
+#include "fragment_planner.hpp"
+#include "gain_ramp.hpp"
+#include "pcm_write_buffer.hpp"
+#include "perf_counters.hpp"
+#include "speak_timeline.hpp"
+#include "time_stretcher.hpp"
+#include "utf16_transcoder.hpp"
+#include "worker_pool.hpp"
+#include "debug_log.h"
+
+namespace Espeak {
+namespace sapi {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::size_t AUDIO_CHANNELS = 1;
+constexpr std::size_t AUDIO_BITS_PER_SAMPLE = 16;
+constexpr std::size_t FLOAT_BITS_PER_SAMPLE = 32;
+
+constexpr int MIN_RATE = -10;
+constexpr int MAX_RATE = 10;
+constexpr int RATE_TO_WPM_MULTIPLIER = 10;
+
+constexpr int BASE_PITCH = 50;
+constexpr int PITCH_ADJ_MULTIPLIER = 2;
+constexpr int MIN_PITCH_ADJ = -50;
+constexpr int MAX_PITCH_ADJ = 50;
+
+constexpr int MIN_VOLUME = 0;
+constexpr int MAX_VOLUME = 100;
+
+constexpr int GAIN_RAMP_MS = 10;
+
+// Prosody of the unit being spoken, so rate and volume changes made while it
+// plays can be applied to the audio that is already synthesized.
+struct live_prosody {
+    const speak_fragment* state = nullptr;
+    long* sapi_rate = nullptr;
+    unsigned short* sapi_volume = nullptr;
+    int base_rate = 0;
+    int base_volume = MAX_VOLUME;
+    bool rateboost = false;
+};
+
+struct job_prosody {
+    int rate = 0;
+    int volume = MAX_VOLUME;
+};
+
+struct SpeakContext {
+    speak_site* caller = nullptr;
+    pcm_write_buffer* buffer = nullptr;
+    Resampler* resampler = nullptr;
+    live_prosody* live = nullptr;
+    TimeStretcher* stretcher = nullptr;
+    GainRamp* gain = nullptr;
+    std::vector<short> processed;
+    std::vector<std::uint8_t> converted;
+    std::uint64_t bytes_written = 0;
+    bool aborted = false;
+    CancelToken* cancel = nullptr;
+    std::vector<site_event> events;
+    std::deque<std::u16string> event_strings;
+    Clock::time_point started;
+    Clock::time_point stop_requested{};
+    std::uint64_t blocked_us = 0;
+    std::uint64_t bytes_out = 0;
+};
+
+inline bool checkAndHandleActionFlags(speak_site* site, bool* aborted = nullptr,
+                                      CancelToken* cancel = nullptr) {
+    const unsigned actions = site->actions();
+
+    if (actions & SITE_ACTION_ABORT) {
+        DEBUG_LOG("SAPI: ABORT requested");
+        if (aborted) *aborted = true;
+        if (cancel) cancel->cancel();
+        return false;
+    }
+
+    if (actions & SITE_ACTION_SKIP) {
+        DEBUG_LOG("SAPI: SKIP requested");
+        site->complete_skip();
+        if (aborted) *aborted = true;
+        if (cancel) cancel->cancel();
+        return false;
+    }
+
+    return true;
+}
+
+bool check_actions(SpeakContext& ctx) {
+    if (checkAndHandleActionFlags(ctx.caller, &ctx.aborted, ctx.cancel)) {
+        return true;
+    }
+    if (ctx.stop_requested == Clock::time_point{}) {
+        ctx.stop_requested = Clock::now();
+    }
+    return false;
+}
+
+std::size_t bits_per_sample(const output_format& format) {
+    return format.sample_format == SampleFormat::Float32 ? FLOAT_BITS_PER_SAMPLE : AUDIO_BITS_PER_SAMPLE;
+}
+
+bool write_to_site(SpeakContext& ctx, const std::uint8_t* data, std::size_t size) {
+    if (!check_actions(ctx)) {
+        return false;
+    }
+
+    const std::uint8_t* ptr = data;
+    std::size_t remaining = size;
+
+    while (remaining > 0) {
+        std::size_t written = remaining;
+        const Clock::time_point write_started = Clock::now();
+        const bool ok = ctx.caller->write(ptr, remaining, written);
+        const Clock::time_point write_done = Clock::now();
+        if (Timeline::instance().enabled()) {
+            Timeline::instance().record("Write", write_started, write_done,
+                                        "bytes", static_cast<std::int64_t>(written));
+        }
+        ctx.blocked_us += static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(write_done - write_started).count());
+        if (!ok) {
+            LOG_ERROR("SAPI Write: FAILED");
+            return false;
+        }
+        if (written > remaining) {
+            LOG_ERROR("SAPI Write: error - written (%zu) > remaining (%zu)", written, remaining);
+            return false;
+        }
+        if (ctx.bytes_out == 0 && written > 0) {
+            PerfCounters::local().record(PerfHistogram::FirstAudio,
+                                         std::chrono::duration<double, std::milli>(write_done - ctx.started).count());
+        }
+        ctx.bytes_out += written;
+        remaining -= written;
+        ptr += written;
+
+        if (remaining > 0 && !check_actions(ctx)) {
+            return false;
+        }
+    }
+
+    DEBUG_LOG("SAPI Write: Flushed %zu bytes", size);
+    return true;
+}
+
+// Publishes the counters of a Speak call however it ends. Synthesis time is
+// the wall time of the call less the time spent blocked in the site.
+class speak_perf_scope
+{
+public:
+    explicit speak_perf_scope(const SpeakContext& ctx)
+        : ctx_(ctx)
+    {}
+
+    ~speak_perf_scope()
+    {
+        PerfCounters& perf = PerfCounters::local();
+        const Clock::time_point now = Clock::now();
+        const auto total_us = static_cast<std::uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - ctx_.started).count());
+        perf.add(PerfCounter::SynthMicroseconds, total_us > ctx_.blocked_us ? total_us - ctx_.blocked_us : 0);
+        perf.add(PerfCounter::WriteBlockedMicroseconds, ctx_.blocked_us);
+        perf.add(PerfCounter::BytesProduced, ctx_.bytes_out);
+        if (ctx_.aborted && ctx_.stop_requested != Clock::time_point{}) {
+            perf.add(PerfCounter::Aborts);
+            perf.record(PerfHistogram::AbortLatency,
+                        std::chrono::duration<double, std::milli>(now - ctx_.stop_requested).count());
+        }
+    }
+
+    speak_perf_scope(const speak_perf_scope&) = delete;
+    speak_perf_scope& operator=(const speak_perf_scope&) = delete;
+
+private:
+    const SpeakContext& ctx_;
+};
+
+void flush_events(SpeakContext& ctx) {
+    if (ctx.events.empty()) {
+        return;
+    }
+    const TimelineSpan span("events", "count", static_cast<std::int64_t>(ctx.events.size()));
+    ctx.caller->add_events(ctx.events.data(), ctx.events.size());
+    DEBUG_LOG("SAPI Event: Added %zu events", ctx.events.size());
+    ctx.events.clear();
+    ctx.event_strings.clear();
+}
+
+void queue_boundary(SpeakContext& ctx, site_event_type type, std::uint64_t offset,
+                    std::uint32_t start, std::uint32_t length) {
+    site_event event;
+    event.type = type;
+    event.offset = offset;
+    event.source_start = start;
+    event.source_length = length;
+    ctx.events.push_back(event);
+}
+
+bool append_audio(SpeakContext& ctx, const short* audio, std::size_t sample_count) {
+    const std::uint8_t* data = reinterpret_cast<const std::uint8_t*>(audio);
+    std::size_t size = sample_count * sizeof(short);
+    if (ctx.resampler && !ctx.resampler->passthrough()) {
+        ctx.converted.clear();
+        ctx.resampler->process(audio, static_cast<int>(sample_count), ctx.converted);
+        data = ctx.converted.data();
+        size = ctx.converted.size();
+    }
+    DEBUG_LOG("SAPI Callback: Buffering %zu samples (%zu bytes), %zu pending",
+              sample_count, size, ctx.buffer->pending());
+
+    ctx.bytes_written += size;
+    if (!ctx.buffer->append(data, size)) {
+        ctx.buffer->discard();
+        return false;
+    }
+    return true;
+}
+
+void fragment_prosody(const speak_fragment& state, long sapi_rate, unsigned short sapi_volume,
+                      int& rate, int& pitch, int& volume) {
+    int combined_rate = static_cast<int>(sapi_rate) + state.rate_adj;
+    combined_rate = std::clamp(combined_rate, MIN_RATE, MAX_RATE);
+    rate = combined_rate * RATE_TO_WPM_MULTIPLIER;
+
+    const int pitch_adj = state.pitch_adj;
+    pitch = BASE_PITCH + std::clamp(pitch_adj * PITCH_ADJ_MULTIPLIER, MIN_PITCH_ADJ, MAX_PITCH_ADJ);
+
+    const int volume_adj = (sapi_volume - MAX_VOLUME) + (state.volume - MAX_VOLUME);
+    volume = std::clamp(static_cast<int>(sapi_volume) + volume_adj, MIN_VOLUME, MAX_VOLUME);
+}
+
+// Re-reads rate and volume from the site and retargets the stretcher and the
+// gain relative to the prosody the unit was synthesized with. Unless forced,
+// this only happens when the site reports a change.
+void update_live_prosody(SpeakContext& ctx, bool force) {
+    live_prosody& live = *ctx.live;
+    const unsigned actions = ctx.caller->actions();
+    if (actions & SITE_ACTION_RATE) {
+        *live.sapi_rate = ctx.caller->rate();
+    }
+    if (actions & SITE_ACTION_VOLUME) {
+        *live.sapi_volume = ctx.caller->volume();
+    }
+    if (!force && !(actions & (SITE_ACTION_RATE | SITE_ACTION_VOLUME))) {
+        return;
+    }
+
+    int rate = 0;
+    int pitch = BASE_PITCH;
+    int volume = MAX_VOLUME;
+    fragment_prosody(*live.state, *live.sapi_rate, *live.sapi_volume, rate, pitch, volume);
+
+    const int base_wpm = EspeakEngine::espeakRate(live.base_rate, live.rateboost);
+    const double speed = base_wpm > 0
+        ? static_cast<double>(EspeakEngine::espeakRate(rate, live.rateboost)) / base_wpm : 1.0;
+    const float gain = live.base_volume > 0
+        ? static_cast<float>(volume) / static_cast<float>(live.base_volume) : 1.0f;
+    ctx.stretcher->setSpeed(speed);
+    if (force) {
+        ctx.gain->reset(gain);
+    } else {
+        ctx.gain->setTarget(gain);
+        DEBUG_LOG("Live prosody: rate %d -> speed %.2f, volume %d -> gain %.2f", rate, speed, volume, gain);
+    }
+}
+
+bool speak_callback(const short* audio, int sample_count, void* user) {
+    auto* ctx = static_cast<SpeakContext*>(user);
+    if (!ctx || !ctx->caller || !ctx->buffer) {
+        DEBUG_LOG("SAPI Callback: ERROR - No context or caller");
+        return false;
+    }
+    const TimelineSpan span("callback", "samples", sample_count);
+
+    if (!check_actions(*ctx)) {
+        ctx->buffer->discard();
+        return false;
+    }
+    flush_events(*ctx);
+
+    if (!ctx->live) {
+        return append_audio(*ctx, audio, static_cast<std::size_t>(sample_count));
+    }
+    update_live_prosody(*ctx, false);
+    if (ctx->stretcher->passthrough() && ctx->gain->unity()) {
+        return append_audio(*ctx, audio, static_cast<std::size_t>(sample_count));
+    }
+
+    ctx->processed.clear();
+    ctx->stretcher->process(audio, static_cast<std::size_t>(sample_count), ctx->processed);
+    ctx->gain->apply(ctx->processed.data(), ctx->processed.size());
+    return ctx->processed.empty() || append_audio(*ctx, ctx->processed.data(), ctx->processed.size());
+}
+
+bool flush_live_prosody(SpeakContext& ctx) {
+    if (!ctx.live) {
+        return true;
+    }
+    ctx.processed.clear();
+    ctx.stretcher->flush(ctx.processed);
+    ctx.gain->apply(ctx.processed.data(), ctx.processed.size());
+    return ctx.processed.empty() || append_audio(ctx, ctx.processed.data(), ctx.processed.size());
+}
+
+std::size_t write_buffer_bytes(int buffer_ms, const output_format& format) {
+    const std::size_t block_align = AUDIO_CHANNELS * bits_per_sample(format) / 8;
+    const std::size_t samples = static_cast<std::size_t>(buffer_ms) * format.sample_rate / 1000;
+    return samples * block_align;
+}
+
+// Bookmark names are numbers by convention; anything else, or a number that
+// does not fit, is reported as 0 like std::stol failing would.
+long parse_bookmark_id(std::u16string_view text) {
+    std::string narrow;
+    utf16ToUtf8(text, narrow);
+    char* end = nullptr;
+    errno = 0;
+    const long id = std::strtol(narrow.c_str(), &end, 10);
+    if (end == narrow.c_str()) {
+        DEBUG_LOG("Bookmark: Invalid number format '%s', using 0", narrow.c_str());
+        return 0;
+    }
+    if (errno == ERANGE) {
+        DEBUG_LOG("Bookmark: Number out of range '%s', using 0", narrow.c_str());
+        return 0;
+    }
+    return id;
+}
+
+void queue_bookmark(SpeakContext& ctx, const speak_fragment& frag, std::uint64_t offset) {
+    site_event event;
+    event.type = site_event_type::bookmark;
+    event.offset = offset;
+    if (!frag.text.empty()) {
+        const std::u16string& bookmark_text = ctx.event_strings.emplace_back(frag.text);
+        event.bookmark_id = parse_bookmark_id(bookmark_text);
+        event.bookmark = bookmark_text.c_str();
+        DEBUG_LOG("SAPI Event: Bookmark at byte offset %llu, id=%ld",
+                  static_cast<unsigned long long>(offset), event.bookmark_id);
+    } else {
+        DEBUG_LOG("SAPI Event: Bookmark (empty) at byte offset %llu", static_cast<unsigned long long>(offset));
+    }
+    ctx.events.push_back(event);
+}
+
+plan_fragment to_plan_fragment(const speak_fragment& frag, long sapi_rate, unsigned short sapi_volume) {
+    plan_fragment fragment;
+    fragment.kind = frag.kind;
+    fragment.text = frag.text;
+    fragment_prosody(frag, sapi_rate, sapi_volume, fragment.rate, fragment.pitch, fragment.volume);
+    fragment.emphasis = frag.emphasis > 0;
+    fragment.silence_ms = frag.silence_ms;
+    fragment.source_offset = frag.source_offset;
+    return fragment;
+}
+
+bool prepare_job(const synth_unit& unit, const std::vector<speak_fragment>& frags, speak_site& site,
+                 const config::Configuration& cfg, const std::string& voice, bool events,
+                 long& sapi_rate, unsigned short& sapi_volume, synth_job& job) {
+    const unsigned actions = site.actions();
+    DEBUG_LOG("Actions flags: 0x%08X (ABORT=%d, SKIP=%d, RATE=%d, VOLUME=%d)",
+             actions,
+             !!(actions & SITE_ACTION_ABORT),
+             !!(actions & SITE_ACTION_SKIP),
+             !!(actions & SITE_ACTION_RATE),
+             !!(actions & SITE_ACTION_VOLUME));
+
+    if (actions & SITE_ACTION_RATE) {
+        sapi_rate = site.rate();
+        DEBUG_LOG("  Rate updated via SPVES_RATE: %d", (int)sapi_rate);
+    }
+    if (actions & SITE_ACTION_VOLUME) {
+        sapi_volume = site.volume();
+        DEBUG_LOG("  Volume updated via SPVES_VOLUME: %u", sapi_volume);
+    }
+
+    const long current_rate = site.rate();
+    if (current_rate != sapi_rate) {
+        DEBUG_LOG("  Rate mismatch detected! Cached=%d, Current=%d - using current",
+                 (int)sapi_rate, (int)current_rate);
+        sapi_rate = current_rate;
+    }
+
+    const speak_fragment& frag = frags[unit.base];
+    DEBUG_LOG("Fragment State: RateAdj=%d, Volume=%u, PitchAdj=%d", frag.rate_adj, frag.volume, frag.pitch_adj);
+
+    job.text = unit.text;
+    job.ssml = unit.ssml;
+    job.spell = unit.spell;
+    job.events = events || !unit.marks.empty();
+    DEBUG_LOG("Unit text (%s, %zu fragments, %zu code units)",
+              job.ssml ? "ssml" : job.spell ? "spelled" : "plain", unit.spoken.size(), job.text.size());
+    if (job.text.empty()) {
+        DEBUG_LOG("Unit skipped - empty text");
+        return false;
+    }
+
+    fragment_prosody(frag, sapi_rate, sapi_volume, job.rate, job.pitch, job.volume);
+
+    job.voice = voice;
+    job.intonation = cfg.intonation;
+    job.wordgap = cfg.wordgap;
+    job.rateboost = cfg.rateboost;
+
+    DEBUG_LOG("--- Parameters ---");
+    DEBUG_LOG("  Rate: eSpeak-range=%d%s", job.rate, job.rateboost ? " (will boost x3 at WPM level)" : "");
+    DEBUG_LOG("  Pitch: eSpeak=%d", job.pitch);
+    DEBUG_LOG("  Volume: eSpeak=%d", job.volume);
+    DEBUG_LOG("  Intonation: %d", job.intonation);
+    DEBUG_LOG("  Word gap: %d", job.wordgap);
+    return true;
+}
+
+// One character, or a surrogate pair: what cursor movement and typing produce.
+bool is_key_echo(const synth_job& job) {
+    if (job.ssml || job.text.empty()) {
+        return false;
+    }
+    if (job.text.size() == 1) {
+        return job.text[0] < 0xD800 || job.text[0] > 0xDFFF;
+    }
+    return job.text.size() == 2 && job.text[0] >= 0xD800 && job.text[0] <= 0xDBFF &&
+           job.text[1] >= 0xDC00 && job.text[1] <= 0xDFFF;
+}
+
+std::uint64_t sample_offset_bytes(int sample, const output_format& native, const output_format& format) {
+    const std::uint64_t block_align = AUDIO_CHANNELS * bits_per_sample(format) / 8;
+    return static_cast<std::uint64_t>(sample) * format.sample_rate / native.sample_rate * block_align;
+}
+
+struct event_mapping {
+    const synth_unit* unit = nullptr;
+    const std::vector<speak_fragment>* frags = nullptr;
+    std::uint64_t unit_offset = 0;
+    output_format native{};
+    output_format format{};
+    bool words = false;
+    bool sentences = false;
+};
+
+void queue_synth_event(SpeakContext& ctx, const event_mapping& mapping, const SynthEvent& event) {
+    const synth_unit& unit = *mapping.unit;
+    const std::uint64_t offset = mapping.unit_offset + sample_offset_bytes(event.sample, mapping.native, mapping.format);
+
+    if (event.type == SynthEventType::Mark) {
+        char* end = nullptr;
+        const unsigned long index = std::strtoul(event.name.c_str(), &end, 10);
+        if (event.name.empty() || *end != '\0' || index >= unit.marks.size()) {
+            DEBUG_LOG("Mark: Ignoring unknown mark '%s'", event.name.c_str());
+            return;
+        }
+        queue_bookmark(ctx, (*mapping.frags)[unit.marks[index]], offset);
+        return;
+    }
+
+    const bool word = event.type == SynthEventType::Word;
+    if ((word ? !mapping.words : !mapping.sentences) || unit.positions.empty()) {
+        return;
+    }
+
+    // espeak-ng positions are 1-based code point indexes into the synthesized text.
+    const std::size_t last = unit.positions.size() - 1;
+    const std::size_t index = std::min(static_cast<std::size_t>((std::max)(event.text_position - 1, 0)), last);
+    const std::size_t end = std::min(index + static_cast<std::size_t>((std::max)(event.length, 0)), last);
+    const std::uint32_t start = unit.positions[index];
+    std::uint32_t length = unit.positions[end] - start;
+
+    if (word) {
+        queue_boundary(ctx, site_event_type::word_boundary, offset, start, length);
+        DEBUG_LOG("SAPI Event: Word boundary at source %u (+%u), byte offset %llu",
+                  start, length, static_cast<unsigned long long>(offset));
+        return;
+    }
+
+    if (length == 0) {
+        for (const std::size_t spoken : unit.spoken) {
+            const speak_fragment& frag = (*mapping.frags)[spoken];
+            const std::uint32_t frag_end = frag.source_offset + static_cast<std::uint32_t>(frag.text.size());
+            if (start >= frag.source_offset && start < frag_end) {
+                length = frag_end - start;
+                break;
+            }
+        }
+    }
+    queue_boundary(ctx, site_event_type::sentence_boundary, offset, start, length);
+    DEBUG_LOG("SAPI Event: Sentence boundary at source %u (+%u), byte offset %llu",
+              start, length, static_cast<unsigned long long>(offset));
+}
+
+std::mutex g_worker_pool_mutex;
+std::shared_ptr<WorkerPool> g_worker_pool;
+
+std::shared_ptr<WorkerPool> configure_worker_pool(int size) {
+    std::lock_guard<std::mutex> lock(g_worker_pool_mutex);
+    if (size <= 0) {
+        g_worker_pool.reset();
+    } else if (!g_worker_pool || g_worker_pool->size() != static_cast<std::size_t>(size)) {
+        g_worker_pool = std::make_shared<WorkerPool>(WorkerPool::defaultWorkerPath(), static_cast<std::size_t>(size));
+    }
+    return g_worker_pool;
+}
+
+std::shared_ptr<WorkerPool> current_worker_pool() {
+    std::lock_guard<std::mutex> lock(g_worker_pool_mutex);
+    return g_worker_pool;
+}
+
+bool synthesize_job(const synth_job& job, SpeakCallback callback, void* user_data,
+                    const synth_pipeline::event_sink& on_event) {
+    const TimelineSpan span("synthesize", "chars", static_cast<std::int64_t>(job.text.size()));
+    if (std::shared_ptr<WorkerPool> workers = current_worker_pool()) {
+        SpeakRequest request{0, job.voice, job.rate, job.pitch, job.volume,
+                             job.intonation, job.wordgap, job.rateboost, {}, job.ssml, job.spell};
+        utf16ToUtf8(job.text, request.text);
+        const TimelineSpan worker_span("worker speak");
+        const WorkerPool::Result result = workers->speak(std::move(request),
+            [&](const short* audio, int sample_count) {
+                return callback(audio, sample_count, user_data);
+            },
+            job.events ? on_event : nullptr, job.cancel);
+        if (result != WorkerPool::Result::Unavailable) {
+            return result == WorkerPool::Result::Ok;
+        }
+        DEBUG_LOG("Worker pool unavailable, synthesizing in-process");
+    }
+
+    EventCallback event_callback;
+    if (job.events && on_event) {
+        event_callback = [&on_event](const SynthEvent& event, void*) { on_event(event); };
+    }
+    return EspeakEngine::getInstance().speak(job.text, job.rate, job.pitch, job.volume,
+                                             job.intonation, job.wordgap, job.rateboost,
+                                             std::move(callback), user_data, std::move(event_callback),
+                                             job.ssml ? TextFormat::Ssml : job.spell ? TextFormat::Characters : TextFormat::Plain,
+                                             job.cancel, job.voice);
+}
+}
+
+output_format native_format() {
+    return {static_cast<std::uint32_t>(EspeakEngine::getInstance().sampleRate()), SampleFormat::Pcm16};
+}
+
+bool speak_session::speak(speak_site& site, const std::vector<speak_fragment>& frags,
+                          const speak_options& options, const config::Configuration& cfg)
+{
+    const Clock::time_point started = Clock::now();
+    const TimelineSpan span("speak session", "fragments", static_cast<std::int64_t>(frags.size()));
+    long sapi_rate = site.rate();
+    unsigned short sapi_volume = site.volume();
+    PerfCounters::local().add(PerfCounter::SpeakCalls);
+    PerfCounters::local().add(PerfCounter::Fragments, frags.size());
+
+    DEBUG_LOG("=== New Speech Request ===");
+    DEBUG_LOG("Voice: %s", options.voice.c_str());
+    DEBUG_LOG("SAPI Rate: %d, SAPI Volume: %u", (int)sapi_rate, sapi_volume);
+    DEBUG_LOG("Events: sentence %d, word %d", options.sentence_events, options.word_events);
+
+    std::shared_ptr<WorkerPool> workers;
+    {
+        const TimelineSpan configure_span("configure");
+        EspeakEngine::getInstance().configureCache(
+            static_cast<std::size_t>(cfg.audio_cache_mb) * 1024 * 1024, cfg.audio_cache_persist);
+        EspeakEngine::getInstance().configureChunking(
+            static_cast<std::size_t>(cfg.chunk_first_chars), static_cast<std::size_t>(cfg.chunk_max_chars));
+        EspeakEngine::getInstance().configureBuffer(cfg.synth_buffer_ms);
+        EspeakEngine::getInstance().configureSilenceTrim(cfg.silence_trim, cfg.silence_threshold,
+                                                         cfg.silence_lookahead_ms, cfg.silence_max_gap_ms);
+        EspeakEngine::getInstance().configureCharacterTable(
+            static_cast<std::size_t>(cfg.character_table_mb) * 1024 * 1024, options.config_generation);
+        workers = configure_worker_pool(cfg.worker_processes);
+        if (workers) {
+            WorkerSettings settings{};
+            settings.cache_bytes = static_cast<std::uint64_t>(cfg.audio_cache_mb) * 1024 * 1024;
+            settings.chunk_first_chars = static_cast<std::uint32_t>(cfg.chunk_first_chars);
+            settings.chunk_max_chars = static_cast<std::uint32_t>(cfg.chunk_max_chars);
+            settings.buffer_ms = cfg.synth_buffer_ms;
+            settings.trim = cfg.silence_trim;
+            settings.trim_threshold = cfg.silence_threshold;
+            settings.trim_lookahead_ms = cfg.silence_lookahead_ms;
+            settings.trim_max_gap_ms = cfg.silence_max_gap_ms;
+            settings.character_table_bytes = static_cast<std::uint64_t>(cfg.character_table_mb) * 1024 * 1024;
+            settings.generation = options.config_generation;
+            workers->configure(settings);
+        }
+    }
+    DEBUG_LOG("Worker processes: %d", cfg.worker_processes);
+
+    const output_format native = native_format();
+    const output_format format = options.format.sample_rate > 0 ? options.format : native;
+    if (!resampler_ || resampler_->outputRate() != static_cast<int>(format.sample_rate) ||
+        resampler_->inputRate() != static_cast<int>(native.sample_rate) ||
+        resampler_->format() != format.sample_format) {
+        resampler_ = std::make_unique<Resampler>(static_cast<int>(native.sample_rate),
+                                                 static_cast<int>(format.sample_rate), format.sample_format);
+    }
+    resampler_->reset();
+    DEBUG_LOG("Output format: %u Hz %s (engine %u Hz, kernel %s)", format.sample_rate,
+              format.sample_format == SampleFormat::Float32 ? "float" : "pcm16", native.sample_rate,
+              Resampler::kernelName(resampler_->kernel()));
+
+    SpeakContext ctx;
+    ctx.caller = &site;
+    ctx.resampler = resampler_.get();
+    ctx.bytes_written = 0;
+    ctx.aborted = false;
+    cancel_.reset();
+    ctx.cancel = &cancel_;
+    ctx.started = started;
+    const speak_perf_scope perf_scope(ctx);
+
+    TimeStretcher stretcher(static_cast<int>(native.sample_rate));
+    GainRamp gain(static_cast<std::size_t>(native.sample_rate) * GAIN_RAMP_MS / 1000);
+    live_prosody live;
+    live.sapi_rate = &sapi_rate;
+    live.sapi_volume = &sapi_volume;
+    live.rateboost = cfg.rateboost;
+    ctx.stretcher = &stretcher;
+    ctx.gain = &gain;
+
+    pcm_write_buffer buffer(
+        [&ctx](const std::uint8_t* data, std::size_t size) { return write_to_site(ctx, data, size); },
+        write_buffer_bytes(cfg.write_buffer_ms, format),
+        std::chrono::milliseconds(cfg.write_latency_ms));
+    ctx.buffer = &buffer;
+    DEBUG_LOG("Write buffer: %d ms (%zu bytes), max latency %d ms",
+              cfg.write_buffer_ms, write_buffer_bytes(cfg.write_buffer_ms, format), cfg.write_latency_ms);
+    DEBUG_LOG("Fragment count: %zu", frags.size());
+
+    synth_pipeline* pipeline = nullptr;
+    const std::size_t depth = static_cast<std::size_t>(cfg.lookahead_fragments);
+    if (depth > 0) {
+        if (!pipeline_ || pipeline_->depth() != depth) {
+            pipeline_ = std::make_unique<synth_pipeline>(
+                [](const synth_job& job, const synth_pipeline::audio_sink& sink,
+                   const synth_pipeline::event_sink& events) {
+                    return synthesize_job(job, [&sink](const short* audio, int sample_count, void*) {
+                        return sink(audio, sample_count);
+                    }, nullptr, events);
+                },
+                depth);
+        }
+        pipeline = pipeline_.get();
+        DEBUG_LOG("Lookahead pipeline: depth %zu", depth);
+    }
+
+    plan_options plan;
+    plan.merge = cfg.merge_fragments;
+    plan.rateboost = cfg.rateboost;
+    plan.max_chars = static_cast<std::size_t>(cfg.chunk_max_chars);
+    plan.map_positions = options.word_events || options.sentence_events;
+    std::vector<synth_unit> units;
+    {
+        const TimelineSpan plan_span("plan", "fragments", static_cast<std::int64_t>(frags.size()));
+        std::vector<plan_fragment> plan_input;
+        plan_input.reserve(frags.size());
+        for (const speak_fragment& f : frags) {
+            plan_input.push_back(to_plan_fragment(f, sapi_rate, sapi_volume));
+        }
+        plan_fragments(plan_input, plan, units);
+    }
+    DEBUG_LOG("Fragment plan: %zu fragments -> %zu units (merge %d)", frags.size(), units.size(), plan.merge);
+
+    std::vector<bool> submitted(units.size(), false);
+    std::vector<job_prosody> prosody(units.size());
+    std::optional<synth_job> key_echo;
+    std::size_t next_submit = 0;
+    std::vector<short> samples;
+    std::vector<SynthEvent> events;
+
+    for (std::size_t unit_index = 0; unit_index < units.size(); ++unit_index) {
+        const synth_unit& unit = units[unit_index];
+        const TimelineSpan unit_span("unit", "index", static_cast<std::int64_t>(unit_index));
+        DEBUG_LOG("--- Processing Unit %zu/%zu ---", unit_index + 1, units.size());
+
+        if (!check_actions(ctx)) {
+            break;
+        }
+
+        if (unit.spoken.empty()) {
+            for (const std::size_t mark : unit.marks) {
+                DEBUG_LOG("Fragment %zu is a BOOKMARK", mark + 1);
+                queue_bookmark(ctx, frags[mark], ctx.bytes_written);
+            }
+            flush_events(ctx);
+            continue;
+        }
+
+        synth_job job;
+        job.cancel = &cancel_;
+        if (pipeline) {
+            for (; next_submit < units.size() && next_submit <= unit_index + depth; ++next_submit) {
+                if (units[next_submit].spoken.empty()) {
+                    continue;
+                }
+                if (prepare_job(units[next_submit], frags, site, cfg, options.voice, plan.map_positions,
+                                sapi_rate, sapi_volume, job)) {
+                    prosody[next_submit] = {job.rate, job.volume};
+                    if (!key_echo && is_key_echo(job)) {
+                        key_echo = job;
+                    }
+                    pipeline->submit(std::move(job));
+                    submitted[next_submit] = true;
+                    DEBUG_LOG("Lookahead: Submitted unit %zu", next_submit + 1);
+                }
+            }
+            if (!submitted[unit_index]) {
+                continue;
+            }
+        } else if (prepare_job(unit, frags, site, cfg, options.voice, plan.map_positions,
+                               sapi_rate, sapi_volume, job)) {
+            prosody[unit_index] = {job.rate, job.volume};
+            if (!key_echo && is_key_echo(job)) {
+                key_echo = job;
+            }
+        } else {
+            continue;
+        }
+
+        if (cfg.live_prosody) {
+            live.state = &frags[unit.base];
+            live.base_rate = prosody[unit_index].rate;
+            live.base_volume = prosody[unit_index].volume;
+            stretcher.reset();
+            ctx.live = &live;
+            update_live_prosody(ctx, true);
+        }
+
+        event_mapping mapping;
+        mapping.unit = &unit;
+        mapping.frags = &frags;
+        mapping.unit_offset = ctx.bytes_written;
+        mapping.native = native;
+        mapping.format = format;
+        mapping.words = options.word_events;
+        mapping.sentences = options.sentence_events;
+        const auto on_event = [&](const SynthEvent& event) {
+            if (!ctx.live) {
+                queue_synth_event(ctx, mapping, event);
+                return;
+            }
+            SynthEvent stretched = event;
+            stretched.sample = static_cast<int>(stretcher.map(event.sample));
+            queue_synth_event(ctx, mapping, stretched);
+        };
+
+        bool ok = true;
+        if (pipeline) {
+            for (;;) {
+                synth_pipeline::status result;
+                {
+                    const TimelineSpan read_span("pipeline read");
+                    result = pipeline->read(samples, events, std::chrono::milliseconds(10));
+                }
+                if (result == synth_pipeline::status::audio) {
+                    if (!samples.empty() &&
+                        !speak_callback(samples.data(), static_cast<int>(samples.size()), &ctx)) {
+                        ok = false;
+                        break;
+                    }
+                    for (const SynthEvent& event : events) {
+                        on_event(event);
+                    }
+                    flush_events(ctx);
+                } else if (result == synth_pipeline::status::pending) {
+                    if (!check_actions(ctx)) {
+                        break;
+                    }
+                } else {
+                    ok = (result == synth_pipeline::status::done);
+                    break;
+                }
+            }
+        } else {
+            ok = synthesize_job(job, speak_callback, &ctx, on_event);
+        }
+
+        if (ctx.aborted || !ok) {
+            ctx.events.clear();
+            ctx.event_strings.clear();
+        } else {
+            flush_events(ctx);
+        }
+
+        if (ctx.aborted) {
+            DEBUG_LOG("Speech aborted");
+            buffer.discard();
+            break;
+        }
+        if (!ok) {
+            LOG_ERROR("Speech failed");
+            if (pipeline) {
+                pipeline->cancel();
+            }
+            return false;
+        }
+
+        if (!flush_live_prosody(ctx) || !buffer.flush()) {
+            if (ctx.aborted) {
+                DEBUG_LOG("Speech aborted during flush");
+                break;
+            }
+            LOG_WARN("Flush failed");
+            if (pipeline) {
+                pipeline->cancel();
+            }
+            return false;
+        }
+    }
+
+    if (pipeline) {
+        pipeline->cancel();
+    }
+
+    if (!ctx.aborted && !resampler_->passthrough()) {
+        ctx.converted.clear();
+        resampler_->flush(ctx.converted);
+        ctx.bytes_written += ctx.converted.size();
+        if (!buffer.append(ctx.converted.data(), ctx.converted.size()) || !buffer.flush()) {
+            if (!ctx.aborted) {
+                LOG_WARN("Flush failed");
+                return false;
+            }
+        }
+    }
+
+    if (key_echo && !ctx.aborted && cfg.character_table_mb > 0 && options.on_key_echo) {
+        options.on_key_echo(*key_echo);
+    }
+
+    DEBUG_LOG("Write buffer: %llu writes for %llu bytes",
+              buffer.flush_count(), static_cast<unsigned long long>(ctx.bytes_written));
+
+#if ENABLE_DEBUG_LOG
+    // The statistics take the cache and pool locks, so they are only gathered for the log.
+    if (DebugLog::Enabled(DebugLog::Level::Debug)) {
+        const AudioCache::Stats cache_stats = EspeakEngine::getInstance().cacheStats();
+        DEBUG_LOG("Audio cache: %llu hits, %llu misses, %zu entries, %zu bytes",
+                  cache_stats.hits, cache_stats.misses, cache_stats.entries, cache_stats.bytes);
+        const CharacterTable::Stats table_stats = EspeakEngine::getInstance().characterTableStats();
+        DEBUG_LOG("Character table: %llu hits, %llu misses, %zu sets, %zu entries, %zu bytes",
+                  table_stats.hits, table_stats.misses, table_stats.sets, table_stats.entries, table_stats.bytes);
+        if (workers) {
+            const WorkerPool::Stats worker_stats = workers->stats();
+            DEBUG_LOG("Worker pool: %llu requests, %llu spawns, %llu failures, %llu waits, %llu voice hits",
+                      worker_stats.requests, worker_stats.spawns, worker_stats.failures, worker_stats.waits,
+                      worker_stats.voice_hits);
+        }
+    }
+#endif
+    DEBUG_LOG("=== Speak Completed Successfully ===");
+    return true;
+}
+}
+}
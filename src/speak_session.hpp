@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "cancel_token.hpp"
+#include "config_types.hpp"
+#include "resampler.hpp"
+#include "speak_site.hpp"
+#include "synth_pipeline.hpp"
+
+namespace Espeak {
+namespace sapi {
+
+struct output_format {
+    std::uint32_t sample_rate;
+    SampleFormat sample_format;
+};
+
+struct speak_options {
+    output_format format{};
+    std::string voice;
+    bool word_events = false;
+    bool sentence_events = false;
+    std::uint64_t config_generation = 0;
+    // Called with the prosody of the first single-character unit, if any.
+    std::function<void(const synth_job& job)> on_key_echo;
+};
+
+[[nodiscard]] output_format native_format();
+
+// The platform-independent body of ISpTTSEngine::Speak: plans the fragments,
+// synthesizes them and streams audio and events to the site. The pipeline and
+// resampler are kept between calls.
+class speak_session
+{
+public:
+    speak_session() = default;
+
+    speak_session(const speak_session&) = delete;
+    speak_session& operator=(const speak_session&) = delete;
+
+    // Returns false on failure; an abort or skip still counts as success.
+    [[nodiscard]] bool speak(speak_site& site, const std::vector<speak_fragment>& fragments,
+                             const speak_options& options, const config::Configuration& cfg);
+
+private:
+    std::unique_ptr<synth_pipeline> pipeline_;
+    std::unique_ptr<Resampler> resampler_;
+    CancelToken cancel_;
+};
+}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "fragment_planner.hpp"
+
+namespace Espeak {
+namespace sapi {
+
+// Action flags, with the values of SPVESACTIONS.
+constexpr unsigned SITE_ACTION_ABORT = 1u << 0;
+constexpr unsigned SITE_ACTION_SKIP = 1u << 1;
+constexpr unsigned SITE_ACTION_RATE = 1u << 2;
+constexpr unsigned SITE_ACTION_VOLUME = 1u << 3;
+
+enum class site_event_type {
+    word_boundary,
+    sentence_boundary,
+    bookmark
+};
+
+// offset is in bytes of the output stream. Boundaries carry the source range;
+// bookmarks carry their id and text, which stays valid until add_events returns.
+struct site_event {
+    site_event_type type = site_event_type::bookmark;
+    std::uint64_t offset = 0;
+    std::uint32_t source_start = 0;
+    std::uint32_t source_length = 0;
+    long bookmark_id = 0;
+    const char16_t* bookmark = nullptr;
+};
+
+// A text fragment with its SPVSTATE adjustments, independent of the SAPI headers.
+struct speak_fragment {
+    fragment_kind kind = fragment_kind::ignored;
+    std::u16string_view text;
+    std::uint32_t source_offset = 0;
+    int rate_adj = 0;
+    int pitch_adj = 0;
+    unsigned short volume = 100;
+    int emphasis = 0;
+    unsigned long silence_ms = 0;
+};
+
+// What a synthesis run needs from its caller. The SAPI adapter forwards to
+// ISpTTSEngineSite; headless builds use mock_speak_site.
+class speak_site
+{
+public:
+    virtual ~speak_site() = default;
+
+    [[nodiscard]] virtual unsigned actions() = 0;
+
+    [[nodiscard]] virtual bool write(const void* data, std::size_t size, std::size_t& written) = 0;
+
+    virtual void add_events(const site_event* events, std::size_t count) = 0;
+
+    [[nodiscard]] virtual long rate() = 0;
+
+    [[nodiscard]] virtual unsigned short volume() = 0;
+
+    virtual void complete_skip() = 0;
+};
+}
+}
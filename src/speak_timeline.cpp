@@ -0,0 +1,151 @@
+#include "speak_timeline.hpp"
+#include <cstdio>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "debug_log.h"
+
+namespace Espeak {
+
+namespace {
+
+static_assert((TIMELINE_CAPACITY & (TIMELINE_CAPACITY - 1)) == 0, "capacity must be a power of two");
+
+constexpr std::uint64_t TIMELINE_MASK = TIMELINE_CAPACITY - 1;
+
+std::atomic<std::uint32_t> g_next_thread{1};
+std::mutex g_enable_mutex;
+
+// Small, stable ids read better in a trace viewer than OS thread ids.
+std::uint32_t currentThread() noexcept {
+    thread_local const std::uint32_t thread = g_next_thread.fetch_add(1, std::memory_order_relaxed);
+    return thread;
+}
+
+unsigned long currentPid() {
+#ifdef _WIN32
+    return static_cast<unsigned long>(GetCurrentProcessId());
+#else
+    return static_cast<unsigned long>(getpid());
+#endif
+}
+
+void appendEscaped(std::string& out, const char* text) {
+    for (; *text; ++text) {
+        if (*text == '"' || *text == '\\') {
+            out.push_back('\\');
+        }
+        out.push_back(*text);
+    }
+}
+}
+
+Timeline& Timeline::instance() {
+    static Timeline* timeline = new Timeline();
+    return *timeline;
+}
+
+void Timeline::enable(bool enabled) {
+    if (enabled == this->enabled()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(g_enable_mutex);
+    if (enabled && !slots_.load(std::memory_order_relaxed)) {
+        epoch_ = Clock::now();
+        slots_.store(new Slot[TIMELINE_CAPACITY], std::memory_order_release);
+    }
+    enabled_.store(enabled, std::memory_order_release);
+    LOG_INFO("Timeline: Recording %s", enabled ? "on" : "off");
+}
+
+void Timeline::record(const char* name, Clock::time_point start, Clock::time_point end,
+                      const char* arg_name, std::int64_t arg) noexcept {
+    Slot* slots = slots_.load(std::memory_order_acquire);
+    if (!slots) {
+        return;
+    }
+
+    // The sequence is zero while the slot is written, then one past its index.
+    const std::uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+    Slot& slot = slots[index & TIMELINE_MASK];
+    slot.sequence.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.name.store(name, std::memory_order_relaxed);
+    slot.arg_name.store(arg_name, std::memory_order_relaxed);
+    slot.start_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(start - epoch_).count(),
+                        std::memory_order_relaxed);
+    slot.duration_ns.store(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count(),
+                           std::memory_order_relaxed);
+    slot.arg.store(arg, std::memory_order_relaxed);
+    slot.thread.store(currentThread(), std::memory_order_relaxed);
+    slot.sequence.store(index + 1, std::memory_order_release);
+}
+
+bool Timeline::dump(const std::filesystem::path& path) const {
+    const Slot* slots = slots_.load(std::memory_order_acquire);
+    if (!slots) {
+        return false;
+    }
+
+    const std::uint64_t end = next_.load(std::memory_order_acquire);
+    const std::uint64_t begin = end > TIMELINE_CAPACITY ? end - TIMELINE_CAPACITY : 0;
+    const unsigned long pid = currentPid();
+
+    std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out.reserve(static_cast<std::size_t>(end - begin) * 112 + out.size());
+    std::size_t written = 0;
+    char number[160];
+    for (std::uint64_t index = begin; index < end; ++index) {
+        const Slot& slot = slots[index & TIMELINE_MASK];
+        if (slot.sequence.load(std::memory_order_acquire) != index + 1) {
+            continue;
+        }
+        const char* name = slot.name.load(std::memory_order_relaxed);
+        const char* arg_name = slot.arg_name.load(std::memory_order_relaxed);
+        const std::int64_t start_ns = slot.start_ns.load(std::memory_order_relaxed);
+        const std::int64_t duration_ns = slot.duration_ns.load(std::memory_order_relaxed);
+        const std::int64_t arg = slot.arg.load(std::memory_order_relaxed);
+        const std::uint32_t thread = slot.thread.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.sequence.load(std::memory_order_relaxed) != index + 1 || !name) {
+            continue;
+        }
+
+        out += written++ == 0 ? "{\"name\":\"" : ",\n{\"name\":\"";
+        appendEscaped(out, name);
+        std::snprintf(number, sizeof(number),
+                      "\",\"cat\":\"speak\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lu,\"tid\":%u",
+                      static_cast<double>(start_ns) / 1000.0, static_cast<double>(duration_ns) / 1000.0,
+                      pid, static_cast<unsigned>(thread));
+        out += number;
+        if (arg_name) {
+            out += ",\"args\":{\"";
+            appendEscaped(out, arg_name);
+            std::snprintf(number, sizeof(number), "\":%lld}", static_cast<long long>(arg));
+            out += number;
+        }
+        out += '}';
+    }
+    out += "\n]}\n";
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        LOG_WARN("Timeline: Failed to open %S for writing", path.c_str());
+        return false;
+    }
+    file.write(out.data(), static_cast<std::streamsize>(out.size()));
+    if (!file) {
+        LOG_WARN("Timeline: Failed to write %S", path.c_str());
+        return false;
+    }
+    LOG_INFO("Timeline: Wrote %zu spans to %S", written, path.c_str());
+    return true;
+}
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+namespace Espeak {
+
+// Spans kept before the oldest are overwritten.
+constexpr std::size_t TIMELINE_CAPACITY = 1 << 16;
+
+// A ring of timed spans for one process, written as Chrome trace events
+// (chrome://tracing, Perfetto) on request. Recording is off until enabled; the
+// buffer is allocated once on the first enable and never grows.
+class Timeline {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static Timeline& instance();
+
+    Timeline(const Timeline&) = delete;
+    Timeline& operator=(const Timeline&) = delete;
+
+    void enable(bool enabled);
+
+    [[nodiscard]] bool enabled() const noexcept { return enabled_.load(std::memory_order_relaxed); }
+
+    // Names must be string literals; they are kept by pointer.
+    void record(const char* name, Clock::time_point start, Clock::time_point end,
+                const char* arg_name = nullptr, std::int64_t arg = 0) noexcept;
+
+    // Writes the spans still in the ring as a Chrome trace. Recording may
+    // continue meanwhile; spans overwritten while they are read are dropped.
+    bool dump(const std::filesystem::path& path) const;
+
+    // Spans recorded since the first enable, including overwritten ones.
+    [[nodiscard]] std::uint64_t recorded() const noexcept { return next_.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot {
+        std::atomic<std::uint64_t> sequence{0};
+        std::atomic<const char*> name{nullptr};
+        std::atomic<const char*> arg_name{nullptr};
+        std::atomic<std::int64_t> start_ns{0};
+        std::atomic<std::int64_t> duration_ns{0};
+        std::atomic<std::int64_t> arg{0};
+        std::atomic<std::uint32_t> thread{0};
+    };
+
+    Timeline() = default;
+
+    std::atomic<bool> enabled_{false};
+    std::atomic<std::uint64_t> next_{0};
+    std::atomic<Slot*> slots_{nullptr};
+    Clock::time_point epoch_;
+};
+
+// Records the lifetime of a scope on the timeline. When recording is off this
+// costs one relaxed load.
+class TimelineSpan {
+public:
+    explicit TimelineSpan(const char* name, const char* arg_name = nullptr, std::int64_t arg = 0) noexcept
+        : name_(name)
+        , arg_name_(arg_name)
+        , arg_(arg)
+        , active_(Timeline::instance().enabled())
+    {
+        if (active_) {
+            start_ = Timeline::Clock::now();
+        }
+    }
+
+    ~TimelineSpan() {
+        if (active_) {
+            Timeline::instance().record(name_, start_, Timeline::Clock::now(), arg_name_, arg_);
+        }
+    }
+
+    TimelineSpan(const TimelineSpan&) = delete;
+    TimelineSpan& operator=(const TimelineSpan&) = delete;
+
+    void setArg(const char* arg_name, std::int64_t arg) noexcept {
+        arg_name_ = arg_name;
+        arg_ = arg;
+    }
+
+private:
+    const char* name_;
+    const char* arg_name_;
+    std::int64_t arg_;
+    bool active_;
+    Timeline::Clock::time_point start_;
+};
+}
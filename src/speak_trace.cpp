@@ -0,0 +1,329 @@
+#include "speak_trace.hpp"
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include "worker_protocol.hpp"
+#include "debug_log.h"
+
+namespace Espeak {
+namespace sapi {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr std::uint32_t WORD_EVENTS = 1u << 0;
+constexpr std::uint32_t SENTENCE_EVENTS = 1u << 1;
+constexpr std::uint32_t RECORDED_ACTIONS = SITE_ACTION_ABORT | SITE_ACTION_SKIP;
+
+// Smallest encodings, used to reject counts a truncated payload cannot hold.
+constexpr std::size_t MIN_FRAGMENT_BYTES = 8 * sizeof(std::uint32_t);
+constexpr std::size_t MIN_ACTION_BYTES = 4 * sizeof(std::uint32_t);
+
+void put_header(std::vector<std::uint8_t>& out) {
+    PayloadWriter writer(out);
+    writer.putU32(SPEAK_TRACE_MAGIC);
+    writer.putU32(SPEAK_TRACE_VERSION);
+}
+}
+
+std::vector<speak_fragment> trace_call::speak_fragments() const {
+    std::vector<speak_fragment> out;
+    out.reserve(fragments.size());
+    for (const trace_fragment& f : fragments) {
+        speak_fragment fragment;
+        fragment.kind = f.kind;
+        fragment.text = f.text;
+        fragment.source_offset = f.source_offset;
+        fragment.rate_adj = f.rate_adj;
+        fragment.pitch_adj = f.pitch_adj;
+        fragment.volume = f.volume;
+        fragment.emphasis = f.emphasis;
+        fragment.silence_ms = f.silence_ms;
+        out.push_back(fragment);
+    }
+    return out;
+}
+
+speak_options trace_call::options() const {
+    speak_options out;
+    out.format = format;
+    out.voice = voice;
+    out.word_events = word_events;
+    out.sentence_events = sentence_events;
+    return out;
+}
+
+trace_call make_trace_call(const std::vector<speak_fragment>& fragments, const speak_options& options) {
+    trace_call call;
+    call.voice = options.voice;
+    call.format = options.format;
+    call.word_events = options.word_events;
+    call.sentence_events = options.sentence_events;
+    call.fragments.reserve(fragments.size());
+    for (const speak_fragment& f : fragments) {
+        trace_fragment fragment;
+        fragment.kind = f.kind;
+        fragment.text.assign(f.text);
+        fragment.source_offset = f.source_offset;
+        fragment.rate_adj = f.rate_adj;
+        fragment.pitch_adj = f.pitch_adj;
+        fragment.volume = f.volume;
+        fragment.emphasis = f.emphasis;
+        fragment.silence_ms = f.silence_ms;
+        call.fragments.push_back(std::move(fragment));
+    }
+    return call;
+}
+
+void encode_trace_call(const trace_call& call, std::vector<std::uint8_t>& out) {
+    PayloadWriter writer(out);
+    writer.putU32(static_cast<std::uint32_t>(call.start_ms));
+    writer.putU32(static_cast<std::uint32_t>(call.start_ms >> 32));
+    writer.putU32(call.duration_us);
+    writer.putString(call.voice);
+    writer.putU32(call.format.sample_rate);
+    writer.putU32(static_cast<std::uint32_t>(call.format.sample_format));
+    writer.putU32((call.word_events ? WORD_EVENTS : 0) | (call.sentence_events ? SENTENCE_EVENTS : 0));
+    writer.putI32(static_cast<std::int32_t>(call.rate));
+    writer.putU32(call.volume);
+
+    writer.putU32(static_cast<std::uint32_t>(call.fragments.size()));
+    for (const trace_fragment& f : call.fragments) {
+        writer.putU32(static_cast<std::uint32_t>(f.kind));
+        writer.putU32(static_cast<std::uint32_t>(f.text.size()));
+        writer.putBytes(f.text.data(), f.text.size() * sizeof(char16_t));
+        writer.putU32(f.source_offset);
+        writer.putI32(f.rate_adj);
+        writer.putI32(f.pitch_adj);
+        writer.putU32(f.volume);
+        writer.putI32(f.emphasis);
+        writer.putU32(static_cast<std::uint32_t>(f.silence_ms));
+    }
+
+    writer.putU32(static_cast<std::uint32_t>(call.actions.size()));
+    for (const trace_action& a : call.actions) {
+        writer.putU32(a.at_us);
+        writer.putU32(a.flags);
+        writer.putI32(static_cast<std::int32_t>(a.rate));
+        writer.putU32(a.volume);
+    }
+}
+
+bool decode_trace_call(const std::vector<std::uint8_t>& payload, trace_call& call) {
+    PayloadReader reader(payload);
+    trace_call decoded;
+    std::uint32_t start_low = 0;
+    std::uint32_t start_high = 0;
+    std::uint32_t sample_format = 0;
+    std::uint32_t events = 0;
+    std::int32_t rate = 0;
+    std::uint32_t volume = 0;
+    std::uint32_t count = 0;
+    if (!reader.getU32(start_low) || !reader.getU32(start_high) || !reader.getU32(decoded.duration_us) ||
+        !reader.getString(decoded.voice) || !reader.getU32(decoded.format.sample_rate) ||
+        !reader.getU32(sample_format) || !reader.getU32(events) || !reader.getI32(rate) ||
+        !reader.getU32(volume) || !reader.getU32(count)) {
+        return false;
+    }
+    if (sample_format > static_cast<std::uint32_t>(SampleFormat::Float32) ||
+        count > reader.remaining() / MIN_FRAGMENT_BYTES) {
+        return false;
+    }
+    decoded.start_ms = (static_cast<std::uint64_t>(start_high) << 32) | start_low;
+    decoded.format.sample_format = static_cast<SampleFormat>(sample_format);
+    decoded.word_events = (events & WORD_EVENTS) != 0;
+    decoded.sentence_events = (events & SENTENCE_EVENTS) != 0;
+    decoded.rate = rate;
+    decoded.volume = static_cast<unsigned short>(volume);
+
+    decoded.fragments.resize(count);
+    for (trace_fragment& f : decoded.fragments) {
+        std::uint32_t kind = 0;
+        std::uint32_t length = 0;
+        std::uint32_t fragment_volume = 0;
+        std::uint32_t silence = 0;
+        if (!reader.getU32(kind) || kind > static_cast<std::uint32_t>(fragment_kind::ignored) ||
+            !reader.getU32(length) || length > reader.remaining() / sizeof(char16_t)) {
+            return false;
+        }
+        f.kind = static_cast<fragment_kind>(kind);
+        f.text.resize(length);
+        std::int32_t rate_adj = 0;
+        std::int32_t pitch_adj = 0;
+        std::int32_t emphasis = 0;
+        if (!reader.getBytes(f.text.data(), length * sizeof(char16_t)) || !reader.getU32(f.source_offset) ||
+            !reader.getI32(rate_adj) || !reader.getI32(pitch_adj) || !reader.getU32(fragment_volume) ||
+            !reader.getI32(emphasis) || !reader.getU32(silence)) {
+            return false;
+        }
+        f.rate_adj = rate_adj;
+        f.pitch_adj = pitch_adj;
+        f.volume = static_cast<unsigned short>(fragment_volume);
+        f.emphasis = emphasis;
+        f.silence_ms = silence;
+    }
+
+    if (!reader.getU32(count) || count > reader.remaining() / MIN_ACTION_BYTES) {
+        return false;
+    }
+    decoded.actions.resize(count);
+    for (trace_action& a : decoded.actions) {
+        std::uint32_t flags = 0;
+        std::int32_t action_rate = 0;
+        std::uint32_t action_volume = 0;
+        if (!reader.getU32(a.at_us) || !reader.getU32(flags) || !reader.getI32(action_rate) ||
+            !reader.getU32(action_volume)) {
+            return false;
+        }
+        a.flags = flags;
+        a.rate = action_rate;
+        a.volume = static_cast<unsigned short>(action_volume);
+    }
+    if (reader.remaining() != 0) {
+        return false;
+    }
+
+    call = std::move(decoded);
+    return true;
+}
+
+bool read_trace(const std::filesystem::path& path, std::vector<trace_call>& calls) {
+    std::ifstream file{path, std::ios::binary};
+    if (!file.is_open()) {
+        return false;
+    }
+    const std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    PayloadReader reader(data);
+    std::uint32_t magic = 0;
+    std::uint32_t version = 0;
+    if (!reader.getU32(magic) || magic != SPEAK_TRACE_MAGIC || !reader.getU32(version) ||
+        version != SPEAK_TRACE_VERSION) {
+        return false;
+    }
+
+    calls.clear();
+    std::vector<std::uint8_t> payload;
+    std::uint32_t size = 0;
+    while (reader.getU32(size) && size <= reader.remaining()) {
+        payload.resize(size);
+        if (!reader.getBytes(payload.data(), size)) {
+            break;
+        }
+        trace_call call;
+        if (!decode_trace_call(payload, call)) {
+            DEBUG_LOG("Speak trace: Skipping unreadable call %zu", calls.size());
+            continue;
+        }
+        calls.push_back(std::move(call));
+    }
+    return true;
+}
+
+bool trace_writer::open(const std::filesystem::path& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    file_.open(path, std::ios::binary | std::ios::trunc);
+    if (!file_.is_open()) {
+        return false;
+    }
+    put_header(buffer_);
+    file_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+    file_.flush();
+    opened_ = Clock::now();
+    return file_.good();
+}
+
+bool trace_writer::is_open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return file_.is_open();
+}
+
+std::uint64_t trace_writer::elapsed_ms() const {
+    return static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - opened_).count());
+}
+
+void trace_writer::write(const trace_call& call) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!file_.is_open()) {
+        return;
+    }
+    encode_trace_call(call, buffer_);
+    const std::uint32_t size = static_cast<std::uint32_t>(buffer_.size());
+    file_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(buffer_.size()));
+    file_.flush();
+    if (!file_.good()) {
+        LOG_WARN("Speak trace: Write failed, recording stopped");
+        file_.close();
+    }
+}
+
+recording_site::recording_site(speak_site& inner, trace_call& call)
+    : inner_(inner)
+    , call_(call)
+    , started_(Clock::now())
+{
+    call_.rate = last_rate_ = inner_.rate();
+    call_.volume = last_volume_ = inner_.volume();
+}
+
+unsigned recording_site::actions()
+{
+    const unsigned flags = inner_.actions();
+    const unsigned recorded = flags & RECORDED_ACTIONS;
+    if (recorded && recorded != last_flags_) {
+        call_.actions.push_back({elapsed_us(), recorded, last_rate_, last_volume_});
+    }
+    last_flags_ = recorded;
+    return flags;
+}
+
+bool recording_site::write(const void* data, std::size_t size, std::size_t& written)
+{
+    return inner_.write(data, size, written);
+}
+
+void recording_site::add_events(const site_event* events, std::size_t count)
+{
+    inner_.add_events(events, count);
+}
+
+long recording_site::rate()
+{
+    const long rate = inner_.rate();
+    if (rate != last_rate_) {
+        call_.actions.push_back({elapsed_us(), SITE_ACTION_RATE, rate, last_volume_});
+        last_rate_ = rate;
+    }
+    return rate;
+}
+
+unsigned short recording_site::volume()
+{
+    const unsigned short volume = inner_.volume();
+    if (volume != last_volume_) {
+        call_.actions.push_back({elapsed_us(), SITE_ACTION_VOLUME, last_rate_, volume});
+        last_volume_ = volume;
+    }
+    return volume;
+}
+
+void recording_site::complete_skip()
+{
+    inner_.complete_skip();
+}
+
+void recording_site::finish()
+{
+    call_.duration_us = elapsed_us();
+}
+
+std::uint32_t recording_site::elapsed_us() const
+{
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started_).count();
+    return static_cast<std::uint32_t>(std::min<long long>(us, std::numeric_limits<std::uint32_t>::max()));
+}
+}
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "speak_session.hpp"
+
+namespace Espeak {
+namespace sapi {
+
+constexpr std::uint32_t SPEAK_TRACE_MAGIC = 0x52545345;
+constexpr std::uint32_t SPEAK_TRACE_VERSION = 1;
+
+// An action the site raised, in microseconds from the start of the call. For
+// rate and volume changes, the value the engine read.
+struct trace_action {
+    std::uint32_t at_us = 0;
+    unsigned flags = 0;
+    long rate = 0;
+    unsigned short volume = 100;
+};
+
+struct trace_fragment {
+    fragment_kind kind = fragment_kind::ignored;
+    std::u16string text;
+    std::uint32_t source_offset = 0;
+    int rate_adj = 0;
+    int pitch_adj = 0;
+    unsigned short volume = 100;
+    int emphasis = 0;
+    unsigned long silence_ms = 0;
+};
+
+// One Speak call: its inputs, the actions raised while it ran, and when it
+// started relative to the start of the trace.
+struct trace_call {
+    std::uint64_t start_ms = 0;
+    std::uint32_t duration_us = 0;
+    std::string voice;
+    output_format format{};
+    bool word_events = false;
+    bool sentence_events = false;
+    long rate = 0;
+    unsigned short volume = 100;
+    std::vector<trace_fragment> fragments;
+    std::vector<trace_action> actions;
+
+    // Views into fragments; valid while the call is alive and unmodified.
+    [[nodiscard]] std::vector<speak_fragment> speak_fragments() const;
+
+    [[nodiscard]] speak_options options() const;
+};
+
+[[nodiscard]] trace_call make_trace_call(const std::vector<speak_fragment>& fragments, const speak_options& options);
+
+void encode_trace_call(const trace_call& call, std::vector<std::uint8_t>& out);
+
+[[nodiscard]] bool decode_trace_call(const std::vector<std::uint8_t>& payload, trace_call& call);
+
+// Reads every complete call; a trace cut short by a crash reads up to the last
+// record that was fully written.
+[[nodiscard]] bool read_trace(const std::filesystem::path& path, std::vector<trace_call>& calls);
+
+// Appends calls to a trace file, flushing each one. Safe to share between
+// engine instances.
+class trace_writer
+{
+public:
+    trace_writer() = default;
+
+    trace_writer(const trace_writer&) = delete;
+    trace_writer& operator=(const trace_writer&) = delete;
+
+    [[nodiscard]] bool open(const std::filesystem::path& path);
+
+    [[nodiscard]] bool is_open();
+
+    [[nodiscard]] std::uint64_t elapsed_ms() const;
+
+    void write(const trace_call& call);
+
+private:
+    std::mutex mutex_;
+    std::ofstream file_;
+    std::chrono::steady_clock::time_point opened_;
+    std::vector<std::uint8_t> buffer_;
+};
+
+// Forwards to another site and records the abort, skip, rate and volume
+// changes it raises into a trace call.
+class recording_site : public speak_site
+{
+public:
+    recording_site(speak_site& inner, trace_call& call);
+
+    unsigned actions() override;
+
+    bool write(const void* data, std::size_t size, std::size_t& written) override;
+
+    void add_events(const site_event* events, std::size_t count) override;
+
+    long rate() override;
+
+    unsigned short volume() override;
+
+    void complete_skip() override;
+
+    // Stamps the duration of the call.
+    void finish();
+
+private:
+    [[nodiscard]] std::uint32_t elapsed_us() const;
+
+    speak_site& inner_;
+    trace_call& call_;
+    std::chrono::steady_clock::time_point started_;
+    unsigned last_flags_ = 0;
+    long last_rate_ = 0;
+    unsigned short last_volume_ = 100;
+};
+}
+}
@@ -0,0 +1,180 @@
+#include "synth_pipeline.hpp"
+#include "debug_log.h"
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace Espeak {
+namespace sapi {
+
+synth_pipeline::synth_pipeline(synth_function synth, std::size_t depth)
+    : synth_(std::move(synth))
+    , depth_(depth)
+    , cancel_(false)
+    , stop_(false)
+{
+    worker_ = std::thread(&synth_pipeline::run, this);
+}
+
+synth_pipeline::~synth_pipeline()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stop_ = true;
+        cancel_ = true;
+        jobs_.clear();
+    }
+    work_cv_.notify_all();
+    data_cv_.notify_all();
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+}
+
+std::size_t synth_pipeline::queued() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return jobs_.size();
+}
+
+void synth_pipeline::submit(synth_job job)
+{
+    auto state = std::make_shared<job_state>();
+    state->job = std::move(job);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(state));
+    }
+    work_cv_.notify_one();
+}
+
+synth_pipeline::status synth_pipeline::read(std::vector<short>& out, std::vector<SynthEvent>& events,
+                                            std::chrono::milliseconds timeout)
+{
+    out.clear();
+    events.clear();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (jobs_.empty()) {
+        return status::done;
+    }
+
+    const std::shared_ptr<job_state> front = jobs_.front();
+    data_cv_.wait_for(lock, timeout, [&]() {
+        return !front->chunks.empty() || front->finished;
+    });
+
+    // One synthesis block per read, so the caller sees site actions between
+    // blocks; events wait until the audio they point into has been handed out.
+    if (!front->chunks.empty()) {
+        out.assign(front->chunks.front().begin(), front->chunks.front().end());
+        front->chunks.pop_front();
+        front->delivered += out.size();
+    }
+    const auto ready = front->chunks.empty() && front->finished
+        ? front->events.end()
+        : std::find_if(front->events.begin(), front->events.end(), [&](const SynthEvent& event) {
+              return event.sample >= 0 && static_cast<std::size_t>(event.sample) >= front->delivered;
+          });
+    events.assign(std::make_move_iterator(front->events.begin()), std::make_move_iterator(ready));
+    front->events.erase(front->events.begin(), ready);
+    if (!out.empty() || !events.empty()) {
+        return status::audio;
+    }
+
+    if (!front->finished) {
+        return status::pending;
+    }
+
+    jobs_.pop_front();
+    return front->ok ? status::done : status::failed;
+}
+
+void synth_pipeline::cancel()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (jobs_.empty() && !running_) {
+        return;
+    }
+
+    DEBUG_LOG("synth_pipeline: Cancelling %zu queued jobs", jobs_.size());
+    cancel_ = true;
+    jobs_.clear();
+    data_cv_.wait(lock, [&]() { return !running_; });
+    cancel_ = false;
+}
+
+void synth_pipeline::run()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        work_cv_.wait(lock, [&]() {
+            if (stop_) {
+                return true;
+            }
+            for (const auto& job : jobs_) {
+                if (!job->started) {
+                    return true;
+                }
+            }
+            return false;
+        });
+
+        if (stop_) {
+            return;
+        }
+
+        std::shared_ptr<job_state> state;
+        for (const auto& job : jobs_) {
+            if (!job->started) {
+                state = job;
+                break;
+            }
+        }
+        state->started = true;
+        running_ = state;
+        lock.unlock();
+
+        bool ok = false;
+        try {
+            ok = synth_(state->job, [&](const short* audio, int sample_count) {
+                if (cancel_) {
+                    return false;
+                }
+                std::vector<short> chunk(audio, audio + sample_count);
+                {
+                    std::lock_guard<std::mutex> chunk_lock(mutex_);
+                    state->chunks.push_back(std::move(chunk));
+                }
+                data_cv_.notify_all();
+                return true;
+            }, [&](const SynthEvent& event) {
+                if (cancel_) {
+                    return;
+                }
+                {
+                    std::lock_guard<std::mutex> event_lock(mutex_);
+                    state->events.push_back(event);
+                }
+                data_cv_.notify_all();
+            });
+        }
+        catch (const std::exception& e) {
+            [[maybe_unused]] const char* what = e.what();
+            LOG_ERROR("synth_pipeline: Exception during synthesis - %s", what);
+            ok = false;
+        }
+        catch (...) {
+            LOG_ERROR("synth_pipeline: Unexpected exception during synthesis");
+            ok = false;
+        }
+
+        lock.lock();
+        state->ok = ok && !cancel_;
+        state->finished = true;
+        running_.reset();
+        data_cv_.notify_all();
+    }
+}
+}
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "audio_cache.hpp"
+#include "cancel_token.hpp"
+
+namespace Espeak {
+namespace sapi {
+
+struct synth_job {
+    std::u16string text;
+    bool ssml = false;
+    bool spell = false;
+    bool events = false;
+    std::string voice;
+    int rate = 0;
+    int pitch = 50;
+    int volume = 100;
+    int intonation = 50;
+    int wordgap = 0;
+    bool rateboost = false;
+    const CancelToken* cancel = nullptr;
+};
+
+class synth_pipeline
+{
+public:
+    using audio_sink = std::function<bool(const short* audio, int sample_count)>;
+    using event_sink = std::function<void(const SynthEvent& event)>;
+    using synth_function = std::function<bool(const synth_job& job, const audio_sink& sink, const event_sink& events)>;
+
+    enum class status {
+        audio,
+        pending,
+        done,
+        failed
+    };
+
+    synth_pipeline(synth_function synth, std::size_t depth);
+    ~synth_pipeline();
+
+    synth_pipeline(const synth_pipeline&) = delete;
+    synth_pipeline& operator=(const synth_pipeline&) = delete;
+
+    [[nodiscard]] std::size_t depth() const noexcept
+    {
+        return depth_;
+    }
+
+    [[nodiscard]] std::size_t queued() const;
+
+    void submit(synth_job job);
+
+    [[nodiscard]] status read(std::vector<short>& out, std::vector<SynthEvent>& events,
+                              std::chrono::milliseconds timeout);
+
+    void cancel();
+
+private:
+    struct job_state {
+        synth_job job;
+        std::deque<std::vector<short>> chunks;
+        std::vector<SynthEvent> events;
+        std::size_t delivered = 0;
+        bool started = false;
+        bool finished = false;
+        bool ok = true;
+    };
+
+    void run();
+
+    synth_function synth_;
+    std::size_t depth_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable data_cv_;
+    std::deque<std::shared_ptr<job_state>> jobs_;
+    std::shared_ptr<job_state> running_;
+    std::atomic<bool> cancel_;
+    bool stop_;
+    std::thread worker_;
+};
+}
+}
@@ -0,0 +1,236 @@
+#include "text_chunker.hpp"
+#include <algorithm>
+
+namespace Espeak {
+
+namespace {
+
+struct LanguageRules {
+    std::string_view language;
+    std::string_view abbreviations;
+    bool numeric_ordinals;
+};
+
+constexpr LanguageRules LANGUAGE_RULES[] = {
+    {"en", "mr mrs ms dr prof st jr sr vs etc e.g i.e inc ltd co corp no fig vol pp approx dept est mt "
+           "gen col lt sgt capt rev jan feb mar apr jun jul aug sep sept oct nov dec", false},
+    {"de", "z.b d.h u.a usw bzw ca dr prof hr fr nr str vgl evtl ggf inkl sog z.t u.u o.ä", true},
+    {"fr", "m mm mme mlle dr pr st ste etc cf av bd env", false},
+    {"es", "sr sra srta dr dra ud uds etc pág núm av ej", false},
+    {"it", "sig sigg dott prof ecc es pag dr", false},
+    {"pt", "sr sra dr dra prof etc pág av ex", false},
+    {"nl", "dhr mevr dr prof bijv enz o.a m.a.w nr blz ca", false},
+    {"pl", "np itd itp tzn dr prof ul nr godz tj", true},
+    {"cs", "např tzv atd apod dr prof ul", true},
+    {"ru", "г гг т.е т.д т.п др см стр ул им напр проф", false},
+    {"uk", "т.д т.п див напр проф ім вул", false},
+};
+
+constexpr std::string_view DEFAULT_ABBREVIATIONS = "mr mrs ms dr prof st etc e.g i.e vs";
+
+constexpr std::string_view SENTENCE_MARKS[] = {".", "!", "?", "\xE2\x80\xA6", "\xE3\x80\x82", "\xEF\xBC\x81", "\xEF\xBC\x9F"};
+constexpr std::string_view CLAUSE_MARKS[] = {",", ";", ":", "\xE2\x80\x94", "\xEF\xBC\x8C", "\xEF\xBC\x9B", "\xEF\xBC\x9A"};
+constexpr std::string_view CLOSING_MARKS[] = {"\"", "'", ")", "]", "\xC2\xBB", "\xE2\x80\x9D", "\xE2\x80\x99"};
+
+bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+bool isAsciiAlpha(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+bool isContinuation(char c) {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+std::size_t sequenceLength(char c) {
+    const auto byte = static_cast<unsigned char>(c);
+    if (byte < 0x80) return 1;
+    if ((byte & 0xE0) == 0xC0) return 2;
+    if ((byte & 0xF0) == 0xE0) return 3;
+    if ((byte & 0xF8) == 0xF0) return 4;
+    return 1;
+}
+
+template<std::size_t N>
+std::size_t matchMark(std::string_view text, std::size_t pos, const std::string_view (&marks)[N]) {
+    for (const auto& mark : marks) {
+        if (text.compare(pos, mark.size(), mark) == 0) {
+            return mark.size();
+        }
+    }
+    return 0;
+}
+
+std::size_t countChars(std::string_view text) {
+    return static_cast<std::size_t>(std::count_if(text.begin(), text.end(), [](char c) { return !isContinuation(c); }));
+}
+}
+
+TextChunker::TextChunker(std::string_view language, std::size_t first_chars, std::size_t max_chars)
+    : numeric_ordinals_(false)
+    , first_chars_((std::max)(first_chars, static_cast<std::size_t>(1)))
+    , max_chars_((std::max)(max_chars, first_chars_))
+    , pos_(0)
+    , char_pos_(0)
+    , first_(true)
+{
+    std::string_view list = DEFAULT_ABBREVIATIONS;
+    for (const auto& rules : LANGUAGE_RULES) {
+        if (rules.language == language) {
+            list = rules.abbreviations;
+            numeric_ordinals_ = rules.numeric_ordinals;
+            break;
+        }
+    }
+
+    while (!list.empty()) {
+        const std::size_t space = list.find(' ');
+        abbreviations_.push_back(list.substr(0, space));
+        list = space == std::string_view::npos ? std::string_view() : list.substr(space + 1);
+    }
+}
+
+std::string TextChunker::languageOf(std::string_view voice) {
+    const std::size_t slash = voice.find_last_of("/\\");
+    if (slash != std::string_view::npos) {
+        voice = voice.substr(slash + 1);
+    }
+    std::string language(voice.substr(0, voice.find_first_of("-+_")));
+    std::transform(language.begin(), language.end(), language.begin(), [](char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    });
+    return language;
+}
+
+void TextChunker::reset(std::string_view text) {
+    text_ = text;
+    pos_ = 0;
+    char_pos_ = 0;
+    first_ = true;
+}
+
+bool TextChunker::isAbbreviation(std::size_t dot) const {
+    std::size_t start = dot;
+    while (start > pos_) {
+        const char c = text_[start - 1];
+        if (!isAsciiAlpha(c) && c != '.' && static_cast<unsigned char>(c) < 0x80) {
+            break;
+        }
+        --start;
+    }
+
+    if (start == dot) {
+        if (!numeric_ordinals_ || dot == pos_) {
+            return false;
+        }
+        std::size_t digits = dot;
+        while (digits > pos_ && text_[digits - 1] >= '0' && text_[digits - 1] <= '9') {
+            --digits;
+        }
+        return digits < dot && (digits == pos_ || isSpace(text_[digits - 1]));
+    }
+
+    std::string token(text_.substr(start, dot - start));
+    if (token.size() == 1 && isAsciiAlpha(token[0])) {
+        return true;
+    }
+    std::transform(token.begin(), token.end(), token.begin(), [](char c) {
+        return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+    });
+    return std::find(abbreviations_.begin(), abbreviations_.end(), token) != abbreviations_.end();
+}
+
+bool TextChunker::isSentenceEnd(std::size_t pos, std::size_t& after) const {
+    if (text_[pos] == '\n') {
+        std::size_t next = pos + 1;
+        if (next < text_.size() && text_[next] == '\r') {
+            ++next;
+        }
+        if (next < text_.size() && text_[next] == '\n') {
+            after = next + 1;
+            return true;
+        }
+        return false;
+    }
+
+    std::size_t end = pos;
+    bool ascii_mark = false;
+    for (std::size_t len; end < text_.size() && (len = matchMark(text_, end, SENTENCE_MARKS)) > 0; end += len) {
+        ascii_mark = ascii_mark || len == 1;
+    }
+    if (end == pos) {
+        return false;
+    }
+    if (end == pos + 1 && text_[pos] == '.' && isAbbreviation(pos)) {
+        return false;
+    }
+
+    for (std::size_t len; end < text_.size() && (len = matchMark(text_, end, CLOSING_MARKS)) > 0;) {
+        end += len;
+    }
+
+    if (ascii_mark && end < text_.size() && !isSpace(text_[end])) {
+        return false;
+    }
+    after = end;
+    return true;
+}
+
+bool TextChunker::next(TextChunk& chunk) {
+    if (pos_ >= text_.size()) {
+        return false;
+    }
+
+    const std::size_t limit = first_ ? first_chars_ : max_chars_;
+    first_ = false;
+
+    std::size_t sentence_break = 0;
+    std::size_t clause_break = 0;
+    std::size_t space_break = 0;
+
+    std::size_t i = pos_;
+    for (std::size_t chars = 0; i < text_.size() && chars < limit; ++chars) {
+        std::size_t after = 0;
+        if (isSentenceEnd(i, after)) {
+            sentence_break = after;
+        } else if (const std::size_t len = matchMark(text_, i, CLAUSE_MARKS)) {
+            if (len > 1 || i + 1 >= text_.size() || isSpace(text_[i + 1])) {
+                clause_break = i + len;
+            }
+        } else if (isSpace(text_[i]) && i > pos_) {
+            space_break = i;
+        }
+        i += sequenceLength(text_[i]);
+    }
+
+    std::size_t end = text_.size();
+    bool sentence_end = false;
+    if (i < text_.size()) {
+        if (sentence_break > pos_) {
+            end = sentence_break;
+            sentence_end = true;
+        } else if (clause_break > pos_) {
+            end = clause_break;
+        } else if (space_break > pos_) {
+            end = space_break;
+        } else {
+            end = (std::min)(i, text_.size());
+        }
+    }
+
+    while (end < text_.size() && isSpace(text_[end])) {
+        ++end;
+    }
+
+    chunk.offset = pos_;
+    chunk.length = end - pos_;
+    chunk.char_offset = char_pos_;
+    chunk.sentence_end = sentence_end;
+
+    char_pos_ += countChars(text_.substr(pos_, end - pos_));
+    pos_ = end;
+    return true;
+}
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Espeak {
+
+struct TextChunk {
+    std::size_t offset;
+    std::size_t length;
+    std::size_t char_offset;
+    bool sentence_end;
+};
+
+class TextChunker {
+public:
+    static constexpr std::size_t DEFAULT_FIRST_CHARS = 80;
+    static constexpr std::size_t DEFAULT_MAX_CHARS = 400;
+
+    TextChunker(std::string_view language, std::size_t first_chars, std::size_t max_chars);
+
+    void reset(std::string_view text);
+
+    [[nodiscard]] bool next(TextChunk& chunk);
+
+    [[nodiscard]] static std::string languageOf(std::string_view voice);
+
+private:
+    [[nodiscard]] bool isAbbreviation(std::size_t dot) const;
+
+    [[nodiscard]] bool isSentenceEnd(std::size_t pos, std::size_t& after) const;
+
+    std::vector<std::string_view> abbreviations_;
+    bool numeric_ordinals_;
+    std::size_t first_chars_;
+    std::size_t max_chars_;
+
+    std::string_view text_;
+    std::size_t pos_;
+    std::size_t char_pos_;
+    bool first_;
+};
+}
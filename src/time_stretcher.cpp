@@ -0,0 +1,220 @@
+#include "time_stretcher.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace Espeak {
+
+namespace {
+
+constexpr int MIN_PITCH_HZ = 65;
+constexpr int MAX_PITCH_HZ = 400;
+constexpr int SEARCH_RATE_HZ = 4000;
+constexpr double UNIT_SPEED_TOLERANCE = 0.005;
+constexpr std::size_t COMPACT_THRESHOLD = 4096;
+
+// Cross-fades ramp_down into ramp_up over count samples and appends the result.
+void overlapAdd(const short* ramp_down, const short* ramp_up, std::size_t count, std::vector<short>& out) {
+    const long n = static_cast<long>(count);
+    for (long t = 0; t < n; ++t) {
+        out.push_back(static_cast<short>((static_cast<long>(ramp_down[t]) * (n - t) +
+                                          static_cast<long>(ramp_up[t]) * t) / n));
+    }
+}
+
+std::size_t rounded(double value) {
+    return static_cast<std::size_t>(std::lround((std::max)(value, 0.0)));
+}
+}
+
+TimeStretcher::TimeStretcher(int sample_rate)
+    : min_period_((std::max)(sample_rate / MAX_PITCH_HZ, 1)),
+      max_period_((std::max)(sample_rate / MIN_PITCH_HZ, 2)),
+      skip_((std::max)(sample_rate / SEARCH_RATE_HZ, 1)),
+      speed_(1.0),
+      position_(0),
+      copy_remaining_(0),
+      consumed_(0),
+      produced_(0),
+      copying_(false) {
+    reset();
+}
+
+void TimeStretcher::setSpeed(double speed) noexcept {
+    speed_ = std::clamp(speed, MIN_SPEED, MAX_SPEED);
+}
+
+void TimeStretcher::reset() {
+    input_.clear();
+    position_ = 0;
+    copy_remaining_ = 0;
+    consumed_ = 0;
+    produced_ = 0;
+    copying_ = false;
+    checkpoints_.clear();
+    checkpoints_.push_back({0, 0});
+}
+
+bool TimeStretcher::unitSpeed() const noexcept {
+    return std::abs(speed_ - 1.0) < UNIT_SPEED_TOLERANCE;
+}
+
+void TimeStretcher::process(const short* input, std::size_t count, std::vector<short>& out) {
+    if (count == 0) {
+        return;
+    }
+
+    if (unitSpeed() && position_ == input_.size()) {
+        out.insert(out.end(), input, input + count);
+        advance(count, count, true);
+        return;
+    }
+
+    input_.insert(input_.end(), input, input + count);
+    const std::size_t window = 2 * static_cast<std::size_t>(max_period_);
+    for (;;) {
+        const std::size_t available = input_.size() - position_;
+        if (copy_remaining_ > 0 && available > 0) {
+            const std::size_t n = (std::min)(copy_remaining_, available);
+            copy_remaining_ -= n;
+            copy(n, out);
+            continue;
+        }
+        if (unitSpeed()) {
+            copy(available, out);
+            break;
+        }
+        if (available < window) {
+            break;
+        }
+
+        const short* samples = input_.data() + position_;
+        const int period = findPeriod(samples);
+        const std::size_t before = out.size();
+        const std::size_t consumed = speed_ > 1.0 ? skipPeriod(samples, period, out)
+                                                  : insertPeriod(samples, period, out);
+        position_ += consumed;
+        advance(consumed, out.size() - before, false);
+    }
+    compact();
+}
+
+void TimeStretcher::flush(std::vector<short>& out) {
+    copy_remaining_ = 0;
+    copy(input_.size() - position_, out);
+    compact();
+}
+
+long long TimeStretcher::map(long long input_sample) const noexcept {
+    const auto next = std::upper_bound(checkpoints_.begin(), checkpoints_.end(), input_sample,
+                                       [](long long value, const Checkpoint& c) { return value < c.input; });
+    if (next == checkpoints_.begin()) {
+        return input_sample;
+    }
+    const Checkpoint& from = *(next - 1);
+    const long long offset = input_sample - from.input;
+    if (next == checkpoints_.end()) {
+        return from.output + static_cast<long long>(static_cast<double>(offset) / speed_);
+    }
+    return from.output + offset * (next->output - from.output) / (next->input - from.input);
+}
+
+int TimeStretcher::findPeriod(const short* samples) {
+    // Coarse AMDF search on a decimated copy, then refine around the best lag
+    // at the full rate.
+    const int coarse_min = (std::max)(min_period_ / skip_, 1);
+    const int coarse_max = max_period_ / skip_;
+    const std::size_t coarse_size = 2 * static_cast<std::size_t>(coarse_max);
+    downsampled_.resize(coarse_size);
+    for (std::size_t i = 0; i < coarse_size; ++i) {
+        int sum = 0;
+        for (int j = 0; j < skip_; ++j) {
+            sum += samples[i * skip_ + j];
+        }
+        downsampled_[i] = sum / skip_;
+    }
+
+    auto search = [](auto* data, int min_period, int max_period, int best) {
+        long best_diff = -1;
+        for (int period = min_period; period <= max_period; ++period) {
+            long diff = 0;
+            for (int i = 0; i < period; ++i) {
+                diff += std::abs(static_cast<long>(data[i]) - static_cast<long>(data[i + period]));
+            }
+            // Compare the per-sample difference without dividing.
+            if (best_diff < 0 || diff * best < best_diff * period) {
+                best_diff = diff;
+                best = period;
+            }
+        }
+        return best;
+    };
+
+    int period = search(downsampled_.data(), coarse_min, coarse_max, coarse_min) * skip_;
+    if (skip_ > 1) {
+        const int low = (std::max)(period - 2 * skip_, min_period_);
+        const int high = (std::min)(period + 2 * skip_, max_period_);
+        period = search(samples, low, high, low);
+    }
+    return period;
+}
+
+std::size_t TimeStretcher::skipPeriod(const short* samples, int period, std::vector<short>& out) {
+    const std::size_t p = static_cast<std::size_t>(period);
+    std::size_t new_samples = p;
+    if (speed_ >= 2.0) {
+        new_samples = rounded(static_cast<double>(p) / (speed_ - 1.0));
+    } else {
+        copy_remaining_ = rounded(static_cast<double>(p) * (2.0 - speed_) / (speed_ - 1.0));
+    }
+    new_samples = (std::max)(new_samples, std::size_t{1});
+    overlapAdd(samples, samples + p, new_samples, out);
+    return p + new_samples;
+}
+
+std::size_t TimeStretcher::insertPeriod(const short* samples, int period, std::vector<short>& out) {
+    const std::size_t p = static_cast<std::size_t>(period);
+    std::size_t new_samples = p;
+    if (speed_ < 0.5) {
+        new_samples = rounded(static_cast<double>(p) * speed_ / (1.0 - speed_));
+    } else {
+        copy_remaining_ = rounded(static_cast<double>(p) * (2.0 * speed_ - 1.0) / (1.0 - speed_));
+    }
+    new_samples = (std::max)(new_samples, std::size_t{1});
+    out.insert(out.end(), samples, samples + p);
+    overlapAdd(samples + p, samples, new_samples, out);
+    return new_samples;
+}
+
+void TimeStretcher::copy(std::size_t count, std::vector<short>& out) {
+    if (count == 0) {
+        return;
+    }
+    const auto begin = input_.begin() + static_cast<std::ptrdiff_t>(position_);
+    out.insert(out.end(), begin, begin + static_cast<std::ptrdiff_t>(count));
+    position_ += count;
+    advance(count, count, true);
+}
+
+void TimeStretcher::advance(std::size_t consumed, std::size_t produced, bool copied) {
+    consumed_ += static_cast<long long>(consumed);
+    produced_ += static_cast<long long>(produced);
+    // Consecutive copies lie on one line, so they can share a checkpoint.
+    if (copied && copying_ && checkpoints_.size() > 1) {
+        checkpoints_.back() = {consumed_, produced_};
+    } else {
+        checkpoints_.push_back({consumed_, produced_});
+    }
+    copying_ = copied;
+}
+
+void TimeStretcher::compact() {
+    if (position_ == input_.size()) {
+        input_.clear();
+        position_ = 0;
+    } else if (position_ >= COMPACT_THRESHOLD) {
+        input_.erase(input_.begin(), input_.begin() + static_cast<std::ptrdiff_t>(position_));
+        position_ = 0;
+    }
+}
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+namespace Espeak {
+
+// Streaming speed change without a pitch change, for mono 16-bit speech.
+// Whole pitch periods are dropped or repeated with a cross-fade, the way
+// sonic does it; at speed 1 audio passes straight through.
+class TimeStretcher {
+public:
+    static constexpr double MIN_SPEED = 0.25;
+    static constexpr double MAX_SPEED = 4.0;
+
+    explicit TimeStretcher(int sample_rate);
+
+    void setSpeed(double speed) noexcept;
+
+    [[nodiscard]] double speed() const noexcept { return speed_; }
+
+    // True while audio would be copied through unchanged.
+    [[nodiscard]] bool passthrough() const noexcept { return unitSpeed() && position_ == input_.size(); }
+
+    void process(const short* input, std::size_t count, std::vector<short>& out);
+
+    void flush(std::vector<short>& out);
+
+    void reset();
+
+    // Maps a sample position in the input stream to the output stream.
+    [[nodiscard]] long long map(long long input_sample) const noexcept;
+
+private:
+    struct Checkpoint {
+        long long input;
+        long long output;
+    };
+
+    [[nodiscard]] bool unitSpeed() const noexcept;
+
+    [[nodiscard]] int findPeriod(const short* samples);
+
+    std::size_t skipPeriod(const short* samples, int period, std::vector<short>& out);
+
+    std::size_t insertPeriod(const short* samples, int period, std::vector<short>& out);
+
+    void copy(std::size_t count, std::vector<short>& out);
+
+    void advance(std::size_t consumed, std::size_t produced, bool copied);
+
+    void compact();
+
+    int min_period_;
+    int max_period_;
+    int skip_;
+    double speed_;
+    std::vector<short> input_;
+    std::size_t position_;
+    std::size_t copy_remaining_;
+    long long consumed_;
+    long long produced_;
+    bool copying_;
+    std::vector<Checkpoint> checkpoints_;
+    std::vector<int> downsampled_;
+};
+}
@@ -0,0 +1,199 @@
+#include "utf16_transcoder.hpp"
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ESPEAK_UTF16_SSE2 1
+#include <emmintrin.h>
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define ESPEAK_UTF16_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace Espeak {
+
+namespace {
+
+constexpr std::size_t MAX_UTF8_PER_UNIT = 3;
+constexpr char16_t HIGH_SURROGATE_FIRST = 0xD800;
+constexpr char16_t LOW_SURROGATE_FIRST = 0xDC00;
+constexpr char16_t SURROGATE_LAST = 0xDFFF;
+constexpr char32_t REPLACEMENT_CHARACTER = 0xFFFD;
+
+inline bool isHighSurrogate(char16_t unit) {
+    return unit >= HIGH_SURROGATE_FIRST && unit < LOW_SURROGATE_FIRST;
+}
+
+inline bool isLowSurrogate(char16_t unit) {
+    return unit >= LOW_SURROGATE_FIRST && unit <= SURROGATE_LAST;
+}
+
+inline std::size_t encodeOne(const char16_t* input, std::size_t i, std::size_t length, char*& out) {
+    const char16_t unit = input[i];
+    if (unit < 0x80) {
+        *out++ = static_cast<char>(unit);
+        return i + 1;
+    }
+    if (unit < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (unit >> 6));
+        *out++ = static_cast<char>(0x80 | (unit & 0x3F));
+        return i + 1;
+    }
+
+    char32_t code_point = unit;
+    std::size_t next = i + 1;
+    if (isHighSurrogate(unit) && next < length && isLowSurrogate(input[next])) {
+        code_point = 0x10000 + ((static_cast<char32_t>(unit) - HIGH_SURROGATE_FIRST) << 10) +
+                     (static_cast<char32_t>(input[next]) - LOW_SURROGATE_FIRST);
+        ++next;
+        *out++ = static_cast<char>(0xF0 | (code_point >> 18));
+        *out++ = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+        *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+        return next;
+    }
+    if (unit >= HIGH_SURROGATE_FIRST && unit <= SURROGATE_LAST) {
+        code_point = REPLACEMENT_CHARACTER;
+    }
+    *out++ = static_cast<char>(0xE0 | (code_point >> 12));
+    *out++ = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    *out++ = static_cast<char>(0x80 | (code_point & 0x3F));
+    return next;
+}
+
+inline void encodeBmp(char16_t unit, char*& out) {
+    if (unit < 0x80) {
+        *out++ = static_cast<char>(unit);
+    } else if (unit < 0x800) {
+        *out++ = static_cast<char>(0xC0 | (unit >> 6));
+        *out++ = static_cast<char>(0x80 | (unit & 0x3F));
+    } else {
+        *out++ = static_cast<char>(0xE0 | (unit >> 12));
+        *out++ = static_cast<char>(0x80 | ((unit >> 6) & 0x3F));
+        *out++ = static_cast<char>(0x80 | (unit & 0x3F));
+    }
+}
+
+std::size_t encodeScalar(const char16_t* input, std::size_t length, char* out) {
+    char* const begin = out;
+    for (std::size_t i = 0; i < length;) {
+        i = encodeOne(input, i, length, out);
+    }
+    return static_cast<std::size_t>(out - begin);
+}
+
+std::size_t encodeSimd(const char16_t* input, std::size_t length, char* out) {
+    char* const begin = out;
+    std::size_t i = 0;
+
+#if defined(ESPEAK_UTF16_SSE2)
+    const __m128i non_ascii = _mm_set1_epi16(static_cast<short>(0xFF80));
+    const __m128i surrogate_mask = _mm_set1_epi16(static_cast<short>(0xF800));
+    const __m128i surrogate = _mm_set1_epi16(static_cast<short>(0xD800));
+    const __m128i zero = _mm_setzero_si128();
+    while (i + 16 <= length) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input + i + 8));
+        const __m128i high = _mm_and_si128(_mm_or_si128(a, b), non_ascii);
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, zero)) == 0xFFFF) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(a, b));
+            out += 16;
+            i += 16;
+            continue;
+        }
+        const __m128i surrogates = _mm_or_si128(
+            _mm_cmpeq_epi16(_mm_and_si128(a, surrogate_mask), surrogate),
+            _mm_cmpeq_epi16(_mm_and_si128(b, surrogate_mask), surrogate));
+        if (_mm_movemask_epi8(surrogates) == 0) {
+            for (const std::size_t block_end = i + 16; i < block_end; ++i) {
+                encodeBmp(input[i], out);
+            }
+            continue;
+        }
+        for (const std::size_t block_end = i + 16; i < block_end;) {
+            i = encodeOne(input, i, length, out);
+        }
+    }
+#elif defined(ESPEAK_UTF16_NEON)
+    const uint16x8_t surrogate_mask = vdupq_n_u16(0xF800);
+    const uint16x8_t surrogate = vdupq_n_u16(0xD800);
+    while (i + 16 <= length) {
+        const uint16x8_t a = vld1q_u16(reinterpret_cast<const std::uint16_t*>(input + i));
+        const uint16x8_t b = vld1q_u16(reinterpret_cast<const std::uint16_t*>(input + i + 8));
+        if (vmaxvq_u16(vorrq_u16(a, b)) < 0x80) {
+            vst1q_u8(reinterpret_cast<std::uint8_t*>(out), vcombine_u8(vmovn_u16(a), vmovn_u16(b)));
+            out += 16;
+            i += 16;
+            continue;
+        }
+        const uint16x8_t surrogates = vorrq_u16(vceqq_u16(vandq_u16(a, surrogate_mask), surrogate),
+                                                vceqq_u16(vandq_u16(b, surrogate_mask), surrogate));
+        if (vmaxvq_u16(surrogates) == 0) {
+            for (const std::size_t block_end = i + 16; i < block_end; ++i) {
+                encodeBmp(input[i], out);
+            }
+            continue;
+        }
+        for (const std::size_t block_end = i + 16; i < block_end;) {
+            i = encodeOne(input, i, length, out);
+        }
+    }
+#endif
+
+    while (i < length) {
+        i = encodeOne(input, i, length, out);
+    }
+    return static_cast<std::size_t>(out - begin);
+}
+}
+
+void utf16ToUtf8(std::u16string_view input, std::string& out) {
+    out.resize(input.size() * MAX_UTF8_PER_UNIT);
+    out.resize(encodeSimd(input.data(), input.size(), out.data()));
+}
+
+void utf16ToUtf8Scalar(std::u16string_view input, std::string& out) {
+    out.resize(input.size() * MAX_UTF8_PER_UNIT);
+    out.resize(encodeScalar(input.data(), input.size(), out.data()));
+}
+
+bool containsSurrogates(std::u16string_view input) noexcept {
+    std::size_t i = 0;
+
+#if defined(ESPEAK_UTF16_SSE2)
+    const __m128i mask = _mm_set1_epi16(static_cast<short>(0xF800));
+    const __m128i surrogate = _mm_set1_epi16(static_cast<short>(0xD800));
+    for (; i + 8 <= input.size(); i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input.data() + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, mask), surrogate)) != 0) {
+            return true;
+        }
+    }
+#elif defined(ESPEAK_UTF16_NEON)
+    const uint16x8_t mask = vdupq_n_u16(0xF800);
+    const uint16x8_t surrogate = vdupq_n_u16(0xD800);
+    for (; i + 8 <= input.size(); i += 8) {
+        const uint16x8_t v = vld1q_u16(reinterpret_cast<const std::uint16_t*>(input.data() + i));
+        if (vmaxvq_u16(vceqq_u16(vandq_u16(v, mask), surrogate)) != 0) {
+            return true;
+        }
+    }
+#endif
+
+    for (; i < input.size(); ++i) {
+        if (input[i] >= HIGH_SURROGATE_FIRST && input[i] <= SURROGATE_LAST) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* utf16TranscoderKernel() noexcept {
+#if defined(ESPEAK_UTF16_SSE2)
+    return "sse2";
+#elif defined(ESPEAK_UTF16_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace Espeak {
+
+void utf16ToUtf8(std::u16string_view input, std::string& out);
+
+void utf16ToUtf8Scalar(std::u16string_view input, std::string& out);
+
+[[nodiscard]] bool containsSurrogates(std::u16string_view input) noexcept;
+
+[[nodiscard]] const char* utf16TranscoderKernel() noexcept;
+}
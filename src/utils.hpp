@@ -1,13 +1,19 @@
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <string>
 #include <string_view>
 #include <memory>
 #include <vector>
 #include <filesystem>
+#ifdef _WIN32
 #include <windows.h>
 #include <shlobj.h>
+#else
+#include <cstdlib>
+#include <unistd.h>
+#endif
 
 namespace Espeak {
 namespace utils {
@@ -16,6 +22,7 @@ namespace fs = std::filesystem;
 
 constexpr wchar_t APP_DIR_NAME[] = L"espeak-ng-sapi";
 
+#ifdef _WIN32
 [[nodiscard]] inline fs::path getSpecialFolderPath(int csidl)
 {
     wchar_t path[MAX_PATH];
@@ -34,6 +41,42 @@ constexpr wchar_t APP_DIR_NAME[] = L"espeak-ng-sapi";
 {
     return getSpecialFolderPath(CSIDL_COMMON_APPDATA);
 }
+#else
+[[nodiscard]] inline fs::path getEnvPath(const char* name)
+{
+    const char* value = std::getenv(name);
+    if (!value || !*value) {
+        return {};
+    }
+    return fs::path(value);
+}
+
+[[nodiscard]] inline fs::path getAppDataPath()
+{
+    fs::path config_home = getEnvPath("XDG_CONFIG_HOME");
+    if (!config_home.empty()) {
+        return config_home;
+    }
+    fs::path home = getEnvPath("HOME");
+    if (home.empty()) {
+        return {};
+    }
+    return home / ".config";
+}
+
+[[nodiscard]] inline fs::path getProgramDataPath()
+{
+    fs::path data_home = getEnvPath("XDG_DATA_HOME");
+    if (!data_home.empty()) {
+        return data_home;
+    }
+    fs::path home = getEnvPath("HOME");
+    if (home.empty()) {
+        return {};
+    }
+    return home / ".local" / "share";
+}
+#endif
 
 [[nodiscard]] inline fs::path getEspeakConfigDir()
 {
@@ -62,6 +105,23 @@ constexpr wchar_t APP_DIR_NAME[] = L"espeak-ng-sapi";
     return data_dir / "voices" / "!v";
 }
 
+// A sibling of path that no other process or thread is writing, for saving a
+// file through an atomic rename.
+[[nodiscard]] inline fs::path uniqueTempPath(const fs::path& path)
+{
+    static std::atomic<unsigned> counter{0};
+#ifdef _WIN32
+    const unsigned long pid = GetCurrentProcessId();
+#else
+    const unsigned long pid = static_cast<unsigned long>(getpid());
+#endif
+    fs::path tmp = path;
+    const unsigned serial = counter.fetch_add(1, std::memory_order_relaxed);
+    tmp += "." + std::to_string(pid) + "." + std::to_string(serial) + ".tmp";
+    return tmp;
+}
+
+#ifdef _WIN32
 [[nodiscard]] inline std::wstring string_to_wstring(std::string_view s)
 {
     if (s.empty()) {
@@ -101,6 +161,7 @@ constexpr wchar_t APP_DIR_NAME[] = L"espeak-ng-sapi";
                         result.data(), size_needed, nullptr, nullptr);
     return result;
 }
+#endif
 
 template<typename T>
 class out_ptr
@@ -2,6 +2,9 @@
 
 #include <string>
 #include <array>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
 #include "utils.hpp"
 #include "debug_log.h"
 
@@ -16,12 +19,14 @@ public:
         std::string lang = "en",
         bool is_female = false,
         int age = 0,
-        std::string identifier = "") noexcept
+        std::string identifier = "",
+        std::uint32_t language_id = 0) noexcept
         : name_(std::move(name))
         , language_(std::move(lang))
         , is_female_(is_female)
         , age_(age)
         , identifier_(identifier.empty() ? name_ : std::move(identifier))
+        , language_id_(language_id)
     {
     }
 
@@ -40,6 +45,12 @@ public:
         return language_;
     }
 
+    [[nodiscard]] std::string cache_key() const
+    {
+        return name_ + '\x1f' + identifier_ + '\x1f' + language_ + '\x1f' +
+               std::to_string(is_female_) + '\x1f' + std::to_string(age_) + '\x1f' + std::to_string(language_id_);
+    }
+
     [[nodiscard]] std::wstring get_age() const
     {
         if (age_ == 0) {
@@ -60,19 +71,39 @@ public:
 
     [[nodiscard]] std::wstring get_language() const
     {
-        std::wstring locale_name = utils::string_to_wstring(language_);
+        const std::uint32_t id = language_id_ != 0 ? language_id_ : resolve_language_id(language_);
+        std::array<wchar_t, 10> lcid_str{};
+        swprintf_s(lcid_str.data(), lcid_str.size(), L"%x", id);
+        return lcid_str.data();
+    }
+
+    [[nodiscard]] static std::uint32_t resolve_language_id(const std::string& language)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<std::string, std::uint32_t> table;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = table.find(language);
+        if (it == table.end()) {
+            it = table.emplace(language, lookup_language_id(language)).first;
+        }
+        return it->second;
+    }
+
+private:
+    [[nodiscard]] static std::uint32_t lookup_language_id(const std::string& language)
+    {
+        std::wstring locale_name = utils::string_to_wstring(language);
         LCID lcid = 0;
 
         DEBUG_LOG("  Voice language field: '%s', trying locale: '%S', length=%zu",
-                  language_.c_str(), locale_name.c_str(), locale_name.length());
+                  language.c_str(), locale_name.c_str(), locale_name.length());
 
         DEBUG_LOG("    Trying neutral locale: '%S'", locale_name.c_str());
         lcid = LocaleNameToLCID(locale_name.c_str(), LOCALE_ALLOW_NEUTRAL_NAMES);
         if (lcid != 0) {
-            std::array<wchar_t, 10> lcid_str{};
-            swprintf_s(lcid_str.data(), lcid_str.size(), L"%x", LANGIDFROMLCID(lcid));
-            DEBUG_LOG("    Success with neutral locale, LCID: %S", lcid_str.data());
-            return lcid_str.data();
+            DEBUG_LOG("    Success with neutral locale, LCID: %x", LANGIDFROMLCID(lcid));
+            return LANGIDFROMLCID(lcid);
         }
 
         size_t hyphen_pos = locale_name.find(L'-');
@@ -82,10 +113,8 @@ public:
 
             lcid = LocaleNameToLCID(lang_only.c_str(), LOCALE_ALLOW_NEUTRAL_NAMES);
             if (lcid != 0) {
-                std::array<wchar_t, 10> lcid_str{};
-                swprintf_s(lcid_str.data(), lcid_str.size(), L"%x", LANGIDFROMLCID(lcid));
-                DEBUG_LOG("    Success with language part, LCID: %S", lcid_str.data());
-                return lcid_str.data();
+                DEBUG_LOG("    Success with language part, LCID: %x", LANGIDFROMLCID(lcid));
+                return LANGIDFROMLCID(lcid);
             }
         }
 
@@ -100,23 +129,21 @@ public:
 
             lcid = LocaleNameToLCID(constructed_locale.c_str(), 0);
             if (lcid != 0) {
-                std::array<wchar_t, 10> lcid_str{};
-                swprintf_s(lcid_str.data(), lcid_str.size(), L"%x", LANGIDFROMLCID(lcid));
-                DEBUG_LOG("    Success with constructed fallback, LCID: %S", lcid_str.data());
-                return lcid_str.data();
+                DEBUG_LOG("    Success with constructed fallback, LCID: %x", LANGIDFROMLCID(lcid));
+                return LANGIDFROMLCID(lcid);
             }
         }
 
         DEBUG_LOG("    All attempts failed, defaulting to 409 (en-US)");
-        return L"409";
+        return 0x409;
     }
 
-private:
     std::string name_;
     std::string language_;
     bool is_female_;
     int age_;
     std::string identifier_;
+    std::uint32_t language_id_;
 };
 }
 }
@@ -0,0 +1,358 @@
+#include "voice_catalog.hpp"
+#include "debug_log.h"
+#include "utils.hpp"
+#include <espeak-ng/speak_lib.h>
+#include <cstdio>
+#include <fstream>
+
+namespace Espeak {
+
+namespace {
+
+constexpr char CATALOG_FILE_NAME[] = "voice_catalog.bin";
+constexpr std::uint32_t CATALOG_MAGIC = 0x54435645;
+constexpr std::uint32_t CATALOG_FORMAT_VERSION = 1;
+constexpr std::uint32_t MAX_CATALOG_VOICES = 4096;
+constexpr std::uint32_t MAX_SERIALIZED_SIZE = 64 * 1024;
+constexpr std::chrono::seconds REVALIDATE_INTERVAL(2);
+// In between, only the watched directories are checked, which misses a voice
+// file rewritten in place until the next walk.
+constexpr std::chrono::minutes FULL_WALK_INTERVAL(5);
+constexpr std::uint64_t FNV_OFFSET = 1469598103934665603ULL;
+constexpr std::uint64_t FNV_PRIME = 1099511628211ULL;
+
+const char* const DATA_FILES[] = {"phontab", "phondata", "phonindex", "intonations"};
+const char* const VOICE_DIRS[] = {"lang", "voices"};
+
+void writeU32(std::ostream& out, std::uint32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeI32(std::ostream& out, std::int32_t value) {
+    out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void writeString(std::ostream& out, const std::string& value) {
+    writeU32(out, static_cast<std::uint32_t>(value.size()));
+    out.write(value.data(), static_cast<std::streamsize>(value.size()));
+}
+
+bool readU32(std::istream& in, std::uint32_t& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+bool readI32(std::istream& in, std::int32_t& value) {
+    return static_cast<bool>(in.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+bool readString(std::istream& in, std::string& value) {
+    std::uint32_t size = 0;
+    if (!readU32(in, size) || size > MAX_SERIALIZED_SIZE) {
+        return false;
+    }
+    value.resize(size);
+    return size == 0 || static_cast<bool>(in.read(value.data(), size));
+}
+
+class Fingerprint {
+public:
+    void mix(const void* data, std::size_t size) {
+        const auto* bytes = static_cast<const unsigned char*>(data);
+        for (std::size_t i = 0; i < size; ++i) {
+            hash_ = (hash_ ^ bytes[i]) * FNV_PRIME;
+        }
+    }
+
+    void mix(const std::string& value) {
+        mix(value.data(), value.size() + 1);
+    }
+
+    void mixFile(const std::string& name, std::uintmax_t size, utils::fs::file_time_type modified) {
+        mix(name);
+        const auto stamp = static_cast<std::uint64_t>(modified.time_since_epoch().count());
+        const auto length = static_cast<std::uint64_t>(size);
+        mix(&stamp, sizeof(stamp));
+        mix(&length, sizeof(length));
+        ++files_;
+    }
+
+    [[nodiscard]] std::string str() const {
+        char buffer[48];
+        std::snprintf(buffer, sizeof(buffer), "%016llx-%zu", static_cast<unsigned long long>(hash_), files_);
+        return buffer;
+    }
+
+private:
+    std::uint64_t hash_ = FNV_OFFSET;
+    std::size_t files_ = 0;
+};
+}
+
+VoiceCatalog& VoiceCatalog::getInstance() {
+    static VoiceCatalog instance;
+    return instance;
+}
+
+VoiceCatalog::VoiceCatalog()
+    : valid_(false)
+    , stats_{0, 0, 0}
+{
+}
+
+std::filesystem::path VoiceCatalog::cachePath() {
+    utils::fs::path dir = utils::getEspeakConfigDir();
+    if (dir.empty()) {
+        return {};
+    }
+    return dir / CATALOG_FILE_NAME;
+}
+
+std::string VoiceCatalog::fingerprint(const std::filesystem::path& data_dir, std::vector<WatchedPath>* watched) {
+    if (watched) {
+        watched->clear();
+    }
+    if (data_dir.empty()) {
+        return {};
+    }
+
+    std::error_code ec;
+    utils::fs::path root = data_dir;
+    if (!utils::fs::exists(root / "phontab", ec)) {
+        root = data_dir / "espeak-ng-data";
+        if (!utils::fs::exists(root / "phontab", ec)) {
+            return {};
+        }
+    }
+
+    static const std::string version = espeak_Info(nullptr);
+    const auto watch = [watched](const utils::fs::path& path, utils::fs::file_time_type modified) {
+        if (watched) {
+            watched->push_back({path, modified});
+        }
+    };
+
+    Fingerprint print;
+    print.mix(version);
+    print.mix(root.u8string());
+
+    for (const char* name : DATA_FILES) {
+        const utils::fs::path file = root / name;
+        const auto size = utils::fs::file_size(file, ec);
+        if (ec) {
+            continue;
+        }
+        const auto modified = utils::fs::last_write_time(file, ec);
+        if (!ec) {
+            print.mixFile(name, size, modified);
+            watch(file, modified);
+        }
+    }
+
+    for (const char* dir : VOICE_DIRS) {
+        const utils::fs::path voice_dir = root / dir;
+        const auto dir_modified = utils::fs::last_write_time(voice_dir, ec);
+        if (ec) {
+            ec.clear();
+            continue;
+        }
+        watch(voice_dir, dir_modified);
+        utils::fs::recursive_directory_iterator it(
+            voice_dir, utils::fs::directory_options::skip_permission_denied, ec);
+        for (const utils::fs::recursive_directory_iterator end; !ec && it != end; it.increment(ec)) {
+            const utils::fs::directory_entry& entry = *it;
+            std::error_code entry_ec;
+            if (entry.is_directory(entry_ec)) {
+                const auto modified = entry.last_write_time(entry_ec);
+                if (!entry_ec) {
+                    watch(entry.path(), modified);
+                }
+                continue;
+            }
+            if (!entry.is_regular_file(entry_ec)) {
+                continue;
+            }
+            const auto size = entry.file_size(entry_ec);
+            const auto modified = entry.last_write_time(entry_ec);
+            if (!entry_ec) {
+                print.mixFile(entry.path().lexically_relative(root).generic_u8string(), size, modified);
+            }
+        }
+    }
+
+    return print.str();
+}
+
+std::vector<CatalogVoice> VoiceCatalog::voices(const LanguageResolver& resolve_language) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    const auto now = std::chrono::steady_clock::now();
+    if (valid_ && now - validated_ < REVALIDATE_INTERVAL) {
+        ++stats_.memory_hits;
+        return voices_;
+    }
+    if (valid_ && now - walked_ < FULL_WALK_INTERVAL && watchedUnchanged()) {
+        validated_ = now;
+        ++stats_.memory_hits;
+        return voices_;
+    }
+
+    const std::string print = fingerprint(utils::getEspeakDataDir(), &watched_);
+    walked_ = now;
+    if (!print.empty()) {
+        if (valid_ && print == fingerprint_) {
+            validated_ = now;
+            ++stats_.memory_hits;
+            return voices_;
+        }
+        if (readCatalog(print)) {
+            fingerprint_ = print;
+            validated_ = now;
+            valid_ = true;
+            ++stats_.disk_hits;
+            DEBUG_LOG("VoiceCatalog: Loaded %zu voices from catalog", voices_.size());
+            return voices_;
+        }
+    }
+
+    valid_ = false;
+    voices_.clear();
+
+    EspeakEngine& engine = EspeakEngine::getInstance();
+    if (!engine.initialize()) {
+        LOG_WARN("VoiceCatalog: Engine initialization failed, catalog empty");
+        return voices_;
+    }
+
+    for (auto& voice : engine.getVoices()) {
+        const std::uint32_t language_id = resolve_language ? resolve_language(voice) : 0;
+        voices_.push_back({std::move(voice), language_id});
+    }
+    ++stats_.rebuilds;
+
+    if (!print.empty()) {
+        fingerprint_ = print;
+        validated_ = now;
+        valid_ = true;
+        [[maybe_unused]] bool written = writeCatalog(print);
+    }
+
+    DEBUG_LOG("VoiceCatalog: Rebuilt catalog with %zu voices", voices_.size());
+    return voices_;
+}
+
+void VoiceCatalog::invalidate() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    valid_ = false;
+}
+
+// Adding, removing or renaming a file changes the time of its directory.
+bool VoiceCatalog::watchedUnchanged() const {
+    if (watched_.empty()) {
+        return false;
+    }
+    for (const WatchedPath& watched : watched_) {
+        std::error_code ec;
+        const auto modified = utils::fs::last_write_time(watched.path, ec);
+        if (ec || modified != watched.modified) {
+            return false;
+        }
+    }
+    return true;
+}
+
+VoiceCatalog::Stats VoiceCatalog::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+bool VoiceCatalog::readCatalog(const std::string& fingerprint) {
+    const utils::fs::path path = cachePath();
+    std::error_code ec;
+    if (path.empty() || !utils::fs::exists(path, ec)) {
+        return false;
+    }
+
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        DEBUG_LOG("VoiceCatalog: Failed to open %S", path.c_str());
+        return false;
+    }
+
+    std::uint32_t magic = 0;
+    std::uint32_t format = 0;
+    std::string stored_fingerprint;
+    std::uint32_t count = 0;
+    if (!readU32(file, magic) || magic != CATALOG_MAGIC ||
+        !readU32(file, format) || format != CATALOG_FORMAT_VERSION ||
+        !readString(file, stored_fingerprint) || stored_fingerprint != fingerprint ||
+        !readU32(file, count) || count > MAX_CATALOG_VOICES) {
+        DEBUG_LOG("VoiceCatalog: Ignoring stale or invalid catalog");
+        return false;
+    }
+
+    std::vector<CatalogVoice> loaded(count);
+    for (auto& entry : loaded) {
+        std::int32_t gender = 0;
+        std::int32_t age = 0;
+        if (!readString(file, entry.voice.name) || !readString(file, entry.voice.identifier) ||
+            !readString(file, entry.voice.languages) || !readI32(file, gender) || !readI32(file, age) ||
+            !readU32(file, entry.language_id)) {
+            DEBUG_LOG("VoiceCatalog: Truncated catalog");
+            return false;
+        }
+        entry.voice.gender = gender;
+        entry.voice.age = age;
+    }
+
+    voices_ = std::move(loaded);
+    return true;
+}
+
+bool VoiceCatalog::writeCatalog(const std::string& fingerprint) const {
+    const utils::fs::path path = cachePath();
+    if (path.empty()) {
+        return false;
+    }
+
+    std::error_code ec;
+    utils::fs::create_directories(path.parent_path(), ec);
+
+    const utils::fs::path tmp_path = utils::uniqueTempPath(path);
+
+    {
+        std::ofstream file(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            LOG_WARN("VoiceCatalog: Failed to open %S for writing", tmp_path.c_str());
+            return false;
+        }
+
+        writeU32(file, CATALOG_MAGIC);
+        writeU32(file, CATALOG_FORMAT_VERSION);
+        writeString(file, fingerprint);
+        writeU32(file, static_cast<std::uint32_t>(voices_.size()));
+        for (const auto& entry : voices_) {
+            writeString(file, entry.voice.name);
+            writeString(file, entry.voice.identifier);
+            writeString(file, entry.voice.languages);
+            writeI32(file, entry.voice.gender);
+            writeI32(file, entry.voice.age);
+            writeU32(file, entry.language_id);
+        }
+
+        if (!file) {
+            LOG_WARN("VoiceCatalog: Failed to write catalog");
+            return false;
+        }
+    }
+
+    utils::fs::rename(tmp_path, path, ec);
+    if (ec) {
+        LOG_WARN("VoiceCatalog: Failed to replace catalog: %s", ec.message().c_str());
+        utils::fs::remove(tmp_path, ec);
+        return false;
+    }
+
+    DEBUG_LOG("VoiceCatalog: Saved %zu voices", voices_.size());
+    return true;
+}
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "espeak_wrapper.h"
+
+namespace Espeak {
+
+struct CatalogVoice {
+    VoiceInfo voice;
+    std::uint32_t language_id;
+};
+
+class VoiceCatalog {
+public:
+    using LanguageResolver = std::function<std::uint32_t(const VoiceInfo& voice)>;
+
+    // A directory or data file and its modification time at the last walk.
+    struct WatchedPath {
+        std::filesystem::path path;
+        std::filesystem::file_time_type modified;
+    };
+
+    struct Stats {
+        std::uint64_t memory_hits;
+        std::uint64_t disk_hits;
+        std::uint64_t rebuilds;
+    };
+
+    static VoiceCatalog& getInstance();
+
+    VoiceCatalog(const VoiceCatalog&) = delete;
+    VoiceCatalog& operator=(const VoiceCatalog&) = delete;
+
+    [[nodiscard]] std::vector<CatalogVoice> voices(const LanguageResolver& resolve_language);
+
+    void invalidate();
+
+    [[nodiscard]] Stats stats() const;
+
+    // Hashes every voice file. When watched is given it receives the
+    // directories and data files whose times reveal a later change.
+    [[nodiscard]] static std::string fingerprint(const std::filesystem::path& data_dir,
+                                                 std::vector<WatchedPath>* watched = nullptr);
+
+    [[nodiscard]] static std::filesystem::path cachePath();
+
+private:
+    VoiceCatalog();
+
+    [[nodiscard]] bool readCatalog(const std::string& fingerprint);
+
+    [[nodiscard]] bool writeCatalog(const std::string& fingerprint) const;
+
+    [[nodiscard]] bool watchedUnchanged() const;
+
+    mutable std::mutex mutex_;
+    std::vector<CatalogVoice> voices_;
+    std::string fingerprint_;
+    std::chrono::steady_clock::time_point validated_;
+    std::chrono::steady_clock::time_point walked_;
+    std::vector<WatchedPath> watched_;
+    bool valid_;
+    Stats stats_;
+};
+}
@@ -1,4 +1,6 @@
 #include <new>
+#include <mutex>
+#include <unordered_map>
 #include <comdef.h>
 #include "voice_token.hpp"
 #include "ISpTTSEngineImpl.hpp"
@@ -8,25 +10,54 @@
 namespace Espeak {
 namespace sapi {
 
-voice_token::voice_token(const voice_attributes& attr)
+voice_token::voice_token(const std::shared_ptr<const voice_token_data>& data)
+    : ISpDataKeyImpl(data->values)
+    , data_(data)
 {
-    const std::wstring name = attr.get_name();
-    set(name);
+    set(data_->name);
+}
+
+std::shared_ptr<const voice_token_data> voice_token::data_for(const voice_attributes& attr)
+{
+    static std::mutex mutex;
+    static std::unordered_map<std::string, std::shared_ptr<const voice_token_data>> cache;
+
+    const std::string key = attr.cache_key();
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = cache.find(key);
+    if (it != cache.end()) {
+        return it->second;
+    }
+
+    static const std::wstring clsid = []() {
+        utils::out_ptr<wchar_t> clsid_str(CoTaskMemFree);
+        StringFromCLSID(__uuidof(ISpTTSEngineImpl), clsid_str.address());
+        return std::wstring(clsid_str.get());
+    }();
 
-    utils::out_ptr<wchar_t> clsid_str(CoTaskMemFree);
-    StringFromCLSID(__uuidof(ISpTTSEngineImpl), clsid_str.address());
-    set(L"CLSID", clsid_str.get());
+    auto data = std::make_shared<voice_token_data>();
+    data->name = attr.get_name();
+
+    auto values = std::make_shared<value_map>();
+    (*values)[L"CLSID"] = clsid;
+    data->values = std::move(values);
 
     std::wstring language_lcid = attr.get_language();
-    DEBUG_LOG("voice_token: Creating token for '%S', language_code='%s', LCID='%S'",
-              name.c_str(), attr.get_language_utf8().c_str(), language_lcid.c_str());
-
-    attributes_[L"Age"] = attr.get_age();
-    attributes_[L"Vendor"] = L"eSpeak-NG";
-    attributes_[L"Language"] = language_lcid;
-    attributes_[L"Gender"] = attr.get_gender();
-    attributes_[L"Name"] = name;
-    attributes_[L"VoiceId"] = utils::string_to_wstring(attr.get_identifier_utf8());
+    DEBUG_LOG("voice_token: Creating token data for '%S', language_code='%s', LCID='%S'",
+              data->name.c_str(), attr.get_language_utf8().c_str(), language_lcid.c_str());
+
+    auto attributes = std::make_shared<value_map>();
+    (*attributes)[L"Age"] = attr.get_age();
+    (*attributes)[L"Vendor"] = L"eSpeak-NG";
+    (*attributes)[L"Language"] = language_lcid;
+    (*attributes)[L"Gender"] = attr.get_gender();
+    (*attributes)[L"Name"] = data->name;
+    (*attributes)[L"VoiceId"] = utils::string_to_wstring(attr.get_identifier_utf8());
+    data->attributes = std::move(attributes);
+
+    std::shared_ptr<const voice_token_data> result = std::move(data);
+    cache.emplace(key, result);
+    return result;
 }
 
 STDMETHODIMP voice_token::OpenKey(LPCWSTR pszSubKeyName, ISpDataKey** ppSubKey)
@@ -44,10 +75,7 @@ STDMETHODIMP voice_token::OpenKey(LPCWSTR pszSubKeyName, ISpDataKey** ppSubKey)
             return SPERR_NOT_FOUND;
         }
 
-        com::object<ISpDataKeyImpl> obj;
-        for (const auto& [key, value] : attributes_) {
-            obj->set(key, value);
-        }
+        com::object<ISpDataKeyImpl> obj(data_->attributes);
 
         com::interface_ptr<ISpDataKey> int_ptr(obj);
         *ppSubKey = int_ptr.get();
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <map>
+#include <memory>
 #include <comdef.h>
 #include <comip.h>
 
@@ -11,10 +12,19 @@
 namespace Espeak {
 namespace sapi {
 
+struct voice_token_data
+{
+    std::wstring name;
+    ISpDataKeyImpl::shared_values values;
+    ISpDataKeyImpl::shared_values attributes;
+};
+
 class voice_token : public ISpDataKeyImpl
 {
 public:
-    explicit voice_token(const voice_attributes& attr);
+    explicit voice_token(const std::shared_ptr<const voice_token_data>& data);
+
+    [[nodiscard]] static std::shared_ptr<const voice_token_data> data_for(const voice_attributes& attr);
 
     STDMETHOD(OpenKey)(LPCWSTR pszSubKeyName, ISpDataKey** ppSubKey) override;
     STDMETHOD(EnumKeys)(ULONG Index, LPWSTR* ppszSubKeyName) override;
@@ -25,9 +35,7 @@ private:
         return _wcsicmp(s1.c_str(), s2.c_str()) == 0;
     }
 
-    using attribute_map = std::map<std::wstring, std::wstring, str_less>;
-
-    attribute_map attributes_;
+    std::shared_ptr<const voice_token_data> data_;
 };
 }
 }
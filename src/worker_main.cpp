@@ -0,0 +1,175 @@
+#include "espeak_wrapper.h"
+#include "worker_protocol.hpp"
+#include "debug_log.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace Espeak {
+
+namespace {
+
+#ifdef _WIN32
+WorkerChannel::native_handle stdinHandle() { return GetStdHandle(STD_INPUT_HANDLE); }
+WorkerChannel::native_handle stdoutHandle() { return GetStdHandle(STD_OUTPUT_HANDLE); }
+#else
+WorkerChannel::native_handle stdinHandle() { return STDIN_FILENO; }
+WorkerChannel::native_handle stdoutHandle() { return STDOUT_FILENO; }
+#endif
+
+class WorkerServer {
+public:
+    WorkerServer()
+        : channel_(stdinHandle(), stdoutHandle(), false)
+        , cancelled_id_(0)
+        , settings_{}
+        , settings_pending_(false)
+        , stop_(false)
+    {
+    }
+
+    int run() {
+        EspeakEngine& engine = EspeakEngine::getInstance();
+        if (!engine.initialize()) {
+            LOG_ERROR("Worker: Failed to initialize espeak-ng");
+            return 1;
+        }
+
+        WorkerHello hello{WORKER_PROTOCOL_MAGIC, WORKER_PROTOCOL_VERSION, engine.sampleRate()};
+        encodeHello(hello, payload_);
+        if (!channel_.writeFrame(WorkerMessage::Ready, payload_)) {
+            return 1;
+        }
+
+        std::thread reader(&WorkerServer::readLoop, this);
+
+        for (;;) {
+            SpeakRequest request;
+            WorkerSettings settings{};
+            bool configure = false;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                cv_.wait(lock, [this]() { return stop_ || !requests_.empty(); });
+                if (requests_.empty()) {
+                    break;
+                }
+                request = std::move(requests_.front());
+                requests_.pop_front();
+                configure = settings_pending_;
+                settings = settings_;
+                settings_pending_ = false;
+            }
+            if (configure) {
+                apply(engine, settings);
+            }
+            handle(engine, request);
+        }
+
+        reader.join();
+        DEBUG_LOG("Worker: Shutting down");
+        return 0;
+    }
+
+private:
+    void readLoop() {
+        WorkerFrame frame;
+        while (channel_.readFrame(frame)) {
+            if (frame.type == WorkerMessage::Speak) {
+                SpeakRequest request;
+                if (!decodeSpeakRequest(frame.payload, request)) {
+                    break;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(mutex_);
+                    requests_.push_back(std::move(request));
+                }
+                cv_.notify_one();
+            } else if (frame.type == WorkerMessage::Configure) {
+                // Sent before the request it applies to, so it is in place
+                // by the time that request is taken off the queue.
+                WorkerSettings settings{};
+                if (!decodeSettings(frame.payload, settings)) {
+                    break;
+                }
+                std::lock_guard<std::mutex> lock(mutex_);
+                settings_ = settings;
+                settings_pending_ = true;
+            } else if (frame.type == WorkerMessage::Cancel) {
+                std::uint32_t id = 0;
+                if (decodeId(frame.payload, id)) {
+                    cancelled_id_.store(id);
+                }
+            } else {
+                break;
+            }
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_one();
+    }
+
+    static void apply(EspeakEngine& engine, const WorkerSettings& settings) {
+        engine.configureCache(static_cast<std::size_t>(settings.cache_bytes), false);
+        engine.configureChunking(settings.chunk_first_chars, settings.chunk_max_chars);
+        engine.configureBuffer(settings.buffer_ms);
+        engine.configureSilenceTrim(settings.trim, settings.trim_threshold, settings.trim_lookahead_ms,
+                                    settings.trim_max_gap_ms);
+        engine.configureCharacterTable(static_cast<std::size_t>(settings.character_table_bytes),
+                                       settings.generation);
+        DEBUG_LOG("Worker: Applied settings for generation %llu",
+                  static_cast<unsigned long long>(settings.generation));
+    }
+
+    void handle(EspeakEngine& engine, const SpeakRequest& request) {
+        const std::uint32_t id = request.id;
+        bool ok = cancelled_id_.load() != id && engine.speak(
+            request.text, request.rate, request.pitch, request.volume,
+            request.intonation, request.wordgap, request.rateboost,
+            [this, id](const short* audio, int sample_count, void*) {
+                if (cancelled_id_.load() == id) {
+                    return false;
+                }
+                encodeAudio(id, audio, sample_count, payload_);
+                return channel_.writeFrame(WorkerMessage::Audio, payload_);
+            },
+            nullptr,
+            [this, id](const SynthEvent& event, void*) {
+                encodeEvent(id, event, payload_);
+                (void)channel_.writeFrame(WorkerMessage::Event, payload_);
+            },
+            request.ssml ? TextFormat::Ssml : request.spell ? TextFormat::Characters : TextFormat::Plain,
+            nullptr, request.voice);
+
+        ok = ok && cancelled_id_.load() != id;
+        encodeDone(id, ok, payload_);
+        (void)channel_.writeFrame(WorkerMessage::Done, payload_);
+    }
+
+    WorkerChannel channel_;
+    std::vector<std::uint8_t> payload_;
+    std::atomic<std::uint32_t> cancelled_id_;
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<SpeakRequest> requests_;
+    WorkerSettings settings_;
+    bool settings_pending_;
+    bool stop_;
+};
+}
+}
+
+int main() {
+    Espeak::WorkerServer server;
+    return server.run();
+}
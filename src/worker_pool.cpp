@@ -0,0 +1,473 @@
+#include "worker_pool.hpp"
+#include "debug_log.h"
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <csignal>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace Espeak {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr int MAX_SPAWN_FAILURES = 3;
+constexpr unsigned SHUTDOWN_WAIT_MS = 1000;
+constexpr auto CANCEL_POLL = std::chrono::milliseconds(10);
+constexpr auto STALL_TIMEOUT = std::chrono::milliseconds(5000);
+constexpr auto CANCEL_TIMEOUT = std::chrono::milliseconds(1000);
+
+#ifdef _WIN32
+constexpr wchar_t WORKER_EXE_NAME[] = L"EspeakSAPIWorker.exe";
+#else
+constexpr char WORKER_EXE_NAME[] = "EspeakSAPIWorker";
+
+// Socket pairs rather than pipes, so channel writes can suppress SIGPIPE per
+// call instead of the pool changing the host's signal disposition.
+bool makeSocketPair(int fds[2]) {
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+        return false;
+    }
+    for (int i = 0; i < 2; ++i) {
+        fcntl(fds[i], F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+        const int on = 1;
+        setsockopt(fds[i], SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+    }
+    return true;
+}
+#endif
+}
+
+struct WorkerPool::Worker {
+    std::unique_ptr<WorkerChannel> channel;
+#ifdef _WIN32
+    HANDLE process = nullptr;
+#else
+    pid_t pid = -1;
+#endif
+    bool busy = false;
+    std::string voice;
+    std::uint64_t last_used = 0;
+    std::uint64_t settings_version = 0;
+};
+
+WorkerPool::WorkerPool(std::filesystem::path worker_path, std::size_t size)
+    : worker_path_(std::move(worker_path))
+    , next_id_(1)
+    , sample_rate_(0)
+    , use_clock_(0)
+    , settings_version_(0)
+    , spawn_failures_(0)
+    , unavailable_(false)
+    , stats_{}
+{
+    workers_.reserve(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        workers_.push_back(std::make_unique<Worker>());
+    }
+    DEBUG_LOG("WorkerPool: Created with %zu slots, worker %S", size, worker_path_.c_str());
+}
+
+WorkerPool::~WorkerPool() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& worker : workers_) {
+        if (worker->channel) {
+            (void)worker->channel->writeFrame(WorkerMessage::Shutdown);
+        }
+        terminate(*worker);
+    }
+}
+
+std::filesystem::path WorkerPool::defaultWorkerPath() {
+#ifdef _WIN32
+    HMODULE module = nullptr;
+    if (!GetModuleHandleExW(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS | GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                            reinterpret_cast<LPCWSTR>(&WorkerPool::defaultWorkerPath), &module)) {
+        return WORKER_EXE_NAME;
+    }
+    wchar_t path[MAX_PATH];
+    const DWORD length = GetModuleFileNameW(module, path, MAX_PATH);
+    if (length == 0 || length >= MAX_PATH) {
+        return WORKER_EXE_NAME;
+    }
+    return std::filesystem::path(path).parent_path() / WORKER_EXE_NAME;
+#else
+    std::error_code ec;
+    const std::filesystem::path self = std::filesystem::read_symlink("/proc/self/exe", ec);
+    if (ec) {
+        return WORKER_EXE_NAME;
+    }
+    return self.parent_path() / WORKER_EXE_NAME;
+#endif
+}
+
+void WorkerPool::configure(const WorkerSettings& settings) {
+    std::vector<std::uint8_t> payload;
+    encodeSettings(settings, payload);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (payload != settings_) {
+        settings_ = std::move(payload);
+        ++settings_version_;
+    }
+}
+
+WorkerPool::Result WorkerPool::speak(SpeakRequest request, const AudioSink& on_audio, const EventSink& on_event,
+                                     const CancelToken* cancel) {
+    Worker* worker = acquire(request.voice);
+    if (!worker) {
+        return Result::Unavailable;
+    }
+
+    request.id = next_id_.fetch_add(1, std::memory_order_relaxed);
+
+    std::vector<std::uint8_t> payload;
+    std::uint64_t settings_version = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (worker->settings_version != settings_version_) {
+            payload = settings_;
+            settings_version = settings_version_;
+        }
+    }
+    if (settings_version != 0) {
+        if (!worker->channel->writeFrame(WorkerMessage::Configure, payload)) {
+            LOG_WARN("WorkerPool: Failed to send settings for request %u", request.id);
+            release(worker, false);
+            return Result::Failed;
+        }
+        worker->settings_version = settings_version;
+    }
+
+    encodeSpeakRequest(request, payload);
+    if (!worker->channel->writeFrame(WorkerMessage::Speak, payload)) {
+        LOG_WARN("WorkerPool: Failed to send request %u", request.id);
+        release(worker, false);
+        return Result::Failed;
+    }
+
+    bool healthy = true;
+    bool cancelled = false;
+    bool ok = false;
+    WorkerFrame frame;
+    const auto send_cancel = [&]() {
+        cancelled = true;
+        encodeId(request.id, payload);
+        return worker->channel->writeFrame(WorkerMessage::Cancel, payload);
+    };
+
+    // The worker gets STALL_TIMEOUT between frames, and CANCEL_TIMEOUT to
+    // finish once cancelled; past either it is treated as hung.
+    Clock::time_point last_frame = Clock::now();
+    for (bool finished = false; !finished;) {
+        if (!cancelled && cancel && cancel->cancelled()) {
+            if (!send_cancel()) {
+                healthy = false;
+                break;
+            }
+            last_frame = Clock::now();
+        }
+        if (!worker->channel->waitReadable(CANCEL_POLL)) {
+            if (Clock::now() - last_frame >= (cancelled ? CANCEL_TIMEOUT : STALL_TIMEOUT)) {
+                LOG_WARN("WorkerPool: Worker stopped responding during request %u", request.id);
+                healthy = false;
+                break;
+            }
+            continue;
+        }
+        if (!worker->channel->readFrame(frame)) {
+            DEBUG_LOG("WorkerPool: Lost worker during request %u", request.id);
+            healthy = false;
+            break;
+        }
+        last_frame = Clock::now();
+
+        std::uint32_t id = 0;
+        switch (frame.type) {
+            case WorkerMessage::Audio: {
+                const short* samples = nullptr;
+                int sample_count = 0;
+                if (!decodeAudio(frame.payload, id, samples, sample_count)) {
+                    healthy = false;
+                    finished = true;
+                    break;
+                }
+                if (id != request.id || cancelled || sample_count == 0) {
+                    break;
+                }
+                if (!on_audio(samples, sample_count) && !send_cancel()) {
+                    healthy = false;
+                    finished = true;
+                }
+                break;
+            }
+            case WorkerMessage::Event: {
+                SynthEvent event{};
+                if (!decodeEvent(frame.payload, id, event)) {
+                    healthy = false;
+                    finished = true;
+                    break;
+                }
+                if (id == request.id && !cancelled && on_event) {
+                    on_event(event);
+                }
+                break;
+            }
+            case WorkerMessage::Done: {
+                bool done_ok = false;
+                if (!decodeDone(frame.payload, id, done_ok)) {
+                    healthy = false;
+                    finished = true;
+                    break;
+                }
+                if (id == request.id) {
+                    ok = done_ok && !cancelled;
+                    finished = true;
+                }
+                break;
+            }
+            default:
+                DEBUG_LOG("WorkerPool: Unexpected message %u from worker", static_cast<unsigned>(frame.type));
+                healthy = false;
+                finished = true;
+                break;
+        }
+    }
+
+    release(worker, healthy);
+    return ok ? Result::Ok : Result::Failed;
+}
+
+WorkerPool::Stats WorkerPool::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+// Each worker process keeps the last voice it spoke with loaded, so requests
+// go to an idle worker that already has the voice, then to the idle worker
+// whose voice was used least recently.
+WorkerPool::Worker* WorkerPool::acquire(const std::string& voice) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        if (unavailable_ || workers_.empty()) {
+            return nullptr;
+        }
+
+        Worker* idle = nullptr;
+        for (auto& worker : workers_) {
+            if (worker->busy || !worker->channel) {
+                continue;
+            }
+            if (worker->voice == voice) {
+                idle = worker.get();
+                ++stats_.voice_hits;
+                break;
+            }
+            if (!idle || worker->last_used < idle->last_used) {
+                idle = worker.get();
+            }
+        }
+        if (idle) {
+            idle->busy = true;
+            idle->voice = voice;
+            idle->last_used = ++use_clock_;
+            ++stats_.requests;
+            return idle;
+        }
+
+        for (auto& worker : workers_) {
+            if (worker->busy || worker->channel) {
+                continue;
+            }
+            worker->busy = true;
+            lock.unlock();
+            const bool spawned = spawn(*worker);
+            lock.lock();
+            if (spawned) {
+                spawn_failures_ = 0;
+                ++stats_.spawns;
+                ++stats_.requests;
+                worker->voice = voice;
+                worker->last_used = ++use_clock_;
+                return worker.get();
+            }
+            worker->busy = false;
+            if (++spawn_failures_ >= MAX_SPAWN_FAILURES) {
+                LOG_WARN("WorkerPool: Giving up after %d failed spawns", spawn_failures_);
+                unavailable_ = true;
+                idle_cv_.notify_all();
+                return nullptr;
+            }
+            break;
+        }
+
+        if (std::none_of(workers_.begin(), workers_.end(), [](const auto& w) { return !w->busy; })) {
+            ++stats_.waits;
+            idle_cv_.wait(lock);
+        }
+    }
+}
+
+void WorkerPool::release(Worker* worker, bool healthy) {
+    if (!healthy) {
+        terminate(*worker);
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!healthy) {
+            ++stats_.failures;
+            worker->voice.clear();
+        }
+        worker->busy = false;
+    }
+    idle_cv_.notify_one();
+}
+
+bool WorkerPool::spawn(Worker& worker) {
+#ifdef _WIN32
+    SECURITY_ATTRIBUTES sa = {};
+    sa.nLength = sizeof(sa);
+    sa.bInheritHandle = TRUE;
+
+    HANDLE child_stdin_read = nullptr;
+    HANDLE child_stdin_write = nullptr;
+    HANDLE child_stdout_read = nullptr;
+    HANDLE child_stdout_write = nullptr;
+    if (!CreatePipe(&child_stdin_read, &child_stdin_write, &sa, 0)) {
+        return false;
+    }
+    if (!CreatePipe(&child_stdout_read, &child_stdout_write, &sa, 0)) {
+        CloseHandle(child_stdin_read);
+        CloseHandle(child_stdin_write);
+        return false;
+    }
+    SetHandleInformation(child_stdin_write, HANDLE_FLAG_INHERIT, 0);
+    SetHandleInformation(child_stdout_read, HANDLE_FLAG_INHERIT, 0);
+
+    HANDLE inherited[2] = {child_stdin_read, child_stdout_write};
+    SIZE_T attr_size = 0;
+    InitializeProcThreadAttributeList(nullptr, 1, 0, &attr_size);
+    std::vector<std::uint8_t> attr_storage(attr_size);
+    auto* attrs = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attr_storage.data());
+    const bool attrs_ok = InitializeProcThreadAttributeList(attrs, 1, 0, &attr_size) &&
+        UpdateProcThreadAttribute(attrs, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+                                  inherited, sizeof(inherited), nullptr, nullptr);
+
+    STARTUPINFOEXW si = {};
+    si.StartupInfo.cb = sizeof(si);
+    si.StartupInfo.dwFlags = STARTF_USESTDHANDLES;
+    si.StartupInfo.hStdInput = child_stdin_read;
+    si.StartupInfo.hStdOutput = child_stdout_write;
+    si.StartupInfo.hStdError = nullptr;
+    si.lpAttributeList = attrs_ok ? attrs : nullptr;
+
+    std::wstring command_line = L"\"" + worker_path_.wstring() + L"\"";
+    PROCESS_INFORMATION pi = {};
+    const BOOL created = attrs_ok && CreateProcessW(worker_path_.c_str(), command_line.data(), nullptr, nullptr,
+                                                    TRUE, CREATE_NO_WINDOW | EXTENDED_STARTUPINFO_PRESENT,
+                                                    nullptr, nullptr, &si.StartupInfo, &pi);
+    if (attrs_ok) {
+        DeleteProcThreadAttributeList(attrs);
+    }
+    CloseHandle(child_stdin_read);
+    CloseHandle(child_stdout_write);
+
+    if (!created) {
+        LOG_WARN("WorkerPool: CreateProcess failed for %S, error %lu", worker_path_.c_str(), GetLastError());
+        CloseHandle(child_stdin_write);
+        CloseHandle(child_stdout_read);
+        return false;
+    }
+
+    CloseHandle(pi.hThread);
+    worker.process = pi.hProcess;
+    worker.channel = std::make_unique<WorkerChannel>(child_stdout_read, child_stdin_write, true);
+#else
+    int to_child[2];
+    int from_child[2];
+    if (!makeSocketPair(to_child)) {
+        return false;
+    }
+    if (!makeSocketPair(from_child)) {
+        ::close(to_child[0]);
+        ::close(to_child[1]);
+        return false;
+    }
+
+    const std::string path = worker_path_.string();
+    const pid_t pid = fork();
+    if (pid == 0) {
+        dup2(to_child[0], STDIN_FILENO);
+        dup2(from_child[1], STDOUT_FILENO);
+        execl(path.c_str(), path.c_str(), static_cast<char*>(nullptr));
+        _exit(127);
+    }
+
+    ::close(to_child[0]);
+    ::close(from_child[1]);
+
+    if (pid < 0) {
+        ::close(to_child[1]);
+        ::close(from_child[0]);
+        return false;
+    }
+
+    worker.pid = pid;
+    worker.channel = std::make_unique<WorkerChannel>(from_child[0], to_child[1], true);
+#endif
+
+    WorkerFrame frame;
+    WorkerHello hello{};
+    if (!worker.channel->waitReadable(STALL_TIMEOUT) || !worker.channel->readFrame(frame) ||
+        frame.type != WorkerMessage::Ready ||
+        !decodeHello(frame.payload, hello) || hello.magic != WORKER_PROTOCOL_MAGIC ||
+        hello.version != WORKER_PROTOCOL_VERSION) {
+        DEBUG_LOG("WorkerPool: Worker did not complete handshake");
+        terminate(worker);
+        return false;
+    }
+
+    sample_rate_.store(hello.sample_rate, std::memory_order_relaxed);
+    DEBUG_LOG("WorkerPool: Worker started (sample rate %d Hz)", hello.sample_rate);
+    return true;
+}
+
+void WorkerPool::terminate(Worker& worker) noexcept {
+    worker.channel.reset();
+    worker.settings_version = 0;
+#ifdef _WIN32
+    if (worker.process) {
+        if (WaitForSingleObject(worker.process, SHUTDOWN_WAIT_MS) != WAIT_OBJECT_0) {
+            TerminateProcess(worker.process, 1);
+        }
+        CloseHandle(worker.process);
+        worker.process = nullptr;
+    }
+#else
+    if (worker.pid > 0) {
+        int status = 0;
+        for (unsigned waited = 0; waitpid(worker.pid, &status, WNOHANG) == 0; waited += 10) {
+            if (waited >= SHUTDOWN_WAIT_MS) {
+                kill(worker.pid, SIGKILL);
+                waitpid(worker.pid, &status, 0);
+                break;
+            }
+            usleep(10 * 1000);
+        }
+        worker.pid = -1;
+    }
+#endif
+}
+}
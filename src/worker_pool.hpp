@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "cancel_token.hpp"
+#include "worker_protocol.hpp"
+
+namespace Espeak {
+
+class WorkerPool {
+public:
+    using AudioSink = std::function<bool(const short* audio, int sample_count)>;
+    using EventSink = std::function<void(const SynthEvent& event)>;
+
+    enum class Result {
+        Ok,
+        Failed,
+        Unavailable
+    };
+
+    struct Stats {
+        std::uint64_t requests;
+        std::uint64_t spawns;
+        std::uint64_t failures;
+        std::uint64_t waits;
+        std::uint64_t voice_hits;
+    };
+
+    WorkerPool(std::filesystem::path worker_path, std::size_t size);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    [[nodiscard]] std::size_t size() const noexcept { return workers_.size(); }
+
+    [[nodiscard]] int sampleRate() const noexcept { return sample_rate_.load(std::memory_order_relaxed); }
+
+    // Sent to each worker before its next request if the settings changed.
+    void configure(const WorkerSettings& settings);
+
+    // Cancelling the token stops the worker within a poll interval. A worker
+    // that sends nothing for too long is treated as hung and replaced.
+    [[nodiscard]] Result speak(SpeakRequest request, const AudioSink& on_audio, const EventSink& on_event,
+                               const CancelToken* cancel = nullptr);
+
+    [[nodiscard]] Stats stats() const;
+
+    [[nodiscard]] static std::filesystem::path defaultWorkerPath();
+
+private:
+    struct Worker;
+
+    Worker* acquire(const std::string& voice);
+
+    void release(Worker* worker, bool healthy);
+
+    bool spawn(Worker& worker);
+
+    static void terminate(Worker& worker) noexcept;
+
+    std::filesystem::path worker_path_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    mutable std::mutex mutex_;
+    std::condition_variable idle_cv_;
+    std::atomic<std::uint32_t> next_id_;
+    std::atomic<int> sample_rate_;
+    std::uint64_t use_clock_;
+    std::vector<std::uint8_t> settings_;
+    std::uint64_t settings_version_;
+    int spawn_failures_;
+    bool unavailable_;
+    Stats stats_;
+};
+}
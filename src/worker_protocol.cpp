@@ -0,0 +1,375 @@
+#include "worker_protocol.hpp"
+#include <cstring>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace Espeak {
+
+namespace {
+
+constexpr std::size_t FRAME_HEADER_SIZE = 2 * sizeof(std::uint32_t);
+
+#ifdef _WIN32
+const WorkerChannel::native_handle INVALID_CHANNEL_HANDLE = nullptr;
+#else
+constexpr WorkerChannel::native_handle INVALID_CHANNEL_HANDLE = -1;
+
+// A peer that has gone away must fail the write, not raise SIGPIPE in a host
+// whose signal handling is not ours to change.
+#ifdef MSG_NOSIGNAL
+constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SEND_FLAGS = 0;
+#endif
+#endif
+
+void closeHandle(WorkerChannel::native_handle handle) noexcept {
+    if (handle == INVALID_CHANNEL_HANDLE) {
+        return;
+    }
+#ifdef _WIN32
+    CloseHandle(handle);
+#else
+    ::close(handle);
+#endif
+}
+}
+
+void PayloadWriter::putU32(std::uint32_t value) {
+    putBytes(&value, sizeof(value));
+}
+
+void PayloadWriter::putI32(std::int32_t value) {
+    putBytes(&value, sizeof(value));
+}
+
+void PayloadWriter::putU64(std::uint64_t value) {
+    putBytes(&value, sizeof(value));
+}
+
+void PayloadWriter::putString(const std::string& value) {
+    putU32(static_cast<std::uint32_t>(value.size()));
+    putBytes(value.data(), value.size());
+}
+
+void PayloadWriter::putBytes(const void* data, std::size_t size) {
+    const auto* bytes = static_cast<const std::uint8_t*>(data);
+    out_.insert(out_.end(), bytes, bytes + size);
+}
+
+bool PayloadReader::getU32(std::uint32_t& value) {
+    if (remaining() < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, data_ + offset_, sizeof(value));
+    offset_ += sizeof(value);
+    return true;
+}
+
+bool PayloadReader::getI32(std::int32_t& value) {
+    if (remaining() < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, data_ + offset_, sizeof(value));
+    offset_ += sizeof(value);
+    return true;
+}
+
+bool PayloadReader::getU64(std::uint64_t& value) {
+    if (remaining() < sizeof(value)) {
+        return false;
+    }
+    std::memcpy(&value, data_ + offset_, sizeof(value));
+    offset_ += sizeof(value);
+    return true;
+}
+
+bool PayloadReader::getString(std::string& value) {
+    std::uint32_t size = 0;
+    if (!getU32(size) || remaining() < size) {
+        return false;
+    }
+    value.assign(reinterpret_cast<const char*>(data_ + offset_), size);
+    offset_ += size;
+    return true;
+}
+
+bool PayloadReader::getBytes(void* data, std::size_t size) {
+    if (remaining() < size) {
+        return false;
+    }
+    std::memcpy(data, data_ + offset_, size);
+    offset_ += size;
+    return true;
+}
+
+void encodeHello(const WorkerHello& hello, std::vector<std::uint8_t>& out) {
+    PayloadWriter writer(out);
+    writer.putU32(hello.magic);
+    writer.putU32(hello.version);
+    writer.putI32(hello.sample_rate);
+}
+
+bool decodeHello(const std::vector<std::uint8_t>& payload, WorkerHello& hello) {
+    PayloadReader reader(payload);
+    return reader.getU32(hello.magic) && reader.getU32(hello.version) && reader.getI32(hello.sample_rate);
+}
+
+void encodeSpeakRequest(const SpeakRequest& request, std::vector<std::uint8_t>& out) {
+    PayloadWriter writer(out);
+    writer.putU32(request.id);
+    writer.putString(request.voice);
+    writer.putI32(request.rate);
+    writer.putI32(request.pitch);
+    writer.putI32(request.volume);
+    writer.putI32(request.intonation);
+    writer.putI32(request.wordgap);
+    writer.putU32(request.rateboost ? 1 : 0);
+    writer.putString(request.text);
+    writer.putU32(request.ssml ? 1 : 0);
+    writer.putU32(request.spell ? 1 : 0);
+}
+
+bool decodeSpeakRequest(const std::vector<std::uint8_t>& payload, SpeakRequest& request) {
+    PayloadReader reader(payload);
+    std::uint32_t rateboost = 0;
+    std::uint32_t ssml = 0;
+    std::uint32_t spell = 0;
+    if (!reader.getU32(request.id) || !reader.getString(request.voice) ||
+        !reader.getI32(request.rate) || !reader.getI32(request.pitch) ||
+        !reader.getI32(request.volume) || !reader.getI32(request.intonation) ||
+        !reader.getI32(request.wordgap) || !reader.getU32(rateboost) ||
+        !reader.getString(request.text) || !reader.getU32(ssml) || !reader.getU32(spell)) {
+        return false;
+    }
+    request.rateboost = rateboost != 0;
+    request.ssml = ssml != 0;
+    request.spell = spell != 0;
+    return true;
+}
+
+void encodeSettings(const WorkerSettings& settings, std::vector<std::uint8_t>& out) {
+    PayloadWriter writer(out);
+    writer.putU64(settings.cache_bytes);
+    writer.putU32(settings.chunk_first_chars);
+    writer.putU32(settings.chunk_max_chars);
+    writer.putI32(settings.buffer_ms);
+    writer.putU32(settings.trim ? 1 : 0);
+    writer.putI32(settings.trim_threshold);
+    writer.putI32(settings.trim_lookahead_ms);
+    writer.putI32(settings.trim_max_gap_ms);
+    writer.putU64(settings.character_table_bytes);
+    writer.putU64(settings.generation);
+}
+
+bool decodeSettings(const std::vector<std::uint8_t>& payload, WorkerSettings& settings) {
+    PayloadReader reader(payload);
+    std::uint32_t trim = 0;
+    if (!reader.getU64(settings.cache_bytes) || !reader.getU32(settings.chunk_first_chars) ||
+        !reader.getU32(settings.chunk_max_chars) || !reader.getI32(settings.buffer_ms) ||
+        !reader.getU32(trim) || !reader.getI32(settings.trim_threshold) ||
+        !reader.getI32(settings.trim_lookahead_ms) || !reader.getI32(settings.trim_max_gap_ms) ||
+        !reader.getU64(settings.character_table_bytes) || !reader.getU64(settings.generation)) {
+        return false;
+    }
+    settings.trim = trim != 0;
+    return true;
+}
+
+void encodeAudio(std::uint32_t id, const short* samples, int sample_count, std::vector<std::uint8_t>& out) {
+    PayloadWriter writer(out);
+    writer.putU32(id);
+    writer.putBytes(samples, static_cast<std::size_t>(sample_count) * sizeof(short));
+}
+
+bool decodeAudio(const std::vector<std::uint8_t>& payload, std::uint32_t& id,
+                 const short*& samples, int& sample_count) {
+    PayloadReader reader(payload);
+    if (!reader.getU32(id) || reader.remaining() % sizeof(short) != 0) {
+        return false;
+    }
+    samples = reinterpret_cast<const short*>(reader.rest());
+    sample_count = static_cast<int>(reader.remaining() / sizeof(short));
+    return true;
+}
+
+void encodeEvent(std::uint32_t id, const SynthEvent& event, std::vector<std::uint8_t>& out) {
+    PayloadWriter writer(out);
+    writer.putU32(id);
+    writer.putI32(static_cast<std::int32_t>(event.type));
+    writer.putI32(event.text_position);
+    writer.putI32(event.length);
+    writer.putI32(event.sample);
+    writer.putI32(event.number);
+    writer.putString(event.name);
+}
+
+bool decodeEvent(const std::vector<std::uint8_t>& payload, std::uint32_t& id, SynthEvent& event) {
+    PayloadReader reader(payload);
+    std::int32_t type = 0;
+    if (!reader.getU32(id) || !reader.getI32(type) || !reader.getI32(event.text_position) ||
+        !reader.getI32(event.length) || !reader.getI32(event.sample) ||
+        !reader.getI32(event.number) || !reader.getString(event.name)) {
+        return false;
+    }
+    event.type = static_cast<SynthEventType>(type);
+    return true;
+}
+
+void encodeDone(std::uint32_t id, bool ok, std::vector<std::uint8_t>& out) {
+    PayloadWriter writer(out);
+    writer.putU32(id);
+    writer.putU32(ok ? 1 : 0);
+}
+
+bool decodeDone(const std::vector<std::uint8_t>& payload, std::uint32_t& id, bool& ok) {
+    PayloadReader reader(payload);
+    std::uint32_t flag = 0;
+    if (!reader.getU32(id) || !reader.getU32(flag)) {
+        return false;
+    }
+    ok = flag != 0;
+    return true;
+}
+
+void encodeId(std::uint32_t id, std::vector<std::uint8_t>& out) {
+    PayloadWriter writer(out);
+    writer.putU32(id);
+}
+
+bool decodeId(const std::vector<std::uint8_t>& payload, std::uint32_t& id) {
+    PayloadReader reader(payload);
+    return reader.getU32(id);
+}
+
+WorkerChannel::WorkerChannel(native_handle read_handle, native_handle write_handle, bool owns_handles)
+    : read_(read_handle)
+    , write_(write_handle)
+    , owns_(owns_handles)
+{
+}
+
+WorkerChannel::~WorkerChannel() {
+    close();
+}
+
+void WorkerChannel::close() noexcept {
+    if (owns_) {
+        closeHandle(read_);
+        closeHandle(write_);
+    }
+    read_ = INVALID_CHANNEL_HANDLE;
+    write_ = INVALID_CHANNEL_HANDLE;
+}
+
+bool WorkerChannel::readFrame(WorkerFrame& frame) {
+    std::uint32_t header[2] = {};
+    if (!readExact(header, FRAME_HEADER_SIZE)) {
+        return false;
+    }
+    if (header[1] > MAX_WORKER_FRAME_SIZE) {
+        return false;
+    }
+
+    frame.type = static_cast<WorkerMessage>(header[0]);
+    frame.payload.resize(header[1]);
+    return header[1] == 0 || readExact(frame.payload.data(), header[1]);
+}
+
+bool WorkerChannel::waitReadable(std::chrono::milliseconds timeout) {
+#ifdef _WIN32
+    // Anonymous pipes have no overlapped reads, so poll what is buffered.
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    for (;;) {
+        DWORD available = 0;
+        if (!PeekNamedPipe(read_, nullptr, 0, nullptr, &available, nullptr) || available > 0) {
+            return true;
+        }
+        if (std::chrono::steady_clock::now() >= deadline) {
+            return false;
+        }
+        Sleep(1);
+    }
+#else
+    pollfd descriptor = {read_, POLLIN, 0};
+    const int ready = ::poll(&descriptor, 1, static_cast<int>(timeout.count()));
+    return ready > 0 || (ready < 0 && errno != EINTR);
+#endif
+}
+
+bool WorkerChannel::writeFrame(WorkerMessage type, const std::vector<std::uint8_t>& payload) {
+    if (payload.size() > MAX_WORKER_FRAME_SIZE) {
+        return false;
+    }
+
+    const std::uint32_t header[2] = {static_cast<std::uint32_t>(type), static_cast<std::uint32_t>(payload.size())};
+    scratch_.resize(FRAME_HEADER_SIZE + payload.size());
+    std::memcpy(scratch_.data(), header, FRAME_HEADER_SIZE);
+    if (!payload.empty()) {
+        std::memcpy(scratch_.data() + FRAME_HEADER_SIZE, payload.data(), payload.size());
+    }
+    return writeAll(scratch_.data(), scratch_.size());
+}
+
+bool WorkerChannel::writeFrame(WorkerMessage type) {
+    const std::uint32_t header[2] = {static_cast<std::uint32_t>(type), 0};
+    return writeAll(header, FRAME_HEADER_SIZE);
+}
+
+bool WorkerChannel::readExact(void* data, std::size_t size) {
+    auto* ptr = static_cast<std::uint8_t*>(data);
+    while (size > 0) {
+#ifdef _WIN32
+        DWORD read = 0;
+        if (!ReadFile(read_, ptr, static_cast<DWORD>(size), &read, nullptr) || read == 0) {
+            return false;
+        }
+#else
+        const ssize_t read = ::read(read_, ptr, size);
+        if (read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (read <= 0) {
+            return false;
+        }
+#endif
+        ptr += read;
+        size -= static_cast<std::size_t>(read);
+    }
+    return true;
+}
+
+bool WorkerChannel::writeAll(const void* data, std::size_t size) {
+    const auto* ptr = static_cast<const std::uint8_t*>(data);
+    while (size > 0) {
+#ifdef _WIN32
+        DWORD written = 0;
+        if (!WriteFile(write_, ptr, static_cast<DWORD>(size), &written, nullptr)) {
+            return false;
+        }
+#else
+        ssize_t written = ::send(write_, ptr, size, SEND_FLAGS);
+        if (written < 0 && errno == ENOTSOCK) {
+            // A worker started by hand on plain pipes.
+            written = ::write(write_, ptr, size);
+        }
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+#endif
+        ptr += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+}
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "audio_cache.hpp"
+
+namespace Espeak {
+
+constexpr std::uint32_t WORKER_PROTOCOL_MAGIC = 0x4B525745;
+constexpr std::uint32_t WORKER_PROTOCOL_VERSION = 4;
+constexpr std::uint32_t MAX_WORKER_FRAME_SIZE = 4 * 1024 * 1024;
+
+enum class WorkerMessage : std::uint32_t {
+    Speak = 1,
+    Cancel = 2,
+    Shutdown = 3,
+    Configure = 4,
+    Ready = 16,
+    Audio = 17,
+    Event = 18,
+    Done = 19
+};
+
+struct WorkerFrame {
+    WorkerMessage type;
+    std::vector<std::uint8_t> payload;
+};
+
+struct SpeakRequest {
+    std::uint32_t id;
+    std::string voice;
+    int rate;
+    int pitch;
+    int volume;
+    int intonation;
+    int wordgap;
+    bool rateboost;
+    std::string text;
+    bool ssml;
+    bool spell;
+};
+
+// The engine settings the host applies to its own engine, sent to a worker
+// before its next request whenever they change. Workers keep their audio
+// cache in memory only, so pool processes never race on the cache file.
+struct WorkerSettings {
+    std::uint64_t cache_bytes;
+    std::uint32_t chunk_first_chars;
+    std::uint32_t chunk_max_chars;
+    std::int32_t buffer_ms;
+    bool trim;
+    std::int32_t trim_threshold;
+    std::int32_t trim_lookahead_ms;
+    std::int32_t trim_max_gap_ms;
+    std::uint64_t character_table_bytes;
+    std::uint64_t generation;
+};
+
+struct WorkerHello {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::int32_t sample_rate;
+};
+
+class PayloadWriter {
+public:
+    explicit PayloadWriter(std::vector<std::uint8_t>& out) : out_(out) { out_.clear(); }
+
+    void putU32(std::uint32_t value);
+    void putI32(std::int32_t value);
+    void putU64(std::uint64_t value);
+    void putString(const std::string& value);
+    void putBytes(const void* data, std::size_t size);
+
+private:
+    std::vector<std::uint8_t>& out_;
+};
+
+class PayloadReader {
+public:
+    PayloadReader(const std::uint8_t* data, std::size_t size) : data_(data), size_(size), offset_(0) {}
+
+    explicit PayloadReader(const std::vector<std::uint8_t>& payload)
+        : PayloadReader(payload.data(), payload.size()) {}
+
+    [[nodiscard]] bool getU32(std::uint32_t& value);
+    [[nodiscard]] bool getI32(std::int32_t& value);
+    [[nodiscard]] bool getU64(std::uint64_t& value);
+    [[nodiscard]] bool getString(std::string& value);
+    [[nodiscard]] bool getBytes(void* data, std::size_t size);
+
+    [[nodiscard]] const std::uint8_t* rest() const noexcept { return data_ + offset_; }
+    [[nodiscard]] std::size_t remaining() const noexcept { return size_ - offset_; }
+
+private:
+    const std::uint8_t* data_;
+    std::size_t size_;
+    std::size_t offset_;
+};
+
+void encodeHello(const WorkerHello& hello, std::vector<std::uint8_t>& out);
+[[nodiscard]] bool decodeHello(const std::vector<std::uint8_t>& payload, WorkerHello& hello);
+
+void encodeSpeakRequest(const SpeakRequest& request, std::vector<std::uint8_t>& out);
+[[nodiscard]] bool decodeSpeakRequest(const std::vector<std::uint8_t>& payload, SpeakRequest& request);
+
+void encodeSettings(const WorkerSettings& settings, std::vector<std::uint8_t>& out);
+[[nodiscard]] bool decodeSettings(const std::vector<std::uint8_t>& payload, WorkerSettings& settings);
+
+void encodeAudio(std::uint32_t id, const short* samples, int sample_count, std::vector<std::uint8_t>& out);
+[[nodiscard]] bool decodeAudio(const std::vector<std::uint8_t>& payload, std::uint32_t& id,
+                               const short*& samples, int& sample_count);
+
+void encodeEvent(std::uint32_t id, const SynthEvent& event, std::vector<std::uint8_t>& out);
+[[nodiscard]] bool decodeEvent(const std::vector<std::uint8_t>& payload, std::uint32_t& id, SynthEvent& event);
+
+void encodeDone(std::uint32_t id, bool ok, std::vector<std::uint8_t>& out);
+[[nodiscard]] bool decodeDone(const std::vector<std::uint8_t>& payload, std::uint32_t& id, bool& ok);
+
+void encodeId(std::uint32_t id, std::vector<std::uint8_t>& out);
+[[nodiscard]] bool decodeId(const std::vector<std::uint8_t>& payload, std::uint32_t& id);
+
+class WorkerChannel {
+public:
+#ifdef _WIN32
+    using native_handle = void*;
+#else
+    using native_handle = int;
+#endif
+
+    WorkerChannel(native_handle read_handle, native_handle write_handle, bool owns_handles);
+    ~WorkerChannel();
+
+    WorkerChannel(const WorkerChannel&) = delete;
+    WorkerChannel& operator=(const WorkerChannel&) = delete;
+
+    [[nodiscard]] bool readFrame(WorkerFrame& frame);
+
+    // True once data is waiting or the channel has failed, so the next
+    // readFrame will not block for long; false if the timeout passed.
+    [[nodiscard]] bool waitReadable(std::chrono::milliseconds timeout);
+
+    [[nodiscard]] bool writeFrame(WorkerMessage type, const std::vector<std::uint8_t>& payload);
+
+    [[nodiscard]] bool writeFrame(WorkerMessage type);
+
+    void close() noexcept;
+
+private:
+    bool readExact(void* data, std::size_t size);
+
+    bool writeAll(const void* data, std::size_t size);
+
+    native_handle read_;
+    native_handle write_;
+    bool owns_;
+    std::vector<std::uint8_t> scratch_;
+};
+}
@@ -0,0 +1,330 @@
+#include "config_types.hpp"
+#include "espeak_wrapper.h"
+#include "mock_speak_site.hpp"
+#include "speak_session.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Drives speak_session through mock_speak_site with the real engine and checks
+// what a SAPI site would see: event offsets, aborts and skips, rate and volume
+// actions, and positions across text chunks. Exits non-zero on any failure.
+
+namespace {
+
+using namespace Espeak::sapi;
+using Espeak::config::Configuration;
+
+constexpr std::size_t PCM16_BYTES = 2;
+constexpr std::size_t FLOAT_BYTES = 4;
+
+const char16_t* const SENTENCE = u"The quick brown fox jumps over the lazy dog.";
+
+const char16_t* const PARAGRAPH =
+    u"The committee met on Thursday afternoon to review the proposal, and after a long discussion "
+    u"it agreed to postpone the final vote until the budget figures for the next quarter were available. "
+    u"It was late in the evening when the train finally pulled into the station; the platform was almost "
+    u"empty, and the only sound was the rain drumming steadily on the glass roof above. Researchers have "
+    u"long suspected that sleep plays a central role in memory, but only recently have experiments shown "
+    u"how the brain replays the events of the day while we rest.";
+
+int g_failures = 0;
+const char* g_test = "";
+
+void check(bool ok, const char* expression, int line) {
+    if (!ok) {
+        std::fprintf(stderr, "  %s: line %d: CHECK(%s) failed\n", g_test, line, expression);
+        ++g_failures;
+    }
+}
+
+#define CHECK(expression) check((expression), #expression, __LINE__)
+
+Configuration testConfig() {
+    // Every utterance is synthesized, so runs of the same text are comparable.
+    Configuration cfg;
+    cfg.audio_cache_mb = 0;
+    cfg.character_table_mb = 0;
+    return cfg;
+}
+
+speak_options eventOptions() {
+    speak_options options;
+    options.format = native_format();
+    options.word_events = true;
+    options.sentence_events = true;
+    return options;
+}
+
+speak_fragment speakFragment(std::u16string_view text, std::uint32_t source_offset = 0) {
+    speak_fragment fragment;
+    fragment.kind = fragment_kind::speak;
+    fragment.text = text;
+    fragment.source_offset = source_offset;
+    return fragment;
+}
+
+bool speak(mock_speak_site& site, const std::vector<speak_fragment>& fragments,
+           const Configuration& cfg, const speak_options& options = eventOptions()) {
+    speak_session session;
+    return session.speak(site, fragments, options, cfg);
+}
+
+std::vector<std::uint32_t> wordStarts(const mock_speak_site& site) {
+    std::vector<std::uint32_t> starts;
+    for (const mock_speak_site::recorded_event& event : site.events()) {
+        if (event.type == site_event_type::word_boundary) {
+            starts.push_back(event.source_start);
+        }
+    }
+    return starts;
+}
+
+double rms(const std::vector<std::uint8_t>& audio, std::size_t from) {
+    const std::size_t samples = audio.size() / PCM16_BYTES;
+    double sum = 0.0;
+    std::size_t count = 0;
+    for (std::size_t i = from; i < samples; ++i) {
+        short sample = 0;
+        std::memcpy(&sample, audio.data() + i * PCM16_BYTES, PCM16_BYTES);
+        sum += static_cast<double>(sample) * sample;
+        ++count;
+    }
+    return count > 0 ? std::sqrt(sum / static_cast<double>(count)) : 0.0;
+}
+
+// Offsets must be sample-aligned, never run ahead of the audio and never go
+// back; word ranges must start on a word inside the text.
+void checkEvents(const mock_speak_site& site, std::u16string_view text, std::size_t block_align) {
+    std::uint64_t last_offset = 0;
+    std::uint32_t last_start = 0;
+    bool first_word = true;
+    for (const mock_speak_site::recorded_event& event : site.events()) {
+        CHECK(event.offset % block_align == 0);
+        CHECK(event.offset <= site.audio().size());
+        CHECK(event.offset >= last_offset);
+        last_offset = event.offset;
+        if (event.type != site_event_type::word_boundary) {
+            continue;
+        }
+        CHECK(event.source_start < text.size());
+        CHECK(event.source_start + event.source_length <= text.size());
+        CHECK(event.source_start < text.size() && text[event.source_start] != u' ');
+        CHECK(first_word || event.source_start > last_start);
+        last_start = event.source_start;
+        first_word = false;
+    }
+}
+
+void wordEventsFollowTheAudio() {
+    const Configuration cfg = testConfig();
+    mock_speak_site site;
+    CHECK(speak(site, {speakFragment(SENTENCE)}, cfg));
+    CHECK(!site.audio().empty());
+
+    const std::vector<std::uint32_t> starts = wordStarts(site);
+    CHECK(starts.size() >= 5);
+    CHECK(!starts.empty() && starts.front() == 0);
+    checkEvents(site, SENTENCE, PCM16_BYTES);
+}
+
+void eventOffsetsFollowTheOutputFormat() {
+    const Configuration cfg = testConfig();
+    mock_speak_site native_site;
+    CHECK(speak(native_site, {speakFragment(SENTENCE)}, cfg));
+
+    speak_options options = eventOptions();
+    options.format = {native_format().sample_rate * 2, Espeak::SampleFormat::Float32};
+    mock_speak_site site;
+    CHECK(speak(site, {speakFragment(SENTENCE)}, cfg, options));
+
+    // Twice the rate and twice the sample size: about four times the bytes.
+    const double ratio = static_cast<double>(site.audio().size()) / static_cast<double>(native_site.audio().size());
+    CHECK(ratio > 3.9 && ratio < 4.1);
+    CHECK(wordStarts(site) == wordStarts(native_site));
+    checkEvents(site, SENTENCE, FLOAT_BYTES);
+}
+
+void bookmarksLandBetweenFragments() {
+    const std::u16string first = u"Hello there.";
+    const std::u16string mark = u"42";
+    const std::u16string second = u"General Kenobi.";
+    const std::vector<speak_fragment> fragments = {
+        speakFragment(first, 0),
+        [&] {
+            speak_fragment fragment;
+            fragment.kind = fragment_kind::bookmark;
+            fragment.text = mark;
+            fragment.source_offset = static_cast<std::uint32_t>(first.size() + 1);
+            return fragment;
+        }(),
+        speakFragment(second, static_cast<std::uint32_t>(first.size() + 1)),
+    };
+
+    Configuration cfg = testConfig();
+    cfg.merge_fragments = false;
+    mock_speak_site alone;
+    CHECK(speak(alone, {speakFragment(first, 0)}, cfg));
+
+    for (const bool merge : {false, true}) {
+        cfg.merge_fragments = merge;
+        mock_speak_site site;
+        CHECK(speak(site, fragments, cfg));
+
+        const auto bookmark = std::find_if(site.events().begin(), site.events().end(),
+            [](const mock_speak_site::recorded_event& event) { return event.type == site_event_type::bookmark; });
+        CHECK(bookmark != site.events().end());
+        if (bookmark == site.events().end()) {
+            continue;
+        }
+        CHECK(bookmark->bookmark_id == 42);
+        CHECK(bookmark->bookmark == mark);
+        CHECK(bookmark->offset > 0 && bookmark->offset < site.audio().size());
+        if (!merge) {
+            // Spoken separately, the mark sits exactly where the first fragment ends.
+            CHECK(bookmark->offset == alone.audio().size());
+        }
+    }
+}
+
+void abortStopsTheStream() {
+    for (const int lookahead : {0, 2}) {
+        Configuration cfg = testConfig();
+        cfg.lookahead_fragments = lookahead;
+
+        mock_speak_site full;
+        CHECK(speak(full, {speakFragment(PARAGRAPH)}, cfg));
+
+        mock_speak_site site;
+        site.abort_after(full.audio().size() / 4);
+        CHECK(speak(site, {speakFragment(PARAGRAPH)}, cfg));
+        CHECK(!site.audio().empty());
+        CHECK(site.audio().size() < full.audio().size() / 2);
+        CHECK(site.write_calls() < full.write_calls());
+        for (const mock_speak_site::recorded_event& event : site.events()) {
+            CHECK(event.offset <= site.audio().size());
+        }
+
+        mock_speak_site early;
+        early.abort();
+        CHECK(speak(early, {speakFragment(PARAGRAPH)}, cfg));
+        CHECK(early.audio().empty());
+        CHECK(early.events().empty());
+    }
+}
+
+void skipIsCompleted() {
+    const Configuration cfg = testConfig();
+    mock_speak_site full;
+    CHECK(speak(full, {speakFragment(PARAGRAPH)}, cfg));
+
+    mock_speak_site site;
+    site.skip_after(full.audio().size() / 4);
+    CHECK(speak(site, {speakFragment(PARAGRAPH)}, cfg));
+    CHECK(site.skips() == 1);
+    CHECK((site.actions() & SITE_ACTION_SKIP) == 0);
+    CHECK(site.audio().size() < full.audio().size() / 2);
+}
+
+void rateActionsAreApplied() {
+    const Configuration cfg = testConfig();
+    mock_speak_site normal;
+    CHECK(speak(normal, {speakFragment(PARAGRAPH)}, cfg));
+
+    // Raised before the call: the whole utterance is faster.
+    mock_speak_site before;
+    before.set_rate(5);
+    CHECK(speak(before, {speakFragment(PARAGRAPH)}, cfg));
+    CHECK((before.actions() & SITE_ACTION_RATE) == 0);
+    CHECK(before.audio().size() < normal.audio().size() * 9 / 10);
+
+    // Raised after the first write: live prosody speeds up the rest.
+    mock_speak_site during;
+    during.on_write = [](mock_speak_site& site, std::size_t) {
+        if (site.write_calls() == 1) {
+            site.set_rate(10);
+        }
+    };
+    CHECK(speak(during, {speakFragment(PARAGRAPH)}, cfg));
+    CHECK((during.actions() & SITE_ACTION_RATE) == 0);
+    CHECK(during.audio().size() < normal.audio().size() * 9 / 10);
+    checkEvents(during, PARAGRAPH, PCM16_BYTES);
+}
+
+void volumeActionsAreApplied() {
+    const Configuration cfg = testConfig();
+    mock_speak_site normal;
+    CHECK(speak(normal, {speakFragment(PARAGRAPH)}, cfg));
+
+    mock_speak_site quiet;
+    quiet.on_write = [](mock_speak_site& site, std::size_t) {
+        if (site.write_calls() == 1) {
+            site.set_volume(20);
+        }
+    };
+    CHECK(speak(quiet, {speakFragment(PARAGRAPH)}, cfg));
+    CHECK((quiet.actions() & SITE_ACTION_VOLUME) == 0);
+
+    // The second half was written well after the change took effect.
+    const std::size_t half = normal.audio().size() / PCM16_BYTES / 2;
+    CHECK(rms(quiet.audio(), half) < rms(normal.audio(), half) * 0.5);
+}
+
+void chunkBoundariesKeepPositions() {
+    Configuration chunked = testConfig();
+    Configuration whole = testConfig();
+    whole.chunk_first_chars = 0;
+
+    mock_speak_site chunked_site;
+    CHECK(speak(chunked_site, {speakFragment(PARAGRAPH)}, chunked));
+    mock_speak_site whole_site;
+    CHECK(speak(whole_site, {speakFragment(PARAGRAPH)}, whole));
+
+    checkEvents(chunked_site, PARAGRAPH, PCM16_BYTES);
+    checkEvents(whole_site, PARAGRAPH, PCM16_BYTES);
+
+    // The same words at the same source positions, whether or not the
+    // paragraph was split; the last word is past the first chunk.
+    const std::vector<std::uint32_t> starts = wordStarts(chunked_site);
+    CHECK(starts == wordStarts(whole_site));
+    CHECK(!starts.empty() && starts.back() > static_cast<std::uint32_t>(chunked.chunk_max_chars));
+}
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+const TestCase TESTS[] = {
+    {"word events follow the audio", wordEventsFollowTheAudio},
+    {"event offsets follow the output format", eventOffsetsFollowTheOutputFormat},
+    {"bookmarks land between fragments", bookmarksLandBetweenFragments},
+    {"abort stops the stream", abortStopsTheStream},
+    {"skip is completed", skipIsCompleted},
+    {"rate actions are applied", rateActionsAreApplied},
+    {"volume actions are applied", volumeActionsAreApplied},
+    {"chunk boundaries keep positions", chunkBoundariesKeepPositions},
+};
+}
+
+int main() {
+    if (!Espeak::EspeakEngine::getInstance().initialize()) {
+        std::fprintf(stderr, "espeak-ng failed to initialize\n");
+        return 1;
+    }
+
+    int failed = 0;
+    for (const TestCase& test : TESTS) {
+        g_test = test.name;
+        const int before = g_failures;
+        test.run();
+        const bool ok = g_failures == before;
+        failed += ok ? 0 : 1;
+        std::printf("%s %s\n", ok ? "[  OK  ]" : "[ FAIL ]", test.name);
+    }
+    std::printf("%d of %zu tests failed\n", failed, sizeof(TESTS) / sizeof(TESTS[0]));
+    return failed == 0 ? 0 : 1;
+}
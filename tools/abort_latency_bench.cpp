@@ -0,0 +1,182 @@
+#include "cancel_token.hpp"
+#include "espeak_wrapper.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Measures how long a synthesis keeps running after it is cancelled, from the
+// moment the token is tripped until speak() returns.
+// By default the audio callback is paced at real time, the way a SAPI site
+// blocks in Write; --unpaced lets espeak-ng run as fast as it can.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char16_t* const SAMPLE_TEXT =
+    u"Screen reader users skip through text constantly, so speech has to stop the moment a key is pressed. "
+    u"Every sentence that keeps playing after the user moved on is time wasted listening to the wrong thing. ";
+
+struct Options {
+    std::vector<int> buffers{0, 60, 20, 10, 5};
+    int trials = 40;
+    int min_delay_ms = 20;
+    int max_delay_ms = 200;
+    bool paced = true;
+};
+
+struct Trial {
+    bool cancelled = false;
+    double latency_ms = 0.0;
+    int callbacks = 0;
+    long long samples = 0;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--buffers MS,MS,...] [--trials N] [--delay MIN_MS MAX_MS] [--unpaced]\n",
+                 argv0);
+}
+
+bool parseBuffers(const char* list, std::vector<int>& buffers) {
+    buffers.clear();
+    for (const char* p = list; *p;) {
+        char* end = nullptr;
+        const long value = std::strtol(p, &end, 10);
+        if (end == p || value < 0) {
+            return false;
+        }
+        buffers.push_back(static_cast<int>(value));
+        p = *end == ',' ? end + 1 : end;
+    }
+    return !buffers.empty();
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--buffers") == 0 && i + 1 < argc) {
+            if (!parseBuffers(argv[++i], options.buffers)) {
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--trials") == 0 && i + 1 < argc) {
+            options.trials = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--delay") == 0 && i + 2 < argc) {
+            options.min_delay_ms = std::atoi(argv[++i]);
+            options.max_delay_ms = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--unpaced") == 0) {
+            options.paced = false;
+        } else {
+            return false;
+        }
+    }
+    return options.trials > 0 && options.min_delay_ms >= 0 && options.max_delay_ms >= options.min_delay_ms;
+}
+
+Trial runTrial(Espeak::EspeakEngine& engine, const std::u16string& text, const Options& options,
+               int delay_ms) {
+    Espeak::CancelToken token;
+    std::atomic<bool> returned{false};
+    Clock::time_point returned_at;
+    Trial trial;
+
+    const int sample_rate = engine.sampleRate();
+    const Clock::time_point started = Clock::now();
+    std::thread speaker([&]() {
+        long long samples = 0;
+        [[maybe_unused]] const bool ok = engine.speak(
+            std::u16string_view(text), 0, 50, 100, 50, 0, false,
+            [&](const short*, int sample_count, void*) {
+                ++trial.callbacks;
+                samples += sample_count;
+                if (options.paced) {
+                    std::this_thread::sleep_until(started + std::chrono::microseconds(
+                        samples * 1000000 / sample_rate));
+                }
+                return true;
+            },
+            nullptr, nullptr, Espeak::TextFormat::Plain, &token);
+        returned_at = Clock::now();
+        trial.samples = samples;
+        returned.store(true, std::memory_order_release);
+    });
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+    const Clock::time_point cancelled_at = Clock::now();
+    if (!returned.load(std::memory_order_acquire)) {
+        trial.cancelled = true;
+        token.cancel();
+    }
+    speaker.join();
+
+    if (trial.cancelled) {
+        trial.latency_ms = std::chrono::duration<double, std::milli>(returned_at - cancelled_at).count();
+    }
+    return trial;
+}
+
+double percentile(const std::vector<double>& sorted, double fraction) {
+    const std::size_t index = static_cast<std::size_t>(fraction * static_cast<double>(sorted.size() - 1) + 0.5);
+    return sorted[(std::min)(index, sorted.size() - 1)];
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    Espeak::EspeakEngine& engine = Espeak::EspeakEngine::getInstance();
+    if (!engine.initialize()) {
+        std::fprintf(stderr, "espeak-ng failed to initialize\n");
+        return 1;
+    }
+    engine.configureCache(0, false);
+
+    std::u16string text;
+    while (text.size() < 8000) {
+        text += SAMPLE_TEXT;
+    }
+
+    std::mt19937 random(12345);
+    std::uniform_int_distribution<int> delay(options.min_delay_ms, options.max_delay_ms);
+
+    std::printf("%s, %d trials per buffer, cancel after %d-%d ms\n",
+                options.paced ? "paced" : "unpaced", options.trials, options.min_delay_ms, options.max_delay_ms);
+    std::printf("%9s %8s %8s %8s %8s %8s %12s\n", "buffer ms", "trials", "p50 ms", "p90 ms", "p99 ms", "max ms",
+                "samples/cb");
+
+    for (const int buffer_ms : options.buffers) {
+        engine.configureBuffer(buffer_ms);
+
+        std::vector<double> latencies;
+        long long samples = 0;
+        long long callbacks = 0;
+        for (int i = 0; i < options.trials; ++i) {
+            const Trial trial = runTrial(engine, text, options, delay(random));
+            samples += trial.samples;
+            callbacks += trial.callbacks;
+            if (trial.cancelled) {
+                latencies.push_back(trial.latency_ms);
+            }
+        }
+
+        if (latencies.empty()) {
+            std::printf("%9d %8s (synthesis finished before every cancel)\n", buffer_ms, "0");
+            continue;
+        }
+        std::sort(latencies.begin(), latencies.end());
+        std::printf("%9d %8zu %8.2f %8.2f %8.2f %8.2f %12.0f\n", buffer_ms, latencies.size(),
+                    percentile(latencies, 0.5), percentile(latencies, 0.9), percentile(latencies, 0.99),
+                    latencies.back(), callbacks > 0 ? static_cast<double>(samples) / callbacks : 0.0);
+    }
+    return 0;
+}
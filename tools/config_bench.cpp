@@ -0,0 +1,114 @@
+#include "config_manager.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::size_t threads = 8;
+    std::size_t iterations = 200000;
+    std::size_t reload_every_ms = 0;
+};
+
+std::atomic<long long> g_sink(0);
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s [--threads N] [--iterations N] [--reload-every-ms N]\n", argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            return false;
+        }
+        if (std::strcmp(arg, "--threads") == 0) {
+            options.threads = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--iterations") == 0) {
+            options.iterations = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--reload-every-ms") == 0) {
+            options.reload_every_ms = std::strtoul(value, nullptr, 10);
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return options.threads > 0 && options.iterations > 0;
+}
+
+template<typename Read>
+double measure(const Options& options, Read read) {
+    using clock = std::chrono::steady_clock;
+
+    std::atomic<bool> start(false);
+    std::atomic<bool> readers_done(false);
+    std::vector<std::thread> threads;
+    for (std::size_t t = 0; t < options.threads; ++t) {
+        threads.emplace_back([&]() {
+            while (!start.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+            long long local = 0;
+            for (std::size_t i = 0; i < options.iterations; ++i) {
+                local += read();
+            }
+            g_sink.fetch_add(local);
+        });
+    }
+
+    std::thread reloader;
+    if (options.reload_every_ms > 0) {
+        reloader = std::thread([&]() {
+            const Espeak::config::Configuration config = Espeak::config::ConfigManager::getInstance().getConfig();
+            while (!readers_done.load(std::memory_order_acquire)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.reload_every_ms));
+                [[maybe_unused]] bool saved = Espeak::config::ConfigManager::getInstance().save(config);
+            }
+        });
+    }
+
+    const auto started = clock::now();
+    start.store(true, std::memory_order_release);
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const auto elapsed = clock::now() - started;
+    readers_done.store(true, std::memory_order_release);
+    if (reloader.joinable()) {
+        reloader.join();
+    }
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() / static_cast<double>(options.iterations);
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    Espeak::config::ConfigManager& manager = Espeak::config::ConfigManager::getInstance();
+    [[maybe_unused]] bool loaded = manager.load();
+
+    const double copy_ns = measure(options, [&]() {
+        return static_cast<long long>(manager.getConfig().intonation);
+    });
+    const double snapshot_ns = measure(options, [&]() {
+        return static_cast<long long>(manager.snapshot()->intonation);
+    });
+
+    std::printf("threads=%zu iterations=%zu reload_every_ms=%zu\n",
+                options.threads, options.iterations, options.reload_every_ms);
+    std::printf("getConfig (copy): %8.1f ns/op per thread\n", copy_ns);
+    std::printf("snapshot:         %8.1f ns/op per thread\n", snapshot_ns);
+    std::printf("config generation: %llu\n", static_cast<unsigned long long>(manager.generation()));
+    return 0;
+}
@@ -0,0 +1,269 @@
+#include "espeak_wrapper.h"
+#include "fragment_planner.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Replays SAPI fragment lists with and without merging. A log holds one
+// fragment per line, "action<TAB>rate_adj<TAB>volume<TAB>pitch_adj<TAB>silence_ms<TAB>text",
+// where action is speak, spell, silence or bookmark; a blank line ends a Speak call.
+
+namespace {
+
+using Espeak::sapi::fragment_kind;
+using Espeak::sapi::plan_fragment;
+using Espeak::sapi::synth_unit;
+
+struct Options {
+    const char* log_path = nullptr;
+    bool synthesize = false;
+};
+
+struct Call {
+    std::vector<std::u16string> texts;
+    std::vector<plan_fragment> fragments;
+};
+
+struct Totals {
+    std::size_t units = 0;
+    std::size_t synth_calls = 0;
+    long long samples = 0;
+    double synth_ms = 0.0;
+};
+
+const char* const BUILTIN_LOG =
+    "speak\t0\t100\t0\t0\theading level 2\n"
+    "speak\t0\t100\t0\t0\tRelease notes\n"
+    "\n"
+    "speak\t0\t100\t0\t0\tlink\n"
+    "speak\t0\t100\t0\t0\tvisited\n"
+    "speak\t0\t100\t0\t0\tDownload the installer\n"
+    "\n"
+    "bookmark\t0\t100\t0\t0\t1\n"
+    "speak\t0\t100\t0\t0\tThe \n"
+    "bookmark\t0\t100\t0\t0\t2\n"
+    "speak\t0\t100\t0\t0\tquick \n"
+    "bookmark\t0\t100\t0\t0\t3\n"
+    "speak\t0\t100\t0\t0\tbrown fox jumps over the lazy dog.\n"
+    "\n"
+    "speak\t0\t100\t0\t0\tcap\n"
+    "spell\t0\t100\t15\t0\tN\n"
+    "spell\t0\t100\t0\t0\tv\n"
+    "spell\t0\t100\t0\t0\td\n"
+    "spell\t0\t100\t0\t0\ta\n"
+    "\n"
+    "speak\t0\t100\t0\t0\tedit\n"
+    "silence\t0\t100\t0\t150\t\n"
+    "speak\t2\t80\t0\t0\tmulti line\n"
+    "speak\t0\t100\t0\t0\tblank\n";
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s [--log FILE] [--synthesize]\n", argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--log") == 0 && i + 1 < argc) {
+            options.log_path = argv[++i];
+        } else if (std::strcmp(argv[i], "--synthesize") == 0) {
+            options.synthesize = true;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::u16string utf8ToUtf16(const std::string& text) {
+    std::u16string out;
+    for (std::size_t i = 0; i < text.size();) {
+        const unsigned char lead = static_cast<unsigned char>(text[i]);
+        char32_t code_point = lead;
+        std::size_t extra = 0;
+        if (lead >= 0xF0) {
+            code_point = lead & 0x07;
+            extra = 3;
+        } else if (lead >= 0xE0) {
+            code_point = lead & 0x0F;
+            extra = 2;
+        } else if (lead >= 0xC0) {
+            code_point = lead & 0x1F;
+            extra = 1;
+        }
+        ++i;
+        for (; extra > 0 && i < text.size(); --extra, ++i) {
+            code_point = (code_point << 6) | (static_cast<unsigned char>(text[i]) & 0x3F);
+        }
+        if (code_point >= 0x10000) {
+            code_point -= 0x10000;
+            out.push_back(static_cast<char16_t>(0xD800 + (code_point >> 10)));
+            out.push_back(static_cast<char16_t>(0xDC00 + (code_point & 0x3FF)));
+        } else {
+            out.push_back(static_cast<char16_t>(code_point));
+        }
+    }
+    return out;
+}
+
+bool parseLine(const std::string& line, Call& call) {
+    std::vector<std::string> fields;
+    std::size_t start = 0;
+    for (int field = 0; field < 5; ++field) {
+        const std::size_t tab = line.find('\t', start);
+        if (tab == std::string::npos) {
+            return false;
+        }
+        fields.push_back(line.substr(start, tab - start));
+        start = tab + 1;
+    }
+
+    plan_fragment fragment;
+    const std::string& action = fields[0];
+    if (action == "speak") {
+        fragment.kind = fragment_kind::speak;
+    } else if (action == "spell") {
+        fragment.kind = fragment_kind::spell_out;
+    } else if (action == "silence") {
+        fragment.kind = fragment_kind::silence;
+    } else if (action == "bookmark") {
+        fragment.kind = fragment_kind::bookmark;
+    }
+
+    const int rate_adj = std::atoi(fields[1].c_str());
+    const int pitch_adj = std::atoi(fields[3].c_str());
+    fragment.rate = std::clamp(rate_adj, -10, 10) * 10;
+    fragment.volume = std::clamp(std::atoi(fields[2].c_str()), 0, 100);
+    fragment.pitch = 50 + std::clamp(pitch_adj * 2, -50, 50);
+    fragment.silence_ms = std::strtoul(fields[4].c_str(), nullptr, 10);
+
+    call.texts.push_back(utf8ToUtf16(line.substr(start)));
+    call.fragments.push_back(fragment);
+    return true;
+}
+
+std::vector<Call> parseLog(std::istream& in) {
+    std::vector<Call> calls(1);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            if (!calls.back().fragments.empty()) {
+                calls.emplace_back();
+            }
+        } else if (!parseLine(line, calls.back())) {
+            std::fprintf(stderr, "skipping malformed line: %s\n", line.c_str());
+        }
+    }
+    if (calls.back().fragments.empty()) {
+        calls.pop_back();
+    }
+    // Views are taken once the text storage stops moving.
+    for (Call& call : calls) {
+        for (std::size_t i = 0; i < call.fragments.size(); ++i) {
+            call.fragments[i].text = call.texts[i];
+        }
+    }
+    return calls;
+}
+
+Totals run(const std::vector<Call>& calls, bool merge, bool synthesize) {
+    Espeak::sapi::plan_options options;
+    options.merge = merge;
+
+    Totals totals;
+    std::vector<synth_unit> units;
+    for (const Call& call : calls) {
+        Espeak::sapi::plan_fragments(call.fragments, options, units);
+        totals.units += units.size();
+        for (const synth_unit& unit : units) {
+            if (unit.spoken.empty()) {
+                continue;
+            }
+            ++totals.synth_calls;
+            if (!synthesize) {
+                continue;
+            }
+            const plan_fragment& base = call.fragments[unit.base];
+            const auto started = std::chrono::steady_clock::now();
+            [[maybe_unused]] const bool ok = Espeak::EspeakEngine::getInstance().speak(
+                std::u16string_view(unit.text), base.rate, base.pitch, base.volume, 50, 0, false,
+                [&totals](const short*, int sample_count, void*) {
+                    totals.samples += sample_count;
+                    return true;
+                },
+                nullptr, nullptr,
+                unit.ssml ? Espeak::TextFormat::Ssml
+                          : unit.spell ? Espeak::TextFormat::Characters : Espeak::TextFormat::Plain);
+            totals.synth_ms += std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - started).count();
+        }
+    }
+    return totals;
+}
+
+void report(const char* label, const Totals& totals, bool synthesize, int sample_rate) {
+    std::printf("%-8s units %5zu  synth calls %5zu", label, totals.units, totals.synth_calls);
+    if (synthesize && sample_rate > 0) {
+        std::printf("  audio %9.1f ms  synth %8.1f ms",
+                    1000.0 * static_cast<double>(totals.samples) / sample_rate, totals.synth_ms);
+    }
+    std::printf("\n");
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::vector<Call> calls;
+    if (options.log_path) {
+        std::ifstream file(options.log_path);
+        if (!file.is_open()) {
+            std::fprintf(stderr, "cannot open %s\n", options.log_path);
+            return 1;
+        }
+        calls = parseLog(file);
+    } else {
+        std::istringstream builtin(BUILTIN_LOG);
+        calls = parseLog(builtin);
+    }
+
+    int sample_rate = 0;
+    if (options.synthesize) {
+        Espeak::EspeakEngine& engine = Espeak::EspeakEngine::getInstance();
+        if (!engine.initialize()) {
+            std::fprintf(stderr, "espeak-ng failed to initialize; reporting plan only\n");
+            options.synthesize = false;
+        } else {
+            engine.configureCache(0, false);
+            sample_rate = engine.sampleRate();
+        }
+    }
+
+    std::size_t fragments = 0;
+    for (const Call& call : calls) {
+        fragments += call.fragments.size();
+    }
+    std::printf("%zu Speak calls, %zu fragments\n", calls.size(), fragments);
+
+    const Totals separate = run(calls, false, options.synthesize);
+    const Totals merged = run(calls, true, options.synthesize);
+    report("separate", separate, options.synthesize, sample_rate);
+    report("merged", merged, options.synthesize, sample_rate);
+    if (separate.synth_calls > 0) {
+        std::printf("synth calls reduced by %.1f%%\n",
+                    100.0 * (1.0 - static_cast<double>(merged.synth_calls) / separate.synth_calls));
+    }
+    return 0;
+}
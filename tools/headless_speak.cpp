@@ -0,0 +1,191 @@
+#include "config_manager.hpp"
+#include "espeak_wrapper.h"
+#include "mock_speak_site.hpp"
+#include "speak_session.hpp"
+#include "speak_timeline.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Runs the Speak path against mock_speak_site, without SAPI or COM, and reports
+// what a real output site would have received: bytes, write calls, events and
+// the time to the first write. Optionally writes the audio as raw PCM and the
+// span timeline of the call as a Chrome trace.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::string text = "The quick brown fox jumps over the lazy dog. Press Control plus N.";
+    std::string voice;
+    std::string output;
+    std::string timeline;
+    long rate = 0;
+    std::size_t abort_after = 0;
+    std::size_t rate_change_after = 0;
+    long rate_change = 0;
+    std::size_t write_limit = 0;
+    bool spell = false;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--text TEXT] [--voice ID] [--rate N] [--spell] [--abort-after BYTES]\n"
+                 "          [--rate-change-after BYTES N] [--write-limit BYTES] [--output FILE]\n"
+                 "          [--timeline FILE]\n",
+                 argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--text") == 0 && i + 1 < argc) {
+            options.text = argv[++i];
+        } else if (std::strcmp(argv[i], "--voice") == 0 && i + 1 < argc) {
+            options.voice = argv[++i];
+        } else if (std::strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            options.rate = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--spell") == 0) {
+            options.spell = true;
+        } else if (std::strcmp(argv[i], "--abort-after") == 0 && i + 1 < argc) {
+            options.abort_after = static_cast<std::size_t>(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--rate-change-after") == 0 && i + 2 < argc) {
+            options.rate_change_after = static_cast<std::size_t>(std::atol(argv[++i]));
+            options.rate_change = std::atol(argv[++i]);
+        } else if (std::strcmp(argv[i], "--write-limit") == 0 && i + 1 < argc) {
+            options.write_limit = static_cast<std::size_t>(std::atol(argv[++i]));
+        } else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) {
+            options.output = argv[++i];
+        } else if (std::strcmp(argv[i], "--timeline") == 0 && i + 1 < argc) {
+            options.timeline = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::u16string utf8ToUtf16(const std::string& text) {
+    std::u16string out;
+    for (std::size_t i = 0; i < text.size();) {
+        const unsigned char lead = static_cast<unsigned char>(text[i]);
+        char32_t code_point = lead;
+        std::size_t extra = 0;
+        if (lead >= 0xF0) {
+            code_point = lead & 0x07;
+            extra = 3;
+        } else if (lead >= 0xE0) {
+            code_point = lead & 0x0F;
+            extra = 2;
+        } else if (lead >= 0xC0) {
+            code_point = lead & 0x1F;
+            extra = 1;
+        }
+        ++i;
+        for (; extra > 0 && i < text.size(); --extra, ++i) {
+            code_point = (code_point << 6) | (static_cast<unsigned char>(text[i]) & 0x3F);
+        }
+        if (code_point >= 0x10000) {
+            code_point -= 0x10000;
+            out.push_back(static_cast<char16_t>(0xD800 + (code_point >> 10)));
+            out.push_back(static_cast<char16_t>(0xDC00 + (code_point & 0x3FF)));
+        } else {
+            out.push_back(static_cast<char16_t>(code_point));
+        }
+    }
+    return out;
+}
+
+const char* eventName(Espeak::sapi::site_event_type type) {
+    switch (type) {
+        case Espeak::sapi::site_event_type::word_boundary:
+            return "word";
+        case Espeak::sapi::site_event_type::sentence_boundary:
+            return "sentence";
+        case Espeak::sapi::site_event_type::bookmark:
+            return "bookmark";
+    }
+    return "?";
+}
+}
+
+int main(int argc, char** argv) {
+    using namespace Espeak::sapi;
+
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (!Espeak::EspeakEngine::getInstance().initialize()) {
+        std::fprintf(stderr, "espeak-ng failed to initialize\n");
+        return 1;
+    }
+
+    const std::u16string text = utf8ToUtf16(options.text);
+    Espeak::Timeline::instance().enable(!options.timeline.empty());
+
+    speak_fragment fragment;
+    fragment.kind = options.spell ? fragment_kind::spell_out : fragment_kind::speak;
+    fragment.text = text;
+
+    speak_options speak;
+    speak.format = native_format();
+    speak.voice = options.voice;
+    speak.word_events = true;
+    speak.sentence_events = true;
+
+    mock_speak_site site;
+    site.set_rate(options.rate);
+    site.abort_after(options.abort_after);
+    site.set_write_limit(options.write_limit);
+
+    const Clock::time_point started = Clock::now();
+    Clock::time_point first_write;
+    site.on_write = [&](mock_speak_site& s, std::size_t total) {
+        if (s.write_calls() == 1) {
+            first_write = Clock::now();
+        }
+        if (options.rate_change_after > 0 && total >= options.rate_change_after) {
+            s.set_rate(options.rate_change);
+            options.rate_change_after = 0;
+        }
+    };
+
+    speak_session session;
+    const Espeak::config::ConfigSnapshot cfg = Espeak::config::ConfigManager::getInstance().snapshot();
+    const bool ok = session.speak(site, {fragment}, speak, *cfg);
+    const double total_ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+
+    const double bytes_per_ms = speak.format.sample_rate * 2 / 1000.0;
+    std::printf("%s: %zu bytes (%.1f ms audio) in %zu writes, %zu events, %.1f ms\n",
+                ok ? "ok" : "failed", site.audio().size(), site.audio().size() / bytes_per_ms,
+                site.write_calls(), site.events().size(), total_ms);
+    if (site.write_calls() > 0) {
+        std::printf("first write after %.1f ms\n",
+                    std::chrono::duration<double, std::milli>(first_write - started).count());
+    }
+    for (const mock_speak_site::recorded_event& event : site.events()) {
+        std::printf("  %-8s @%8llu  source %u+%u\n", eventName(event.type),
+                    static_cast<unsigned long long>(event.offset), event.source_start, event.source_length);
+    }
+
+    if (!options.output.empty()) {
+        FILE* file = std::fopen(options.output.c_str(), "wb");
+        if (!file) {
+            std::fprintf(stderr, "cannot open %s\n", options.output.c_str());
+            return 1;
+        }
+        std::fwrite(site.audio().data(), 1, site.audio().size(), file);
+        std::fclose(file);
+    }
+    if (!options.timeline.empty() && !Espeak::Timeline::instance().dump(options.timeline)) {
+        std::fprintf(stderr, "cannot write %s\n", options.timeline.c_str());
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
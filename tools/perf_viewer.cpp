@@ -0,0 +1,241 @@
+#include "perf_counters.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Attaches to the performance counters published by running engine processes
+// and prints their rates every interval. Without pids it follows every process
+// of this user that publishes counters. The first sample of a process shows
+// its averages since it started. With --timeline it instead asks each process
+// to write out its span timeline, which it does at the end of its next Speak
+// call if "speak_timeline" is on. The cold-start stages of a process, timed
+// from DLL attach, are printed below the table when it is first seen.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Espeak::PerfCounter;
+using Espeak::PerfCounters;
+using Espeak::PerfHistogram;
+using Espeak::PerfStage;
+
+struct Options {
+    std::vector<std::uint32_t> pids;
+    int interval_ms = 1000;
+    int count = 0;
+    bool timeline = false;
+};
+
+struct Sample {
+    Clock::time_point at;
+    std::uint64_t counters[Espeak::PERF_COUNTER_COUNT] = {};
+};
+
+struct Attached {
+    std::unique_ptr<PerfCounters> counters;
+    Sample last;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--interval MS] [--count N] [PID...]\n"
+                 "       %s --timeline [PID...]\n",
+                 argv0, argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--interval") == 0 && i + 1 < argc) {
+            options.interval_ms = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            options.count = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--timeline") == 0) {
+            options.timeline = true;
+        } else if (argv[i][0] == '-') {
+            return false;
+        } else {
+            char* end = nullptr;
+            const unsigned long pid = std::strtoul(argv[i], &end, 10);
+            if (*end != '\0' || pid == 0) {
+                return false;
+            }
+            options.pids.push_back(static_cast<std::uint32_t>(pid));
+        }
+    }
+    return options.interval_ms > 0 && options.count >= 0;
+}
+
+Sample sample(const PerfCounters& counters) {
+    Sample out;
+    out.at = Clock::now();
+    for (std::size_t i = 0; i < Espeak::PERF_COUNTER_COUNT; ++i) {
+        out.counters[i] = counters.get(static_cast<PerfCounter>(i));
+    }
+    return out;
+}
+
+std::uint64_t delta(const Sample& now, const Sample& last, PerfCounter counter) {
+    const auto i = static_cast<std::size_t>(counter);
+    return now.counters[i] >= last.counters[i] ? now.counters[i] - last.counters[i] : 0;
+}
+
+// Upper bound of the bucket holding the percentile, as text.
+std::string percentile(const PerfCounters& counters, PerfHistogram histogram, double p) {
+    const auto buckets = counters.histogram(histogram);
+    std::uint64_t total = 0;
+    for (const std::uint64_t n : buckets) {
+        total += n;
+    }
+    if (total == 0) {
+        return "-";
+    }
+    const double target = p * static_cast<double>(total);
+    std::uint64_t seen = 0;
+    for (std::size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (static_cast<double>(seen) >= target) {
+            char text[16];
+            if (i + 1 < buckets.size()) {
+                std::snprintf(text, sizeof(text), "<%g", PerfCounters::bucketLimit(i));
+            } else {
+                std::snprintf(text, sizeof(text), ">%g", PerfCounters::bucketLimit(i - 1));
+            }
+            return text;
+        }
+    }
+    return "-";
+}
+
+double hitRate(std::uint64_t hits, std::uint64_t misses) {
+    return hits + misses > 0 ? 100.0 * static_cast<double>(hits) / static_cast<double>(hits + misses) : 0.0;
+}
+
+int requestTimelines(const std::vector<std::uint32_t>& pids) {
+    int failures = 0;
+    for (const std::uint32_t pid : pids) {
+        PerfCounters counters(pid, true);
+        if (counters.requestTimeline()) {
+            std::printf("%8u  timeline requested\n", pid);
+        } else {
+            std::printf("%8u  not publishing counters\n", pid);
+            ++failures;
+        }
+    }
+    return failures == 0 ? 0 : 1;
+}
+
+void printColdStart(std::uint32_t pid, const PerfCounters& counters) {
+    std::string stages;
+    for (std::size_t i = 0; i < Espeak::PERF_STAGE_COUNT; ++i) {
+        const auto stage = static_cast<PerfStage>(i);
+        const std::uint64_t us = counters.stage(stage);
+        if (us == 0) {
+            continue;
+        }
+        char text[64];
+        std::snprintf(text, sizeof(text), "%s%s %.1f", stages.empty() ? "" : ", ", PerfCounters::name(stage),
+                      static_cast<double>(us) / 1000.0);
+        stages += text;
+    }
+    if (!stages.empty()) {
+        std::printf("%8u  cold start ms after attach: %s\n", pid, stages.c_str());
+    }
+}
+
+void printHeader() {
+    std::printf("%8s %8s %8s %10s %10s %10s %6s %6s %6s %6s %7s %7s %7s %7s\n",
+                "pid", "calls/s", "frags/s", "KB/s", "synth ms/s", "block ms/s", "aborts", "voices",
+                "cache%", "table%", "ttfa50", "ttfa95", "abrt50", "abrt95");
+}
+
+void printRow(std::uint32_t pid, const PerfCounters& counters, const Sample& now, const Sample& last) {
+    const double seconds = std::chrono::duration<double>(now.at - last.at).count();
+    const auto rate = [&](PerfCounter counter) {
+        return seconds > 0.0 ? static_cast<double>(delta(now, last, counter)) / seconds : 0.0;
+    };
+    const auto total = [&](PerfCounter counter) {
+        return now.counters[static_cast<std::size_t>(counter)];
+    };
+
+    std::printf("%8u %8.2f %8.2f %10.1f %10.1f %10.1f %6llu %6llu %6.1f %6.1f %7s %7s %7s %7s\n",
+                pid, rate(PerfCounter::SpeakCalls), rate(PerfCounter::Fragments),
+                rate(PerfCounter::BytesProduced) / 1024.0, rate(PerfCounter::SynthMicroseconds) / 1000.0,
+                rate(PerfCounter::WriteBlockedMicroseconds) / 1000.0,
+                static_cast<unsigned long long>(total(PerfCounter::Aborts)),
+                static_cast<unsigned long long>(total(PerfCounter::VoiceSwitches)),
+                hitRate(total(PerfCounter::CacheHits), total(PerfCounter::CacheMisses)),
+                hitRate(total(PerfCounter::TableHits), total(PerfCounter::TableMisses)),
+                percentile(counters, PerfHistogram::FirstAudio, 0.5).c_str(),
+                percentile(counters, PerfHistogram::FirstAudio, 0.95).c_str(),
+                percentile(counters, PerfHistogram::AbortLatency, 0.5).c_str(),
+                percentile(counters, PerfHistogram::AbortLatency, 0.95).c_str());
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (options.timeline) {
+        return requestTimelines(options.pids.empty() ? PerfCounters::processes() : options.pids);
+    }
+
+    std::map<std::uint32_t, Attached> attached;
+    for (int tick = 0; options.count == 0 || tick < options.count; ++tick) {
+        if (tick > 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.interval_ms));
+        }
+
+        const std::vector<std::uint32_t> pids = options.pids.empty() ? PerfCounters::processes() : options.pids;
+        for (auto it = attached.begin(); it != attached.end();) {
+            it = std::find(pids.begin(), pids.end(), it->first) == pids.end() ? attached.erase(it) : std::next(it);
+        }
+
+        const std::time_t now = std::time(nullptr);
+        char stamp[32];
+        std::strftime(stamp, sizeof(stamp), "%H:%M:%S", std::localtime(&now));
+        std::printf("%s  %zu process(es), rates per second, latencies in ms\n", stamp, pids.size());
+        printHeader();
+
+        std::vector<std::uint32_t> first_seen;
+        for (const std::uint32_t pid : pids) {
+            auto found = attached.find(pid);
+            if (found == attached.end()) {
+                auto counters = std::make_unique<PerfCounters>(pid);
+                if (!counters->isOpen()) {
+                    std::printf("%8u  not publishing counters\n", pid);
+                    continue;
+                }
+                // Averages since the process started on first sight.
+                Sample start;
+                const auto uptime = static_cast<std::int64_t>(now) - static_cast<std::int64_t>(counters->startedUnix());
+                start.at = Clock::now() - std::chrono::seconds(uptime > 0 ? uptime : 0);
+                found = attached.emplace(pid, Attached{std::move(counters), start}).first;
+                first_seen.push_back(pid);
+            }
+
+            Attached& process = found->second;
+            const Sample current = sample(*process.counters);
+            printRow(pid, *process.counters, current, process.last);
+            process.last = current;
+        }
+        for (const std::uint32_t pid : first_seen) {
+            printColdStart(pid, *attached[pid].counters);
+        }
+        std::printf("\n");
+        std::fflush(stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,150 @@
+#include "espeak_wrapper.h"
+#include "resampler.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Synthesizes a paragraph once, then streams it through the output resampler
+// in synthesis-sized blocks for each target rate, sample type and dot-product
+// kernel, and reports the CPU cost per second of input audio. The scalar
+// kernel is the portable baseline the SIMD kernels replace.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using Espeak::Resampler;
+using Espeak::ResamplerKernel;
+using Espeak::SampleFormat;
+
+const char* const SAMPLE_TEXT =
+    "Applications that play speech at sixteen, forty-four or forty-eight kilohertz used to get a converter "
+    "inserted by SAPI in front of every stream. The engine now produces the rate the client asks for itself, "
+    "so the cost of that conversion moves onto the synthesis thread and has to stay small.";
+
+struct Options {
+    std::vector<int> rates{8000, 16000, 44100, 48000};
+    int taps = Resampler::DEFAULT_TAPS;
+    int block_ms = 20;
+    int iterations = 20;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s [--rates HZ,HZ,...] [--taps N] [--block MS] [--iterations N]\n", argv0);
+}
+
+bool parseRates(const char* list, std::vector<int>& rates) {
+    rates.clear();
+    for (const char* p = list; *p;) {
+        char* end = nullptr;
+        const long value = std::strtol(p, &end, 10);
+        if (end == p || value < Resampler::MIN_RATE || value > Resampler::MAX_RATE) {
+            return false;
+        }
+        rates.push_back(static_cast<int>(value));
+        p = *end == ',' ? end + 1 : end;
+    }
+    return !rates.empty();
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--rates") == 0 && i + 1 < argc) {
+            if (!parseRates(argv[++i], options.rates)) {
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--taps") == 0 && i + 1 < argc) {
+            options.taps = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--block") == 0 && i + 1 < argc) {
+            options.block_ms = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = std::atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return options.taps > 0 && options.block_ms > 0 && options.iterations > 0;
+}
+
+std::vector<ResamplerKernel> kernels() {
+    std::vector<ResamplerKernel> list{ResamplerKernel::Scalar};
+    const ResamplerKernel best = Resampler::bestKernel();
+    if (best == ResamplerKernel::Sse2 || best == ResamplerKernel::Avx2) {
+        list.push_back(ResamplerKernel::Sse2);
+    }
+    if (best == ResamplerKernel::Avx2) {
+        list.push_back(ResamplerKernel::Avx2);
+    }
+    return list;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    Espeak::EspeakEngine& engine = Espeak::EspeakEngine::getInstance();
+    if (!engine.initialize()) {
+        std::fprintf(stderr, "espeak-ng failed to initialize\n");
+        return 1;
+    }
+    engine.configureCache(0, false);
+
+    std::vector<short> speech;
+    [[maybe_unused]] const bool ok = engine.speak(SAMPLE_TEXT, 0, 50, 100, 50, 0, false,
+        [&](const short* audio, int sample_count, void*) {
+            speech.insert(speech.end(), audio, audio + sample_count);
+            return true;
+        },
+        nullptr);
+    if (speech.empty()) {
+        std::fprintf(stderr, "synthesis produced no audio\n");
+        return 1;
+    }
+
+    const int sample_rate = engine.sampleRate();
+    const double input_seconds = static_cast<double>(speech.size()) / sample_rate;
+    const std::size_t block = static_cast<std::size_t>(sample_rate) * static_cast<std::size_t>(options.block_ms) / 1000;
+    std::printf("%.2f s of speech at %d Hz, %d taps per phase, %d ms blocks, %d iterations\n",
+                input_seconds, sample_rate, options.taps, options.block_ms, options.iterations);
+    std::printf("%7s %-7s %-7s %14s %12s %10s\n", "rate", "format", "kernel", "cpu ms/audio s", "realtime x",
+                "vs scalar");
+
+    const SampleFormat formats[] = {SampleFormat::Pcm16, SampleFormat::Float32};
+    std::vector<std::uint8_t> out;
+    for (const int rate : options.rates) {
+        for (const SampleFormat format : formats) {
+            double scalar_cost = 0.0;
+            for (const ResamplerKernel kernel : kernels()) {
+                Resampler resampler(sample_rate, rate, format, options.taps, kernel);
+                const Clock::time_point started = Clock::now();
+                for (int i = 0; i < options.iterations; ++i) {
+                    resampler.reset();
+                    for (std::size_t offset = 0; offset < speech.size(); offset += block) {
+                        out.clear();
+                        resampler.process(speech.data() + offset,
+                                          static_cast<int>((std::min)(block, speech.size() - offset)), out);
+                    }
+                    out.clear();
+                    resampler.flush(out);
+                }
+                const double elapsed_ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+                const double cost = elapsed_ms / (input_seconds * options.iterations);
+                if (kernel == ResamplerKernel::Scalar) {
+                    scalar_cost = cost;
+                }
+                std::printf("%7d %-7s %-7s %14.3f %12.0f %9.2fx\n", rate,
+                            format == SampleFormat::Float32 ? "float32" : "pcm16",
+                            Resampler::kernelName(resampler.kernel()), cost, cost > 0.0 ? 1000.0 / cost : 0.0,
+                            cost > 0.0 ? scalar_cost / cost : 0.0);
+            }
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,164 @@
+#include "config_image.hpp"
+#include "shared_config.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::size_t writers = 2;
+    std::size_t readers = 6;
+    std::size_t publishes = 20000;
+    std::string name = Espeak::config::SharedConfigRegion::defaultName() + ".stress";
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s [--writers N] [--readers N] [--publishes N] [--name NAME]\n", argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            return false;
+        }
+        if (std::strcmp(arg, "--writers") == 0) {
+            options.writers = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--readers") == 0) {
+            options.readers = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--publishes") == 0) {
+            options.publishes = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--name") == 0) {
+            options.name = value;
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return options.writers > 0 && options.readers > 0;
+}
+
+Espeak::config::Configuration makeConfig(int value) {
+    Espeak::config::Configuration config;
+    config.intonation = value;
+    config.wordgap = value;
+    for (int i = 0; i < value % 7; ++i) {
+        config.enabled_voices.push_back("voice-" + std::to_string(value));
+    }
+    return config;
+}
+
+bool consistent(const Espeak::config::Configuration& config) {
+    if (config.intonation != config.wordgap ||
+        config.enabled_voices.size() != static_cast<std::size_t>(config.intonation % 7)) {
+        return false;
+    }
+    const std::string expected = "voice-" + std::to_string(config.intonation);
+    for (const auto& voice : config.enabled_voices) {
+        if (voice != expected) {
+            return false;
+        }
+    }
+    return true;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    using clock = std::chrono::steady_clock;
+
+    Espeak::config::SharedConfigRegion::remove(options.name);
+
+    std::atomic<std::size_t> writers_left(options.writers);
+    std::atomic<std::size_t> publish_failures(0);
+    std::atomic<std::size_t> reads(0);
+    std::atomic<std::size_t> read_retries(0);
+    std::atomic<std::size_t> torn(0);
+    std::atomic<std::size_t> open_failures(0);
+    std::atomic<std::uint64_t> generation_checks(0);
+
+    const auto started = clock::now();
+    std::vector<std::thread> threads;
+    for (std::size_t w = 0; w < options.writers; ++w) {
+        threads.emplace_back([&, w]() {
+            Espeak::config::SharedConfigRegion region(options.name);
+            if (!region.isOpen()) {
+                open_failures.fetch_add(1);
+            } else {
+                std::vector<std::uint8_t> image;
+                for (std::size_t i = 0; i < options.publishes; ++i) {
+                    const int value = static_cast<int>((i * options.writers + w) % 100);
+                    Espeak::config::encodeConfigImage(makeConfig(value), i, image);
+                    if (region.publish(image) == 0) {
+                        publish_failures.fetch_add(1);
+                    }
+                    std::this_thread::yield();
+                }
+            }
+            writers_left.fetch_sub(1);
+        });
+    }
+    for (std::size_t r = 0; r < options.readers; ++r) {
+        threads.emplace_back([&]() {
+            Espeak::config::SharedConfigRegion region(options.name);
+            if (!region.isOpen()) {
+                open_failures.fetch_add(1);
+                return;
+            }
+            std::uint64_t seen = 0;
+            std::uint64_t checks = 0;
+            std::vector<std::uint8_t> image;
+            while (writers_left.load() > 0) {
+                ++checks;
+                const std::uint64_t generation = region.generation();
+                if (generation == seen) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                std::uint64_t read_generation = 0;
+                Espeak::config::Configuration config;
+                std::uint64_t stamp = 0;
+                if (!region.read(image, read_generation)) {
+                    read_retries.fetch_add(1);
+                    continue;
+                }
+                if (!Espeak::config::decodeConfigImage(image.data(), image.size(), config, stamp) ||
+                    !consistent(config)) {
+                    torn.fetch_add(1);
+                }
+                reads.fetch_add(1);
+                seen = read_generation;
+            }
+            generation_checks.fetch_add(checks);
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    const double elapsed_s = std::chrono::duration<double>(clock::now() - started).count();
+
+    Espeak::config::SharedConfigRegion region(options.name);
+    std::printf("writers=%zu readers=%zu publishes=%zu\n", options.writers, options.readers, options.publishes);
+    std::printf("elapsed %.3f s, final generation %llu\n",
+                elapsed_s, static_cast<unsigned long long>(region.generation()));
+    std::printf("reads %zu, read retries %zu, generation checks %llu\n",
+                reads.load(), read_retries.load(), static_cast<unsigned long long>(generation_checks.load()));
+    std::printf("torn %zu, publish failures %zu, open failures %zu\n",
+                torn.load(), publish_failures.load(), open_failures.load());
+
+    Espeak::config::SharedConfigRegion::remove(options.name);
+    return torn.load() == 0 && open_failures.load() == 0 ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include "espeak_wrapper.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Speaks short utterances with and without silence trimming and reports the
+// time to first audible audio: how much audio precedes the first sample above
+// the threshold, and how long after the call that sample reaches the sink.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const PHRASES[] = {
+    "OK",
+    "button",
+    "Edit, has autocomplete",
+    "heading level 2, Release notes",
+    "The quick brown fox jumps over the lazy dog.",
+    "Press Control plus Shift plus N to open a new window.",
+};
+
+struct Options {
+    int threshold = 64;
+    int lookahead_ms = 5;
+    int max_gap_ms = 300;
+    int iterations = 10;
+};
+
+struct Measurement {
+    double leading_ms = 0.0;
+    double trailing_ms = 0.0;
+    double audio_ms = 0.0;
+    double first_audible_ms = 0.0;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s [--threshold N] [--lookahead MS] [--max-gap MS] [--iterations N]\n", argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            options.threshold = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--lookahead") == 0 && i + 1 < argc) {
+            options.lookahead_ms = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--max-gap") == 0 && i + 1 < argc) {
+            options.max_gap_ms = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = std::atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return options.iterations > 0;
+}
+
+Measurement measure(Espeak::EspeakEngine& engine, const std::string& text, int threshold) {
+    const double sample_rate = engine.sampleRate();
+    long long samples = 0;
+    long long first_audible = -1;
+    long long last_audible = -1;
+    Clock::time_point first_audible_at;
+
+    const Clock::time_point started = Clock::now();
+    [[maybe_unused]] const bool ok = engine.speak(text, 0, 50, 100, 50, 0, false,
+        [&](const short* audio, int sample_count, void*) {
+            for (int i = 0; i < sample_count; ++i) {
+                if (std::abs(static_cast<int>(audio[i])) > threshold) {
+                    if (first_audible < 0) {
+                        first_audible = samples + i;
+                        first_audible_at = Clock::now();
+                    }
+                    last_audible = samples + i;
+                }
+            }
+            samples += sample_count;
+            return true;
+        },
+        nullptr);
+
+    Measurement result;
+    result.audio_ms = 1000.0 * static_cast<double>(samples) / sample_rate;
+    if (first_audible >= 0) {
+        result.leading_ms = 1000.0 * static_cast<double>(first_audible) / sample_rate;
+        result.trailing_ms = 1000.0 * static_cast<double>(samples - last_audible - 1) / sample_rate;
+        // The sample is heard once it has been synthesized and everything before it has played.
+        const double delivered_ms = std::chrono::duration<double, std::milli>(first_audible_at - started).count();
+        result.first_audible_ms = delivered_ms + result.leading_ms;
+    }
+    return result;
+}
+
+Measurement run(Espeak::EspeakEngine& engine, const Options& options, bool trim) {
+    engine.configureSilenceTrim(trim, options.threshold, options.lookahead_ms, options.max_gap_ms);
+
+    Measurement total;
+    int count = 0;
+    for (int i = 0; i < options.iterations; ++i) {
+        for (const char* phrase : PHRASES) {
+            const Measurement m = measure(engine, phrase, options.threshold);
+            total.leading_ms += m.leading_ms;
+            total.trailing_ms += m.trailing_ms;
+            total.audio_ms += m.audio_ms;
+            total.first_audible_ms += m.first_audible_ms;
+            ++count;
+        }
+    }
+    total.leading_ms /= count;
+    total.trailing_ms /= count;
+    total.audio_ms /= count;
+    total.first_audible_ms /= count;
+    return total;
+}
+
+void report(const char* label, const Measurement& m) {
+    std::printf("%-9s leading %7.1f ms  trailing %7.1f ms  audio %8.1f ms  first audible %7.1f ms\n",
+                label, m.leading_ms, m.trailing_ms, m.audio_ms, m.first_audible_ms);
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    Espeak::EspeakEngine& engine = Espeak::EspeakEngine::getInstance();
+    if (!engine.initialize()) {
+        std::fprintf(stderr, "espeak-ng failed to initialize\n");
+        return 1;
+    }
+    engine.configureCache(0, false);
+
+    std::printf("%zu phrases x %d iterations, threshold %d, lookahead %d ms, max gap %d ms\n",
+                sizeof(PHRASES) / sizeof(PHRASES[0]), options.iterations, options.threshold,
+                options.lookahead_ms, options.max_gap_ms);
+
+    const Measurement untrimmed = run(engine, options, false);
+    const Measurement trimmed = run(engine, options, true);
+    report("untrimmed", untrimmed);
+    report("trimmed", trimmed);
+    std::printf("time to first audible audio improved by %.1f ms (%.1f%%)\n",
+                untrimmed.first_audible_ms - trimmed.first_audible_ms,
+                untrimmed.first_audible_ms > 0.0
+                    ? 100.0 * (1.0 - trimmed.first_audible_ms / untrimmed.first_audible_ms) : 0.0);
+    return 0;
+}
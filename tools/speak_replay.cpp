@@ -0,0 +1,217 @@
+#include "config_manager.hpp"
+#include "espeak_wrapper.h"
+#include "mock_speak_site.hpp"
+#include "speak_session.hpp"
+#include "speak_timeline.hpp"
+#include "speak_trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Feeds speak traces recorded with "speak_trace" back through the Speak path
+// against a mock site, raising the recorded aborts, skips and rate and volume
+// changes at their recorded offsets into each call. Calls run back to back, or
+// at their recorded start times with --speed recorded. Reports per-call time
+// to first audio and total time next to the recorded duration. --timeline
+// writes the spans of the replay as a Chrome trace.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+    std::vector<std::string> traces;
+    std::string timeline;
+    bool recorded_speed = false;
+    bool quiet = false;
+    int iterations = 1;
+};
+
+struct CallResult {
+    double first_audio_ms = -1.0;
+    double total_ms = 0.0;
+    double recorded_ms = 0.0;
+    std::size_t bytes = 0;
+    std::size_t writes = 0;
+    bool ok = true;
+};
+
+// A mock site that raises the actions of a recorded call as time passes.
+class replay_site : public Espeak::sapi::mock_speak_site
+{
+public:
+    explicit replay_site(const std::vector<Espeak::sapi::trace_action>& script)
+        : script_(script)
+        , started_(Clock::now())
+    {}
+
+    unsigned actions() override
+    {
+        using namespace Espeak::sapi;
+        const auto now_us = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - started_).count();
+        for (; next_ < script_.size() && script_[next_].at_us <= now_us; ++next_) {
+            const trace_action& action = script_[next_];
+            if (action.flags & SITE_ACTION_RATE) {
+                set_rate(action.rate);
+            }
+            if (action.flags & SITE_ACTION_VOLUME) {
+                set_volume(action.volume);
+            }
+            if (action.flags & SITE_ACTION_SKIP) {
+                skip();
+            }
+            if (action.flags & SITE_ACTION_ABORT) {
+                abort();
+            }
+        }
+        return mock_speak_site::actions();
+    }
+
+private:
+    const std::vector<Espeak::sapi::trace_action>& script_;
+    Clock::time_point started_;
+    std::size_t next_ = 0;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--speed recorded|max] [--iterations N] [--quiet] [--timeline FILE]\n"
+                 "          TRACE...\n",
+                 argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--speed") == 0 && i + 1 < argc) {
+            options.recorded_speed = std::strcmp(argv[++i], "recorded") == 0;
+        } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--quiet") == 0) {
+            options.quiet = true;
+        } else if (std::strcmp(argv[i], "--timeline") == 0 && i + 1 < argc) {
+            options.timeline = argv[++i];
+        } else if (argv[i][0] == '-') {
+            return false;
+        } else {
+            options.traces.emplace_back(argv[i]);
+        }
+    }
+    return !options.traces.empty() && options.iterations > 0;
+}
+
+CallResult replay(Espeak::sapi::speak_session& session, const Espeak::sapi::trace_call& call,
+                  const Espeak::config::Configuration& cfg) {
+    replay_site site(call.actions);
+    site.set_initial(call.rate, call.volume);
+
+    CallResult result;
+    Clock::time_point first_audio;
+    site.on_write = [&](Espeak::sapi::mock_speak_site& s, std::size_t) {
+        if (s.write_calls() == 1) {
+            first_audio = Clock::now();
+        }
+    };
+
+    const std::vector<Espeak::sapi::speak_fragment> fragments = call.speak_fragments();
+    const Clock::time_point started = Clock::now();
+    result.ok = session.speak(site, fragments, call.options(), cfg);
+    result.total_ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+    result.recorded_ms = call.duration_us / 1000.0;
+    result.bytes = site.audio().size();
+    result.writes = site.write_calls();
+    if (result.writes > 0) {
+        result.first_audio_ms = std::chrono::duration<double, std::milli>(first_audio - started).count();
+    }
+    return result;
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    return values[static_cast<std::size_t>(p * static_cast<double>(values.size() - 1) + 0.5)];
+}
+
+void summarize(const char* label, const std::vector<double>& values) {
+    std::printf("%-16s p50 %8.2f ms  p95 %8.2f ms  max %8.2f ms\n", label, percentile(values, 0.5),
+                percentile(values, 0.95), values.empty() ? 0.0 : *std::max_element(values.begin(), values.end()));
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (!Espeak::EspeakEngine::getInstance().initialize()) {
+        std::fprintf(stderr, "espeak-ng failed to initialize\n");
+        return 1;
+    }
+
+    const Espeak::config::ConfigSnapshot cfg = Espeak::config::ConfigManager::getInstance().snapshot();
+    Espeak::sapi::speak_session session;
+    Espeak::Timeline::instance().enable(!options.timeline.empty());
+
+    std::vector<double> first_audio;
+    std::vector<double> total;
+    std::vector<double> recorded;
+    std::size_t failures = 0;
+
+    for (const std::string& path : options.traces) {
+        std::vector<Espeak::sapi::trace_call> calls;
+        if (!Espeak::sapi::read_trace(path, calls)) {
+            std::fprintf(stderr, "cannot read trace %s\n", path.c_str());
+            return 1;
+        }
+        std::printf("%s: %zu calls\n", path.c_str(), calls.size());
+        if (!options.quiet) {
+            std::printf("%6s %6s %6s %7s %12s %10s %11s %10s\n",
+                        "call", "frags", "chars", "actions", "first audio", "total", "recorded", "bytes");
+        }
+
+        for (int iteration = 0; iteration < options.iterations; ++iteration) {
+            const Clock::time_point replay_started = Clock::now();
+            for (std::size_t i = 0; i < calls.size(); ++i) {
+                const Espeak::sapi::trace_call& call = calls[i];
+                if (options.recorded_speed) {
+                    std::this_thread::sleep_until(replay_started + std::chrono::milliseconds(call.start_ms));
+                }
+
+                const CallResult result = replay(session, call, *cfg);
+                std::size_t chars = 0;
+                for (const Espeak::sapi::trace_fragment& f : call.fragments) {
+                    chars += f.text.size();
+                }
+                if (!options.quiet) {
+                    std::printf("%6zu %6zu %6zu %7zu %9.2f ms %7.2f ms %8.2f ms %10zu%s\n",
+                                i, call.fragments.size(), chars, call.actions.size(), result.first_audio_ms,
+                                result.total_ms, result.recorded_ms, result.bytes, result.ok ? "" : "  failed");
+                }
+                if (result.first_audio_ms >= 0.0) {
+                    first_audio.push_back(result.first_audio_ms);
+                }
+                total.push_back(result.total_ms);
+                recorded.push_back(result.recorded_ms);
+                failures += result.ok ? 0 : 1;
+            }
+        }
+    }
+
+    std::printf("%zu calls replayed, %zu failed\n", total.size(), failures);
+    summarize("first audio", first_audio);
+    summarize("total", total);
+    summarize("recorded total", recorded);
+    if (!options.timeline.empty() && !Espeak::Timeline::instance().dump(options.timeline)) {
+        std::fprintf(stderr, "cannot write %s\n", options.timeline.c_str());
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}
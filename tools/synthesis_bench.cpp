@@ -0,0 +1,499 @@
+#include "config_manager.hpp"
+#include "espeak_wrapper.h"
+#include "mock_speak_site.hpp"
+#include "speak_session.hpp"
+#include <nlohmann/json.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Speaks each checked-in corpus with its voice, directly through
+// EspeakEngine::speak and through the full Speak path against a mock site,
+// and reports real-time factor, time to first audio, callbacks, throughput
+// and peak RSS per corpus and voice as a table and optionally as JSON. The
+// site path runs once per write buffer size, and its callbacks are the
+// Write calls the site received. Corpora with lines longer than the first
+// chunk run with text chunking on and off.
+//
+// A corpus is a UTF-8 text file with one utterance per line. Lines starting
+// with '#' are comments; "# voice: ID" selects the voice.
+
+#ifndef ESPEAK_BENCH_CORPORA_DIR
+#define ESPEAK_BENCH_CORPORA_DIR "tools/corpora"
+#endif
+
+namespace {
+
+namespace fs = std::filesystem;
+using Clock = std::chrono::steady_clock;
+using json = nlohmann::ordered_json;
+
+constexpr char VOICE_DIRECTIVE[] = "# voice:";
+constexpr std::size_t BYTES_PER_SAMPLE = 2;
+
+struct Options {
+    std::string corpora = ESPEAK_BENCH_CORPORA_DIR;
+    std::vector<std::string> only;
+    std::string voice;
+    std::string json_path;
+    std::vector<int> write_buffers{0, 20, 100, 250};
+    int iterations = 3;
+    bool engine = true;
+    bool site = true;
+    bool chunked = true;
+    bool unchunked = true;
+};
+
+struct Variant {
+    bool site;
+    bool chunking;
+    int write_buffer_ms;
+};
+
+struct Corpus {
+    std::string name;
+    std::string voice;
+    std::vector<std::string> lines;
+};
+
+struct Result {
+    std::string corpus;
+    std::string voice;
+    std::string path;
+    bool chunking = true;
+    int write_buffer_ms = -1;
+    std::size_t utterances = 0;
+    double wall_ms = 0.0;
+    double audio_ms = 0.0;
+    std::vector<double> first_audio_ms;
+    std::size_t callbacks = 0;
+    std::size_t bytes = 0;
+    std::size_t failures = 0;
+    std::size_t peak_rss_kb = 0;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--corpora DIR] [--corpus NAME]... [--voice ID] [--iterations N]\n"
+                 "          [--path engine|site|both] [--chunking on|off|both] [--write-buffers MS,MS,...]\n"
+                 "          [--json FILE]\n",
+                 argv0);
+}
+
+bool parseBuffers(const char* list, std::vector<int>& buffers) {
+    buffers.clear();
+    for (const char* p = list; *p;) {
+        char* end = nullptr;
+        const long value = std::strtol(p, &end, 10);
+        if (end == p || value < 0) {
+            return false;
+        }
+        buffers.push_back(static_cast<int>(value));
+        p = *end == ',' ? end + 1 : end;
+    }
+    return !buffers.empty();
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            return false;
+        }
+        if (std::strcmp(arg, "--corpora") == 0) {
+            options.corpora = value;
+        } else if (std::strcmp(arg, "--corpus") == 0) {
+            options.only.emplace_back(value);
+        } else if (std::strcmp(arg, "--voice") == 0) {
+            options.voice = value;
+        } else if (std::strcmp(arg, "--iterations") == 0) {
+            options.iterations = std::atoi(value);
+        } else if (std::strcmp(arg, "--path") == 0) {
+            options.engine = std::strcmp(value, "site") != 0;
+            options.site = std::strcmp(value, "engine") != 0;
+        } else if (std::strcmp(arg, "--chunking") == 0) {
+            options.chunked = std::strcmp(value, "off") != 0;
+            options.unchunked = std::strcmp(value, "on") != 0;
+        } else if (std::strcmp(arg, "--write-buffers") == 0) {
+            if (!parseBuffers(value, options.write_buffers)) {
+                return false;
+            }
+        } else if (std::strcmp(arg, "--json") == 0) {
+            options.json_path = value;
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return options.iterations > 0;
+}
+
+std::size_t peakRssKb() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return 0;
+    }
+    return counters.PeakWorkingSetSize / 1024;
+#else
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+#ifdef __APPLE__
+    return static_cast<std::size_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+bool loadCorpus(const fs::path& path, Corpus& corpus) {
+    std::ifstream file{path};
+    if (!file.is_open()) {
+        return false;
+    }
+    corpus.name = path.stem().string();
+    corpus.voice.clear();
+    corpus.lines.clear();
+
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.compare(0, sizeof(VOICE_DIRECTIVE) - 1, VOICE_DIRECTIVE) == 0) {
+            const std::size_t start = line.find_first_not_of(' ', sizeof(VOICE_DIRECTIVE) - 1);
+            corpus.voice = start == std::string::npos ? std::string() : line.substr(start);
+        } else if (!line.empty() && line[0] != '#') {
+            corpus.lines.push_back(line);
+        }
+    }
+    return !corpus.lines.empty();
+}
+
+std::vector<Corpus> loadCorpora(const Options& options) {
+    std::vector<fs::path> paths;
+    std::error_code ec;
+    for (const fs::directory_entry& entry : fs::directory_iterator(options.corpora, ec)) {
+        if (entry.path().extension() == ".txt") {
+            paths.push_back(entry.path());
+        }
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<Corpus> corpora;
+    for (const fs::path& path : paths) {
+        const std::string name = path.stem().string();
+        if (!options.only.empty() && std::find(options.only.begin(), options.only.end(), name) == options.only.end()) {
+            continue;
+        }
+        Corpus corpus;
+        if (loadCorpus(path, corpus)) {
+            if (!options.voice.empty()) {
+                corpus.voice = options.voice;
+            }
+            corpora.push_back(std::move(corpus));
+        }
+    }
+    return corpora;
+}
+
+std::vector<Variant> variants(const Options& options, const Corpus& corpus, std::size_t chunk_first_chars) {
+    const bool long_lines = std::any_of(corpus.lines.begin(), corpus.lines.end(),
+                                        [&](const std::string& line) { return line.size() > chunk_first_chars; });
+    std::vector<Variant> list;
+    for (const bool chunking : {true, false}) {
+        // With every line inside the first chunk, nothing would be split.
+        if (chunking ? !options.chunked : (!options.unchunked || (options.chunked && !long_lines))) {
+            continue;
+        }
+        if (options.engine) {
+            list.push_back({false, chunking, -1});
+        }
+        if (options.site) {
+            for (const int buffer_ms : options.write_buffers) {
+                list.push_back({true, chunking, buffer_ms});
+            }
+        }
+    }
+    return list;
+}
+
+std::u16string utf8ToUtf16(const std::string& text) {
+    std::u16string out;
+    for (std::size_t i = 0; i < text.size();) {
+        const unsigned char lead = static_cast<unsigned char>(text[i]);
+        char32_t code_point = lead;
+        std::size_t extra = 0;
+        if (lead >= 0xF0) {
+            code_point = lead & 0x07;
+            extra = 3;
+        } else if (lead >= 0xE0) {
+            code_point = lead & 0x0F;
+            extra = 2;
+        } else if (lead >= 0xC0) {
+            code_point = lead & 0x1F;
+            extra = 1;
+        }
+        ++i;
+        for (; extra > 0 && i < text.size(); --extra, ++i) {
+            code_point = (code_point << 6) | (static_cast<unsigned char>(text[i]) & 0x3F);
+        }
+        if (code_point >= 0x10000) {
+            code_point -= 0x10000;
+            out.push_back(static_cast<char16_t>(0xD800 + (code_point >> 10)));
+            out.push_back(static_cast<char16_t>(0xDC00 + (code_point & 0x3FF)));
+        } else {
+            out.push_back(static_cast<char16_t>(code_point));
+        }
+    }
+    return out;
+}
+
+double elapsedMs(Clock::time_point from, Clock::time_point to) {
+    return std::chrono::duration<double, std::milli>(to - from).count();
+}
+
+void speakEngine(Espeak::EspeakEngine& engine, const Corpus& corpus, const std::string& line, Result& result) {
+    std::size_t samples = 0;
+    std::size_t callbacks = 0;
+    Clock::time_point first_audio;
+
+    const Clock::time_point started = Clock::now();
+    const bool ok = engine.speak(line, 0, 50, 100, 50, 0, false,
+        [&](const short*, int sample_count, void*) {
+            if (callbacks++ == 0) {
+                first_audio = Clock::now();
+            }
+            samples += static_cast<std::size_t>(sample_count);
+            return true;
+        },
+        nullptr, nullptr, Espeak::TextFormat::Plain, nullptr, corpus.voice);
+    const Clock::time_point finished = Clock::now();
+
+    result.wall_ms += elapsedMs(started, finished);
+    result.audio_ms += 1000.0 * static_cast<double>(samples) / engine.sampleRate();
+    result.callbacks += callbacks;
+    result.bytes += samples * BYTES_PER_SAMPLE;
+    result.failures += ok ? 0 : 1;
+    if (callbacks > 0) {
+        result.first_audio_ms.push_back(elapsedMs(started, first_audio));
+    }
+}
+
+void speakSite(Espeak::sapi::speak_session& session, const Espeak::config::Configuration& cfg,
+               const Corpus& corpus, const std::string& line, Result& result) {
+    using namespace Espeak::sapi;
+
+    const std::u16string text = utf8ToUtf16(line);
+    speak_fragment fragment;
+    fragment.kind = fragment_kind::speak;
+    fragment.text = text;
+
+    speak_options options;
+    options.format = native_format();
+    options.voice = corpus.voice;
+    options.word_events = true;
+    options.sentence_events = true;
+
+    mock_speak_site site;
+    Clock::time_point first_audio;
+    site.on_write = [&](mock_speak_site& s, std::size_t) {
+        if (s.write_calls() == 1) {
+            first_audio = Clock::now();
+        }
+    };
+
+    const Clock::time_point started = Clock::now();
+    const bool ok = session.speak(site, {fragment}, options, cfg);
+    const Clock::time_point finished = Clock::now();
+
+    result.wall_ms += elapsedMs(started, finished);
+    result.audio_ms += 1000.0 * static_cast<double>(site.audio().size()) /
+                       (static_cast<double>(options.format.sample_rate) * BYTES_PER_SAMPLE);
+    result.callbacks += site.write_calls();
+    result.bytes += site.audio().size();
+    result.failures += ok ? 0 : 1;
+    if (site.write_calls() > 0) {
+        result.first_audio_ms.push_back(elapsedMs(started, first_audio));
+    }
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const std::size_t index = static_cast<std::size_t>(p * static_cast<double>(values.size() - 1) + 0.5);
+    return values[index];
+}
+
+double mean(const std::vector<double>& values) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    double sum = 0.0;
+    for (const double v : values) {
+        sum += v;
+    }
+    return sum / static_cast<double>(values.size());
+}
+
+double realTimeFactor(const Result& r) {
+    return r.audio_ms > 0.0 ? r.wall_ms / r.audio_ms : 0.0;
+}
+
+double bytesPerSecond(const Result& r) {
+    return r.wall_ms > 0.0 ? static_cast<double>(r.bytes) * 1000.0 / r.wall_ms : 0.0;
+}
+
+double callbacksPerAudioSecond(const Result& r) {
+    return r.audio_ms > 0.0 ? static_cast<double>(r.callbacks) * 1000.0 / r.audio_ms : 0.0;
+}
+
+std::string bufferLabel(const Result& r) {
+    return r.write_buffer_ms < 0 ? "-" : std::to_string(r.write_buffer_ms);
+}
+
+void printTable(const std::vector<Result>& results) {
+    std::printf("%-13s %-6s %-6s %5s %6s %5s %8s %10s %9s %9s %9s %9s %7s %11s %9s\n",
+                "corpus", "voice", "path", "chunk", "buffer", "utt", "rtf", "audio ms", "ttfa p50", "ttfa p95",
+                "ttfa p99", "callbacks", "per s", "bytes/s", "peak KB");
+    for (const Result& r : results) {
+        std::printf("%-13s %-6s %-6s %5s %6s %5zu %8.4f %10.1f %9.2f %9.2f %9.2f %9zu %7.1f %11.0f %9zu%s\n",
+                    r.corpus.c_str(), r.voice.empty() ? "-" : r.voice.c_str(), r.path.c_str(),
+                    r.chunking ? "on" : "off", bufferLabel(r).c_str(), r.utterances, realTimeFactor(r), r.audio_ms,
+                    percentile(r.first_audio_ms, 0.50), percentile(r.first_audio_ms, 0.95),
+                    percentile(r.first_audio_ms, 0.99), r.callbacks, callbacksPerAudioSecond(r), bytesPerSecond(r),
+                    r.peak_rss_kb, r.failures ? "  (failures)" : "");
+    }
+}
+
+json toJson(const std::vector<Result>& results, const Options& options, int sample_rate) {
+    json j;
+    j["sample_rate"] = sample_rate;
+    j["iterations"] = options.iterations;
+    json rows = json::array();
+    for (const Result& r : results) {
+        json row;
+        row["corpus"] = r.corpus;
+        row["voice"] = r.voice;
+        row["path"] = r.path;
+        row["chunking"] = r.chunking;
+        if (r.write_buffer_ms >= 0) {
+            row["write_buffer_ms"] = r.write_buffer_ms;
+        }
+        row["utterances"] = r.utterances;
+        row["failures"] = r.failures;
+        row["wall_ms"] = r.wall_ms;
+        row["audio_ms"] = r.audio_ms;
+        row["real_time_factor"] = realTimeFactor(r);
+        row["first_audio_ms_mean"] = mean(r.first_audio_ms);
+        row["first_audio_ms_p50"] = percentile(r.first_audio_ms, 0.50);
+        row["first_audio_ms_p95"] = percentile(r.first_audio_ms, 0.95);
+        row["first_audio_ms_p99"] = percentile(r.first_audio_ms, 0.99);
+        row["callbacks"] = r.callbacks;
+        row["callbacks_per_audio_second"] = callbacksPerAudioSecond(r);
+        row["bytes"] = r.bytes;
+        row["bytes_per_second"] = bytesPerSecond(r);
+        row["peak_rss_kb"] = r.peak_rss_kb;
+        rows.push_back(std::move(row));
+    }
+    j["results"] = std::move(rows);
+    return j;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const std::vector<Corpus> corpora = loadCorpora(options);
+    if (corpora.empty()) {
+        std::fprintf(stderr, "no corpora found in %s\n", options.corpora.c_str());
+        return 1;
+    }
+
+    Espeak::EspeakEngine& engine = Espeak::EspeakEngine::getInstance();
+    if (!engine.initialize()) {
+        std::fprintf(stderr, "espeak-ng failed to initialize\n");
+        return 1;
+    }
+
+    // Measure synthesis, not the caches: every utterance is synthesized.
+    Espeak::config::Configuration cfg = Espeak::config::ConfigManager::createDefaultConfig();
+    cfg.audio_cache_mb = 0;
+    cfg.character_table_mb = 0;
+    Espeak::sapi::speak_session session;
+    const int chunk_first_chars = cfg.chunk_first_chars;
+    const int write_buffer_ms = cfg.write_buffer_ms;
+
+    std::vector<Result> results;
+    for (const Corpus& corpus : corpora) {
+        for (const Variant& variant : variants(options, corpus, static_cast<std::size_t>(chunk_first_chars))) {
+            engine.configureCache(0, false);
+            cfg.chunk_first_chars = variant.chunking ? chunk_first_chars : 0;
+            cfg.write_buffer_ms = variant.site ? variant.write_buffer_ms : write_buffer_ms;
+            engine.configureChunking(static_cast<std::size_t>(cfg.chunk_first_chars),
+                                     static_cast<std::size_t>(cfg.chunk_max_chars));
+
+            // Untimed pass so the voice load does not count as time to first audio.
+            Result warmup;
+            if (variant.site) {
+                speakSite(session, cfg, corpus, corpus.lines.front(), warmup);
+            } else {
+                speakEngine(engine, corpus, corpus.lines.front(), warmup);
+            }
+
+            Result result;
+            result.corpus = corpus.name;
+            result.voice = corpus.voice;
+            result.path = variant.site ? "site" : "engine";
+            result.chunking = variant.chunking;
+            result.write_buffer_ms = variant.write_buffer_ms;
+            for (int i = 0; i < options.iterations; ++i) {
+                for (const std::string& line : corpus.lines) {
+                    if (variant.site) {
+                        speakSite(session, cfg, corpus, line, result);
+                    } else {
+                        speakEngine(engine, corpus, line, result);
+                    }
+                    ++result.utterances;
+                }
+            }
+            result.peak_rss_kb = peakRssKb();
+            results.push_back(std::move(result));
+        }
+    }
+
+    std::printf("%zu corpora x %d iterations, %d Hz; peak RSS is the process peak after each row\n",
+                corpora.size(), options.iterations, engine.sampleRate());
+    printTable(results);
+
+    if (!options.json_path.empty()) {
+        std::ofstream file{fs::path(options.json_path)};
+        if (!file.is_open()) {
+            std::fprintf(stderr, "cannot write %s\n", options.json_path.c_str());
+            return 1;
+        }
+        file << toJson(results, options, engine.sampleRate()).dump(2) << '\n';
+    }
+    return 0;
+}
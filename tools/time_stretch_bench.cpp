@@ -0,0 +1,123 @@
+#include "espeak_wrapper.h"
+#include "time_stretcher.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Synthesizes a paragraph once, then streams it through the time stretcher at
+// several speeds in synthesis-sized blocks and reports the CPU cost per second
+// of input audio and the achieved output/input duration ratio.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const SAMPLE_TEXT =
+    "Screen reader users often listen at two or three times the normal speaking rate. "
+    "Changing the rate while a long paragraph is being read should take effect right away, "
+    "without waiting for the next sentence and without turning the voice into a chipmunk.";
+
+struct Options {
+    std::vector<double> speeds{0.5, 1.0, 2.0, 4.0};
+    int block_ms = 20;
+    int iterations = 20;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s [--speeds X,X,...] [--block MS] [--iterations N]\n", argv0);
+}
+
+bool parseSpeeds(const char* list, std::vector<double>& speeds) {
+    speeds.clear();
+    for (const char* p = list; *p;) {
+        char* end = nullptr;
+        const double value = std::strtod(p, &end);
+        if (end == p || value <= 0.0) {
+            return false;
+        }
+        speeds.push_back(value);
+        p = *end == ',' ? end + 1 : end;
+    }
+    return !speeds.empty();
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--speeds") == 0 && i + 1 < argc) {
+            if (!parseSpeeds(argv[++i], options.speeds)) {
+                return false;
+            }
+        } else if (std::strcmp(argv[i], "--block") == 0 && i + 1 < argc) {
+            options.block_ms = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = std::atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return options.block_ms > 0 && options.iterations > 0;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    Espeak::EspeakEngine& engine = Espeak::EspeakEngine::getInstance();
+    if (!engine.initialize()) {
+        std::fprintf(stderr, "espeak-ng failed to initialize\n");
+        return 1;
+    }
+    engine.configureCache(0, false);
+
+    std::vector<short> speech;
+    [[maybe_unused]] const bool ok = engine.speak(SAMPLE_TEXT, 0, 50, 100, 50, 0, false,
+        [&](const short* audio, int sample_count, void*) {
+            speech.insert(speech.end(), audio, audio + sample_count);
+            return true;
+        },
+        nullptr);
+    if (speech.empty()) {
+        std::fprintf(stderr, "synthesis produced no audio\n");
+        return 1;
+    }
+
+    const int sample_rate = engine.sampleRate();
+    const double input_seconds = static_cast<double>(speech.size()) / sample_rate;
+    const std::size_t block = static_cast<std::size_t>(sample_rate) * static_cast<std::size_t>(options.block_ms) / 1000;
+    std::printf("%.2f s of speech at %d Hz, %d ms blocks, %d iterations\n",
+                input_seconds, sample_rate, options.block_ms, options.iterations);
+    std::printf("%6s %14s %12s %10s\n", "speed", "cpu ms/audio s", "realtime x", "out/in");
+
+    Espeak::TimeStretcher stretcher(sample_rate);
+    std::vector<short> out;
+    for (const double speed : options.speeds) {
+        std::size_t produced = 0;
+        const Clock::time_point started = Clock::now();
+        for (int i = 0; i < options.iterations; ++i) {
+            stretcher.reset();
+            stretcher.setSpeed(speed);
+            produced = 0;
+            for (std::size_t offset = 0; offset < speech.size(); offset += block) {
+                out.clear();
+                stretcher.process(speech.data() + offset, (std::min)(block, speech.size() - offset), out);
+                produced += out.size();
+            }
+            out.clear();
+            stretcher.flush(out);
+            produced += out.size();
+        }
+        const double elapsed_ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+        const double cost = elapsed_ms / (input_seconds * options.iterations);
+        std::printf("%6.2f %14.3f %12.0f %10.3f\n", stretcher.speed(), cost, cost > 0.0 ? 1000.0 / cost : 0.0,
+                    static_cast<double>(produced) / static_cast<double>(speech.size()));
+    }
+    return 0;
+}
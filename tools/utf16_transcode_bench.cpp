@@ -0,0 +1,137 @@
+#include "utf16_transcoder.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+namespace {
+
+struct Corpus {
+    const char* name;
+    const char16_t* sample;
+};
+
+const Corpus CORPORA[] = {
+    {"ascii", u"The quick brown fox jumps over the lazy dog. Screen readers speak a lot of plain text, "
+              u"so the common case has to be fast. "},
+    {"cyrillic", u"Съешь же ещё этих "
+                 u"мягких французских "
+                 u"булок, да выпей чаю. "},
+    {"cjk", u"我能吞下玻璃而不伤身体。"
+            u"いろはにほへとちりぬるを。"},
+};
+
+struct Options {
+    std::size_t length = 4096;
+    std::size_t iterations = 20000;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s [--length UNITS] [--iterations N]\n", argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--length") == 0 && i + 1 < argc) {
+            options.length = std::strtoul(argv[++i], nullptr, 10);
+        } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return options.length > 0 && options.iterations > 0;
+}
+
+std::u16string buildText(const Corpus& corpus, std::size_t length) {
+    const std::u16string sample(corpus.sample);
+    std::u16string text;
+    while (text.size() < length) {
+        text += sample;
+    }
+    text.resize(length);
+    return text;
+}
+
+template<typename Fn>
+double unitsPerNs(const std::u16string& text, std::size_t iterations, Fn fn) {
+    const auto started = std::chrono::steady_clock::now();
+    for (std::size_t i = 0; i < iterations; ++i) {
+        fn(text);
+    }
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+    return static_cast<double>(text.size() * iterations) / ns;
+}
+
+#ifdef _WIN32
+void wideCharToMultiByte(const std::u16string& text, std::string& out) {
+    const auto* wide = reinterpret_cast<const wchar_t*>(text.data());
+    const int size = WideCharToMultiByte(CP_UTF8, 0, wide, static_cast<int>(text.size()), nullptr, 0, nullptr, nullptr);
+    out.assign(static_cast<std::size_t>(size), '\0');
+    WideCharToMultiByte(CP_UTF8, 0, wide, static_cast<int>(text.size()), out.data(), size, nullptr, nullptr);
+}
+#endif
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    std::printf("kernel: %s, %zu units x %zu iterations (units/ns)\n",
+                Espeak::utf16TranscoderKernel(), options.length, options.iterations);
+    std::printf("%-10s %10s %10s %10s\n", "corpus", "scalar", "vector", "win32");
+
+    int failures = 0;
+    for (const Corpus& corpus : CORPORA) {
+        const std::u16string text = buildText(corpus, options.length);
+
+        std::string expected;
+        std::string actual;
+        Espeak::utf16ToUtf8Scalar(text, expected);
+        Espeak::utf16ToUtf8(text, actual);
+        if (actual != expected) {
+            std::fprintf(stderr, "%s: vector output differs from scalar output\n", corpus.name);
+            ++failures;
+        }
+
+        std::string out;
+        const double scalar = unitsPerNs(text, options.iterations,
+            [&](const std::u16string& in) { Espeak::utf16ToUtf8Scalar(in, out); });
+        const double vector = unitsPerNs(text, options.iterations,
+            [&](const std::u16string& in) { Espeak::utf16ToUtf8(in, out); });
+#ifdef _WIN32
+        const double win32 = unitsPerNs(text, options.iterations,
+            [&](const std::u16string& in) { wideCharToMultiByte(in, out); });
+        std::printf("%-10s %10.3f %10.3f %10.3f\n", corpus.name, scalar, vector, win32);
+#else
+        std::printf("%-10s %10.3f %10.3f %10s\n", corpus.name, scalar, vector, "-");
+#endif
+    }
+
+    const std::u16string padding(15, u'a');
+    const std::u16string edge_cases[] = {
+        padding + u"\U0001F600 emoji straddling a block",
+        padding + std::u16string(1, u'\xD800') + u"lone high surrogate",
+        padding + u"b" + std::u16string(1, u'\xDC00') + u"lone low surrogate",
+    };
+    for (const std::u16string& text : edge_cases) {
+        std::string expected;
+        std::string actual;
+        Espeak::utf16ToUtf8Scalar(text, expected);
+        Espeak::utf16ToUtf8(text, actual);
+        if (actual != expected || !Espeak::containsSurrogates(text)) {
+            std::fprintf(stderr, "surrogate edge case mismatch\n");
+            ++failures;
+        }
+    }
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+#include "voice_catalog.hpp"
+#include "utils.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+struct Options {
+    bool cold = false;
+    std::size_t iterations = 100;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s [--cold] [--iterations N]\n", argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--cold") == 0) {
+            options.cold = true;
+        } else if (std::strcmp(argv[i], "--iterations") == 0 && i + 1 < argc) {
+            options.iterations = std::strtoul(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return options.iterations > 0;
+}
+
+template<typename Fn>
+double timeMs(Fn fn) {
+    const auto started = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - started).count();
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    const std::filesystem::path catalog_path = Espeak::VoiceCatalog::cachePath();
+    if (options.cold && !catalog_path.empty()) {
+        std::error_code ec;
+        std::filesystem::remove(catalog_path, ec);
+    }
+
+    Espeak::VoiceCatalog& catalog = Espeak::VoiceCatalog::getInstance();
+    std::size_t voice_count = 0;
+
+    const double fingerprint_ms = timeMs([&]() {
+        [[maybe_unused]] const std::string print =
+            Espeak::VoiceCatalog::fingerprint(Espeak::utils::getEspeakDataDir());
+    });
+    const double first_ms = timeMs([&]() {
+        voice_count = catalog.voices(nullptr).size();
+    });
+
+    double memory_ms = 0.0;
+    double disk_ms = 0.0;
+    for (std::size_t i = 0; i < options.iterations; ++i) {
+        memory_ms += timeMs([&]() { [[maybe_unused]] const auto voices = catalog.voices(nullptr); });
+        catalog.invalidate();
+        disk_ms += timeMs([&]() { [[maybe_unused]] const auto voices = catalog.voices(nullptr); });
+    }
+
+    const Espeak::VoiceCatalog::Stats stats = catalog.stats();
+    std::printf("catalog: %s (%s start)\n", catalog_path.u8string().c_str(), options.cold ? "cold" : "warm");
+    std::printf("voices: %zu\n", voice_count);
+    std::printf("first lookup:      %9.3f ms\n", first_ms);
+    std::printf("fingerprint:       %9.3f ms\n", fingerprint_ms);
+    std::printf("revalidated lookup:%9.3f ms avg\n", disk_ms / static_cast<double>(options.iterations));
+    std::printf("memo lookup:       %9.3f ms avg\n", memory_ms / static_cast<double>(options.iterations));
+    std::printf("memory hits %llu, disk hits %llu, rebuilds %llu\n",
+                static_cast<unsigned long long>(stats.memory_hits), static_cast<unsigned long long>(stats.disk_hits),
+                static_cast<unsigned long long>(stats.rebuilds));
+    return 0;
+}
@@ -0,0 +1,130 @@
+#include "espeak_wrapper.h"
+#include "perf_counters.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// Interleaves two voices the way a screen reader does when one engine
+// instance reads a document and another announces controls: a reading
+// sentence in the first voice, then a short, often repeated announcement in
+// the second. Reports the mean speak() time of each voice and how many voice
+// loads espeak-ng did, with the audio cache on and off.
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const char* const READING[] = {
+    "The committee met on Tuesday to discuss the budget for the coming year.",
+    "Several members raised concerns about the cost of the new building.",
+    "After a long debate the proposal was sent back for another review.",
+    "The chair thanked everyone for their patience and closed the meeting.",
+    "Minutes of the session will be published on the website next week.",
+};
+
+const char* const ANNOUNCEMENTS[] = {
+    "button", "link", "heading level 2", "edit text", "checkbox not checked", "list with 5 items",
+};
+
+struct Options {
+    std::string reading_voice = "en";
+    std::string announce_voice = "de";
+    int rounds = 60;
+    std::vector<int> cache_mb{0, 8};
+};
+
+struct Run {
+    double reading_ms = 0.0;
+    double announce_ms = 0.0;
+    std::uint64_t switches = 0;
+    int failures = 0;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr, "usage: %s [--voices READ,ANNOUNCE] [--rounds N] [--cache-mb N,...]\n", argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            return false;
+        }
+        if (std::strcmp(arg, "--voices") == 0) {
+            const char* comma = std::strchr(value, ',');
+            if (!comma) {
+                return false;
+            }
+            options.reading_voice.assign(value, comma);
+            options.announce_voice = comma + 1;
+        } else if (std::strcmp(arg, "--rounds") == 0) {
+            options.rounds = std::atoi(value);
+        } else if (std::strcmp(arg, "--cache-mb") == 0) {
+            options.cache_mb.clear();
+            for (const char* p = value; *p;) {
+                options.cache_mb.push_back(std::atoi(p));
+                const char* next = std::strchr(p, ',');
+                p = next ? next + 1 : p + std::strlen(p);
+            }
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return options.rounds > 0 && !options.cache_mb.empty();
+}
+
+double speakTimed(Espeak::EspeakEngine& engine, const char* text, const std::string& voice, Run& run) {
+    const Clock::time_point started = Clock::now();
+    const bool ok = engine.speak(std::string(text), 0, 50, 100, 50, 0, false,
+                                 [](const short*, int, void*) { return true; }, nullptr, nullptr,
+                                 Espeak::TextFormat::Plain, nullptr, voice);
+    run.failures += ok ? 0 : 1;
+    return std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+}
+
+Run runRounds(Espeak::EspeakEngine& engine, const Options& options) {
+    constexpr int reading_count = sizeof(READING) / sizeof(READING[0]);
+    constexpr int announce_count = sizeof(ANNOUNCEMENTS) / sizeof(ANNOUNCEMENTS[0]);
+
+    Espeak::PerfCounters& perf = Espeak::PerfCounters::local();
+    const std::uint64_t switches = perf.get(Espeak::PerfCounter::VoiceSwitches);
+    Run run;
+    for (int i = 0; i < options.rounds; ++i) {
+        run.reading_ms += speakTimed(engine, READING[i % reading_count], options.reading_voice, run);
+        run.announce_ms += speakTimed(engine, ANNOUNCEMENTS[i % announce_count], options.announce_voice, run);
+    }
+    run.switches = perf.get(Espeak::PerfCounter::VoiceSwitches) - switches;
+    return run;
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    Espeak::EspeakEngine& engine = Espeak::EspeakEngine::getInstance();
+    if (!engine.initialize()) {
+        std::fprintf(stderr, "espeak-ng failed to initialize\n");
+        return 1;
+    }
+
+    std::printf("%s reading, %s announcing, %d rounds\n",
+                options.reading_voice.c_str(), options.announce_voice.c_str(), options.rounds);
+    std::printf("%8s %12s %13s %14s\n", "cache MB", "read avg ms", "announce avg", "voice switches");
+    for (const int cache_mb : options.cache_mb) {
+        engine.configureCache(static_cast<std::size_t>(cache_mb) * 1024 * 1024, false);
+        const Run run = runRounds(engine, options);
+        std::printf("%8d %12.2f %13.2f %14llu%s\n", cache_mb, run.reading_ms / options.rounds,
+                    run.announce_ms / options.rounds, static_cast<unsigned long long>(run.switches),
+                    run.failures ? "  (failures)" : "");
+    }
+    return 0;
+}
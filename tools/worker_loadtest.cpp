@@ -0,0 +1,160 @@
+#include "worker_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr char DEFAULT_TEXT[] =
+    "The quick brown fox jumps over the lazy dog. Pack my box with five dozen liquor jugs.";
+
+struct Options {
+    std::filesystem::path worker_path = Espeak::WorkerPool::defaultWorkerPath();
+    std::size_t workers = 4;
+    std::size_t clients = 4;
+    std::size_t requests = 32;
+    std::vector<std::string> voices{"en"};
+    std::string text = DEFAULT_TEXT;
+};
+
+void usage(const char* argv0) {
+    std::fprintf(stderr,
+                 "usage: %s [--worker PATH] [--workers N] [--clients N] [--requests N]\n"
+                 "          [--voice ID[,ID...]] [--text TEXT]\n", argv0);
+}
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) {
+            return false;
+        }
+        if (std::strcmp(arg, "--worker") == 0) {
+            options.worker_path = value;
+        } else if (std::strcmp(arg, "--workers") == 0) {
+            options.workers = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--clients") == 0) {
+            options.clients = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--requests") == 0) {
+            options.requests = std::strtoul(value, nullptr, 10);
+        } else if (std::strcmp(arg, "--voice") == 0) {
+            options.voices.clear();
+            for (const char* p = value; *p;) {
+                const char* comma = std::strchr(p, ',');
+                const std::size_t length = comma ? static_cast<std::size_t>(comma - p) : std::strlen(p);
+                options.voices.emplace_back(p, length);
+                p += comma ? length + 1 : length;
+            }
+        } else if (std::strcmp(arg, "--text") == 0) {
+            options.text = value;
+        } else {
+            return false;
+        }
+        ++i;
+    }
+    return options.workers > 0 && options.clients > 0 && !options.voices.empty();
+}
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const std::size_t index = static_cast<std::size_t>(p * static_cast<double>(values.size() - 1));
+    return values[index];
+}
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    using clock = std::chrono::steady_clock;
+
+    Espeak::WorkerPool pool(options.worker_path, options.workers);
+    std::atomic<std::size_t> next_request(0);
+    std::atomic<std::size_t> failures(0);
+    std::atomic<std::uint64_t> total_samples(0);
+    std::mutex latency_mutex;
+    std::vector<double> first_audio_ms;
+    std::vector<double> total_ms;
+
+    const auto started = clock::now();
+    std::vector<std::thread> clients;
+    for (std::size_t c = 0; c < options.clients; ++c) {
+        // Each client sticks to one voice, like a reader and a navigator voice sharing the pool.
+        const std::string& voice = options.voices[c % options.voices.size()];
+        clients.emplace_back([&, voice]() {
+            while (next_request.fetch_add(1) < options.requests) {
+                Espeak::SpeakRequest request{0, voice, 0, 50, 100, 50, 0, false, options.text, false, false};
+                const auto request_start = clock::now();
+                clock::time_point first_audio;
+                bool got_audio = false;
+                std::uint64_t samples = 0;
+
+                const auto result = pool.speak(request,
+                    [&](const short*, int sample_count) {
+                        if (!got_audio) {
+                            first_audio = clock::now();
+                            got_audio = true;
+                        }
+                        samples += static_cast<std::uint64_t>(sample_count);
+                        return true;
+                    },
+                    nullptr);
+
+                const auto request_end = clock::now();
+                if (result != Espeak::WorkerPool::Result::Ok) {
+                    failures.fetch_add(1);
+                    if (result == Espeak::WorkerPool::Result::Unavailable) {
+                        return;
+                    }
+                    continue;
+                }
+
+                total_samples.fetch_add(samples);
+                std::lock_guard<std::mutex> lock(latency_mutex);
+                total_ms.push_back(std::chrono::duration<double, std::milli>(request_end - request_start).count());
+                if (got_audio) {
+                    first_audio_ms.push_back(
+                        std::chrono::duration<double, std::milli>(first_audio - request_start).count());
+                }
+            }
+        });
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    const double elapsed_s = std::chrono::duration<double>(clock::now() - started).count();
+
+    const Espeak::WorkerPool::Stats stats = pool.stats();
+    const int sample_rate = pool.sampleRate();
+    const double audio_s = sample_rate > 0 ? static_cast<double>(total_samples.load()) / sample_rate : 0.0;
+
+    std::printf("workers=%zu clients=%zu requests=%zu failures=%zu\n",
+                options.workers, options.clients, options.requests, failures.load());
+    std::printf("elapsed %.3f s, %.1f requests/s, %.1fx realtime\n",
+                elapsed_s, static_cast<double>(total_ms.size()) / elapsed_s,
+                elapsed_s > 0.0 ? audio_s / elapsed_s : 0.0);
+    std::printf("first audio ms: p50 %.2f p95 %.2f max %.2f\n",
+                percentile(first_audio_ms, 0.50), percentile(first_audio_ms, 0.95), percentile(first_audio_ms, 1.0));
+    std::printf("request ms:     p50 %.2f p95 %.2f max %.2f\n",
+                percentile(total_ms, 0.50), percentile(total_ms, 0.95), percentile(total_ms, 1.0));
+    std::printf("pool: %llu requests, %llu spawns, %llu failures, %llu waits, %llu voice hits\n",
+                static_cast<unsigned long long>(stats.requests), static_cast<unsigned long long>(stats.spawns),
+                static_cast<unsigned long long>(stats.failures), static_cast<unsigned long long>(stats.waits),
+                static_cast<unsigned long long>(stats.voice_hits));
+
+    return failures.load() == 0 ? 0 : 1;
+}